@@ -0,0 +1,132 @@
+#include "admission.h"
+
+#include <netinet/in.h>
+#include <stdlib.h>
+#include <string.h>
+
+void admission_init(Admission *adm, unsigned depth, unsigned per_client, unsigned workers) {
+    memset(adm, 0, sizeof(*adm));
+    pthread_mutex_init(&adm->lock, NULL);
+    adm->depth = depth;
+    adm->per_client = per_client;
+    adm->workers = workers ? workers : 1;
+}
+
+void admission_free(Admission *adm) {
+    for (size_t b = 0; b < ADMISSION_BUCKETS; ++b) {
+        for (AdmissionClient *c = adm->buckets[b], *next; c; c = next) {
+            next = c->chain;
+            free(c);
+        }
+    }
+    pthread_mutex_destroy(&adm->lock);
+}
+
+// Endereço em 16 bytes: IPv4 vira ::ffff:a.b.c.d, para as duas famílias dividirem a tabela
+static void client_key(const struct sockaddr *addr, unsigned char key[16]) {
+    memset(key, 0, 16);
+    if (addr && addr->sa_family == AF_INET) {
+        key[10] = key[11] = 0xff;
+        memcpy(key + 12, &((const struct sockaddr_in *)(const void *)addr)->sin_addr, 4);
+    } else if (addr && addr->sa_family == AF_INET6) {
+        memcpy(key, &((const struct sockaddr_in6 *)(const void *)addr)->sin6_addr, 16);
+    }
+}
+
+// FNV-1a dos 16 bytes
+static AdmissionClient **bucket(Admission *adm, const unsigned char key[16]) {
+    uint32_t h = 2166136261u;
+    for (int i = 0; i < 16; ++i)
+        h = (h ^ key[i]) * 16777619u;
+    return &adm->buckets[h & (ADMISSION_BUCKETS - 1)];
+}
+
+// Entrada do cliente na trava; criada com zero requisições se ainda não existe
+static AdmissionClient *client_find(Admission *adm, const unsigned char key[16]) {
+    AdmissionClient **head = bucket(adm, key);
+    for (AdmissionClient *c = *head; c; c = c->chain)
+        if (memcmp(c->addr, key, 16) == 0)
+            return c;
+    AdmissionClient *c = calloc(1, sizeof(*c));
+    if (!c)
+        return NULL;
+    memcpy(c->addr, key, 16);
+    c->chain = *head;
+    *head = c;
+    return c;
+}
+
+static void client_drop(Admission *adm, AdmissionClient *client) {
+    for (AdmissionClient **p = bucket(adm, client->addr); *p; p = &(*p)->chain) {
+        if (*p == client) {
+            *p = client->chain;
+            free(client);
+            return;
+        }
+    }
+}
+
+AdmissionVerdict admission_enter(Admission *adm, const struct sockaddr *addr, uint64_t now_ns,
+                                 AdmissionTicket *ticket) {
+    memset(ticket, 0, sizeof(*ticket));
+    unsigned char key[16];
+    if (adm->per_client)
+        client_key(addr, key);
+
+    pthread_mutex_lock(&adm->lock);
+    if (adm->depth && adm->pending >= adm->depth) {
+        pthread_mutex_unlock(&adm->lock);
+        atomic_fetch_add_explicit(&adm->rejected_full, 1, memory_order_relaxed);
+        return ADMIT_FULL;
+    }
+    // Sem memória para a entrada do cliente, a requisição passa sem o limite por cliente
+    AdmissionClient *client = adm->per_client ? client_find(adm, key) : NULL;
+    if (client && client->active >= adm->per_client) {
+        pthread_mutex_unlock(&adm->lock);
+        atomic_fetch_add_explicit(&adm->rejected_client, 1, memory_order_relaxed);
+        return ADMIT_CLIENT;
+    }
+    if (client)
+        client->active++;
+    adm->pending++;
+    pthread_mutex_unlock(&adm->lock);
+
+    ticket->client = client;
+    ticket->entered_ns = now_ns;
+    ticket->held = true;
+    return ADMIT_OK;
+}
+
+void admission_leave(Admission *adm, AdmissionTicket *ticket, uint64_t now_ns) {
+    if (!ticket->held)
+        return;
+    uint64_t ns = now_ns > ticket->entered_ns ? now_ns - ticket->entered_ns : 0;
+    pthread_mutex_lock(&adm->lock);
+    adm->pending--;
+    if (ticket->client && --ticket->client->active == 0)
+        client_drop(adm, ticket->client);
+    // Média móvel exponencial com peso 1/8 para a vaga mais recente
+    adm->service_ns = adm->service_ns ? adm->service_ns - adm->service_ns / 8 + ns / 8 : ns;
+    pthread_mutex_unlock(&adm->lock);
+    memset(ticket, 0, sizeof(*ticket));
+}
+
+unsigned admission_retry_after(Admission *adm, AdmissionVerdict verdict) {
+    pthread_mutex_lock(&adm->lock);
+    double service = (double)adm->service_ns / 1e9;
+    double wait = verdict == ADMIT_FULL ? service * adm->pending / adm->workers : service;
+    pthread_mutex_unlock(&adm->lock);
+    if (wait >= ADMISSION_MAX_RETRY)
+        return ADMISSION_MAX_RETRY;
+    unsigned seconds = (unsigned)wait;
+    if (seconds < wait)
+        ++seconds;
+    return seconds ? seconds : 1;
+}
+
+unsigned admission_pending(Admission *adm) {
+    pthread_mutex_lock(&adm->lock);
+    unsigned pending = adm->pending;
+    pthread_mutex_unlock(&adm->lock);
+    return pending;
+}
@@ -0,0 +1,74 @@
+#ifndef FLIR2JSON_ADMISSION_H
+#define FLIR2JSON_ADMISSION_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/socket.h>
+
+// Controle de admissão das requisições com corpo (POST /extract, /render, /metadata,
+// /extract/batch e /jobs). Cada uma ocupa uma vaga do recebimento do corpo até o fim
+// do envio da resposta. A decisão é tomada só com os cabeçalhos, antes de ler qualquer
+// byte do corpo: com todas as vagas ocupadas, ou com o cliente (endereço IP) já no seu
+// limite de requisições simultâneas, a requisição é recusada na hora com um
+// Retry-After estimado pelo tempo médio de serviço, em vez de esperar numa fila sem fim.
+
+// Baldes da tabela de clientes (potência de 2)
+#define ADMISSION_BUCKETS 1024
+
+// Maior Retry-After sugerido, em segundos
+#define ADMISSION_MAX_RETRY 60
+
+// Requisições simultâneas de um endereço; a entrada some quando chega a zero
+typedef struct AdmissionClient {
+    unsigned char addr[16]; // IPv6, ou IPv4 mapeado (::ffff:a.b.c.d)
+    unsigned active;
+    struct AdmissionClient *chain;
+} AdmissionClient;
+
+typedef enum {
+    ADMIT_OK,
+    ADMIT_FULL,   // todas as vagas ocupadas (503)
+    ADMIT_CLIENT  // cliente no limite de requisições simultâneas (429)
+} AdmissionVerdict;
+
+// Vaga de uma requisição admitida, devolvida com admission_leave
+typedef struct {
+    AdmissionClient *client; // NULL sem limite por cliente
+    uint64_t entered_ns;
+    bool held;
+} AdmissionTicket;
+
+typedef struct {
+    pthread_mutex_t lock;
+    unsigned depth;       // vagas; 0 desliga o limite
+    unsigned per_client;  // requisições simultâneas por endereço; 0 desliga o limite
+    unsigned workers;     // threads que atendem as vagas, para o Retry-After
+    unsigned pending;     // vagas ocupadas
+    uint64_t service_ns;  // média móvel do tempo de uma vaga ocupada
+    AdmissionClient *buckets[ADMISSION_BUCKETS];
+    atomic_uint_fast64_t rejected_full;
+    atomic_uint_fast64_t rejected_client;
+} Admission;
+
+void admission_init(Admission *adm, unsigned depth, unsigned per_client, unsigned workers);
+void admission_free(Admission *adm);
+
+// Ocupa uma vaga para o cliente `addr` (NULL ou família desconhecida: um cliente só
+// para todos esses) no instante `now_ns`. Fora ADMIT_OK, `ticket` não ocupa nada.
+AdmissionVerdict admission_enter(Admission *adm, const struct sockaddr *addr, uint64_t now_ns,
+                                 AdmissionTicket *ticket);
+
+// Devolve a vaga (sem efeito se `ticket` não ocupa nenhuma) e atualiza o tempo médio
+void admission_leave(Admission *adm, AdmissionTicket *ticket, uint64_t now_ns);
+
+// Segundos sugeridos no Retry-After de uma recusa, de 1 a ADMISSION_MAX_RETRY: a fila
+// inteira dividida entre as threads (ADMIT_FULL) ou uma requisição (ADMIT_CLIENT)
+unsigned admission_retry_after(Admission *adm, AdmissionVerdict verdict);
+
+// Vagas ocupadas agora (métricas)
+unsigned admission_pending(Admission *adm);
+
+#endif
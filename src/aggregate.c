@@ -0,0 +1,293 @@
+#include "aggregate.h"
+#include "kernels.h"
+#include "pool.h"
+
+#include <acs/thermal_sequence_player.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Ordem de emissão das matrizes de cada janela
+static const struct {
+    unsigned bit;
+    const char *name;
+} aggregate_names[] = {
+    { AGGREGATE_MAX, "max" },
+    { AGGREGATE_MIN, "min" },
+    { AGGREGATE_MEAN, "mean" },
+    { AGGREGATE_VAR, "var" },
+};
+
+#define AGGREGATE_STATS (sizeof(aggregate_names) / sizeof(aggregate_names[0]))
+
+bool aggregate_parse(const char *spec, unsigned *stats) {
+    unsigned bits = 0;
+    for (const char *p = spec;; ++p) {
+        size_t n = strcspn(p, ",");
+        size_t i = 0;
+        while (i < AGGREGATE_STATS &&
+               (strlen(aggregate_names[i].name) != n || strncmp(p, aggregate_names[i].name, n) != 0))
+            ++i;
+        if (i == AGGREGATE_STATS)
+            return false;
+        bits |= aggregate_names[i].bit;
+        p += n;
+        if (!*p)
+            break;
+    }
+    *stats = bits;
+    return true;
+}
+
+// Acúmulo de uma thread; no fim da janela, o primeiro com quadros recebe os demais
+typedef struct {
+    ACS_ThermalSequencePlayer *player;
+    Frame shape;      // retângulo, dimensões e unidade do primeiro quadro da janela
+    uint64_t count;   // quadros acumulados na janela
+    size_t capacity;  // pixels alocados em cada vetor
+    double *min;      // min e max andam juntos (kernel_extremes_f64)
+    double *max;
+    double *mean;
+    double *m2;       // só com AGGREGATE_VAR
+    bool mismatch;    // quadro com dimensões diferentes das do primeiro
+} AggregateWorker;
+
+typedef struct {
+    const char *path;
+    FrameRange range;
+    unsigned stats;
+    AggregateFrameFn fn;
+    void *ctx;
+    AggregateWorker *workers;
+    size_t first;  // janela atual: quadros selecionados [first, first + count)
+    size_t count;
+    size_t parts;  // trechos consecutivos da janela, um por tarefa do pool
+    atomic_size_t failed;
+} AggregateRun;
+
+// Contexto de forEachInRange, que não informa o índice do quadro
+typedef struct {
+    AggregateRun *run;
+    AggregateWorker *w;
+    unsigned worker;
+    size_t index;
+} AggregateVisit;
+
+static bool extremes(unsigned stats) {
+    return stats & (AGGREGATE_MAX | AGGREGATE_MIN);
+}
+
+static bool moments(unsigned stats) {
+    return stats & (AGGREGATE_MEAN | AGGREGATE_VAR);
+}
+
+static bool grow(double **v, size_t pixels) {
+    double *grown = realloc(*v, pixels * sizeof(double));
+    if (!grown)
+        return false;
+    *v = grown;
+    return true;
+}
+
+// Vetores para `pixels`, no estado inicial do acúmulo
+static bool accumulator_reset(AggregateWorker *w, unsigned stats, size_t pixels) {
+    if (pixels > w->capacity) {
+        if ((extremes(stats) && (!grow(&w->min, pixels) || !grow(&w->max, pixels))) ||
+            (moments(stats) && !grow(&w->mean, pixels)) || ((stats & AGGREGATE_VAR) && !grow(&w->m2, pixels)))
+            return false;
+        w->capacity = pixels;
+    }
+    for (size_t i = 0; extremes(stats) && i < pixels; ++i) {
+        w->min[i] = __builtin_inf();
+        w->max[i] = -__builtin_inf();
+    }
+    if (moments(stats))
+        memset(w->mean, 0, pixels * sizeof(double));
+    if (stats & AGGREGATE_VAR)
+        memset(w->m2, 0, pixels * sizeof(double));
+    return true;
+}
+
+static bool accumulate(AggregateRun *run, AggregateWorker *w, const Frame *frame) {
+    size_t pixels = (size_t)frame->width * (size_t)frame->height;
+    if (!w->count) {
+        if (!accumulator_reset(w, run->stats, pixels))
+            return false;
+        w->shape = *frame;
+    } else if (frame->width != w->shape.width || frame->height != w->shape.height) {
+        w->mismatch = true;
+        return false;
+    }
+    w->count++;
+    if (extremes(run->stats))
+        kernel_extremes_f64(frame->values, pixels, w->min, w->max);
+    if (moments(run->stats))
+        kernel_welford_f64(frame->values, pixels, w->count, w->mean, run->stats & AGGREGATE_VAR ? w->m2 : NULL);
+    return true;
+}
+
+static void visit_frame(ACS_ThermalImage *img, void *arg) {
+    AggregateVisit *v = arg;
+    Frame frame;
+    bool ok = img && v->run->fn(v->run->ctx, v->worker, v->index, img, &frame) && frame.values &&
+              accumulate(v->run, v->w, &frame);
+    if (!ok)
+        atomic_fetch_add(&v->run->failed, 1);
+    v->index += v->run->range.stride;
+}
+
+// Um trecho consecutivo da janela, no acúmulo da thread
+static void aggregate_task(void *ctx, unsigned worker, size_t part) {
+    AggregateRun *run = ctx;
+    AggregateWorker *w = &run->workers[worker];
+    size_t first = run->first + run->count * part / run->parts;
+    size_t count = run->first + run->count * (part + 1) / run->parts - first;
+    if (!w->player)
+        w->player = ACS_ThermalSequencePlayer_alloc(run->path);
+    if (!w->player) {
+        atomic_fetch_add(&run->failed, count);
+        return;
+    }
+    size_t start = frame_range_at(&run->range, first);
+    AggregateVisit visit = { run, w, worker, start };
+    if (run->range.stride == 1 && !run->range.list) {
+        // Quadros consecutivos: uma passada do player pelo trecho
+        ACS_ThermalSequencePlayer_forEachInRange(w->player, start, start + count, visit_frame, &visit);
+        if (visit.index != start + count)
+            atomic_fetch_add(&run->failed, start + count - visit.index);
+        return;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        size_t before = frame_range_at(&run->range, first + i);
+        visit.index = before;
+        ACS_ThermalSequencePlayer_withFrame(w->player, before, visit_frame, &visit);
+        if (visit.index == before)
+            atomic_fetch_add(&run->failed, 1);
+    }
+}
+
+// Junta `src` em `dst` (Chan et al.: médias ponderadas e M2 com o termo da diferença)
+static bool merge(AggregateWorker *dst, const AggregateWorker *src, unsigned stats) {
+    if (src->shape.width != dst->shape.width || src->shape.height != dst->shape.height)
+        return false;
+    size_t pixels = (size_t)dst->shape.width * (size_t)dst->shape.height;
+    if (extremes(stats)) {
+        kernel_extremes_f64(src->min, pixels, dst->min, dst->max);
+        kernel_extremes_f64(src->max, pixels, dst->min, dst->max);
+    }
+    double na = (double)dst->count, nb = (double)src->count, n = na + nb;
+    if (moments(stats)) {
+        double wb = nb / n, wm2 = na * nb / n;
+        for (size_t i = 0; i < pixels; ++i) {
+            double delta = src->mean[i] - dst->mean[i];
+            dst->mean[i] += delta * wb;
+            if (stats & AGGREGATE_VAR)
+                dst->m2[i] += src->m2[i] + delta * delta * wm2;
+        }
+    }
+    dst->count += src->count;
+    return true;
+}
+
+// Uma matriz por estatística pedida, com as estatísticas da própria matriz
+static bool emit_window(const AggregateRun *run, AggregateWorker *acc, AggregateEmitFn emit, void *ctx, OutBuf *out) {
+    size_t pixels = (size_t)acc->shape.width * (size_t)acc->shape.height;
+    double *vectors[AGGREGATE_STATS] = { acc->max, acc->min, acc->mean, acc->m2 }; // na ordem de aggregate_names
+    for (size_t s = 0; s < AGGREGATE_STATS; ++s) {
+        unsigned bit = aggregate_names[s].bit;
+        if (!(run->stats & bit))
+            continue;
+        double *values = vectors[s];
+        if (bit == AGGREGATE_VAR) {
+            // Último da ordem: M2 vira a variância no próprio vetor
+            double inv = 1.0 / (double)acc->count;
+            for (size_t i = 0; i < pixels; ++i)
+                values[i] *= inv;
+        }
+        KernelStats ks;
+        kernel_stats_init(&ks, NULL);
+        kernel_stats_f64(values, pixels, &ks);
+        Frame frame = acc->shape;
+        frame.values = values;
+        frame.fixed = NULL;
+        frame.clipped = 0;
+        frame.stats = (FrameStats){ ks.min, ks.max, ks.count ? ks.sum / (double)ks.count : 0 };
+        frame.index = (long)frame_range_at(&run->range, run->first);
+        frame.window_last = (long)frame_range_at(&run->range, run->first + run->count - 1);
+        frame.window_frames = acc->count;
+        frame.aggregate = aggregate_names[s].name;
+        frame.tag_roi = false;
+        frame.params = NULL;
+        if (!emit(ctx, &frame, out))
+            return false;
+    }
+    return true;
+}
+
+bool aggregate_run(const char *path, const FrameRange *range, size_t window, unsigned stats, unsigned workers,
+                   AggregateFrameFn fn, AggregateEmitFn emit, void *ctx, OutBuf *out, AggregateResult *result) {
+    memset(result, 0, sizeof(*result));
+    ACS_ThermalSequencePlayer *probe = ACS_ThermalSequencePlayer_alloc(path);
+    if (!probe)
+        return engine_fail("falha ao abrir sequência %s: %s", path, ACS_getLastErrorMessage());
+    size_t total = ACS_ThermalSequencePlayer_frameCount(probe);
+    ACS_ThermalSequencePlayer_free(probe);
+
+    AggregateRun run = { .path = path, .range = *range, .stats = stats, .fn = fn, .ctx = ctx };
+    if (run.range.last > total)
+        run.range.last = total;
+    size_t selected = frame_range_count(&run.range, total);
+    result->total = total;
+    result->frames = selected;
+    if (!window || window > selected)
+        window = selected ? selected : 1;
+    if (workers > window)
+        workers = (unsigned)window;
+    if (!workers)
+        workers = 1;
+    if (!(run.workers = calloc(workers, sizeof(*run.workers))))
+        return engine_fail("sem memória para %u threads", workers);
+
+    bool ok = true;
+    for (run.first = 0; ok && run.first < selected; run.first += window) {
+        run.count = selected - run.first < window ? selected - run.first : window;
+        run.parts = run.count < workers ? run.count : workers;
+        for (unsigned i = 0; i < workers; ++i) {
+            run.workers[i].count = 0;
+            run.workers[i].mismatch = false;
+        }
+        unsigned used = pool_run(run.parts, workers, aggregate_task, &run);
+        if (used > result->workers)
+            result->workers = used;
+
+        AggregateWorker *acc = NULL;
+        for (unsigned i = 0; ok && i < workers; ++i) {
+            AggregateWorker *w = &run.workers[i];
+            if (w->mismatch || (acc && w->count && !merge(acc, w, stats)))
+                ok = engine_fail("%s: dimensões dos quadros mudam na janela que começa no quadro %zu", path,
+                                 frame_range_at(&run.range, run.first));
+            else if (!acc && w->count)
+                acc = w;
+        }
+        // Janela sem nenhum quadro válido: nada a emitir
+        if (ok && acc) {
+            ok = emit_window(&run, acc, emit, ctx, out);
+            result->windows++;
+        }
+    }
+
+    for (unsigned i = 0; i < workers; ++i) {
+        AggregateWorker *w = &run.workers[i];
+        if (w->player)
+            ACS_ThermalSequencePlayer_free(w->player);
+        free(w->min);
+        free(w->max);
+        free(w->mean);
+        free(w->m2);
+    }
+    free(run.workers);
+    result->failed = atomic_load(&run.failed);
+    if (ok && out->failed)
+        return engine_fail("erro ao gravar a saída dos agregados");
+    return ok;
+}
@@ -0,0 +1,54 @@
+#ifndef FLIR2JSON_AGGREGATE_H
+#define FLIR2JSON_AGGREGATE_H
+
+#include <acs/thermal_image.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "engine.h"
+#include "output.h"
+#include "sequence.h"
+
+// Agregados temporais por pixel de uma sequência (--aggregate): máximo, mínimo, média e
+// variância de cada pixel ao longo de janelas de quadros, sem exportar os quadros.
+// Cada janela é dividida em trechos consecutivos decodificados em paralelo; cada thread
+// acumula os seus quadros, um por vez, em vetores separados por estatística (min, max,
+// média e M2 de Welford, ver kernel_extremes_f64/kernel_welford_f64), e os acúmulos das
+// threads são combinados no fim da janela. A memória não depende do tamanho da janela.
+
+enum {
+    AGGREGATE_MAX = 1,
+    AGGREGATE_MIN = 2,
+    AGGREGATE_MEAN = 4,
+    AGGREGATE_VAR = 8 // populacional, na unidade de saída ao quadrado
+};
+
+// Lista separada por vírgulas de max, min, mean e var
+bool aggregate_parse(const char *spec, unsigned *stats);
+
+// Extrai o quadro `index` (decodificado em `img`) para `frame`, com a matriz em double.
+// Roda em várias threads: `worker` indexa o estado próprio de cada uma; a matriz só
+// precisa valer até a próxima chamada da mesma thread. false conta como falha do quadro.
+typedef bool (*AggregateFrameFn)(void *ctx, unsigned worker, size_t index, ACS_ThermalImage *img, Frame *frame);
+
+// Grava a matriz agregada `frame` (sem ACS_ThermalImage) em `out`
+typedef bool (*AggregateEmitFn)(void *ctx, const Frame *frame, OutBuf *out);
+
+typedef struct {
+    size_t total;   // quadros no arquivo
+    size_t frames;  // quadros selecionados
+    size_t windows; // janelas gravadas
+    size_t failed;  // quadros que não entraram no acúmulo
+    unsigned workers;
+} AggregateResult;
+
+// Percorre os quadros de `range` em janelas de `window` quadros selecionados (0: uma
+// janela só) e, ao fim de cada uma, emite uma matriz por estatística de `stats`, na
+// ordem max, min, mean, var. Janelas sem nenhum quadro válido são puladas. false se a
+// sequência não abre, se as dimensões mudam dentro de uma janela ou se `emit` falha;
+// motivo em engine_last_error().
+bool aggregate_run(const char *path, const FrameRange *range, size_t window, unsigned stats, unsigned workers,
+                   AggregateFrameFn fn, AggregateEmitFn emit, void *ctx, OutBuf *out, AggregateResult *result);
+
+#endif
@@ -0,0 +1,237 @@
+#include "archive.h"
+#include "engine.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#define TAR_BLOCK 512
+
+void archive_free(ArchiveList *list) {
+    free(list->items);
+    memset(list, 0, sizeof(*list));
+}
+
+static ArchiveItem *push_item(ArchiveList *list, size_t max_items) {
+    if (list->count == max_items) {
+        engine_fail("mais de %zu imagens no lote", max_items);
+        return NULL;
+    }
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 64;
+        ArchiveItem *grown = realloc(list->items, capacity * sizeof(*grown));
+        if (!grown) {
+            engine_fail("sem memória para o lote");
+            return NULL;
+        }
+        list->items = grown;
+        list->capacity = capacity;
+    }
+    ArchiveItem *item = &list->items[list->count++];
+    memset(item, 0, sizeof(*item));
+    return item;
+}
+
+// Cópia terminada em NUL, truncada em ARCHIVE_NAME_MAX
+static void set_name(ArchiveItem *item, const char *s, size_t len) {
+    if (len >= ARCHIVE_NAME_MAX)
+        len = ARCHIVE_NAME_MAX - 1;
+    memcpy(item->name, s, len);
+    item->name[len] = '\0';
+}
+
+static const unsigned char *find(const unsigned char *p, const unsigned char *end, const char *needle, size_t n) {
+    while ((size_t)(end - p) >= n) {
+        const unsigned char *hit = memchr(p, (unsigned char)needle[0], (size_t)(end - p) - n + 1);
+        if (!hit)
+            return NULL;
+        if (memcmp(hit, needle, n) == 0)
+            return hit;
+        p = hit + 1;
+    }
+    return NULL;
+}
+
+// Valor do parâmetro `name=` (com ou sem aspas) em [p, end); NULL se ausente
+static const char *header_param(const char *p, const char *end, const char *name, size_t *len) {
+    size_t n = strlen(name);
+    for (; (size_t)(end - p) > n; ++p) {
+        if (strncasecmp(p, name, n) != 0 || p[n] != '=')
+            continue;
+        const char *v = p + n + 1;
+        const char *stop = v;
+        if (v < end && *v == '"') {
+            stop = ++v;
+            while (stop < end && *stop != '"')
+                ++stop;
+        } else {
+            while (stop < end && *stop != ';' && *stop != '\r' && *stop != '\n' && *stop != ' ')
+                ++stop;
+        }
+        *len = (size_t)(stop - v);
+        return v;
+    }
+    return NULL;
+}
+
+// Cada parte vira um item; o preâmbulo e o epílogo são ignorados
+static bool parse_multipart(const char *content_type, const unsigned char *data, size_t len, size_t max_items,
+                            ArchiveList *list) {
+    size_t boundary_len;
+    const char *boundary = header_param(content_type, content_type + strlen(content_type), "boundary",
+                                        &boundary_len);
+    // RFC 2046: até 70 caracteres
+    if (!boundary || !boundary_len || boundary_len > 70)
+        return engine_fail("multipart sem boundary válido");
+    char delim[76] = "\r\n--";
+    memcpy(delim + 4, boundary, boundary_len);
+    size_t delim_len = boundary_len + 4;
+
+    const unsigned char *end = data + len;
+    // O primeiro delimitador pode abrir o corpo, sem o CRLF antes
+    const unsigned char *p;
+    if (len >= delim_len - 2 && memcmp(data, delim + 2, delim_len - 2) == 0)
+        p = data + delim_len - 2;
+    else if ((p = find(data, end, delim, delim_len)))
+        p += delim_len;
+    else
+        return engine_fail("multipart sem nenhuma parte");
+    for (;;) {
+        if (end - p >= 2 && p[0] == '-' && p[1] == '-')
+            return true;
+        while (p < end && (*p == ' ' || *p == '\t'))
+            ++p;
+        if (end - p < 2 || p[0] != '\r' || p[1] != '\n')
+            return engine_fail("multipart malformado");
+        p += 2;
+        const unsigned char *headers = p, *body;
+        if (end - p >= 2 && p[0] == '\r' && p[1] == '\n') {
+            body = p + 2;
+        } else {
+            const unsigned char *blank = find(p, end, "\r\n\r\n", 4);
+            if (!blank)
+                return engine_fail("multipart malformado: parte sem cabeçalhos completos");
+            body = blank + 4;
+        }
+        const unsigned char *next = find(body, end, delim, delim_len);
+        if (!next)
+            return engine_fail("multipart truncado: falta o delimitador final");
+        ArchiveItem *item = push_item(list, max_items);
+        if (!item)
+            return false;
+        item->data = body;
+        item->len = (size_t)(next - body);
+        size_t name_len;
+        const char *name = header_param((const char *)headers, (const char *)body, "filename", &name_len);
+        if (name)
+            set_name(item, name, name_len);
+        p = next + delim_len;
+    }
+}
+
+static bool tar_number(const unsigned char *field, size_t width, uint64_t *value) {
+    // GNU: base 256 para valores grandes, com o bit alto do primeiro byte ligado
+    if (field[0] & 0x80) {
+        uint64_t v = field[0] & 0x7f;
+        for (size_t i = 1; i < width; ++i) {
+            if (v >> 56)
+                return false;
+            v = v << 8 | field[i];
+        }
+        *value = v;
+        return true;
+    }
+    uint64_t v = 0;
+    size_t i = 0;
+    while (i < width && field[i] == ' ')
+        ++i;
+    for (; i < width && field[i] >= '0' && field[i] <= '7'; ++i)
+        v = v * 8 + (uint64_t)(field[i] - '0');
+    *value = v;
+    return true;
+}
+
+static bool tar_checksum_ok(const unsigned char *h) {
+    uint64_t expected;
+    if (!tar_number(h + 148, 8, &expected))
+        return false;
+    uint64_t sum = 0;
+    for (size_t i = 0; i < TAR_BLOCK; ++i)
+        sum += i >= 148 && i < 156 ? ' ' : h[i];
+    return sum == expected;
+}
+
+static size_t field_len(const unsigned char *field, size_t width) {
+    const unsigned char *nul = memchr(field, 0, width);
+    return nul ? (size_t)(nul - field) : width;
+}
+
+// Só arquivos regulares viram itens; nomes longos do GNU ('L') valem para a entrada seguinte
+static bool parse_tar(const unsigned char *data, size_t len, size_t max_items, ArchiveList *list) {
+    const unsigned char *long_name = NULL;
+    size_t long_len = 0;
+    for (size_t off = 0; len - off >= TAR_BLOCK;) {
+        const unsigned char *h = data + off;
+        size_t zero = 0;
+        while (zero < TAR_BLOCK && !h[zero])
+            ++zero;
+        if (zero == TAR_BLOCK)
+            return true; // bloco zerado: fim do arquivo
+        uint64_t size;
+        if (!tar_checksum_ok(h) || !tar_number(h + 124, 12, &size))
+            return engine_fail("tar malformado no byte %zu", off);
+        off += TAR_BLOCK;
+        if (size > len - off)
+            return engine_fail("tar truncado no byte %zu", off);
+        const unsigned char *body = data + off;
+        char type = (char)h[156];
+        if (type == 'L') {
+            long_name = body;
+            long_len = field_len(body, (size_t)size);
+        } else if (type == '0' || type == '\0' || type == '7') {
+            ArchiveItem *item = push_item(list, max_items);
+            if (!item)
+                return false;
+            item->data = body;
+            item->len = (size_t)size;
+            if (long_name) {
+                set_name(item, (const char *)long_name, long_len);
+            } else {
+                char path[ARCHIVE_NAME_MAX];
+                size_t prefix = memcmp(h + 257, "ustar", 5) == 0 ? field_len(h + 345, 155) : 0;
+                size_t name = field_len(h, 100);
+                int n = snprintf(path, sizeof(path), "%.*s%s%.*s", (int)prefix, (const char *)h + 345,
+                                 prefix ? "/" : "", (int)name, (const char *)h);
+                set_name(item, path, n < 0 ? 0 : (size_t)n);
+            }
+            long_name = NULL;
+        } else if (type != 'x' && type != 'g') {
+            long_name = NULL; // diretórios, links e afins ficam de fora
+        }
+        off += (size_t)((size + TAR_BLOCK - 1) / TAR_BLOCK * TAR_BLOCK);
+        if (off > len)
+            off = len;
+    }
+    return true;
+}
+
+bool archive_parse(const char *content_type, const unsigned char *data, size_t len, size_t max_items,
+                   ArchiveList *list) {
+    memset(list, 0, sizeof(*list));
+    bool ok;
+    if (content_type && strncasecmp(content_type, "multipart/", 10) == 0)
+        ok = parse_multipart(content_type, data, len, max_items, list);
+    else if ((content_type && (strncasecmp(content_type, "application/x-tar", 17) == 0 ||
+                               strncasecmp(content_type, "application/tar", 15) == 0)) ||
+             (len >= TAR_BLOCK && memcmp(data + 257, "ustar", 5) == 0))
+        ok = parse_tar(data, len, max_items, list);
+    else
+        ok = engine_fail("corpo do lote não é multipart nem tar");
+    if (ok && !list->count)
+        ok = engine_fail("lote sem imagens");
+    if (!ok)
+        archive_free(list);
+    return ok;
+}
@@ -0,0 +1,32 @@
+#ifndef FLIR2JSON_ARCHIVE_H
+#define FLIR2JSON_ARCHIVE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Imagens de um corpo de lote (POST /extract/batch): multipart (form-data ou mixed)
+// ou tar (ustar/GNU). Os itens apontam para dentro do próprio corpo, sem cópia.
+// Erros em engine_last_error().
+
+#define ARCHIVE_NAME_MAX 256
+
+typedef struct {
+    char name[ARCHIVE_NAME_MAX]; // filename do multipart ou caminho no tar; vazio se ausente
+    const unsigned char *data;
+    size_t len;
+} ArchiveItem;
+
+typedef struct {
+    ArchiveItem *items;
+    size_t count;
+    size_t capacity;
+} ArchiveList;
+
+// `content_type` decide o formato (multipart/... com boundary, application/x-tar);
+// sem ele ou com outro tipo, o tar é reconhecido pela assinatura "ustar".
+// Mais de `max_items` itens é erro.
+bool archive_parse(const char *content_type, const unsigned char *data, size_t len, size_t max_items,
+                   ArchiveList *list);
+void archive_free(ArchiveList *list);
+
+#endif
@@ -0,0 +1,80 @@
+#include "arena.h"
+
+#include <stdlib.h>
+
+static void block_free(ArenaBlock *b) {
+    free(b->data);
+    free(b);
+}
+
+ArenaBlock *arena_take(Arena *arena, size_t min) {
+    ArenaBlock **best = NULL, **largest = NULL;
+    for (ArenaBlock **p = &arena->spare; *p; p = &(*p)->next) {
+        if ((*p)->capacity >= min && (!best || (*p)->capacity < (*best)->capacity))
+            best = p;
+        if (!largest || (*p)->capacity > (*largest)->capacity)
+            largest = p;
+    }
+    ArenaBlock **pick = best ? best : largest;
+    ArenaBlock *b;
+    if (pick) {
+        b = *pick;
+        *pick = b->next;
+        arena->count--;
+    } else if (!(b = calloc(1, sizeof(*b)))) {
+        return NULL;
+    }
+    b->next = NULL;
+    if (b->capacity < min) {
+        // Sem preservar conteúdo: libera antes para não somar os dois tamanhos
+        free(b->data);
+        b->capacity = 0;
+        if (!(b->data = malloc(min))) {
+            arena_give(arena, b);
+            return NULL;
+        }
+        b->capacity = min;
+    }
+    return b;
+}
+
+bool arena_grow(ArenaBlock *b, size_t min) {
+    if (min <= b->capacity)
+        return true;
+    char *grown = realloc(b->data, min);
+    if (!grown)
+        return false;
+    b->data = grown;
+    b->capacity = min;
+    return true;
+}
+
+char *arena_detach(ArenaBlock *b, size_t len) {
+    char *data = b->data;
+    // Encolher devolve ao sistema o excesso da estimativa, em geral sem mover os bytes
+    char *shrunk = realloc(data, len ? len : 1);
+    b->data = NULL;
+    b->capacity = 0;
+    return shrunk ? shrunk : data;
+}
+
+void arena_give(Arena *arena, ArenaBlock *b) {
+    if (!b)
+        return;
+    if (b->capacity > ARENA_KEEP_BYTES || arena->count >= ARENA_KEEP_BLOCKS) {
+        block_free(b);
+        return;
+    }
+    b->next = arena->spare;
+    arena->spare = b;
+    arena->count++;
+}
+
+void arena_free(Arena *arena) {
+    while (arena->spare) {
+        ArenaBlock *b = arena->spare;
+        arena->spare = b->next;
+        block_free(b);
+    }
+    arena->count = 0;
+}
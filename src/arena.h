@@ -0,0 +1,44 @@
+#ifndef FLIR2JSON_ARENA_H
+#define FLIR2JSON_ARENA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Reserva de blocos de uma thread: uploads, documentos de resposta e blocos do JSON
+// em streaming saem daqui e voltam quando a conexão termina. Um bloco devolvido é
+// entregue de novo à próxima requisição que caiba nele, e só cresce quando o quadro
+// aumenta; em regime a thread não chama malloc/free por requisição.
+//
+// Sem trava: tomar e devolver precisam acontecer na thread dona (no MHD com pool de
+// threads, a conexão e a liberação da resposta ficam na mesma thread).
+
+typedef struct ArenaBlock {
+    char *data;
+    size_t capacity;
+    struct ArenaBlock *next;
+} ArenaBlock;
+
+// Blocos guardados por thread e maior bloco retido; o resto volta ao sistema
+#define ARENA_KEEP_BLOCKS 8
+#define ARENA_KEEP_BYTES (64u << 20)
+
+typedef struct {
+    ArenaBlock *spare; // blocos livres, sem ordem
+    size_t count;
+} Arena;
+
+// Bloco com pelo menos `min` bytes (conteúdo indefinido): o menor livre que caiba,
+// senão o maior livre realocado; NULL sem memória
+ArenaBlock *arena_take(Arena *arena, size_t min);
+
+// Cresce o bloco para `min` bytes preservando o conteúdo
+bool arena_grow(ArenaBlock *block, size_t min);
+
+// Entrega os bytes do bloco ao chamador (que passa a liberá-los com free), encolhidos
+// para `len` sem cópia; o bloco fica vazio e volta a ter memória quando for tomado
+char *arena_detach(ArenaBlock *block, size_t len);
+
+void arena_give(Arena *arena, ArenaBlock *block);
+void arena_free(Arena *arena);
+
+#endif
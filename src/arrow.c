@@ -0,0 +1,616 @@
+#include "arrow.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define ARROW_MAGIC "ARROW1"
+#define ARROW_CONTINUATION 0xffffffffu
+
+// Enums do esquema do Arrow (format/Schema.fbs e Message.fbs)
+enum {
+    METADATA_V5 = 4,
+    HEADER_SCHEMA = 1,
+    HEADER_RECORD_BATCH = 3,
+    TYPE_INT = 2,
+    TYPE_FLOAT = 3,
+    TYPE_UTF8 = 5,
+    TYPE_TIMESTAMP = 10,
+    TYPE_LIST = 12,
+    PRECISION_SINGLE = 1,
+    PRECISION_DOUBLE = 2,
+    TIME_MILLISECOND = 1
+};
+
+typedef enum {
+    COL_UTF8,
+    COL_TIMESTAMP,
+    COL_F64,
+    COL_I32,
+    COL_LIST_F32,
+    COL_F32 // só o filho "item" da lista
+} ColumnType;
+
+enum {
+    C_FILE,
+    C_TIMESTAMP,
+    C_MODEL,
+    C_SERIAL,
+    C_LATITUDE,
+    C_LONGITUDE,
+    C_ALTITUDE,
+    C_PARAMS,
+    C_ROI_X,
+    C_ROI_Y,
+    C_WIDTH,
+    C_HEIGHT,
+    C_MIN,
+    C_MAX,
+    C_MEAN,
+    C_TEMPERATURE
+};
+
+static const struct {
+    const char *name;
+    ColumnType type;
+    bool nullable;
+} COLUMNS[ARROW_COLUMNS] = {
+    { "file", COL_UTF8, true },          { "timestamp", COL_TIMESTAMP, true },
+    { "camera_model", COL_UTF8, true },  { "camera_serial", COL_UTF8, true },
+    { "latitude", COL_F64, true },       { "longitude", COL_F64, true },
+    { "altitude", COL_F64, true },       { "params", COL_UTF8, true },
+    { "roi_x", COL_I32, false },         { "roi_y", COL_I32, false },
+    { "width", COL_I32, false },         { "height", COL_I32, false },
+    { "min", COL_F64, false },           { "max", COL_F64, false },
+    { "mean", COL_F64, false },          { "temperature", COL_LIST_F32, false },
+};
+
+// ---------------------------------------------------------------------------
+// Flatbuffer montado para a frente num OutBuf em memória: posições relativas ao início
+// do buffer (alinhado a 8 no arquivo), vtable logo antes de cada tabela e offsets
+// para filhos gravados depois, preenchidos com fb_patch quando o filho sai.
+
+typedef enum {
+    FB_ABSENT,
+    FB_SCALAR,
+    FB_OFFSET
+} FbKind;
+
+typedef struct {
+    FbKind kind;
+    uint8_t size; // bytes do escalar (offsets: 4)
+    uint64_t value;
+} FbField;
+
+#define FB_NONE ((FbField){ FB_ABSENT, 0, 0 })
+#define FB_OFS ((FbField){ FB_OFFSET, 4, 0 })
+#define FB_U8(v) ((FbField){ FB_SCALAR, 1, (uint64_t)(v) })
+#define FB_I16(v) ((FbField){ FB_SCALAR, 2, (uint64_t)(v) })
+#define FB_I32(v) ((FbField){ FB_SCALAR, 4, (uint64_t)(v) })
+#define FB_I64(v) ((FbField){ FB_SCALAR, 8, (uint64_t)(v) })
+
+#define FB_MAX_FIELDS 8
+
+static void fb_pad(OutBuf *b, size_t align) {
+    while (b->len % align)
+        out_char(b, 0);
+}
+
+static void fb_put(OutBuf *b, uint64_t v, size_t size) {
+    unsigned char bytes[8];
+    for (size_t i = 0; i < size; ++i)
+        bytes[i] = (unsigned char)(v >> (8 * i));
+    out_write(b, bytes, size);
+}
+
+static void fb_patch(OutBuf *b, size_t field, size_t target) {
+    if (b->failed)
+        return;
+    uint32_t v = (uint32_t)(target - field);
+    memcpy(b->data + field, &v, 4);
+}
+
+// Tabela com seus campos em ordem; `pos[i]` recebe a posição do campo i (para fb_patch)
+static size_t fb_table(OutBuf *b, const FbField *f, size_t n, size_t *pos) {
+    uint16_t offsets[FB_MAX_FIELDS];
+    size_t off = 4, align = 4;
+    for (size_t i = 0; i < n; ++i) {
+        if (f[i].kind == FB_ABSENT) {
+            offsets[i] = 0;
+            continue;
+        }
+        off = (off + f[i].size - 1) / f[i].size * f[i].size;
+        offsets[i] = (uint16_t)off;
+        off += f[i].size;
+        if (f[i].size > align)
+            align = f[i].size;
+    }
+    fb_pad(b, 2);
+    size_t vtable = b->len;
+    fb_put(b, 4 + 2 * n, 2);
+    fb_put(b, off, 2);
+    for (size_t i = 0; i < n; ++i)
+        fb_put(b, offsets[i], 2);
+    fb_pad(b, align);
+    size_t table = b->len;
+    fb_put(b, table - vtable, 4);
+    for (size_t i = 0; i < n; ++i) {
+        if (f[i].kind == FB_ABSENT)
+            continue;
+        fb_pad(b, f[i].size);
+        if (pos)
+            pos[i] = b->len;
+        fb_put(b, f[i].value, f[i].size);
+    }
+    return table;
+}
+
+// Cabeçalho de um vetor de `count` elementos alinhados a `align`; `*first` recebe a
+// posição do primeiro, que o chamador grava em seguida
+static size_t fb_vector(OutBuf *b, size_t count, size_t align, size_t *first) {
+    if (align < 4)
+        align = 4;
+    while ((b->len + 4) % align)
+        out_char(b, 0);
+    size_t vector = b->len;
+    fb_put(b, count, 4);
+    if (first)
+        *first = b->len;
+    return vector;
+}
+
+// Vetor de offsets ainda zerados; `*first` como em fb_vector (elementos de 4 bytes)
+static size_t fb_offset_vector(OutBuf *b, size_t count, size_t *first) {
+    size_t vector = fb_vector(b, count, 4, first);
+    for (size_t i = 0; i < count; ++i)
+        fb_put(b, 0, 4);
+    return vector;
+}
+
+static size_t fb_string(OutBuf *b, const char *s) {
+    size_t n = strlen(s);
+    size_t pos = fb_vector(b, n, 4, NULL);
+    out_write(b, s, n);
+    out_char(b, 0);
+    return pos;
+}
+
+// ---------------------------------------------------------------------------
+// Esquema
+
+static size_t write_type(OutBuf *b, ColumnType type) {
+    size_t pos[2];
+    switch (type) {
+    case COL_TIMESTAMP: {
+        FbField f[] = { FB_I16(TIME_MILLISECOND), FB_OFS };
+        size_t table = fb_table(b, f, 2, pos);
+        fb_patch(b, pos[1], fb_string(b, "UTC"));
+        return table;
+    }
+    case COL_F64:
+    case COL_F32: {
+        FbField f[] = { FB_I16(type == COL_F64 ? PRECISION_DOUBLE : PRECISION_SINGLE) };
+        return fb_table(b, f, 1, NULL);
+    }
+    case COL_I32: {
+        FbField f[] = { FB_I32(32), FB_U8(1) };
+        return fb_table(b, f, 2, NULL);
+    }
+    default: // Utf8 e List não têm campos
+        return fb_table(b, NULL, 0, NULL);
+    }
+}
+
+static uint8_t type_id(ColumnType type) {
+    switch (type) {
+    case COL_TIMESTAMP: return TYPE_TIMESTAMP;
+    case COL_F64:
+    case COL_F32: return TYPE_FLOAT;
+    case COL_I32: return TYPE_INT;
+    case COL_LIST_F32: return TYPE_LIST;
+    default: return TYPE_UTF8;
+    }
+}
+
+static size_t write_field(OutBuf *b, const char *name, ColumnType type, bool nullable) {
+    // name, nullable, type_type, type, dictionary, children
+    FbField f[] = { FB_OFS, FB_U8(nullable), FB_U8(type_id(type)), FB_OFS, FB_NONE, FB_OFS };
+    size_t pos[6];
+    size_t table = fb_table(b, f, 6, pos);
+    fb_patch(b, pos[0], fb_string(b, name));
+    fb_patch(b, pos[3], write_type(b, type));
+    size_t child;
+    size_t children = fb_offset_vector(b, type == COL_LIST_F32, &child);
+    fb_patch(b, pos[5], children);
+    if (type == COL_LIST_F32)
+        fb_patch(b, child, write_field(b, "item", COL_F32, false));
+    return table;
+}
+
+static size_t write_schema(OutBuf *b, TempUnit unit) {
+    // endianness (little), fields, custom_metadata
+    FbField f[] = { FB_I16(0), FB_OFS, FB_OFS };
+    size_t pos[3];
+    size_t table = fb_table(b, f, 3, pos);
+    size_t first;
+    fb_patch(b, pos[1], fb_offset_vector(b, ARROW_COLUMNS, &first));
+    for (size_t i = 0; i < ARROW_COLUMNS; ++i)
+        fb_patch(b, first + 4 * i, write_field(b, COLUMNS[i].name, COLUMNS[i].type, COLUMNS[i].nullable));
+
+    fb_patch(b, pos[2], fb_offset_vector(b, 1, &first));
+    FbField kv[] = { FB_OFS, FB_OFS };
+    size_t kv_pos[2];
+    fb_patch(b, first, fb_table(b, kv, 2, kv_pos));
+    fb_patch(b, kv_pos[0], fb_string(b, "flir2json.unit"));
+    fb_patch(b, kv_pos[1], fb_string(b, unit_symbol(unit)));
+    return table;
+}
+
+// Mensagem (Schema ou RecordBatch) com o cabeçalho montado por `header`
+static void begin_message(OutBuf *b, uint8_t header_type, uint64_t body_len, size_t *header) {
+    b->len = 0;
+    b->failed = false;
+    fb_put(b, 0, 4); // raiz
+    FbField f[] = { FB_I16(METADATA_V5), FB_U8(header_type), FB_OFS, FB_I64(body_len) };
+    size_t pos[4];
+    fb_patch(b, 0, fb_table(b, f, 4, pos));
+    *header = pos[2];
+}
+
+// Prefixo de continuação, tamanho e o flatbuffer de `w->meta` com padding até 8
+static void emit_message(ArrowWriter *w, int32_t *meta_len) {
+    fb_pad(&w->meta, 8);
+    fb_put(w->out, ARROW_CONTINUATION, 4);
+    fb_put(w->out, w->meta.len, 4);
+    out_write(w->out, w->meta.data, w->meta.len);
+    *meta_len = (int32_t)(8 + w->meta.len);
+    w->pos += 8 + w->meta.len;
+}
+
+// ---------------------------------------------------------------------------
+// Colunas
+
+static void column_reset(ArrowColumn *c, ColumnType type) {
+    c->validity.len = c->offsets.len = c->values.len = 0;
+    c->validity.failed = c->offsets.failed = c->values.failed = false;
+    c->nulls = 0;
+    if (type == COL_UTF8 || type == COL_LIST_F32)
+        fb_put(&c->offsets, 0, 4);
+}
+
+static void column_valid(ArrowColumn *c, size_t row, bool valid) {
+    if (row % 8 == 0)
+        out_char(&c->validity, 0);
+    if (c->validity.failed)
+        return;
+    if (valid)
+        c->validity.data[row / 8] |= (char)(1u << (row % 8));
+    else
+        c->nulls++;
+}
+
+static void push_text(ArrowColumn *c, size_t row, const char *s) {
+    bool valid = s && *s;
+    column_valid(c, row, valid);
+    if (valid)
+        out_write(&c->values, s, strlen(s));
+    fb_put(&c->offsets, c->values.len, 4);
+}
+
+static void push_i64(ArrowColumn *c, size_t row, bool valid, int64_t v) {
+    column_valid(c, row, valid);
+    fb_put(&c->values, valid ? (uint64_t)v : 0, 8);
+}
+
+static void push_f64(ArrowColumn *c, size_t row, bool valid, double v) {
+    column_valid(c, row, valid);
+    if (!valid)
+        v = 0.0;
+    out_write(&c->values, &v, sizeof(v));
+}
+
+static void push_i32(ArrowColumn *c, size_t row, int32_t v) {
+    column_valid(c, row, true);
+    out_write(&c->values, &v, sizeof(v));
+}
+
+static void push_matrix(ArrowColumn *c, size_t row, const double *values, size_t n) {
+    column_valid(c, row, true);
+    if (out_reserve(&c->values, n * sizeof(float))) {
+        float *dst = (float *)(c->values.data + c->values.len);
+        for (size_t i = 0; i < n; ++i)
+            dst[i] = (float)values[i];
+        c->values.len += n * sizeof(float);
+    }
+    fb_put(&c->offsets, c->values.len / sizeof(float), 4);
+}
+
+// Buffers de um nó em pré-ordem: validade, [offsets], valores; o filho da lista vem
+// em seguida com validade vazia e os floats
+typedef struct {
+    const OutBuf *data;
+    size_t len;
+} BodyBuffer;
+
+#define ARROW_BUFFERS (ARROW_COLUMNS * 3 + 2)
+
+static size_t column_buffers(const ArrowColumn *c, ColumnType type, BodyBuffer *out) {
+    size_t n = 0;
+    out[n++] = (BodyBuffer){ &c->validity, c->nulls ? c->validity.len : 0 };
+    if (type == COL_UTF8 || type == COL_LIST_F32)
+        out[n++] = (BodyBuffer){ &c->offsets, c->offsets.len };
+    if (type == COL_LIST_F32)
+        out[n++] = (BodyBuffer){ NULL, 0 };
+    out[n++] = (BodyBuffer){ &c->values, c->values.len };
+    return n;
+}
+
+static size_t padded(size_t len) {
+    return (len + 7) & ~(size_t)7;
+}
+
+static bool flush_batch(ArrowWriter *w) {
+    BodyBuffer buffers[ARROW_BUFFERS];
+    size_t count = 0;
+    for (size_t i = 0; i < ARROW_COLUMNS; ++i) {
+        if (w->columns[i].validity.failed || w->columns[i].offsets.failed || w->columns[i].values.failed)
+            return engine_fail("sem memória para o lote Arrow");
+        count += column_buffers(&w->columns[i], COLUMNS[i].type, buffers + count);
+    }
+    uint64_t body_len = 0;
+    for (size_t i = 0; i < count; ++i)
+        body_len += padded(buffers[i].len);
+
+    // RecordBatch: length, nodes, buffers
+    OutBuf *b = &w->meta;
+    size_t header, pos[3], first;
+    begin_message(b, HEADER_RECORD_BATCH, body_len, &header);
+    FbField f[] = { FB_I64(w->rows), FB_OFS, FB_OFS };
+    fb_patch(b, header, fb_table(b, f, 3, pos));
+    fb_patch(b, pos[1], fb_vector(b, ARROW_COLUMNS + 1, 8, &first));
+    for (size_t i = 0; i < ARROW_COLUMNS; ++i) {
+        fb_put(b, w->rows, 8);
+        fb_put(b, w->columns[i].nulls, 8);
+        if (COLUMNS[i].type == COL_LIST_F32) {
+            fb_put(b, w->columns[i].values.len / sizeof(float), 8);
+            fb_put(b, 0, 8);
+        }
+    }
+    fb_patch(b, pos[2], fb_vector(b, count, 8, &first));
+    uint64_t offset = 0;
+    for (size_t i = 0; i < count; ++i) {
+        fb_put(b, offset, 8);
+        fb_put(b, buffers[i].len, 8);
+        offset += padded(buffers[i].len);
+    }
+    if (b->failed)
+        return engine_fail("sem memória para o lote Arrow");
+
+    if (w->block_count == w->block_capacity) {
+        size_t capacity = w->block_capacity ? w->block_capacity * 2 : 16;
+        ArrowBlock *grown = realloc(w->blocks, capacity * sizeof(*grown));
+        if (!grown)
+            return engine_fail("sem memória para o rodapé Arrow");
+        w->blocks = grown;
+        w->block_capacity = capacity;
+    }
+    ArrowBlock *block = &w->blocks[w->block_count++];
+    block->offset = (int64_t)w->pos;
+    block->body_len = (int64_t)body_len;
+    emit_message(w, &block->meta_len);
+    static const char zeros[8];
+    for (size_t i = 0; i < count; ++i) {
+        if (buffers[i].len)
+            out_write(w->out, buffers[i].data->data, buffers[i].len);
+        out_write(w->out, zeros, padded(buffers[i].len) - buffers[i].len);
+    }
+    w->pos += body_len;
+
+    for (size_t i = 0; i < ARROW_COLUMNS; ++i)
+        column_reset(&w->columns[i], COLUMNS[i].type);
+    w->rows = 0;
+    w->values = 0;
+    return !w->out->failed || engine_fail("falha ao gravar o arquivo Arrow");
+}
+
+// ---------------------------------------------------------------------------
+// Metadados da imagem
+
+typedef struct {
+    char model[128];
+    char serial[128];
+    bool has_time;
+    int64_t time_ms;
+    bool has_gps;
+    double latitude, longitude, altitude;
+} ImageMeta;
+
+static bool read_number(const char **s, int digits, int *v) {
+    *v = 0;
+    for (int i = 0; i < digits; ++i, ++*s) {
+        if (**s < '0' || **s > '9')
+            return false;
+        *v = *v * 10 + (**s - '0');
+    }
+    return true;
+}
+
+// Consome um dos separadores de `seps`
+static bool skip_sep(const char **s, const char *seps) {
+    if (!**s || !strchr(seps, **s))
+        return false;
+    ++*s;
+    return true;
+}
+
+// "AAAA-MM-DD HH:MM:SS[.fff][Z|±HH:MM]", aceitando ':' na data (EXIF) e 'T' no meio
+static bool parse_datetime(const char *s, int64_t *ms) {
+    int year, month, day, hour, minute, second, frac = 0;
+    if (!read_number(&s, 4, &year) || !skip_sep(&s, "-:") || !read_number(&s, 2, &month) || !skip_sep(&s, "-:") ||
+        !read_number(&s, 2, &day) || !skip_sep(&s, " T") || !read_number(&s, 2, &hour) || !skip_sep(&s, ":") ||
+        !read_number(&s, 2, &minute) || !skip_sep(&s, ":") || !read_number(&s, 2, &second))
+        return false;
+    if (*s == '.') {
+        int scale = 100;
+        for (++s; *s >= '0' && *s <= '9'; ++s, scale /= 10)
+            frac += (*s - '0') * scale;
+    }
+    int zone = 0;
+    if (*s == '+' || *s == '-') {
+        int sign = *s++ == '-' ? -1 : 1, zh, zm = 0;
+        if (!read_number(&s, 2, &zh))
+            return false;
+        if (*s == ':')
+            ++s;
+        read_number(&s, 2, &zm);
+        zone = sign * (zh * 60 + zm);
+    }
+    if (month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60)
+        return false;
+    struct tm tm = { .tm_year = year - 1900, .tm_mon = month - 1, .tm_mday = day,
+                     .tm_hour = hour, .tm_min = minute, .tm_sec = second };
+    *ms = ((int64_t)timegm(&tm) - zone * 60) * 1000 + frac;
+    return true;
+}
+
+static void copy_text(char *dst, size_t size, const char *s) {
+    size_t n = s ? strnlen(s, size - 1) : 0;
+    memcpy(dst, s ? s : "", n);
+    dst[n] = 0;
+}
+
+static void read_meta(ACS_ThermalImage *img, ImageMeta *m) {
+    memset(m, 0, sizeof(*m));
+    if (!img)
+        return;
+    ACS_Image_CameraInformation *info = ACS_ThermalImage_getCameraInformation(img);
+    if (info && !ACS_getLastErrorCode()) {
+        copy_text(m->model, sizeof(m->model), ACS_Image_CameraInformation_getModelName(info));
+        copy_text(m->serial, sizeof(m->serial), ACS_Image_CameraInformation_getSerialNumber(info));
+        const char *date = ACS_Image_CameraInformation_getArcDateTime(info);
+        m->has_time = date && parse_datetime(date, &m->time_ms);
+    }
+    if (info)
+        ACS_Image_CameraInformation_free(info);
+
+    ACS_GpsInformation gps = ACS_ThermalImage_getGpsInformation(img);
+    if (ACS_getLastErrorCode() || !gps.isValid)
+        return;
+    // Graus com sinal, como as ferramentas de análise esperam
+    m->has_gps = true;
+    m->latitude = gps.latitudeRef == 'S' ? -fabs(gps.latitude) : gps.latitude;
+    m->longitude = gps.longitudeRef == 'W' ? -fabs(gps.longitude) : gps.longitude;
+    m->altitude = gps.altitudeRef == 1 ? -fabs(gps.altitude) : gps.altitude;
+    if (!m->has_time && gps.timeStamp) {
+        m->has_time = true;
+        m->time_ms = (int64_t)gps.timeStamp * 1000;
+    }
+}
+
+// ---------------------------------------------------------------------------
+
+bool arrow_begin(ArrowWriter *w, OutBuf *out, TempUnit unit) {
+    memset(w, 0, sizeof(*w));
+    pthread_mutex_init(&w->lock, NULL);
+    w->out = out;
+    w->unit = unit;
+    out_init_memory(&w->meta, 4096);
+    for (size_t i = 0; i < ARROW_COLUMNS; ++i) {
+        out_init_memory(&w->columns[i].validity, 256);
+        out_init_memory(&w->columns[i].offsets, 256);
+        out_init_memory(&w->columns[i].values, 4096);
+        column_reset(&w->columns[i], COLUMNS[i].type);
+    }
+
+    out_write(out, ARROW_MAGIC "\0\0", 8);
+    w->pos = 8;
+    size_t header;
+    begin_message(&w->meta, HEADER_SCHEMA, 0, &header);
+    fb_patch(&w->meta, header, write_schema(&w->meta, unit));
+    if (w->meta.failed)
+        return engine_fail("sem memória para o esquema Arrow");
+    int32_t meta_len;
+    emit_message(w, &meta_len);
+    return !out->failed || engine_fail("falha ao gravar o arquivo Arrow");
+}
+
+bool arrow_append(ArrowWriter *w, ACS_ThermalImage *img, const char *file, const Frame *frame) {
+    if (!frame->values)
+        return engine_fail("Arrow precisa da matriz em double");
+    size_t n = (size_t)frame->width * (size_t)frame->height;
+    // Fora da trava: os metadados vêm do SDK da thread chamadora
+    ImageMeta m;
+    read_meta(img, &m);
+
+    pthread_mutex_lock(&w->lock);
+    bool ok = true;
+    if (w->rows && (w->rows >= ARROW_BATCH_ROWS || w->values + n > ARROW_BATCH_VALUES))
+        ok = flush_batch(w);
+    if (ok) {
+        size_t row = w->rows++;
+        ArrowColumn *c = w->columns;
+        push_text(&c[C_FILE], row, file);
+        push_i64(&c[C_TIMESTAMP], row, m.has_time, m.time_ms);
+        push_text(&c[C_MODEL], row, m.model);
+        push_text(&c[C_SERIAL], row, m.serial);
+        push_f64(&c[C_LATITUDE], row, m.has_gps, m.latitude);
+        push_f64(&c[C_LONGITUDE], row, m.has_gps, m.longitude);
+        push_f64(&c[C_ALTITUDE], row, m.has_gps, m.altitude);
+        push_text(&c[C_PARAMS], row, frame->params);
+        push_i32(&c[C_ROI_X], row, frame->rect.x);
+        push_i32(&c[C_ROI_Y], row, frame->rect.y);
+        push_i32(&c[C_WIDTH], row, frame->width);
+        push_i32(&c[C_HEIGHT], row, frame->height);
+        push_f64(&c[C_MIN], row, true, frame->stats.min);
+        push_f64(&c[C_MAX], row, true, frame->stats.max);
+        push_f64(&c[C_MEAN], row, true, frame->stats.mean);
+        push_matrix(&c[C_TEMPERATURE], row, frame->values, n);
+        w->values += n;
+    }
+    pthread_mutex_unlock(&w->lock);
+    return ok;
+}
+
+bool arrow_finish(ArrowWriter *w) {
+    if (w->rows && !flush_batch(w))
+        return false;
+    fb_put(w->out, ARROW_CONTINUATION, 4);
+    fb_put(w->out, 0, 4);
+
+    // Footer: version, schema, dictionaries, recordBatches
+    OutBuf *b = &w->meta;
+    b->len = 0;
+    b->failed = false;
+    fb_put(b, 0, 4);
+    FbField f[] = { FB_I16(METADATA_V5), FB_OFS, FB_OFS, FB_OFS };
+    size_t pos[4], first;
+    fb_patch(b, 0, fb_table(b, f, 4, pos));
+    fb_patch(b, pos[1], write_schema(b, w->unit));
+    fb_patch(b, pos[2], fb_vector(b, 0, 8, NULL));
+    fb_patch(b, pos[3], fb_vector(b, w->block_count, 8, &first));
+    for (size_t i = 0; i < w->block_count; ++i) {
+        fb_put(b, (uint64_t)w->blocks[i].offset, 8);
+        fb_put(b, (uint32_t)w->blocks[i].meta_len, 4);
+        fb_put(b, 0, 4);
+        fb_put(b, (uint64_t)w->blocks[i].body_len, 8);
+    }
+    if (b->failed)
+        return engine_fail("sem memória para o rodapé Arrow");
+    out_write(w->out, b->data, b->len);
+    fb_put(w->out, b->len, 4);
+    out_write(w->out, ARROW_MAGIC, 6);
+    return !w->out->failed || engine_fail("falha ao gravar o arquivo Arrow");
+}
+
+void arrow_free(ArrowWriter *w) {
+    out_free(&w->meta);
+    for (size_t i = 0; i < ARROW_COLUMNS; ++i) {
+        out_free(&w->columns[i].validity);
+        out_free(&w->columns[i].offsets);
+        out_free(&w->columns[i].values);
+    }
+    free(w->blocks);
+    w->blocks = NULL;
+    pthread_mutex_destroy(&w->lock);
+}
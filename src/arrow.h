@@ -0,0 +1,72 @@
+#ifndef FLIR2JSON_ARROW_H
+#define FLIR2JSON_ARROW_H
+
+#include <acs/thermal_image.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "engine.h"
+#include "output.h"
+
+// Arquivo Arrow IPC (formato de arquivo, versão V5) com uma linha por matriz extraída,
+// para Spark/DuckDB/pandas lerem sem passar por CSV. Colunas:
+//   file, params               utf8 (nulos: sem arquivo / sem variante)
+//   timestamp                  timestamp[ms, UTC] da data da câmera (ou do GPS); nulo sem data
+//   camera_model, camera_serial  utf8, nulos quando vazios
+//   latitude, longitude, altitude  float64 com sinal (S/W e abaixo do mar negativos); nulos sem GPS
+//   roi_x, roi_y, width, height    int32: retângulo em pixels da imagem e dimensões da matriz
+//   min, max, mean             float64 da resolução cheia
+//   temperature                list<float32>: a matriz em ordem de linhas
+// A unidade vai nos metadados do esquema ("flir2json.unit"). As linhas se acumulam em
+// lotes colunares (record batches, os "row groups" do arquivo) de até ARROW_BATCH_ROWS
+// linhas ou ARROW_BATCH_VALUES temperaturas; o rodapé com os lotes sai em arrow_finish.
+//
+// O esquema e os lotes são flatbuffers montados à mão (sem a biblioteca do Arrow).
+
+#define ARROW_BATCH_ROWS 1024
+#define ARROW_BATCH_VALUES (4u << 20)
+
+#define ARROW_COLUMNS 16
+
+typedef struct {
+    OutBuf validity; // um bit por linha
+    OutBuf offsets;  // utf8 e lista: int32, começando em 0
+    OutBuf values;
+    size_t nulls;
+} ArrowColumn;
+
+typedef struct {
+    int64_t offset;
+    int32_t meta_len;
+    int64_t body_len;
+} ArrowBlock;
+
+typedef struct {
+    pthread_mutex_t lock;  // arrow_append pode vir de várias threads (lote)
+    OutBuf *out;
+    uint64_t pos;          // bytes já entregues a `out`: offsets do rodapé
+    TempUnit unit;
+    ArrowColumn columns[ARROW_COLUMNS];
+    size_t rows;           // no lote em montagem
+    size_t values;
+    ArrowBlock *blocks;
+    size_t block_count;
+    size_t block_capacity;
+    OutBuf meta;           // flatbuffer da mensagem atual, reaproveitado
+} ArrowWriter;
+
+// Grava a assinatura e o esquema; erros em engine_last_error()
+bool arrow_begin(ArrowWriter *w, OutBuf *out, TempUnit unit);
+
+// Acrescenta a matriz de `frame` (valores double) com os metadados de `img` (NULL: só
+// dimensões e estatísticas); `file` pode ser NULL. Descarrega o lote quando enche.
+bool arrow_append(ArrowWriter *w, ACS_ThermalImage *img, const char *file, const Frame *frame);
+
+// Último lote, marcador de fim do stream e rodapé
+bool arrow_finish(ArrowWriter *w);
+
+void arrow_free(ArrowWriter *w);
+
+#endif
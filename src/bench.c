@@ -0,0 +1,270 @@
+#include <acs/thermal_image.h>
+#include "engine.h"
+#include "input.h"
+#include "kernels.h"
+#include "output.h"
+#include "serialize.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// bench: mede decodificação, extração e serialização de cada caminho de pixel
+// (getValues, sinal + LUT escalar, sinal + LUT SIMD) em cada formato de saída, sobre
+// imagens informadas e quadros sintéticos. Resultados em JSON para comparar versões.
+
+#define BENCH_DEFAULT_REPEAT 20
+#define BENCH_DEFAULT_SYNTHETIC "160x120,640x480,1280x960"
+#define BENCH_MAX_SAMPLES 64
+
+typedef struct {
+    const char *name;
+    Engine engine;
+    const char *isa; // variante dos kernels; NULL = a melhor da CPU
+} PixelPath;
+
+static const PixelPath paths[] = {
+    { "values", ENGINE_VALUES, NULL },
+    { "signal", ENGINE_SIGNAL, "scalar" },
+    { "simd", ENGINE_SIGNAL, NULL },
+};
+
+static const struct {
+    const char *name;
+    OutputFormat format;
+} formats[] = {
+    { "csv", FORMAT_CSV },
+    { "json", FORMAT_JSON },
+    { "bin", FORMAT_BIN },
+};
+
+// Arquivo radiométrico inteiro em memória: cada iteração decodifica com openFromMemory
+typedef struct {
+    char name[256];
+    unsigned char *data;
+    size_t len;
+} Sample;
+
+typedef struct {
+    uint64_t decode_ns;
+    uint64_t extract_ns;
+    uint64_t serialize_ns;
+    uint64_t bytes;
+    int width;
+    int height;
+} Totals;
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Uso: %s [imagem_radiometrica...] [opções]\n"
+            "  --synthetic WxH[,WxH...]  quadros sintéticos (padrão %s; \"none\" desliga)\n"
+            "  --repeat N           iterações medidas por combinação (padrão %d)\n"
+            "  --out arquivo.json   resultados em JSON (padrão: saída padrão)\n",
+            prog, BENCH_DEFAULT_SYNTHETIC, BENCH_DEFAULT_REPEAT);
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+// Gradiente com ruído e um ponto quente (input_synthetic)
+static bool make_synthetic(int width, int height, Sample *s) {
+    snprintf(s->name, sizeof(s->name), "synthetic-%dx%d", width, height);
+    return input_synthetic(width, height, &s->data, &s->len);
+}
+
+// Uma combinação: uma iteração de aquecimento e `repeat` medidas
+static bool run_case(ACS_ThermalImage *img, const Sample *s, const PixelPath *path, OutputFormat format,
+                     int repeat, Workspace *ws, OutBuf *out, Totals *t) {
+    OutputOptions oo = { format, DTYPE_F32, 0.01, 0.0, CSV_DEFAULT_DIALECT };
+    ExtractOptions ext = { .engine = path->engine, .unit = UNIT_CELSIUS };
+    output_configure_extract(&oo, &ext);
+    if (!kernel_force(path->isa))
+        return engine_fail("variante de kernel indisponível: %s", path->isa);
+    memset(t, 0, sizeof(*t));
+
+    for (int i = -1; i < repeat; ++i) {
+        uint64_t t0 = now_ns();
+        ACS_ThermalImage_openFromMemory(img, s->data, s->len);
+        if (ACS_getLastErrorCode())
+            return engine_fail("imagem radiométrica inválida: %s", ACS_getLastErrorMessage());
+        uint64_t t1 = now_ns();
+        ACS_Rectangle rect = { 0, 0, ACS_ThermalImage_getWidth(img), ACS_ThermalImage_getHeight(img) };
+        Frame frame;
+        if (!engine_prepare(img, &ext) || !engine_extract(img, &rect, &ext, ws, &frame))
+            return false;
+        uint64_t t2 = now_ns();
+        out->len = 0;
+        size_t clipped = 0;
+        bool ok = format == FORMAT_BIN ? serialize_bin(out, img, &frame, &oo, ws, &clipped)
+                : format == FORMAT_JSON ? serialize_json(out, img, &frame)
+                                        : serialize_csv(out, &frame, NULL);
+        if (!ok || out->failed)
+            return engine_fail("sem memória ao serializar");
+        uint64_t t3 = now_ns();
+        if (i < 0)
+            continue;
+        t->decode_ns += t1 - t0;
+        t->extract_ns += t2 - t1;
+        t->serialize_ns += t3 - t2;
+        t->bytes += out->len;
+        t->width = rect.width;
+        t->height = rect.height;
+    }
+    return true;
+}
+
+static void write_result(OutBuf *json, bool first, const Sample *s, const PixelPath *path, const char *format,
+                         int repeat, const Totals *t) {
+    uint64_t total = t->decode_ns + t->extract_ns + t->serialize_ns;
+    double seconds = (double)total / 1e9;
+    double pixels = (double)t->width * t->height;
+    out_str(json, first ? "\n    {" : ",\n    {");
+    out_str(json, "\"image\": ");
+    out_json_string(json, s->name);
+    out_str(json, ", \"width\": ");
+    out_int(json, t->width);
+    out_str(json, ", \"height\": ");
+    out_int(json, t->height);
+    out_str(json, ", \"path\": \"");
+    out_str(json, path->name);
+    out_str(json, "\", \"isa\": \"");
+    out_str(json, path->engine == ENGINE_VALUES ? "sdk" : kernel_isa());
+    out_str(json, "\", \"format\": \"");
+    out_str(json, format);
+    out_str(json, "\", \"frames\": ");
+    out_int(json, repeat);
+    out_str(json, ", \"fps\": ");
+    out_json_number(json, seconds > 0 ? repeat / seconds : 0.0, 2);
+    out_str(json, ", \"mb_per_s\": ");
+    out_json_number(json, seconds > 0 ? (double)t->bytes / 1e6 / seconds : 0.0, 2);
+    out_str(json, ", \"output_bytes\": ");
+    out_uint(json, t->bytes / (uint64_t)repeat);
+    out_str(json, ", \"ns\": {\"decode\": ");
+    out_uint(json, t->decode_ns / (uint64_t)repeat);
+    out_str(json, ", \"extract\": ");
+    out_uint(json, t->extract_ns / (uint64_t)repeat);
+    out_str(json, ", \"serialize\": ");
+    out_uint(json, t->serialize_ns / (uint64_t)repeat);
+    out_str(json, "}, \"ns_per_pixel\": {\"extract\": ");
+    out_json_number(json, (double)t->extract_ns / repeat / pixels, 3);
+    out_str(json, ", \"serialize\": ");
+    out_json_number(json, (double)t->serialize_ns / repeat / pixels, 3);
+    out_str(json, "}}");
+
+    fprintf(stderr, "%-24s %-7s %-5s %9.1f fps %9.1f MB/s  decode %9.0f  extract %9.0f  serialize %9.0f ns\n",
+            s->name, path->name, format, seconds > 0 ? repeat / seconds : 0.0,
+            seconds > 0 ? (double)t->bytes / 1e6 / seconds : 0.0, (double)t->decode_ns / repeat,
+            (double)t->extract_ns / repeat, (double)t->serialize_ns / repeat);
+}
+
+int main(int argc, char **argv) {
+    const char *synthetic = BENCH_DEFAULT_SYNTHETIC, *out_path = NULL;
+    const char *inputs[BENCH_MAX_SAMPLES];
+    size_t input_count = 0;
+    int repeat = BENCH_DEFAULT_REPEAT;
+    for (int i = 1; i < argc; ++i) {
+        const char *arg = argv[i];
+        if (strncmp(arg, "--", 2) != 0) {
+            if (input_count == BENCH_MAX_SAMPLES) {
+                usage(argv[0]);
+                return 1;
+            }
+            inputs[input_count++] = arg;
+            continue;
+        }
+        const char *val = i + 1 < argc ? argv[++i] : NULL;
+        bool ok = val != NULL;
+        if (ok && strcmp(arg, "--synthetic") == 0) synthetic = val;
+        else if (ok && strcmp(arg, "--out") == 0) out_path = val;
+        else if (ok && strcmp(arg, "--repeat") == 0) {
+            char *end;
+            long n = strtol(val, &end, 10);
+            ok = !*end && n >= 1 && n <= 100000;
+            repeat = (int)n;
+        } else ok = false;
+        if (!ok) {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    Sample samples[BENCH_MAX_SAMPLES];
+    size_t count = 0;
+    memset(samples, 0, sizeof(samples));
+    for (size_t i = 0; i < input_count; ++i) {
+        Sample *s = &samples[count];
+        snprintf(s->name, sizeof(s->name), "%s", inputs[i]);
+        if (!input_read_file(inputs[i], &s->data, &s->len)) {
+            fprintf(stderr, "Erro ao ler %s: %s\n", inputs[i], strerror(errno));
+            return 1;
+        }
+        ++count;
+    }
+    for (const char *p = synthetic; strcmp(synthetic, "none") != 0 && *p && count < BENCH_MAX_SAMPLES;) {
+        int w, h, n = 0;
+        if (sscanf(p, "%dx%d%n", &w, &h, &n) != 2 || w <= 0 || h <= 0 || w > 8192 || h > 8192 ||
+            (p[n] && p[n] != ',')) {
+            fprintf(stderr, "--synthetic inválido: %s (esperado WxH[,WxH...])\n", synthetic);
+            return 1;
+        }
+        if (!make_synthetic(w, h, &samples[count])) {
+            fprintf(stderr, "Erro ao gerar quadro sintético %dx%d: %s\n", w, h, ACS_getLastErrorMessage());
+            return 1;
+        }
+        ++count;
+        p += n + (p[n] == ',');
+    }
+    if (!count) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    FILE *fp = out_path ? fopen(out_path, "w") : stdout;
+    if (!fp) {
+        perror("Erro ao criar o arquivo de resultados");
+        return 1;
+    }
+    OutBuf json, doc;
+    out_init_file(&json, fp, 0);
+    out_init_memory(&doc, 0);
+    Workspace ws = { 0 };
+    ACS_ThermalImage *img = ACS_ThermalImage_alloc();
+
+    out_str(&json, "{\n  \"repeat\": ");
+    out_int(&json, repeat);
+    out_str(&json, ",\n  \"simd\": \"");
+    out_str(&json, kernel_isa());
+    out_str(&json, "\",\n  \"results\": [");
+    bool ok = true, first = true;
+    for (size_t i = 0; ok && i < count; ++i)
+        for (size_t p = 0; ok && p < sizeof(paths) / sizeof(paths[0]); ++p)
+            for (size_t f = 0; ok && f < sizeof(formats) / sizeof(formats[0]); ++f) {
+                Totals t;
+                ok = run_case(img, &samples[i], &paths[p], formats[f].format, repeat, &ws, &doc, &t);
+                if (ok)
+                    write_result(&json, first, &samples[i], &paths[p], formats[f].name, repeat, &t);
+                first = false;
+            }
+    out_str(&json, "\n  ]\n}\n");
+    if (!ok)
+        fprintf(stderr, "%s\n", engine_last_error());
+    bool written = out_flush(&json);
+    if (fp != stdout && fclose(fp) != 0)
+        written = false;
+    if (!written)
+        perror("Erro ao gravar os resultados");
+
+    out_free(&json);
+    out_free(&doc);
+    workspace_free(&ws);
+    ACS_ThermalImage_free(img);
+    for (size_t i = 0; i < count; ++i)
+        free(samples[i].data);
+    return ok && written ? 0 : 1;
+}
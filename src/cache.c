@@ -0,0 +1,440 @@
+#include "cache.h"
+
+#include <dirent.h>
+#include <endian.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/random.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static inline uint64_t rotl(uint64_t v, int r) {
+    return (v << r) | (v >> (64 - r));
+}
+
+// SipHash-2-4 com saída de 128 bits, incremental (o corpo e as opções são dois pedaços)
+typedef struct {
+    uint64_t v0, v1, v2, v3;
+    uint64_t tail;   // bytes pendentes, little-endian
+    size_t ntail;
+    uint64_t total;
+} SipState;
+
+static inline void sip_round(SipState *s) {
+    s->v0 += s->v1; s->v1 = rotl(s->v1, 13); s->v1 ^= s->v0; s->v0 = rotl(s->v0, 32);
+    s->v2 += s->v3; s->v3 = rotl(s->v3, 16); s->v3 ^= s->v2;
+    s->v0 += s->v3; s->v3 = rotl(s->v3, 21); s->v3 ^= s->v0;
+    s->v2 += s->v1; s->v1 = rotl(s->v1, 17); s->v1 ^= s->v2; s->v2 = rotl(s->v2, 32);
+}
+
+static inline void sip_block(SipState *s, uint64_t m) {
+    s->v3 ^= m;
+    sip_round(s);
+    sip_round(s);
+    s->v0 ^= m;
+}
+
+static void sip_init(SipState *s, const uint64_t k[2]) {
+    s->v0 = k[0] ^ 0x736f6d6570736575ULL;
+    s->v1 = k[1] ^ 0x646f72616e646f6dULL ^ 0xee;
+    s->v2 = k[0] ^ 0x6c7967656e657261ULL;
+    s->v3 = k[1] ^ 0x7465646279746573ULL;
+    s->tail = 0;
+    s->ntail = 0;
+    s->total = 0;
+}
+
+static void sip_update(SipState *s, const unsigned char *p, size_t len) {
+    s->total += len;
+    while (s->ntail && len) {
+        s->tail |= (uint64_t)*p++ << (8 * s->ntail);
+        --len;
+        if (++s->ntail == 8) {
+            sip_block(s, s->tail);
+            s->tail = 0;
+            s->ntail = 0;
+        }
+    }
+    for (; len >= 8; p += 8, len -= 8) {
+        uint64_t w;
+        memcpy(&w, p, sizeof(w));
+        sip_block(s, le64toh(w));
+    }
+    for (size_t k = 0; k < len; ++k)
+        s->tail |= (uint64_t)p[k] << (8 * k);
+    s->ntail = len;
+}
+
+static CacheKey sip_final(SipState *s) {
+    sip_block(s, s->tail | s->total << 56);
+    CacheKey key;
+    s->v2 ^= 0xee;
+    for (int r = 0; r < 4; ++r)
+        sip_round(s);
+    key.lo = s->v0 ^ s->v1 ^ s->v2 ^ s->v3;
+    s->v1 ^= 0xdd;
+    for (int r = 0; r < 4; ++r)
+        sip_round(s);
+    key.hi = s->v0 ^ s->v1 ^ s->v2 ^ s->v3;
+    return key;
+}
+
+CacheKey cache_key(const ResultCache *cache, const void *body, size_t len, const char *options) {
+    SipState s;
+    sip_init(&s, cache->hash_key);
+    sip_update(&s, body, len);
+    // O tamanho do corpo separa os dois pedaços: corpo+opções não se confundem com outra divisão
+    uint64_t blen = htole64((uint64_t)len);
+    sip_update(&s, (const unsigned char *)&blen, sizeof(blen));
+    sip_update(&s, (const unsigned char *)options, strlen(options));
+    return sip_final(&s);
+}
+
+// Chave do hash: na pasta do cache, para os arquivos continuarem valendo depois de um
+// reinício; sem pasta, sorteada a cada partida. O link só publica o arquivo completo, e
+// quem perde a corrida (outro processo na mesma pasta) lê a chave do vencedor
+static bool read_hash_key(const char *path, uint64_t key[2]) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+    bool ok = read(fd, key, 2 * sizeof(*key)) == (ssize_t)(2 * sizeof(*key));
+    close(fd);
+    return ok;
+}
+
+static bool load_hash_key(const char *dir, uint64_t key[2]) {
+    char path[4096], tmp[4200];
+    if (dir) {
+        snprintf(path, sizeof(path), "%s/" CACHE_KEY_FILE, dir);
+        if (read_hash_key(path, key))
+            return true;
+    }
+    if (getrandom(key, 2 * sizeof(*key), 0) != (ssize_t)(2 * sizeof(*key)))
+        return false;
+    if (!dir)
+        return true;
+    snprintf(tmp, sizeof(tmp), "%s.%ld.tmp", path, (long)getpid());
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0)
+        return false;
+    bool ok = write(fd, key, 2 * sizeof(*key)) == (ssize_t)(2 * sizeof(*key));
+    ok = close(fd) == 0 && ok;
+    if (ok && link(tmp, path) != 0)
+        ok = errno == EEXIST && read_hash_key(path, key);
+    unlink(tmp);
+    return ok;
+}
+
+static size_t disk_scan(const ResultCache *cache, bool trim);
+
+bool cache_init(ResultCache *cache, size_t capacity, const char *dir, size_t disk_capacity) {
+    memset(cache, 0, sizeof(*cache));
+    pthread_mutex_init(&cache->lock, NULL);
+    pthread_mutex_init(&cache->disk_lock, NULL);
+    cache->capacity = capacity;
+    cache->dir = dir;
+    cache->disk_capacity = disk_capacity;
+    if (!load_hash_key(dir, cache->hash_key))
+        return false;
+    if (dir)
+        atomic_init(&cache->disk_bytes, disk_scan(cache, disk_capacity > 0));
+    return true;
+}
+
+static void entry_free(CacheEntry *e) {
+    free(e->options);
+    if (e->map)
+        munmap(e->map, e->map_len);
+    else
+        free(e->data);
+    free(e);
+}
+
+void cache_release(CacheEntry *e) {
+    if (e && atomic_fetch_sub_explicit(&e->refs, 1, memory_order_acq_rel) == 1)
+        entry_free(e);
+}
+
+void cache_free(ResultCache *cache) {
+    for (CacheEntry *e = cache->head, *next; e; e = next) {
+        next = e->next;
+        cache_release(e);
+    }
+    pthread_mutex_destroy(&cache->lock);
+    pthread_mutex_destroy(&cache->disk_lock);
+    memset(cache, 0, sizeof(*cache));
+}
+
+static inline CacheEntry **bucket(ResultCache *cache, const CacheKey *key) {
+    return &cache->buckets[key->lo & (CACHE_BUCKETS - 1)];
+}
+
+static bool entry_matches(const CacheEntry *e, const CacheKey *key, const char *options, uint64_t body_len) {
+    return e->key.lo == key->lo && e->key.hi == key->hi && e->body_len == body_len &&
+           strcmp(e->options, options) == 0;
+}
+
+// Com a trava: tira da LRU e da tabela, devolvendo a referência da LRU
+static void unlink_entry(ResultCache *cache, CacheEntry *e) {
+    for (CacheEntry **p = bucket(cache, &e->key); *p; p = &(*p)->chain)
+        if (*p == e) {
+            *p = e->chain;
+            break;
+        }
+    if (e->prev) e->prev->next = e->next;
+    else cache->head = e->next;
+    if (e->next) e->next->prev = e->prev;
+    else cache->tail = e->prev;
+    e->prev = e->next = e->chain = NULL;
+    e->linked = false;
+    cache->bytes -= e->len;
+    cache_release(e);
+}
+
+static void move_to_front(ResultCache *cache, CacheEntry *e) {
+    if (cache->head == e)
+        return;
+    e->prev->next = e->next;
+    if (e->next) e->next->prev = e->prev;
+    else cache->tail = e->prev;
+    e->prev = NULL;
+    e->next = cache->head;
+    cache->head->prev = e;
+    cache->head = e;
+}
+
+// Com a trava: põe na frente da LRU (a LRU ganha uma referência) e descarta o fim
+// até caber. Uma entrada igual já presente (outra thread chegou antes) é substituída.
+static void link_entry(ResultCache *cache, CacheEntry *e) {
+    for (CacheEntry *old = *bucket(cache, &e->key); old; old = old->chain)
+        if (entry_matches(old, &e->key, e->options, e->body_len)) {
+            unlink_entry(cache, old);
+            break;
+        }
+    atomic_fetch_add_explicit(&e->refs, 1, memory_order_relaxed);
+    e->linked = true;
+    e->chain = *bucket(cache, &e->key);
+    *bucket(cache, &e->key) = e;
+    e->next = cache->head;
+    if (cache->head) cache->head->prev = e;
+    else cache->tail = e;
+    cache->head = e;
+    cache->bytes += e->len;
+    while (cache->bytes > cache->capacity && cache->tail != e)
+        unlink_entry(cache, cache->tail);
+}
+
+static CacheEntry *entry_create(const CacheKey *key, const char *options, uint64_t body_len, const char *content_type,
+                                unsigned char *data, size_t len) {
+    size_t olen = strlen(options) + 1;
+    CacheEntry *e = calloc(1, sizeof(*e));
+    if (!e || !(e->options = malloc(olen))) {
+        free(e);
+        free(data);
+        return NULL;
+    }
+    memcpy(e->options, options, olen);
+    atomic_init(&e->refs, 1);
+    e->key = *key;
+    e->body_len = body_len;
+    snprintf(e->content_type, sizeof(e->content_type), "%s", content_type);
+    e->data = data;
+    e->len = len;
+    return e;
+}
+
+static bool admits(const ResultCache *cache, size_t len) {
+    return cache->capacity && len <= cache->capacity / CACHE_MAX_ENTRY_FRACTION;
+}
+
+// Arquivo da camada em disco: cabeçalho fixo (ordem nativa; o diretório é local à
+// máquina) seguido das opções, do content type e da resposta
+typedef struct {
+    char magic[4];      // "F2JC"
+    uint32_t version;   // 1
+    uint64_t body_len;
+    uint64_t data_len;
+    uint32_t options_len;
+    uint32_t type_len;
+} DiskHeader;
+
+static void disk_path(const ResultCache *cache, const CacheKey *key, char *path, size_t size) {
+    snprintf(path, size, "%s/%016llx%016llx" CACHE_FILE_SUFFIX, cache->dir, (unsigned long long)key->hi,
+             (unsigned long long)key->lo);
+}
+
+typedef struct {
+    time_t mtime;
+    size_t size;
+    char name[40];
+} DiskFile;
+
+static int by_mtime(const void *a, const void *b) {
+    time_t x = ((const DiskFile *)a)->mtime, y = ((const DiskFile *)b)->mtime;
+    return (x > y) - (x < y);
+}
+
+// Soma os arquivos da camada em disco. Com `trim`, passando do limite apaga os de mtime
+// mais antigo (acertos renovam o mtime) até 3/4 dele, para não varrer a pasta a cada
+// gravação. Quem ainda tem um arquivo apagado mapeado continua lendo dele
+static size_t disk_scan(const ResultCache *cache, bool trim) {
+    DIR *dir = opendir(cache->dir);
+    if (!dir)
+        return 0;
+    DiskFile *files = NULL;
+    size_t count = 0, cap = 0, total = 0;
+    struct dirent *de;
+    while ((de = readdir(dir))) {
+        size_t len = strlen(de->d_name);
+        struct stat st;
+        if (len != 32 + sizeof(CACHE_FILE_SUFFIX) - 1 || strcmp(de->d_name + 32, CACHE_FILE_SUFFIX) != 0 ||
+            fstatat(dirfd(dir), de->d_name, &st, 0) != 0)
+            continue;
+        total += (size_t)st.st_size;
+        if (!trim)
+            continue;
+        if (count == cap) {
+            DiskFile *grown = realloc(files, (cap = cap ? cap * 2 : 256) * sizeof(*files));
+            if (!grown) {
+                trim = false;
+                continue;
+            }
+            files = grown;
+        }
+        files[count].mtime = st.st_mtime;
+        files[count].size = (size_t)st.st_size;
+        memcpy(files[count].name, de->d_name, len + 1);
+        ++count;
+    }
+    if (trim && total > cache->disk_capacity) {
+        qsort(files, count, sizeof(*files), by_mtime);
+        size_t target = cache->disk_capacity / 4 * 3;
+        for (size_t i = 0; i < count && total > target; ++i)
+            if (unlinkat(dirfd(dir), files[i].name, 0) == 0)
+                total -= files[i].size;
+    }
+    free(files);
+    closedir(dir);
+    return total;
+}
+
+static void disk_store(ResultCache *cache, const CacheEntry *e) {
+    char path[4096], tmp[4200];
+    static atomic_uint serial;
+    disk_path(cache, &e->key, path, sizeof(path));
+    snprintf(tmp, sizeof(tmp), "%s.%ld.%u.tmp", path, (long)getpid(), atomic_fetch_add(&serial, 1));
+    FILE *fp = fopen(tmp, "wb");
+    if (!fp)
+        return;
+    DiskHeader h = { { 'F', '2', 'J', 'C' }, 1, e->body_len, e->len, (uint32_t)strlen(e->options),
+                     (uint32_t)strlen(e->content_type) };
+    bool ok = fwrite(&h, sizeof(h), 1, fp) == 1 && fwrite(e->options, 1, h.options_len, fp) == h.options_len &&
+              fwrite(e->content_type, 1, h.type_len, fp) == h.type_len && fwrite(e->data, 1, e->len, fp) == e->len;
+    // O rename só publica arquivos completos para os leitores
+    if (fclose(fp) != 0 || !ok || rename(tmp, path) != 0) {
+        unlink(tmp);
+        return;
+    }
+    // A conta é aproximada (regravações e outros processos na pasta); a varredura a refaz.
+    // Uma varredura já em andamento basta: as outras threads não esperam por ela
+    size_t bytes = sizeof(h) + h.options_len + h.type_len + e->len;
+    bytes += atomic_fetch_add_explicit(&cache->disk_bytes, bytes, memory_order_relaxed);
+    if (cache->disk_capacity && bytes > cache->disk_capacity && pthread_mutex_trylock(&cache->disk_lock) == 0) {
+        atomic_store_explicit(&cache->disk_bytes, disk_scan(cache, true), memory_order_relaxed);
+        pthread_mutex_unlock(&cache->disk_lock);
+    }
+}
+
+// O arquivo é mapeado em vez de lido: a resposta sai direto das páginas do page cache.
+// Os arquivos só são publicados completos (rename) e nunca reescritos no lugar, então o
+// mapeamento continua válido mesmo que outro processo troque ou apague a entrada.
+static CacheEntry *disk_load(const ResultCache *cache, const CacheKey *key, const char *options, uint64_t body_len) {
+    char path[4096];
+    disk_path(cache, key, path, sizeof(path));
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return NULL;
+    struct stat st;
+    void *map = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(DiskHeader))
+        map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // O mtime marca o último uso, para a limpeza da pasta descartar primeiro os esquecidos
+    if (map != MAP_FAILED && cache->disk_capacity)
+        futimens(fd, NULL);
+    close(fd);
+    if (map == MAP_FAILED)
+        return NULL;
+
+    const unsigned char *p = map;
+    size_t size = (size_t)st.st_size, olen = strlen(options);
+    DiskHeader h;
+    memcpy(&h, p, sizeof(h));
+    CacheEntry *e = NULL;
+    char stored[sizeof(e->content_type)];
+    size_t offset = sizeof(h) + h.options_len + h.type_len;
+    if (memcmp(h.magic, "F2JC", 4) == 0 && h.version == 1 && h.body_len == body_len && h.options_len == olen &&
+        h.type_len < sizeof(stored) && offset <= size && h.data_len == size - offset &&
+        memcmp(p + sizeof(h), options, olen) == 0) {
+        memcpy(stored, p + sizeof(h) + olen, h.type_len);
+        stored[h.type_len] = '\0';
+        if ((e = entry_create(key, options, body_len, stored, NULL, 0))) {
+            e->data = (unsigned char *)map + offset;
+            e->len = (size_t)h.data_len;
+            e->map = map;
+            e->map_len = size;
+            return e;
+        }
+    }
+    munmap(map, size);
+    return NULL;
+}
+
+CacheEntry *cache_get(ResultCache *cache, const CacheKey *key, const char *options, uint64_t body_len) {
+    if (!cache_enabled(cache))
+        return NULL;
+    pthread_mutex_lock(&cache->lock);
+    CacheEntry *e = *bucket(cache, key);
+    while (e && !entry_matches(e, key, options, body_len))
+        e = e->chain;
+    if (e) {
+        move_to_front(cache, e);
+        atomic_fetch_add_explicit(&e->refs, 1, memory_order_relaxed);
+    }
+    pthread_mutex_unlock(&cache->lock);
+    if (e) {
+        atomic_fetch_add_explicit(&cache->hits, 1, memory_order_relaxed);
+        return e;
+    }
+
+    // Leitura do disco fora da trava; a entrada volta para a LRU
+    if (cache->dir && (e = disk_load(cache, key, options, body_len))) {
+        atomic_fetch_add_explicit(&cache->disk_hits, 1, memory_order_relaxed);
+        if (admits(cache, e->len)) {
+            pthread_mutex_lock(&cache->lock);
+            link_entry(cache, e);
+            pthread_mutex_unlock(&cache->lock);
+        }
+        return e;
+    }
+    atomic_fetch_add_explicit(&cache->misses, 1, memory_order_relaxed);
+    return NULL;
+}
+
+CacheEntry *cache_put(ResultCache *cache, const CacheKey *key, const char *options, uint64_t body_len,
+                      const char *content_type, unsigned char *data, size_t len) {
+    CacheEntry *e = entry_create(key, options, body_len, content_type, data, len);
+    if (!e || !cache_enabled(cache))
+        return e;
+    if (cache->dir)
+        disk_store(cache, e);
+    if (admits(cache, len)) {
+        pthread_mutex_lock(&cache->lock);
+        link_entry(cache, e);
+        pthread_mutex_unlock(&cache->lock);
+    }
+    return e;
+}
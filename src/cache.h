@@ -0,0 +1,89 @@
+#ifndef FLIR2JSON_CACHE_H
+#define FLIR2JSON_CACHE_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Cache de respostas endereçado por conteúdo: a chave é um hash de 128 bits com chave
+// secreta (SipHash) dos bytes enviados mais as opções da requisição, para um cliente não
+// conseguir montar um corpo diferente com a chave do de outro. As respostas codificadas
+// ficam numa LRU em memória limitada em bytes e, opcionalmente, também em disco (um
+// arquivo por chave, gravado na inserção e mapeado com mmap quando a memória não tem a
+// entrada), com limite próprio e descarte dos arquivos menos usados.
+//
+// As entradas têm contagem de referências: uma resposta pode continuar apontando
+// para os bytes da entrada (sem cópia) mesmo depois que a LRU a descarta.
+
+typedef struct {
+    uint64_t lo;
+    uint64_t hi;
+} CacheKey;
+
+typedef struct CacheEntry {
+    atomic_uint refs;
+    CacheKey key;
+    char *options;         // opções canônicas da requisição, comparadas no acerto
+    uint64_t body_len;     // tamanho da entrada original, idem
+    char content_type[64];
+    unsigned char *data;   // resposta codificada
+    size_t len;
+    void *map;             // relida do disco: arquivo mapeado, com data apontando para dentro dele
+    size_t map_len;
+    bool linked;           // ainda na LRU (protegido pela trava do cache)
+    struct CacheEntry *prev, *next; // LRU: head é o mais recente
+    struct CacheEntry *chain;       // colisões no mesmo balde
+} CacheEntry;
+
+// Baldes da tabela de dispersão (potência de 2)
+#define CACHE_BUCKETS 4096
+
+// Arquivo da chave do hash na pasta do cache (criado na primeira partida)
+#define CACHE_KEY_FILE "hash.key"
+#define CACHE_FILE_SUFFIX ".f2jc"
+
+typedef struct {
+    pthread_mutex_t lock;
+    size_t capacity;  // bytes de respostas em memória; 0 desliga o cache
+    size_t bytes;
+    uint64_t hash_key[2];
+    const char *dir;  // camada em disco, ou NULL
+    size_t disk_capacity;            // bytes da camada em disco; 0: sem limite
+    atomic_size_t disk_bytes;        // aproximado entre as varreduras da pasta
+    pthread_mutex_t disk_lock;       // uma varredura de limpeza por vez
+    CacheEntry *head, *tail;
+    CacheEntry *buckets[CACHE_BUCKETS];
+    atomic_uint_fast64_t hits;
+    atomic_uint_fast64_t disk_hits;
+    atomic_uint_fast64_t misses;
+} ResultCache;
+
+// Maior resposta guardada: uma fração da capacidade, para uma entrada não esvaziar a LRU
+#define CACHE_MAX_ENTRY_FRACTION 4
+
+// false se não houver como sortear ou gravar a chave do hash na pasta
+bool cache_init(ResultCache *cache, size_t capacity, const char *dir, size_t disk_capacity);
+void cache_free(ResultCache *cache);
+
+static inline bool cache_enabled(const ResultCache *cache) {
+    return cache->capacity > 0;
+}
+
+// SipHash-2-4 de 128 bits da entrada e das opções, com a chave do cache
+CacheKey cache_key(const ResultCache *cache, const void *body, size_t len, const char *options);
+
+// Entrada com a chave, com uma referência para o chamador (cache_release), ou NULL.
+// Sem entrada em memória, procura na camada em disco e a promove para a LRU.
+CacheEntry *cache_get(ResultCache *cache, const CacheKey *key, const char *options, uint64_t body_len);
+
+// Assume `data` (alocado com malloc) e devolve a entrada com uma referência para o
+// chamador. Respostas grandes demais não entram na LRU, mas a entrada devolvida vale
+// igual para enviar a resposta. NULL só sem memória (e `data` é liberado).
+CacheEntry *cache_put(ResultCache *cache, const CacheKey *key, const char *options, uint64_t body_len,
+                      const char *content_type, unsigned char *data, size_t len);
+
+void cache_release(CacheEntry *entry);
+
+#endif
@@ -0,0 +1,140 @@
+#include "compress.h"
+#include "engine.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <zlib.h>
+
+// Cabeçalho e rodapé do gzip além do que compressBound já conta para o zlib
+#define GZIP_OVERHEAD 18
+
+static void publish(GzipJob *job, size_t out_len, bool finished, bool failed) {
+    pthread_mutex_lock(&job->lock);
+    job->out_len = out_len;
+    job->finished = finished;
+    job->failed = failed;
+    if (job->notify)
+        job->notify(job);
+    if (finished)
+        pthread_cond_broadcast(&job->done);
+    pthread_mutex_unlock(&job->lock);
+}
+
+static void run_job(GzipJob *job) {
+    z_stream z;
+    memset(&z, 0, sizeof(z));
+    // windowBits 15 + 16: moldura gzip em vez de zlib
+    if (atomic_load(&job->cancel) ||
+        deflateInit2(&z, COMPRESS_LEVEL, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        publish(job, 0, true, true);
+        return;
+    }
+    z.next_out = job->out;
+    z.avail_out = (uInt)(compressBound(job->len) + GZIP_OVERHEAD);
+    size_t pos = 0;
+    int ret = Z_OK;
+    while (ret == Z_OK) {
+        if (atomic_load(&job->cancel))
+            break;
+        size_t n = job->len - pos < COMPRESS_SLICE_BYTES ? job->len - pos : COMPRESS_SLICE_BYTES;
+        z.next_in = (unsigned char *)job->data + pos;
+        z.avail_in = (uInt)n;
+        pos += n;
+        ret = deflate(&z, pos == job->len ? Z_FINISH : Z_NO_FLUSH);
+        if (ret == Z_OK)
+            publish(job, z.total_out, false, false);
+    }
+    deflateEnd(&z);
+    publish(job, z.total_out, true, ret != Z_STREAM_END);
+}
+
+static void *stage_thread(void *arg) {
+    CompressStage *stage = arg;
+    for (;;) {
+        pthread_mutex_lock(&stage->lock);
+        while (!stage->head)
+            pthread_cond_wait(&stage->wake, &stage->lock);
+        GzipJob *job = stage->head;
+        if (!(stage->head = job->next))
+            stage->tail = NULL;
+        pthread_mutex_unlock(&stage->lock);
+        run_job(job);
+    }
+    return NULL;
+}
+
+bool compress_init(CompressStage *stage, unsigned threads) {
+    memset(stage, 0, sizeof(*stage));
+    pthread_mutex_init(&stage->lock, NULL);
+    pthread_cond_init(&stage->wake, NULL);
+    for (unsigned i = 0; i < threads; ++i) {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, stage_thread, stage) != 0)
+            return engine_fail("falha ao iniciar o estágio de compressão");
+        pthread_detach(thread);
+        stage->threads++;
+    }
+    return true;
+}
+
+bool compress_submit(CompressStage *stage, GzipJob *job, const void *data, size_t len,
+                     void (*notify)(GzipJob *job), void *ctx) {
+    memset(job, 0, sizeof(*job));
+    // Capacidade para o pior caso: o buffer nunca cresce, então o leitor pode enviar
+    // os bytes já publicados sem cópia intermediária
+    if ((uint64_t)len > UINT32_MAX / 2 || !(job->out = malloc(compressBound(len) + GZIP_OVERHEAD)))
+        return false;
+    job->data = data;
+    job->len = len;
+    job->notify = notify;
+    job->ctx = ctx;
+    atomic_init(&job->cancel, false);
+    pthread_mutex_init(&job->lock, NULL);
+    pthread_cond_init(&job->done, NULL);
+
+    pthread_mutex_lock(&stage->lock);
+    if (stage->tail)
+        stage->tail->next = job;
+    else
+        stage->head = job;
+    stage->tail = job;
+    pthread_cond_signal(&stage->wake);
+    pthread_mutex_unlock(&stage->lock);
+    return true;
+}
+
+void compress_wait(GzipJob *job) {
+    pthread_mutex_lock(&job->lock);
+    while (!job->finished)
+        pthread_cond_wait(&job->done, &job->lock);
+    pthread_mutex_unlock(&job->lock);
+    pthread_mutex_destroy(&job->lock);
+    pthread_cond_destroy(&job->done);
+}
+
+bool compress_accepts_gzip(const char *s) {
+    // q da codificação gzip e do curinga; -1 enquanto não aparecem
+    double gzip = -1.0, any = -1.0;
+    while (s && *s) {
+        s += strspn(s, " \t,");
+        size_t len = strcspn(s, " \t;,");
+        if (!len)
+            break;
+        double q = 1.0;
+        const char *p = s + len;
+        while (*p && *p != ',') {
+            p += strspn(p, " \t;");
+            if ((*p == 'q' || *p == 'Q') && p[1] == '=')
+                q = strtod(p + 2, NULL);
+            p += strcspn(p, ";,");
+        }
+        if ((len == 4 && strncasecmp(s, "gzip", 4) == 0) || (len == 6 && strncasecmp(s, "x-gzip", 6) == 0))
+            gzip = q;
+        else if (len == 1 && *s == '*')
+            any = q;
+        s = p;
+    }
+    return gzip >= 0.0 ? gzip > 0.0 : any > 0.0;
+}
@@ -0,0 +1,63 @@
+#ifndef FLIR2JSON_COMPRESS_H
+#define FLIR2JSON_COMPRESS_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Compressão gzip das respostas do servidor num estágio separado: threads próprias
+// comprimem (zlib, nível rápido) documentos já montados, em fatias, e publicam a saída
+// à medida que sai, para que o envio comece antes do fim da compressão sem ocupar as
+// threads de conexão. A saída inteira fica num único buffer (deflateBound), que não
+// muda de lugar até o job ser liberado.
+
+// Nível do deflate: matrizes de temperatura comprimem bem mesmo no mais rápido
+#define COMPRESS_LEVEL 1
+
+// Entrada consumida por passo do deflate, publicada ao fim de cada passo
+#define COMPRESS_SLICE_BYTES (256u * 1024)
+
+// Documentos menores saem sem compressão
+#define COMPRESS_MIN_BYTES 1024
+
+typedef struct GzipJob {
+    const unsigned char *data; // entrada: intocada até `finished`
+    size_t len;
+    pthread_mutex_t lock;
+    pthread_cond_t done;
+    unsigned char *out;        // saída gzip; pertence ao chamador depois de `finished`
+    size_t out_len;            // bytes publicados (sob a trava)
+    bool finished;
+    bool failed;
+    atomic_bool cancel;        // ninguém mais quer a saída: o estágio para no próximo passo
+    void (*notify)(struct GzipJob *job); // na thread do estágio, com a trava tomada, após cada passo
+    void *ctx;
+    struct GzipJob *next;
+} GzipJob;
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    GzipJob *head, *tail;
+    unsigned threads; // 0: compressão desligada
+} CompressStage;
+
+// Inicia `threads` threads do estágio; erros em engine_last_error()
+bool compress_init(CompressStage *stage, unsigned threads);
+
+static inline bool compress_enabled(const CompressStage *stage) {
+    return stage->threads > 0;
+}
+
+// Prepara `job` sobre `data` e o põe na fila; false só sem memória para a saída
+bool compress_submit(CompressStage *stage, GzipJob *job, const void *data, size_t len,
+                     void (*notify)(GzipJob *job), void *ctx);
+
+// Espera o estágio terminar (ou desistir) do job e libera a trava; `out` continua com o chamador
+void compress_wait(GzipJob *job);
+
+// Accept-Encoding aceita gzip (gzip, x-gzip ou *, com q > 0)?
+bool compress_accepts_gzip(const char *accept_encoding);
+
+#endif
@@ -0,0 +1,133 @@
+#include "delta.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+void delta_init(DeltaEncoder *enc, unsigned interval) {
+    memset(enc, 0, sizeof(*enc));
+    enc->interval = interval ? interval : DELTA_DEFAULT_KEYFRAME;
+}
+
+void delta_free(DeltaEncoder *enc) {
+    free(enc->key);
+    free(enc->planes);
+    free(enc->packed);
+    delta_init(enc, enc->interval);
+}
+
+void delta_reset(DeltaEncoder *enc) {
+    enc->has_key = false;
+}
+
+static bool grow(void **buf, size_t *capacity, size_t size) {
+    if (size <= *capacity)
+        return true;
+    void *grown = realloc(*buf, size);
+    if (!grown)
+        return false;
+    *buf = grown;
+    *capacity = size;
+    return true;
+}
+
+static void put_u32le(unsigned char *p, uint32_t v) {
+    for (int i = 0; i < 4; ++i)
+        p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static void put_u64le(unsigned char *p, uint64_t v) {
+    for (int i = 0; i < 8; ++i)
+        p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static void put_f64le(unsigned char *p, double d) {
+    uint64_t v;
+    memcpy(&v, &d, sizeof(v));
+    put_u64le(p, v);
+}
+
+// Resíduo em zigue-zague, separado em planos de bytes: diferenças pequenas deixam o
+// plano alto quase todo zerado, que o deflate comprime bem
+static inline void put_residual(unsigned char *planes, size_t count, size_t i, uint16_t v, uint16_t ref) {
+    uint16_t d = (uint16_t)(v - ref);
+    uint16_t z = (uint16_t)((uint16_t)(d << 1) ^ (uint16_t)-(d >> 15));
+    planes[i] = (unsigned char)z;
+    planes[count + i] = (unsigned char)(z >> 8);
+}
+
+bool delta_encode(DeltaEncoder *enc, OutBuf *out, const Frame *frame, const OutputOptions *opt, uint64_t index,
+                  uint64_t stride) {
+    const uint16_t *v = frame->fixed;
+    if (!v)
+        return engine_fail("formato delta exige a matriz u16 do caminho de sinal");
+    size_t width = (size_t)frame->width;
+    size_t height = (size_t)frame->height;
+    size_t count = width * height;
+
+    bool key = !enc->has_key || enc->since_key >= enc->interval || frame->width != enc->width ||
+               frame->height != enc->height || (stride && index != enc->next_index);
+    uLong bound = compressBound((uLong)(count * 2));
+    if (!grow((void **)&enc->planes, &enc->planes_capacity, count * 2) ||
+        !grow((void **)&enc->packed, &enc->packed_capacity, bound) ||
+        (key && !grow((void **)&enc->key, &enc->key_capacity, count * sizeof(uint16_t))))
+        return engine_fail("sem memória para o quadro delta");
+
+    if (key) {
+        for (size_t y = 0; y < height; ++y) {
+            const uint16_t *row = v + y * width;
+            put_residual(enc->planes, count, y * width, row[0], y ? row[-(ptrdiff_t)width] : 0);
+            for (size_t x = 1; x < width; ++x)
+                put_residual(enc->planes, count, y * width + x, row[x], row[x - 1]);
+        }
+        memcpy(enc->key, v, count * sizeof(uint16_t));
+        enc->has_key = true;
+        enc->key_index = index;
+        enc->width = frame->width;
+        enc->height = frame->height;
+        enc->since_key = 0;
+    } else {
+        for (size_t i = 0; i < count; ++i)
+            put_residual(enc->planes, count, i, v[i], enc->key[i]);
+    }
+    enc->since_key++;
+    enc->next_index = index + stride;
+
+    // Nível 1: o ganho vem da codificação por diferença, não do esforço do deflate
+    uLongf packed = bound;
+    int codec = 1;
+    const unsigned char *payload = enc->packed;
+    if (compress2(enc->packed, &packed, enc->planes, (uLong)(count * 2), 1) != Z_OK || packed >= count * 2) {
+        codec = 0;
+        payload = enc->planes;
+        packed = (uLongf)(count * 2);
+    }
+
+    uLong crc = crc32(0L, Z_NULL, 0);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    for (size_t i = 0; i < count; ++i) {
+        unsigned char le[2] = { (unsigned char)v[i], (unsigned char)(v[i] >> 8) };
+        crc = crc32(crc, le, 2);
+    }
+#else
+    crc = crc32(crc, (const Bytef *)v, (uInt)(count * 2));
+#endif
+
+    unsigned char hdr[DELTA_HEADER_BYTES] = { 0 };
+    memcpy(hdr, DELTA_MAGIC, 4);
+    hdr[4] = 1;
+    hdr[5] = key ? DELTA_KEY : DELTA_DIFF;
+    hdr[6] = (unsigned char)codec;
+    hdr[7] = (unsigned char)unit_symbol(frame->unit)[0];
+    put_u64le(hdr + 8, index);
+    put_u64le(hdr + 16, enc->key_index);
+    put_u32le(hdr + 24, (uint32_t)width);
+    put_u32le(hdr + 28, (uint32_t)height);
+    put_f64le(hdr + 32, opt->scale);
+    put_f64le(hdr + 40, opt->offset);
+    put_u32le(hdr + 48, (uint32_t)packed);
+    put_u32le(hdr + 52, (uint32_t)crc);
+    out_write(out, hdr, sizeof(hdr));
+    out_write(out, payload, packed);
+    return !out->failed;
+}
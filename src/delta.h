@@ -0,0 +1,77 @@
+#ifndef FLIR2JSON_DELTA_H
+#define FLIR2JSON_DELTA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "engine.h"
+#include "output.h"
+#include "serialize.h"
+
+// Formato "delta": matrizes u16 (mesma escala/offset do --dtype u16) em quadros-chave
+// periódicos e quadros intermediários codificados como diferença para o último
+// quadro-chave, comprimidos com deflate (zlib). Como cada intermediário depende só do
+// seu quadro-chave, um leitor que perdeu quadros (push ao vivo) retoma no próximo.
+//
+// Cada quadro é um cabeçalho fixo de DELTA_HEADER_BYTES (little-endian) + payload:
+//   0  "F2JD"          magic
+//   4  u8  versão (1)
+//   5  u8  tipo: 0 quadro-chave, 1 diferença
+//   6  u8  codec: 0 sem compressão, 1 deflate (zlib)
+//   7  u8  unidade: 'C', 'K' ou 'F'
+//   8  u64 índice do quadro
+//   16 u64 quadro-chave de referência (o próprio índice num quadro-chave)
+//   24 u32 largura   28 u32 altura
+//   32 f64 scale     40 f64 offset   (temperatura = valor * scale + offset)
+//   48 u32 bytes do payload
+//   52 u32 crc32 dos valores u16 decodificados (little-endian)
+// O payload descomprimido tem 2 * largura * altura bytes: os bytes baixos de todos os
+// resíduos e depois os altos. Resíduo em zigue-zague (0, -1, 1, -2... → 0, 1, 2, 3...)
+// de v - ref, com ref = pixel à esquerda (ou acima, na coluna 0) num quadro-chave e
+// o mesmo pixel do quadro-chave num quadro de diferença. Num arquivo, a referência
+// de um quadro de diferença é o último quadro-chave anterior a ele.
+
+#define DELTA_MAGIC "F2JD"
+#define DELTA_HEADER_BYTES 56
+
+// Quadros entre dois quadros-chave (padrão de --keyframe)
+#define DELTA_DEFAULT_KEYFRAME 30
+
+typedef enum {
+    DELTA_KEY = 0,
+    DELTA_DIFF = 1
+} DeltaType;
+
+// Estado de um fluxo (uma thread por vez): último quadro-chave e buffers reaproveitados
+typedef struct {
+    unsigned interval;      // quadros por quadro-chave
+    unsigned since_key;
+    bool has_key;
+    uint64_t key_index;
+    uint64_t next_index;    // índice esperado do próximo quadro contínuo
+    int width;
+    int height;
+    uint16_t *key;
+    size_t key_capacity;    // em bytes, como as demais capacidades
+    unsigned char *planes;  // resíduos separados em bytes baixos/altos
+    size_t planes_capacity;
+    unsigned char *packed;  // saída do deflate
+    size_t packed_capacity;
+} DeltaEncoder;
+
+void delta_init(DeltaEncoder *enc, unsigned interval);
+void delta_free(DeltaEncoder *enc);
+
+// Força um quadro-chave no próximo delta_encode
+void delta_reset(DeltaEncoder *enc);
+
+// Grava o quadro (frame->fixed, do caminho de sinal com fixed_u16) em `out`. Gera um
+// quadro-chave no primeiro quadro, a cada `interval`, quando as dimensões mudam ou
+// quando `index` não segue o quadro anterior com passo `stride` (caso dos blocos de
+// sequência em threads diferentes). Com stride 0 lacunas são aceitas: ao vivo, um
+// quadro descartado não invalida a referência.
+bool delta_encode(DeltaEncoder *enc, OutBuf *out, const Frame *frame, const OutputOptions *opt, uint64_t index,
+                  uint64_t stride);
+
+#endif
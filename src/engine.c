@@ -0,0 +1,604 @@
+#include "engine.h"
+#include "kernels.h"
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static __thread char last_error[512];
+
+const char *engine_last_error(void) {
+    return last_error;
+}
+
+bool engine_fail(const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(last_error, sizeof(last_error), fmt, ap);
+    va_end(ap);
+    return false;
+}
+
+
+// Converte o último erro do SDK em erro do motor; true se havia erro
+static bool acs_failed(const char *what) {
+    ACS_Error err = ACS_getLastError();
+    if (!err.code)
+        return false;
+    ACS_String *msg = ACS_getErrorMessage(err);
+    engine_fail("%s: %s | details: %s", what, ACS_String_get(msg), ACS_getLastErrorMessage());
+    ACS_String_free(msg);
+    return true;
+}
+
+UnitConv unit_conv(TempUnit unit) {
+    switch (unit) {
+    case UNIT_KELVIN: return (UnitConv){ 1.0, 273.15 };
+    case UNIT_FAHRENHEIT: return (UnitConv){ 1.8, 32.0 };
+    default: return (UnitConv){ 1.0, 0.0 };
+    }
+}
+
+const char *unit_symbol(TempUnit unit) {
+    switch (unit) {
+    case UNIT_KELVIN: return "K";
+    case UNIT_FAHRENHEIT: return "F";
+    default: return "C";
+    }
+}
+
+bool unit_parse(const char *s, TempUnit *unit) {
+    if (strcmp(s, "C") == 0) *unit = UNIT_CELSIUS;
+    else if (strcmp(s, "K") == 0) *unit = UNIT_KELVIN;
+    else if (strcmp(s, "F") == 0) *unit = UNIT_FAHRENHEIT;
+    else return false;
+    return true;
+}
+
+const char *pool_name(PoolMode pool) {
+    return pool == POOL_AVG ? "avg" : "max";
+}
+
+bool pool_parse(const char *s, PoolMode *pool) {
+    if (strcmp(s, "max") == 0) *pool = POOL_MAX;
+    else if (strcmp(s, "avg") == 0) *pool = POOL_AVG;
+    else return false;
+    return true;
+}
+
+static int unit_to_acs(TempUnit unit) {
+    switch (unit) {
+    case UNIT_KELVIN: return ACS_TemperatureUnit_kelvin;
+    case UNIT_FAHRENHEIT: return ACS_TemperatureUnit_fahrenheit;
+    default: return ACS_TemperatureUnit_celsius;
+    }
+}
+
+double thermal_value_in(ACS_ThermalValue v, TempUnit unit) {
+    switch (unit) {
+    case UNIT_KELVIN: return ACS_ThermalValue_asKelvin(v).value;
+    case UNIT_FAHRENHEIT: return ACS_ThermalValue_asFahrenheit(v).value;
+    default: return ACS_ThermalValue_asCelsius(v).value;
+    }
+}
+
+double unit_absolute_zero(TempUnit unit) {
+    UnitConv conv = unit_conv(unit);
+    return -273.15 * conv.mul + conv.add;
+}
+
+bool parse_roi(const char *spec, int img_w, int img_h, ACS_Rectangle *out) {
+    ACS_Rectangle r;
+    char tail;
+    if (sscanf(spec, "%d,%d,%d,%d%c", &r.x, &r.y, &r.width, &r.height, &tail) != 4)
+        return false;
+    if (r.x < 0 || r.y < 0 || r.width <= 0 || r.height <= 0 ||
+        r.x > img_w - r.width || r.y > img_h - r.height)
+        return false;
+    *out = r;
+    return true;
+}
+
+bool parse_roi_list(const char *spec, int img_w, int img_h, ACS_Rectangle *rects, size_t *count) {
+    const char *p = spec;
+    for (;;) {
+        size_t len = strcspn(p, ";");
+        char item[64];
+        if (len >= sizeof(item))
+            return engine_fail("ROI inválida: %.*s", (int)len, p);
+        memcpy(item, p, len);
+        item[len] = '\0';
+        if (*count >= ROI_MAX)
+            return engine_fail("no máximo %d ROIs por imagem", ROI_MAX);
+        if (!parse_roi(item, img_w, img_h, &rects[*count]))
+            return engine_fail("ROI inválida para imagem %dx%d: %s", img_w, img_h, item);
+        ++*count;
+        if (!p[len])
+            return true;
+        p += len + 1;
+    }
+}
+
+// Cresce `*buf` para `count` elementos de `elem` bytes, sem preservar conteúdo
+static bool ensure_capacity(void **buf, size_t *capacity, size_t count, size_t elem) {
+    if (count <= *capacity)
+        return true;
+    void *grown = malloc(count * elem);
+    if (!grown)
+        return engine_fail("sem memória para %zu elementos", count);
+    free(*buf);
+    *buf = grown;
+    *capacity = count;
+    return true;
+}
+
+void workspace_free(Workspace *ws) {
+    free(ws->values);
+    free(ws->fixed);
+    free(ws->unpooled);
+    free(ws->scratch);
+    free(ws->lut.values);
+    free(ws->lut.histogram);
+    free(ws->signal_counts);
+    free(ws->runs);
+    memset(ws, 0, sizeof(*ws));
+}
+
+double *workspace_take_values(Workspace *ws, size_t *capacity) {
+    double *values = ws->values;
+    *capacity = ws->values_capacity;
+    ws->values = NULL;
+    ws->values_capacity = 0;
+    return values;
+}
+
+void workspace_give_values(Workspace *ws, double *values, size_t capacity) {
+    if (capacity <= ws->values_capacity) {
+        free(values);
+        return;
+    }
+    free(ws->values);
+    ws->values = values;
+    ws->values_capacity = capacity;
+}
+
+unsigned char *workspace_scratch(Workspace *ws, size_t size) {
+    if (!ensure_capacity((void **)&ws->scratch, &ws->scratch_capacity, size, 1))
+        return NULL;
+    return ws->scratch;
+}
+
+bool engine_prepare(ACS_ThermalImage *img, const ExtractOptions *opt) {
+    // A LUT é montada em °C e a conversão de unidade fica no kernel;
+    // o caminho getValues pede a unidade de saída direto ao SDK
+    ACS_ThermalImage_setTemperatureUnit(img, opt->engine == ENGINE_VALUES ? unit_to_acs(opt->unit)
+                                                                           : ACS_TemperatureUnit_celsius);
+    return !acs_failed("setTemperatureUnit");
+}
+
+// Visão do buffer de sinal de 16 bits restrita ao retângulo extraído
+typedef struct {
+    const unsigned char *base;
+    size_t stride;
+    ACS_Rectangle rect;
+} SignalView;
+
+// Obtém o buffer bruto de sinal; false se a imagem não expõe sinal de 16 bits
+static bool open_signal(const ACS_ThermalImage *img, const ACS_Rectangle *rect, SignalView *view) {
+    ACS_ImageBuffer *signal = ACS_ThermalImage_getSignalData(img);
+    if (ACS_getLastErrorCode() || !signal || ACS_ImageBuffer_getBytesPerPixel(signal) != 2)
+        return false;
+    view->base = ACS_ImageBuffer_getData(signal);
+    view->stride = (size_t)ACS_ImageBuffer_getStride(signal);
+    view->rect = *rect;
+    return true;
+}
+
+static inline const uint16_t *signal_row(const SignalView *view, size_t y) {
+    return (const uint16_t *)(view->base + ((size_t)view->rect.y + y) * view->stride) + view->rect.x;
+}
+
+// Monta a LUT chamando getValueFromSignal uma vez por sinal distinto da faixa do retângulo.
+// getMin/MaxSignalValue nem sempre cobrem todos os pixels; a faixa real sai de uma
+// varredura vetorizada do próprio buffer.
+static bool build_signal_lut(const ACS_ThermalImage *img, const SignalView *view, SignalLut *lut) {
+    unsigned lo = 0xffff, hi = 0;
+    for (size_t y = 0; y < (size_t)view->rect.height; ++y)
+        kernel_minmax_u16(signal_row(view, y), (size_t)view->rect.width, &lo, &hi);
+
+    size_t len = (size_t)(hi - lo) + 1;
+    if (!ensure_capacity((void **)&lut->values, &lut->capacity, len, sizeof(double)))
+        return false;
+
+    for (size_t i = 0; i < len; ++i)
+        lut->values[i] = ACS_ThermalImage_getValueFromSignal(img, (unsigned short)(lo + i)).value;
+    if (acs_failed("getValueFromSignal"))
+        return false;
+    lut->base = lo;
+    lut->len = len;
+    return true;
+}
+
+// Zera (e dimensiona) a contagem por sinal usada pelo histograma
+static uint32_t *reset_histogram(SignalLut *lut) {
+    if (!ensure_capacity((void **)&lut->histogram, &lut->histogram_capacity, lut->len, sizeof(uint32_t)))
+        return NULL;
+    memset(lut->histogram, 0, lut->len * sizeof(uint32_t));
+    return lut->histogram;
+}
+
+static FrameStats frame_stats(const KernelStats *st) {
+    FrameStats fs = { st->min, st->max, st->count ? st->sum / (double)st->count : 0.0 };
+    return fs;
+}
+
+static void frame_init(Frame *frame, const ACS_Rectangle *rect, const ExtractOptions *opt) {
+    memset(frame, 0, sizeof(*frame));
+    frame->rect = *rect;
+    frame->downsample = opt->downsample > 1 ? opt->downsample : 1;
+    frame->pool = opt->pool;
+    frame->width = downsample_dim(rect->width, frame->downsample);
+    frame->height = downsample_dim(rect->height, frame->downsample);
+    frame->unit = opt->unit;
+    frame->index = -1;
+}
+
+// Acumula uma linha de pixels nas células da faixa atual da grade
+static void pool_row(const double *row, size_t width, unsigned factor, PoolMode pool, double *cells) {
+    for (size_t x0 = 0, c = 0; x0 < width; x0 += factor, ++c) {
+        size_t x1 = x0 + factor < width ? x0 + factor : width;
+        double acc = cells[c];
+        if (pool == POOL_MAX) {
+            for (size_t x = x0; x < x1; ++x)
+                if (row[x] > acc)
+                    acc = row[x];
+        } else {
+            for (size_t x = x0; x < x1; ++x)
+                acc += row[x];
+        }
+        cells[c] = acc;
+    }
+}
+
+static void pool_band_begin(double *cells, size_t count, PoolMode pool) {
+    for (size_t c = 0; c < count; ++c)
+        cells[c] = pool == POOL_MAX ? -INFINITY : 0.0;
+}
+
+// Fecha a faixa de `rows` linhas: a média divide pela área de cada célula (menor na borda)
+static void pool_band_end(double *cells, size_t width, unsigned factor, size_t rows, PoolMode pool) {
+    if (pool != POOL_AVG)
+        return;
+    for (size_t x0 = 0, c = 0; x0 < width; x0 += factor, ++c) {
+        size_t cols = x0 + factor < width ? factor : width - x0;
+        cells[c] /= (double)(cols * rows);
+    }
+}
+
+// Reduz a matriz `width` x `height` em `values` para a grade do quadro (em ws->values)
+static void pool_matrix(const double *values, size_t width, size_t height, Frame *frame, double *grid) {
+    size_t grid_width = (size_t)frame->width;
+    for (size_t y0 = 0; y0 < height; y0 += frame->downsample) {
+        size_t rows = y0 + frame->downsample < height ? frame->downsample : height - y0;
+        double *cells = grid + y0 / frame->downsample * grid_width;
+        pool_band_begin(cells, grid_width, frame->pool);
+        for (size_t y = y0; y < y0 + rows; ++y)
+            pool_row(values + y * width, width, frame->downsample, frame->pool, cells);
+        pool_band_end(cells, width, frame->downsample, rows, frame->pool);
+    }
+}
+
+// Grade reduzida → u16 com o mesmo arredondamento dos kernels: floor(v + 0.5) saturado
+static size_t quantize_grid(const double *grid, size_t count, const ExtractOptions *opt, uint16_t *out) {
+    size_t clipped = 0;
+    for (size_t i = 0; i < count; ++i) {
+        double q = (grid[i] - opt->offset) / opt->scale + 0.5;
+        if (q >= 0.0 && q < 65536.0) {
+            out[i] = (uint16_t)q;
+        } else {
+            out[i] = q >= 65536.0 ? 65535 : 0;
+            ++clipped;
+        }
+    }
+    return clipped;
+}
+
+// Grade double pronta em ws->values: vira u16 se pedido (sem matriz double no quadro)
+static bool finish_pooled(const ExtractOptions *opt, Workspace *ws, Frame *frame) {
+    size_t count = (size_t)frame->width * (size_t)frame->height;
+    if (!opt->fixed_u16) {
+        frame->values = ws->values;
+        return true;
+    }
+    if (!ensure_capacity((void **)&ws->fixed, &ws->fixed_capacity, count, sizeof(uint16_t)))
+        return false;
+    frame->clipped = quantize_grid(ws->values, count, opt, ws->fixed);
+    frame->fixed = ws->fixed;
+    return true;
+}
+
+// Downsample no caminho de sinal: uma passada pelo buffer, cada linha convertida numa
+// área de uma linha e acumulada direto nas células; as estatísticas usam todos os pixels
+static bool map_signal_pooled(const SignalView *view, const SignalMap *map, KernelStats *kstats,
+                              const ExtractOptions *opt, Workspace *ws, Frame *frame) {
+    size_t width = (size_t)view->rect.width;
+    size_t height = (size_t)view->rect.height;
+    size_t grid_width = (size_t)frame->width;
+    unsigned factor = frame->downsample;
+    if (!ensure_capacity((void **)&ws->unpooled, &ws->unpooled_capacity, width, sizeof(double)) ||
+        !ensure_capacity((void **)&ws->values, &ws->values_capacity, grid_width * (size_t)frame->height,
+                         sizeof(double)))
+        return false;
+    for (size_t y0 = 0; y0 < height; y0 += factor) {
+        size_t rows = y0 + factor < height ? factor : height - y0;
+        double *cells = ws->values + y0 / factor * grid_width;
+        pool_band_begin(cells, grid_width, frame->pool);
+        for (size_t y = y0; y < y0 + rows; ++y) {
+            kernel_map_signal_f64(map, signal_row(view, y), width, ws->unpooled, kstats);
+            pool_row(ws->unpooled, width, factor, frame->pool, cells);
+        }
+        pool_band_end(cells, width, factor, rows, frame->pool);
+    }
+    frame->stats = frame_stats(kstats);
+    return finish_pooled(opt, ws, frame);
+}
+
+// Converte o retângulo de sinal com a tabela `table` (índice sinal - base, em °C)
+static bool map_signal(const SignalView *view, const double *table, unsigned base, uint32_t *histogram,
+                       const ExtractOptions *opt, Workspace *ws, Frame *frame) {
+    size_t width = (size_t)view->rect.width;
+    size_t height = (size_t)view->rect.height;
+    size_t count = width * height;
+    KernelStats kstats;
+    kernel_stats_init(&kstats, histogram);
+
+    UnitConv conv = unit_conv(opt->unit);
+    if (frame->downsample > 1) {
+        SignalMap map = { table, base, conv.mul, conv.add };
+        return map_signal_pooled(view, &map, &kstats, opt, ws, frame);
+    }
+    if (opt->fixed_u16) {
+        // Sinal → u16 direto no kernel, sem matriz double intermediária
+        if (!ensure_capacity((void **)&ws->fixed, &ws->fixed_capacity, count, sizeof(uint16_t)))
+            return false;
+        SignalMap map = { table, base, conv.mul / opt->scale, (conv.add - opt->offset) / opt->scale };
+        for (size_t y = 0; y < height; ++y)
+            frame->clipped += kernel_map_signal_u16(&map, signal_row(view, y), width, ws->fixed + y * width, &kstats);
+        frame->fixed = ws->fixed;
+        // Estatísticas saem no domínio do mapa: desfaz a escala de ponto fixo
+        frame->stats = frame_stats(&kstats);
+        frame->stats.min = frame->stats.min * opt->scale + opt->offset;
+        frame->stats.max = frame->stats.max * opt->scale + opt->offset;
+        frame->stats.mean = frame->stats.mean * opt->scale + opt->offset;
+        return true;
+    }
+
+    if (!ensure_capacity((void **)&ws->values, &ws->values_capacity, count, sizeof(double)))
+        return false;
+    SignalMap map = { table, base, conv.mul, conv.add };
+    for (size_t y = 0; y < height; ++y)
+        kernel_map_signal_f64(&map, signal_row(view, y), width, ws->values + y * width, &kstats);
+    frame->values = ws->values;
+    frame->stats = frame_stats(&kstats);
+    return true;
+}
+
+bool engine_extract(ACS_ThermalImage *img, const ACS_Rectangle *rect, const ExtractOptions *opt,
+                    Workspace *ws, Frame *frame) {
+    size_t count = (size_t)rect->width * (size_t)rect->height;
+    frame_init(frame, rect, opt);
+
+    SignalView view;
+    frame->used_signal = opt->engine == ENGINE_SIGNAL && open_signal(img, rect, &view);
+    if (opt->histogram && !frame->used_signal)
+        return engine_fail("histograma requer engine signal e uma imagem com buffer de sinal");
+
+    if (!frame->used_signal) {
+        // Uma única chamada ao SDK para o retângulo inteiro; com downsample a matriz cheia
+        // fica à parte e só a grade reduzida ocupa ws->values
+        bool pooled = frame->downsample > 1;
+        double **full = pooled ? &ws->unpooled : &ws->values;
+        size_t *full_capacity = pooled ? &ws->unpooled_capacity : &ws->values_capacity;
+        if (!ensure_capacity((void **)full, full_capacity, count, sizeof(double)))
+            return false;
+        ACS_ThermalImage_getValues(img, *full, count * sizeof(double), rect);
+        if (acs_failed("getValues"))
+            return false;
+        KernelStats kstats;
+        kernel_stats_init(&kstats, NULL);
+        kernel_stats_f64(*full, count, &kstats);
+        frame->stats = frame_stats(&kstats);
+        if (!pooled) {
+            frame->values = ws->values;
+            return true;
+        }
+        if (!ensure_capacity((void **)&ws->values, &ws->values_capacity,
+                             (size_t)frame->width * (size_t)frame->height, sizeof(double)))
+            return false;
+        pool_matrix(ws->unpooled, (size_t)rect->width, (size_t)rect->height, frame, ws->values);
+        return finish_pooled(opt, ws, frame);
+    }
+
+    if (!build_signal_lut(img, &view, &ws->lut))
+        return false;
+    uint32_t *histogram = NULL;
+    if (opt->histogram && !(histogram = reset_histogram(&ws->lut)))
+        return false;
+    return map_signal(&view, ws->lut.values, ws->lut.base, histogram, opt, ws, frame);
+}
+
+bool engine_signal_window(ACS_ThermalImage *img, const ACS_Rectangle *rect, Workspace *ws, SignalWindow *win) {
+    SignalView view;
+    if (!open_signal(img, rect, &view))
+        return engine_fail("imagem sem buffer de sinal de 16 bits");
+    if (!build_signal_lut(img, &view, &ws->lut))
+        return false;
+    *win = (SignalWindow){ (const unsigned char *)signal_row(&view, 0), view.stride, rect->width, rect->height,
+                           ws->lut.values, ws->lut.base, ws->lut.len };
+    return true;
+}
+
+size_t signal_window_search(const SignalWindow *win, double celsius, bool strict) {
+    size_t lo = 0, hi = win->lut_len;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (strict ? win->lut[mid] <= celsius : win->lut[mid] < celsius)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+// Visão de um sinal bruto copiado da câmera (modo ao vivo)
+static bool raw_view(const RawSignal *raw, const ACS_Rectangle *rect, SignalView *view) {
+    if (rect->x < 0 || rect->y < 0 || rect->width <= 0 || rect->height <= 0 ||
+        rect->x > raw->width - rect->width || rect->y > raw->height - rect->height)
+        return engine_fail("retângulo fora do quadro %dx%d", raw->width, raw->height);
+    view->base = (const unsigned char *)raw->data;
+    view->stride = raw->stride;
+    view->rect = *rect;
+    return true;
+}
+
+bool engine_extract_raw(const RawSignal *raw, const ACS_Rectangle *rect, const ExtractOptions *opt,
+                        Workspace *ws, Frame *frame) {
+    frame_init(frame, rect, opt);
+    frame->used_signal = true;
+    if (opt->histogram)
+        return engine_fail("histograma não disponível no modo ao vivo");
+    SignalView view;
+    if (!raw_view(raw, rect, &view))
+        return false;
+    return map_signal(&view, raw->lut, 0, NULL, opt, ws, frame);
+}
+
+bool engine_signal_window_raw(const RawSignal *raw, const ACS_Rectangle *rect, SignalWindow *win) {
+    SignalView view = { 0 };
+    if (!raw_view(raw, rect, &view))
+        return false;
+    *win = (SignalWindow){ (const unsigned char *)signal_row(&view, 0), view.stride, rect->width, rect->height,
+                           raw->lut, 0, 65536 };
+    return true;
+}
+
+static void summary_position(FrameSummary *sm, size_t at, bool hot) {
+    int x = (int)(at % (size_t)sm->rect.width), y = (int)(at / (size_t)sm->rect.width);
+    if (hot) {
+        sm->hot_x = x;
+        sm->hot_y = y;
+    } else {
+        sm->cold_x = x;
+        sm->cold_y = y;
+    }
+}
+
+// Caminho getValues: duas passadas sobre a matriz double (média, depois variância)
+static bool summarize_values(ACS_ThermalImage *img, Workspace *ws, FrameSummary *sm) {
+    size_t count = sm->count;
+    if (!ensure_capacity((void **)&ws->values, &ws->values_capacity, count, sizeof(double)))
+        return false;
+    ACS_ThermalImage_getValues(img, ws->values, count * sizeof(double), &sm->rect);
+    if (acs_failed("getValues"))
+        return false;
+
+    const double *v = ws->values;
+    size_t lo_at = 0, hi_at = 0;
+    double sum = 0.0;
+    for (size_t i = 0; i < count; ++i) {
+        if (v[i] < v[lo_at]) lo_at = i;
+        if (v[i] > v[hi_at]) hi_at = i;
+        sum += v[i];
+    }
+    double mean = sum / (double)count, sq = 0.0;
+    for (size_t i = 0; i < count; ++i)
+        sq += (v[i] - mean) * (v[i] - mean);
+    // getValues já entrega na unidade de saída (engine_prepare)
+    sm->min = v[lo_at];
+    sm->max = v[hi_at];
+    sm->mean = mean;
+    sm->stddev = sqrt(sq / (double)count);
+    summary_position(sm, lo_at, false);
+    summary_position(sm, hi_at, true);
+    return true;
+}
+
+// Contagem por sinal + extremos; temperaturas vêm de `table` (índice = sinal, °C)
+// ou, sem tabela, de getValueFromSignal só para os sinais presentes
+static bool summarize_signal(const SignalView *view, const ACS_ThermalImage *img, const double *table,
+                             const ExtractOptions *opt, Workspace *ws, FrameSummary *sm) {
+    if (!ws->signal_counts && !(ws->signal_counts = calloc(65536, sizeof(uint32_t))))
+        return engine_fail("sem memória para a contagem de sinais");
+    uint32_t *counts = ws->signal_counts;
+    SignalExtremes ex = { 0xffff, 0, 0, 0 };
+    size_t width = (size_t)view->rect.width;
+    for (size_t y = 0; y < (size_t)view->rect.height; ++y)
+        kernel_census_u16(signal_row(view, y), width, y * width, counts, &ex);
+
+    // O sinal cresce com a temperatura: extremos de sinal são os pontos quente e frio.
+    // Média e variância saem do histograma (soma por sinal distinto), em duas passadas
+    // sobre ele para não perder precisão com E[x²] - E[x]².
+    size_t span = (size_t)(ex.hi - ex.lo + 1);
+    double *temps = (double *)workspace_scratch(ws, span * sizeof(double));
+    if (!temps) {
+        memset(counts + ex.lo, 0, span * sizeof(uint32_t));
+        return false;
+    }
+    double sum = 0.0;
+    for (unsigned s = ex.lo; s <= ex.hi; ++s) {
+        if (!counts[s])
+            continue;
+        temps[s - ex.lo] = table ? table[s] : ACS_ThermalImage_getValueFromSignal(img, (unsigned short)s).value;
+        sum += (double)counts[s] * temps[s - ex.lo];
+    }
+    if (!table && acs_failed("getValueFromSignal")) {
+        memset(counts + ex.lo, 0, span * sizeof(uint32_t));
+        return false;
+    }
+    double mean = sum / (double)sm->count, sq = 0.0;
+    for (unsigned s = ex.lo; s <= ex.hi; ++s) {
+        if (!counts[s])
+            continue;
+        double d = temps[s - ex.lo] - mean;
+        sq += (double)counts[s] * d * d;
+        counts[s] = 0; // deixa a tabela zerada para o próximo quadro
+    }
+
+    UnitConv conv = unit_conv(opt->unit);
+    sm->min = temps[0] * conv.mul + conv.add;
+    sm->max = temps[ex.hi - ex.lo] * conv.mul + conv.add;
+    sm->mean = mean * conv.mul + conv.add;
+    sm->stddev = sqrt(sq / (double)sm->count) * conv.mul;
+    summary_position(sm, ex.lo_at, false);
+    summary_position(sm, ex.hi_at, true);
+    return true;
+}
+
+static void summary_init(FrameSummary *sm, const ACS_Rectangle *rect, const ExtractOptions *opt) {
+    memset(sm, 0, sizeof(*sm));
+    sm->rect = *rect;
+    sm->unit = opt->unit;
+    sm->count = (size_t)rect->width * (size_t)rect->height;
+}
+
+bool engine_summarize(ACS_ThermalImage *img, const ACS_Rectangle *rect, const ExtractOptions *opt,
+                      Workspace *ws, FrameSummary *sm) {
+    summary_init(sm, rect, opt);
+    SignalView view;
+    sm->used_signal = opt->engine == ENGINE_SIGNAL && open_signal(img, rect, &view);
+    if (!sm->used_signal)
+        return summarize_values(img, ws, sm);
+    return summarize_signal(&view, img, NULL, opt, ws, sm);
+}
+
+bool engine_summarize_raw(const RawSignal *raw, const ACS_Rectangle *rect, const ExtractOptions *opt,
+                          Workspace *ws, FrameSummary *sm) {
+    summary_init(sm, rect, opt);
+    sm->used_signal = true;
+    SignalView view;
+    if (!raw_view(raw, rect, &view))
+        return false;
+    return summarize_signal(&view, NULL, raw->lut, opt, ws, sm);
+}
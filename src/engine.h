@@ -0,0 +1,217 @@
+#ifndef FLIR2JSON_ENGINE_H
+#define FLIR2JSON_ENGINE_H
+
+#include <acs/thermal_image.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Motor de extração compartilhado pelo extrator e pelo servidor.
+// As funções retornam false em erro; a mensagem fica em engine_last_error()
+// (por thread, como ACS_getLastErrorMessage).
+
+// Unidades de saída
+typedef enum {
+    UNIT_CELSIUS,
+    UNIT_KELVIN,
+    UNIT_FAHRENHEIT
+} TempUnit;
+
+// Caminho usado para obter as temperaturas
+typedef enum {
+    ENGINE_SIGNAL, // buffer de sinal + LUT (padrão)
+    ENGINE_VALUES  // ACS_ThermalImage_getValues
+} Engine;
+
+// Redução da matriz (downsample): cada célula fica com o máximo ou a média do bloco
+typedef enum {
+    POOL_MAX, // preserva os pontos quentes (padrão)
+    POOL_AVG
+} PoolMode;
+
+// Conversão afim a partir de °C: saída = celsius * mul + add
+typedef struct {
+    double mul;
+    double add;
+} UnitConv;
+
+// Tabela sinal→temperatura (°C) da imagem atual, cobrindo apenas [base, base + len)
+typedef struct {
+    double *values;
+    size_t capacity; // em elementos
+    size_t len;
+    unsigned base;
+    uint32_t *histogram; // contagem por sinal, mesmo índice da tabela
+    size_t histogram_capacity;
+} SignalLut;
+
+// Buffers reutilizáveis entre imagens (um por thread); só crescem
+typedef struct {
+    double *values;
+    size_t values_capacity; // em elementos
+    uint16_t *fixed;
+    size_t fixed_capacity;  // em elementos
+    unsigned char *scratch; // área temporária dos serializadores
+    size_t scratch_capacity;
+    double *unpooled;       // downsample: temperaturas antes da redução (uma linha no caminho de sinal)
+    size_t unpooled_capacity;
+    SignalLut lut;
+    uint32_t *signal_counts; // 65536 contagens do modo só-estatísticas, zeradas entre usos
+    struct HotspotRun *runs; // corridas da rotulação de regiões quentes (hotspot.h)
+    size_t runs_capacity;
+} Workspace;
+
+typedef struct {
+    Engine engine;
+    TempUnit unit;
+    bool histogram;  // conta pixels por sinal (só engine signal)
+    bool fixed_u16;  // gera u16 direto do sinal em vez da matriz double
+    double scale;    // u16: temperatura = valor * scale + offset
+    double offset;
+    unsigned downsample; // células de N x N pixels (0 ou 1: resolução cheia)
+    PoolMode pool;
+} ExtractOptions;
+
+// Maior fator aceito em --downsample / ?downsample=
+#define DOWNSAMPLE_MAX 64
+
+// Estatísticas da matriz extraída, na unidade de saída (sempre da resolução cheia)
+typedef struct {
+    double min;
+    double max;
+    double mean;
+} FrameStats;
+
+// Resultado de uma extração; os ponteiros apontam para buffers do Workspace
+typedef struct {
+    ACS_Rectangle rect;    // retângulo extraído, em pixels da imagem
+    int width;             // dimensões da matriz: as de rect, ou a grade reduzida com downsample
+    int height;
+    unsigned downsample;   // fator aplicado (1 = resolução cheia)
+    PoolMode pool;
+    TempUnit unit;
+    const double *values;  // matriz width x height, ou NULL se fixed_u16
+    const uint16_t *fixed; // matriz u16 (ordem nativa), só com fixed_u16 no caminho de sinal
+    size_t clipped;        // u16: pixels saturados
+    FrameStats stats;
+    bool used_signal;
+    long index;            // quadro da sequência; -1 em imagem única
+    bool tag_roi;          // várias ROIs por imagem: o CSV identifica o retângulo
+    const char *params;    // variante de parâmetros térmicos (params.h): linha "# params" do CSV
+    const char *aggregate; // agregado temporal (aggregate.h): "max", "min", "mean" ou "var"
+    long window_last;      // com `aggregate`: a janela vai do quadro `index` até este
+    size_t window_frames;  // com `aggregate`: quadros da janela que entraram no acúmulo
+} Frame;
+
+// Resumo de um quadro sem a matriz (modo só-estatísticas), na unidade de saída.
+// Posições relativas ao retângulo extraído.
+typedef struct {
+    ACS_Rectangle rect;
+    TempUnit unit;
+    size_t count;
+    double min;
+    double max;
+    double mean;
+    double stddev; // populacional
+    int hot_x, hot_y;
+    int cold_x, cold_y;
+    bool used_signal;
+} FrameSummary;
+
+// Sinal bruto já copiado para fora do SDK (modo ao vivo), com a tabela completa
+// sinal→°C (65536 posições) da câmera no momento da captura
+typedef struct {
+    const uint16_t *data;
+    size_t stride; // em bytes
+    int width;
+    int height;
+    const double *lut;
+} RawSignal;
+
+// Sinal de 16 bits de um retângulo com a tabela sinal→°C que cobre seus valores, para
+// análises que comparam direto no domínio do sinal (isotherm.h)
+typedef struct {
+    const unsigned char *base; // pixel (0, 0) do retângulo
+    size_t stride;             // em bytes
+    int width;
+    int height;
+    const double *lut;         // °C do sinal lut_base + i
+    unsigned lut_base;
+    size_t lut_len;
+} SignalWindow;
+
+static inline const uint16_t *signal_window_row(const SignalWindow *win, size_t y) {
+    return (const uint16_t *)(win->base + y * win->stride);
+}
+
+// Primeira posição da LUT com temperatura >= celsius (com `strict`, > celsius); lut_len
+// se nenhuma. Busca binária: a temperatura cresce com o sinal.
+size_t signal_window_search(const SignalWindow *win, double celsius, bool strict);
+
+const char *engine_last_error(void);
+
+// Registra a mensagem em engine_last_error() e retorna false (para módulos vizinhos)
+bool engine_fail(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+UnitConv unit_conv(TempUnit unit);
+const char *unit_symbol(TempUnit unit);
+bool unit_parse(const char *s, TempUnit *unit);
+const char *pool_name(PoolMode pool);
+bool pool_parse(const char *s, PoolMode *pool);
+
+// Dimensão da grade reduzida: células parciais na borda contam como uma célula
+static inline int downsample_dim(int pixels, unsigned factor) {
+    return factor > 1 ? (int)(((unsigned)pixels + factor - 1) / factor) : pixels;
+}
+double thermal_value_in(ACS_ThermalValue v, TempUnit unit);
+
+// Zero absoluto na unidade indicada (offset padrão do u16: centi-kelvin com scale 0.01)
+double unit_absolute_zero(TempUnit unit);
+
+// Interpreta "x,y,w,h" e valida contra as dimensões da imagem
+bool parse_roi(const char *spec, int img_w, int img_h, ACS_Rectangle *out);
+
+// Máximo de retângulos extraídos de uma imagem (--roi repetido, ?roi=)
+#define ROI_MAX 16
+
+// Uma ou mais ROIs "x,y,w,h" separadas por ';', acrescentadas a rects[*count]
+// (até ROI_MAX); em erro a mensagem indica o trecho inválido
+bool parse_roi_list(const char *spec, int img_w, int img_h, ACS_Rectangle *rects, size_t *count);
+
+// Sinal do retângulo e LUT em ws->lut; falha se a imagem não expõe sinal de 16 bits
+bool engine_signal_window(ACS_ThermalImage *img, const ACS_Rectangle *rect, Workspace *ws, SignalWindow *win);
+
+// O mesmo sobre um RawSignal, com a tabela completa dele
+bool engine_signal_window_raw(const RawSignal *raw, const ACS_Rectangle *rect, SignalWindow *win);
+
+void workspace_free(Workspace *ws);
+
+// Entrega a matriz double ao chamador (que passa a liberá-la com free);
+// o Workspace aloca outra na próxima extração
+double *workspace_take_values(Workspace *ws, size_t *capacity);
+
+// Devolve uma matriz tomada; fica a maior entre ela e a atual
+void workspace_give_values(Workspace *ws, double *values, size_t capacity);
+
+// Garante `size` bytes em ws->scratch
+unsigned char *workspace_scratch(Workspace *ws, size_t size);
+
+// Prepara a imagem recém-aberta para extração (unidade pedida ao SDK)
+bool engine_prepare(ACS_ThermalImage *img, const ExtractOptions *opt);
+
+// Extrai o retângulo `rect` da imagem conforme `opt`
+bool engine_extract(ACS_ThermalImage *img, const ACS_Rectangle *rect, const ExtractOptions *opt,
+                    Workspace *ws, Frame *frame);
+
+// Só estatísticas do retângulo, sem gerar a matriz: no caminho de sinal, uma passada
+// conta os sinais e acha os extremos, e a LUT é consultada só nos sinais presentes
+bool engine_summarize(ACS_ThermalImage *img, const ACS_Rectangle *rect, const ExtractOptions *opt,
+                      Workspace *ws, FrameSummary *summary);
+
+// Mesmas extrações a partir de um RawSignal (sem ACS_ThermalImage)
+bool engine_extract_raw(const RawSignal *raw, const ACS_Rectangle *rect, const ExtractOptions *opt,
+                        Workspace *ws, Frame *frame);
+bool engine_summarize_raw(const RawSignal *raw, const ACS_Rectangle *rect, const ExtractOptions *opt,
+                          Workspace *ws, FrameSummary *summary);
+
+#endif
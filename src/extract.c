@@ -1,10 +1,36 @@
+// dl_iterate_phdr (--profile)
+#define _GNU_SOURCE
 #include <acs/thermal_image.h>
 #include <acs/renderer.h>
 #include <acs/palette.h>
+#include "aggregate.h"
+#include "arrow.h"
+#include "delta.h"
+#include "engine.h"
+#include "input.h"
+#include "kernels.h"
+#include "live.h"
+#include "hotspot.h"
+#include "isotherm.h"
+#include "measure.h"
+#include "output.h"
+#include "params.h"
+#include "pool.h"
+#include "sequence.h"
+#include "serialize.h"
+#include <dirent.h>
+#include <errno.h>
+#include <glob.h>
+#include <link.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <time.h>
 
 // Função de verificação de erro genérica
 static void checkAcs(void) {
@@ -29,59 +55,1752 @@ static void json_escape(const char *in, char *out, size_t outsz) {
     out[j] = 0;
 }
 
-// Função para gravar matriz de temperaturas em CSV
-static void write_temperature_csv(ACS_ThermalImage *img, const char *csv_path) {
-    FILE *fp = fopen(csv_path, "w");
-    if (!fp) {
-        perror("Erro ao criar arquivo CSV");
-        exit(1);
+typedef struct {
+    const char *input_path;
+    const char *output_path;
+    const char *roi_specs[ROI_MAX]; // --roi repetido; cada um pode ter várias separadas por ';'
+    size_t roi_count;
+    bool multi_roi;     // mais de um retângulo por imagem
+    MeasureSet measure; // --measure: só os valores das formas, em JSON
+    IsothermSet isotherm; // --isotherm: máscaras por faixa de temperatura, em JSON
+    HotspotOptions hotspots; // --hotspots: regiões acima do limite, em JSON
+    bool format_set;
+    ParamSet variants[PARAMS_MAX_VARIANTS]; // --params: a mesma imagem com outros parâmetros térmicos
+    size_t variant_count;
+    ExtractOptions extract;
+    OutputOptions output;
+    bool offset_set;
+    int histogram_bins; // 0: sem histograma
+    bool batch;         // input_path é diretório/glob/manifesto e output_path, diretório (arquivo com arrow)
+    unsigned jobs;      // threads do lote (0: padrão)
+    InputMode input_mode;
+    bool sequence;      // input_path é uma sequência .seq/.csq
+    FrameRange frames;
+    const char *write_index; // --write-index: índice da sequência com as estatísticas de cada quadro
+    const char *index_path;  // --index: só os quadros do índice que atendem `where`
+    IndexQuery where;        // --where; sem condições, todos os quadros do índice
+    unsigned aggregate;      // --aggregate: bits AGGREGATE_* dos mapas temporais por pixel
+    size_t window;           // --window: quadros por janela dos agregados (0: a sequência toda)
+    bool stats_only;    // só a série de estatísticas por quadro, sem a matriz
+    bool metadata_only; // só câmera, parâmetros térmicos e GPS, sem extrair os pixels
+    const char *live;   // IPs das câmeras separados por vírgula; output_path é o diretório
+    size_t live_ring;
+    LiveDropPolicy live_drop;
+    unsigned keyframe;  // --format delta: quadros por quadro-chave
+    bool profile;       // tempo de cada fase no resumo
+    unsigned repeat;    // --repeat: conversões do mesmo arquivo no processo (implica --profile)
+} Options;
+
+// --profile: fases de cada conversão de uma imagem
+typedef enum {
+    PHASE_OPEN,    // open_input (SDK ou mmap + openFromMemory)
+    PHASE_PREPARE, // engine_prepare e as ROIs
+    PHASE_EXTRACT, // engine_extract de todos os retângulos e variantes
+    PHASE_WRITE,   // serialização e gravação da saída, sem a extração
+    PHASE_COUNT
+} ProfilePhase;
+
+static const char *const phase_names[PHASE_COUNT] = { "open", "prepare", "extract", "write" };
+
+typedef struct {
+    uint64_t load_cpu_ns;  // CPU do processo antes do main: carregador, relocações e construtores
+    size_t shared_objects; // bibliotecas carregadas (SDK e dependências)
+    uint64_t sdk_init_ns;  // primeira chamada ao SDK (ACS_ThermalImage_alloc)
+    uint64_t (*samples)[PHASE_COUNT]; // ns de cada fase, uma linha por repetição
+    size_t count;
+    uint64_t extract_ns;   // acumulado por serialize_regions na repetição atual
+} Profile;
+
+// Só com --profile; serialize_regions separa a extração da escrita
+static Profile *profiling;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Uso: %s <imagem_radiometrica> <saida> [opções]\n"
+            "     %s --batch <diretório|glob|manifesto> <diretório_saída|saida.arrow> [opções]\n"
+            "     %s [--batch] <entrada> <saida.ndjson> --metadata-only [--unit C|K|F] [--input mmap]\n"
+            "     %s <sequência.seq|.csq> <saida> [--frames INÍCIO:FIM[:PASSO]] [--write-index ARQ]\n"
+            "        [--index ARQ [--where COND]] [--aggregate max,min,mean,var [--window N]] [opções]\n"
+            "     %s --live <ip[,ip...]> <diretório_saída> [--ring N] [--drop new|latest] [opções]\n"
+            "  --roi x,y,w,h        extrai apenas o retângulo indicado; repetido (ou com ';'\n"
+            "                       entre retângulos), grava cada um em sequência na saída\n"
+            "  --measure FORMAS     só os valores das medições do SDK, em JSON (uma linha por\n"
+            "                       imagem/quadro): spot:x,y  box:x,y,w,h  ellipse:x,y,rx,ry\n"
+            "                       line:x1,y1,x2,y2  polyline:x1,y1,x2,y2,...  separadas\n"
+            "                       por ';' ou com --measure repetido\n"
+            "  --isotherm FAIXAS    só as máscaras das faixas, em JSON (uma linha por imagem/quadro\n"
+            "                       e retângulo): above:T  below:T  interval:A,B  na unidade de\n"
+            "                       saída, separadas por ';' ou com --isotherm repetido; cada uma\n"
+            "                       com contagem, retângulo envolvente e máscara\n"
+            "  --isotherm-encoding rle|bits  máscara em corridas alternadas fora/dentro (padrão)\n"
+            "                       ou bits por linha em base64\n"
+            "  --hotspots T         só as regiões conectadas com t >= T (unidade de saída), em JSON:\n"
+            "                       área, pico, média, centróide e retângulo de cada uma, da mais\n"
+            "                       quente para a mais fria (também ao vivo)\n"
+            "  --hotspot-min-area N  ignora regiões com menos de N pixels (padrão 1)\n"
+            "  --params VARIANTES   repete a extração com outros parâmetros térmicos sem reabrir\n"
+            "                       a imagem: \"emissivity=0.95,distance=2;reflected=35\" (campos\n"
+            "                       emissivity distance reflected atmosphere humidity transmission\n"
+            "                       optics_temp optics_transmission; temperaturas em °C)\n"
+            "  --engine signal|values  sinal bruto + LUT (padrão) ou getValues do SDK\n"
+            "  --unit C|K|F         unidade de saída (padrão C)\n"
+            "  --format csv|bin|json|delta|arrow  csv (padrão), cabeçalho JSON + payload binário,\n"
+            "                       JSON completo, (sequência/ao vivo) u16 com quadros-chave e\n"
+            "                       diferenças comprimidas ou Arrow IPC: uma linha por matriz com\n"
+            "                       arquivo, data, câmera, GPS e temperaturas; no lote, todas as\n"
+            "                       imagens num único arquivo\n"
+            "  --keyframe N         delta: um quadro-chave a cada N quadros (padrão 30)\n"
+            "  --csv-delimiter D    csv: separador , ; | : tab ou space (padrão ;)\n"
+            "  --csv-decimals N     csv: casas decimais, 0 a 3 (padrão 2)\n"
+            "  --csv-header         csv: primeira linha com a coluna x (pixels da imagem) de cada valor\n"
+            "  --dtype f32|u16      tipo do payload binário (padrão f32)\n"
+            "  --scale S            u16: temperatura = valor * S + offset (padrão 0.01; 1e-6 a 1e3)\n"
+            "  --offset O           u16: deslocamento na unidade de saída (padrão: zero absoluto;\n"
+            "                       até ±1e6)\n"
+            "  --downsample N       prévia: matriz reduzida em células de N x N pixels\n"
+            "  --pool max|avg       valor de cada célula: máximo (padrão, preserva pontos\n"
+            "                       quentes) ou média; as estatísticas usam a resolução cheia\n"
+            "  --histogram N        inclui histograma de N faixas no resumo (engine signal)\n"
+            "  --batch              processa vários arquivos: diretório, glob (\"fotos/*.jpg\")\n"
+            "                       ou manifesto com um caminho por linha\n"
+            "  --input file|mmap    leitura pelo SDK (padrão) ou mmap + openFromMemory,\n"
+            "                       com leitura antecipada do próximo arquivo no lote\n"
+            "  --jobs N             threads do lote/sequência e das faixas de matrizes grandes em CSV/JSON;\n"
+            "                       no modo ao vivo, workers fixados em núcleos que dividem as câmeras\n"
+            "                       (padrão: FLIR2JSON_THREADS ou uma por núcleo)\n"
+            "  --sequence           trata a entrada como sequência (automático para .seq/.csq)\n"
+            "  --frames A:B[:S]     quadros A até B (exclusivo) a cada S; todos por padrão.\n"
+            "                       A saída traz os quadros em ordem num único arquivo\n"
+            "  --write-index ARQ    sequência: grava o índice dos quadros extraídos (quadro, data,\n"
+            "                       mín/máx/média de todas as regiões) para reextrações seletivas\n"
+            "  --index ARQ          sequência: só os quadros do índice (dentro de --frames), cada\n"
+            "                       um buscado direto, sem percorrer a sequência\n"
+            "  --where COND         com --index: condições sobre as estatísticas do índice, na\n"
+            "                       unidade dele, todas obrigatórias: \"max>40\", \"mean<=20,min>0\"\n"
+            "  --aggregate LISTA    sequência: em vez dos quadros, mapas por pixel de max, min, mean\n"
+            "                       e/ou var (variância, unidade ao quadrado), na ordem max, min,\n"
+            "                       mean, var; uma matriz por estatística e janela\n"
+            "  --window N           com --aggregate: janelas de N quadros selecionados (padrão: uma\n"
+            "                       janela com todos)\n"
+            "  --stats-only         só min/max/média/desvio e pontos quente/frio por quadro:\n"
+            "                       CSV (padrão) ou NDJSON com --format json\n"
+            "  --metadata-only      só câmera, parâmetros térmicos e GPS, sem extrair os pixels:\n"
+            "                       uma linha JSON por imagem; com --batch, o lote inteiro num\n"
+            "                       único arquivo NDJSON\n"
+            "  --live IPs           recebe quadros das câmeras até SIGINT/SIGTERM; cada câmera\n"
+            "                       grava <diretório>/<ip>.<formato> com os quadros em sequência\n"
+            "  --ring N             quadros na fila de cada câmera, potência de 2 (padrão 8)\n"
+            "  --drop new|latest    fila cheia: descarta o quadro novo (padrão) ou, com o\n"
+            "                       consumidor atrasado, pula direto para o mais recente\n"
+            "  --profile            imagem única: no resumo, o custo da partida (CPU antes do main\n"
+            "                       e bibliotecas carregadas), da primeira chamada ao SDK e de cada\n"
+            "                       fase (open, prepare, extract, write), em microssegundos\n"
+            "  --repeat N           converte o mesmo arquivo N vezes no processo (implica --profile)\n"
+            "                       e separa a primeira (fria) da média e do mínimo das demais\n",
+            prog, prog, prog, prog, prog);
+}
+
+static bool parse_options(int argc, char **argv, Options *opt) {
+    memset(opt, 0, sizeof(*opt));
+    opt->frames = (FrameRange){ 0, SIZE_MAX, 1, NULL, 0 };
+    opt->extract.engine = ENGINE_SIGNAL;
+    opt->extract.unit = UNIT_CELSIUS;
+    opt->output.format = FORMAT_CSV;
+    opt->output.csv = CSV_DEFAULT_DIALECT;
+    opt->output.dtype = DTYPE_F32;
+    opt->hotspots.min_area = 1;
+    opt->output.scale = 0.01;
+    opt->live_ring = LIVE_DEFAULT_RING;
+    opt->live_drop = LIVE_DROP_NEW;
+    opt->keyframe = DELTA_DEFAULT_KEYFRAME;
+
+    int positional = 0;
+    for (int i = 1; i < argc; ++i) {
+        const char *arg = argv[i];
+        const char *val = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strncmp(arg, "--", 2) != 0) {
+            if (positional == 0) opt->input_path = arg;
+            else if (positional == 1) opt->output_path = arg;
+            else return false;
+            ++positional;
+            continue;
+        }
+        if (strcmp(arg, "--batch") == 0) {
+            opt->batch = true;
+            continue;
+        }
+        if (strcmp(arg, "--sequence") == 0) {
+            opt->sequence = true;
+            continue;
+        }
+        if (strcmp(arg, "--stats-only") == 0) {
+            opt->stats_only = true;
+            continue;
+        }
+        if (strcmp(arg, "--metadata-only") == 0) {
+            opt->metadata_only = true;
+            continue;
+        }
+        if (strcmp(arg, "--csv-header") == 0) {
+            opt->output.csv.header = true;
+            continue;
+        }
+        if (strcmp(arg, "--profile") == 0) {
+            opt->profile = true;
+            continue;
+        }
+        if (!val)
+            return false;
+        ++i;
+        if (strcmp(arg, "--roi") == 0) {
+            if (opt->roi_count == ROI_MAX) return false;
+            opt->roi_specs[opt->roi_count++] = val;
+            opt->multi_roi = opt->multi_roi || opt->roi_count > 1 || strchr(val, ';');
+        } else if (strcmp(arg, "--measure") == 0) {
+            if (!measure_parse(val, &opt->measure)) {
+                fprintf(stderr, "%s\n", engine_last_error());
+                return false;
+            }
+        } else if (strcmp(arg, "--isotherm") == 0) {
+            if (!isotherm_parse(val, &opt->isotherm)) {
+                fprintf(stderr, "%s\n", engine_last_error());
+                return false;
+            }
+        } else if (strcmp(arg, "--isotherm-encoding") == 0) {
+            if (!isotherm_encoding_parse(val, &opt->isotherm.encoding)) return false;
+        } else if (strcmp(arg, "--hotspots") == 0) {
+            char *end;
+            opt->hotspots.threshold = strtod(val, &end);
+            if (*end || end == val || opt->hotspots.threshold != opt->hotspots.threshold) return false;
+            opt->hotspots.enabled = true;
+        } else if (strcmp(arg, "--hotspot-min-area") == 0) {
+            char *end;
+            long area = strtol(val, &end, 10);
+            if (*end || area < 1) return false;
+            opt->hotspots.min_area = (size_t)area;
+        } else if (strcmp(arg, "--params") == 0) {
+            if (!params_parse(val, opt->variants, &opt->variant_count)) {
+                fprintf(stderr, "%s\n", engine_last_error());
+                return false;
+            }
+        } else if (strcmp(arg, "--engine") == 0) {
+            if (strcmp(val, "signal") == 0) opt->extract.engine = ENGINE_SIGNAL;
+            else if (strcmp(val, "values") == 0) opt->extract.engine = ENGINE_VALUES;
+            else return false;
+        } else if (strcmp(arg, "--unit") == 0) {
+            if (!unit_parse(val, &opt->extract.unit)) return false;
+        } else if (strcmp(arg, "--format") == 0) {
+            if (!output_format_parse(val, &opt->output.format)) return false;
+            opt->format_set = true;
+        } else if (strcmp(arg, "--csv-delimiter") == 0) {
+            if (!csv_delimiter_parse(val, &opt->output.csv.delimiter)) return false;
+        } else if (strcmp(arg, "--csv-decimals") == 0) {
+            char *end;
+            long n = strtol(val, &end, 10);
+            if (*end || end == val || n < 0 || n > OUT_ROW_MAX_DECIMALS) return false;
+            opt->output.csv.decimals = (int)n;
+        } else if (strcmp(arg, "--dtype") == 0) {
+            if (!output_dtype_parse(val, &opt->output.dtype)) return false;
+        } else if (strcmp(arg, "--scale") == 0) {
+            char *end;
+            opt->output.scale = strtod(val, &end);
+            if (*end || !(opt->output.scale >= OUTPUT_SCALE_MIN && opt->output.scale <= OUTPUT_SCALE_MAX))
+                return false;
+        } else if (strcmp(arg, "--offset") == 0) {
+            char *end;
+            opt->output.offset = strtod(val, &end);
+            if (*end || end == val ||
+                !(opt->output.offset >= -OUTPUT_OFFSET_MAX && opt->output.offset <= OUTPUT_OFFSET_MAX))
+                return false;
+            opt->offset_set = true;
+        } else if (strcmp(arg, "--downsample") == 0) {
+            char *end;
+            long factor = strtol(val, &end, 10);
+            if (*end || factor < 1 || factor > DOWNSAMPLE_MAX) return false;
+            opt->extract.downsample = (unsigned)factor;
+        } else if (strcmp(arg, "--pool") == 0) {
+            if (!pool_parse(val, &opt->extract.pool)) return false;
+        } else if (strcmp(arg, "--histogram") == 0) {
+            char *end;
+            long bins = strtol(val, &end, 10);
+            if (*end || bins < 1 || bins > 4096) return false;
+            opt->histogram_bins = (int)bins;
+        } else if (strcmp(arg, "--frames") == 0) {
+            if (!frame_range_parse(val, &opt->frames)) return false;
+            opt->sequence = true;
+        } else if (strcmp(arg, "--write-index") == 0) {
+            opt->write_index = val;
+        } else if (strcmp(arg, "--index") == 0) {
+            opt->index_path = val;
+        } else if (strcmp(arg, "--where") == 0) {
+            if (!index_query_parse(val, &opt->where)) return false;
+        } else if (strcmp(arg, "--aggregate") == 0) {
+            if (!aggregate_parse(val, &opt->aggregate)) return false;
+            opt->sequence = true;
+        } else if (strcmp(arg, "--window") == 0) {
+            char *end;
+            long long n = strtoll(val, &end, 10);
+            if (*end || end == val || n < 1) return false;
+            opt->window = (size_t)n;
+        } else if (strcmp(arg, "--input") == 0) {
+            if (!input_mode_parse(val, &opt->input_mode)) return false;
+        } else if (strcmp(arg, "--live") == 0) {
+            opt->live = val;
+        } else if (strcmp(arg, "--ring") == 0) {
+            char *end;
+            long ring = strtol(val, &end, 10);
+            if (*end || ring < 2 || ring > 1024 || (ring & (ring - 1))) return false;
+            opt->live_ring = (size_t)ring;
+        } else if (strcmp(arg, "--keyframe") == 0) {
+            char *end;
+            long n = strtol(val, &end, 10);
+            if (*end || n < 1 || n > 100000) return false;
+            opt->keyframe = (unsigned)n;
+        } else if (strcmp(arg, "--drop") == 0) {
+            if (!live_drop_parse(val, &opt->live_drop)) return false;
+        } else if (strcmp(arg, "--jobs") == 0) {
+            char *end;
+            long jobs = strtol(val, &end, 10);
+            if (*end || jobs < 1 || jobs > POOL_MAX_WORKERS) return false;
+            opt->jobs = (unsigned)jobs;
+        } else if (strcmp(arg, "--repeat") == 0) {
+            char *end;
+            long n = strtol(val, &end, 10);
+            if (*end || end == val || n < 1 || n > 1000000) return false;
+            opt->repeat = (unsigned)n;
+            opt->profile = true;
+        } else {
+            return false;
+        }
     }
 
-    size_t width = ACS_ThermalImage_getWidth(img);
-    size_t height = ACS_ThermalImage_getHeight(img);
+    // Perfil só da conversão de uma imagem, o caminho que tem as fases e o resumo
+    if (opt->profile && (opt->batch || opt->live || opt->metadata_only || opt->stats_only || opt->measure.count ||
+                         opt->isotherm.count || opt->hotspots.enabled))
+        return false;
+    if (opt->profile && !opt->repeat)
+        opt->repeat = 1;
 
-    // Tentativas automáticas de função compatível
-    for (size_t y = 0; y < height; ++y) {
-        for (size_t x = 0; x < width; ++x) {
-            double temp = 0.0;
+    if (!opt->offset_set)
+        opt->output.offset = unit_absolute_zero(opt->extract.unit);
+    // Só metadados: nada de matriz nem de análises, uma linha JSON por imagem
+    if (opt->metadata_only) {
+        if (opt->roi_count || opt->measure.count || opt->isotherm.count || opt->hotspots.enabled ||
+            opt->variant_count || opt->stats_only || opt->histogram_bins || opt->live || opt->sequence ||
+            opt->write_index || opt->index_path || opt->extract.downsample > 1 || (opt->format_set && opt->output.format != FORMAT_JSON))
+            return false;
+        opt->output.format = FORMAT_JSON;
+        return positional == 2;
+    }
+    // Medições substituem a matriz: saída sempre JSON, com as formas dando as áreas
+    if (opt->measure.count) {
+        if (opt->roi_count || opt->stats_only || opt->histogram_bins || opt->live || opt->extract.downsample > 1 ||
+            (opt->format_set && opt->output.format != FORMAT_JSON))
+            return false;
+        opt->output.format = FORMAT_JSON;
+    }
+    // Isotermas também substituem a matriz; as máscaras comparam direto o buffer de sinal
+    if (opt->isotherm.count) {
+        if (opt->measure.count || opt->stats_only || opt->histogram_bins || opt->live ||
+            opt->extract.downsample > 1 || opt->extract.engine != ENGINE_SIGNAL ||
+            (opt->format_set && opt->output.format != FORMAT_JSON))
+            return false;
+        opt->output.format = FORMAT_JSON;
+    }
+    // Regiões quentes idem, e também sobre o sinal bruto do modo ao vivo
+    if (opt->hotspots.enabled) {
+        if (opt->measure.count || opt->isotherm.count || opt->stats_only || opt->histogram_bins ||
+            opt->extract.downsample > 1 || opt->extract.engine != ENGINE_SIGNAL ||
+            (opt->format_set && opt->output.format != FORMAT_JSON))
+            return false;
+        opt->output.format = FORMAT_JSON;
+    }
+    // Variantes precisam da ACS_ThermalImage e geram uma matriz cada
+    if (opt->variant_count && (opt->live || opt->stats_only || opt->measure.count || opt->isotherm.count ||
+                               opt->hotspots.enabled || opt->histogram_bins || opt->output.format == FORMAT_DELTA))
+        return false;
+    // Delta referencia o quadro anterior do mesmo retângulo e o histograma é de um só
+    if (opt->multi_roi && (opt->output.format == FORMAT_DELTA || opt->histogram_bins))
+        return false;
+    // Delta só faz sentido entre quadros: sequência ou ao vivo, pelo caminho de sinal
+    if (opt->output.format == FORMAT_DELTA &&
+        (opt->stats_only || opt->batch || opt->extract.engine != ENGINE_SIGNAL || (!opt->live && !opt->sequence &&
+         !(positional == 2 && sequence_path_detect(opt->input_path)))))
+        return false;
+    if (opt->live) {
+        // Só o diretório de saída é posicional; quadros ao vivo chegam como sinal bruto
+        if (positional != 1 || opt->batch || opt->sequence || opt->histogram_bins || opt->write_index ||
+            opt->index_path || opt->where.count ||
+            opt->extract.engine != ENGINE_SIGNAL || (opt->stats_only && opt->output.format == FORMAT_BIN))
+            return false;
+        if (opt->output.format == FORMAT_ARROW)
+            return false;
+        opt->output_path = opt->input_path;
+        opt->input_path = NULL;
+        output_configure_extract(&opt->output, &opt->extract);
+        return true;
+    }
+    opt->extract.histogram = opt->histogram_bins > 0;
+    output_configure_extract(&opt->output, &opt->extract);
+    if (positional == 2 && !opt->batch && sequence_path_detect(opt->input_path))
+        opt->sequence = true;
+    if (opt->profile && opt->sequence)
+        return false;
+    // O histograma vai no resumo de um único arquivo
+    if ((opt->batch || opt->sequence) && opt->histogram_bins)
+        return false;
+    if (opt->batch && opt->sequence)
+        return false;
+    // O índice é de sequência e guarda as estatísticas das matrizes ou do resumo
+    if ((opt->write_index || opt->index_path) && !opt->sequence)
+        return false;
+    if ((opt->where.count && !opt->index_path) ||
+        (opt->write_index && (opt->measure.count || opt->isotherm.count || opt->hotspots.enabled)))
+        return false;
+    // Agregados: uma matriz por estatística e janela, de um único retângulo
+    if (opt->window && !opt->aggregate)
+        return false;
+    if (opt->aggregate &&
+        (opt->multi_roi || opt->measure.count || opt->isotherm.count || opt->hotspots.enabled || opt->variant_count ||
+         opt->stats_only || opt->write_index || opt->output.format == FORMAT_DELTA))
+        return false;
+    // Arrow guarda matrizes inteiras de imagens, não séries de quadros
+    if (opt->output.format == FORMAT_ARROW && (opt->sequence || opt->stats_only))
+        return false;
+    if (opt->stats_only && (opt->batch || opt->output.format == FORMAT_BIN || opt->histogram_bins ||
+                            opt->extract.downsample > 1))
+        return false;
+    return positional == 2;
+}
 
-            #if defined(ACS_ThermalImage_getObjectTemperatureAt)
-                temp = ACS_ThermalImage_getObjectTemperatureAt(img, x, y).value;
-            #elif defined(ACS_ThermalImage_getTemperatureAt)
-                temp = ACS_ThermalImage_getTemperatureAt(img, x, y).value;
-            #elif defined(ACS_ThermalImage_getPixelTemperature)
-                temp = ACS_ThermalImage_getPixelTemperature(img, x, y).value;
-            #else
-                fprintf(stderr, "⚠️ Nenhuma função de leitura de temperatura encontrada no SDK instalado.\n");
-                temp = -9999.0; // marcador de erro
-            #endif
+// Destino das linhas com --format arrow: o arquivo aberto e o nome da entrada
+typedef struct {
+    ArrowWriter *writer;
+    const char *file;
+} ArrowTarget;
+
+// `delta` guarda o quadro-chave do fluxo (só com --format delta); `stride` como em delta_encode.
+// Com `bands`, matrizes grandes em CSV/JSON são formatadas em faixas paralelas (--jobs threads).
+static bool serialize_frame(OutBuf *out, ACS_ThermalImage *img, const Frame *frame, const Options *opt,
+                            Workspace *ws, DeltaEncoder *delta, uint64_t stride, RowBands *bands,
+                            const ArrowTarget *arrow, size_t *clipped) {
+    *clipped = 0;
+    switch (opt->output.format) {
+    case FORMAT_ARROW: return arrow && arrow_append(arrow->writer, img, arrow->file, frame);
+    case FORMAT_DELTA:
+        *clipped = frame->clipped;
+        return delta && delta_encode(delta, out, frame, &opt->output, (uint64_t)frame->index, stride);
+    case FORMAT_BIN: return serialize_bin(out, img, frame, &opt->output, ws, clipped);
+    default:
+        return serialize_banded(out, img, frame, opt->output.format, &opt->output.csv, bands,
+                                bands ? (opt->jobs ? opt->jobs : pool_default_workers()) : 1);
+    }
+}
+
+// Retângulos de --roi numa imagem width x height (ela inteira sem --roi)
+static bool resolve_rois(const Options *opt, int width, int height, ACS_Rectangle *rects, size_t *count) {
+    *count = 0;
+    for (size_t i = 0; i < opt->roi_count; ++i)
+        if (!parse_roi_list(opt->roi_specs[i], width, height, rects, count))
+            return false;
+    if (!*count) {
+        rects[0] = (ACS_Rectangle){ 0, 0, width, height };
+        *count = 1;
+    }
+    return true;
+}
 
-            fprintf(fp, "%.2f", temp);
-            if (x < width - 1) fprintf(fp, ";");
+// Extrai e serializa cada retângulo em sequência, da imagem ou (ao vivo, `img` NULL) do
+// sinal bruto; só a área pedida é convertida. Com --params, repete tudo para cada
+// variante sobre o mesmo sinal (só a LUT muda) e devolve a imagem aos parâmetros do
+// arquivo. Com várias ROIs ou variantes o JSON vira um array e o CSV marca cada
+// bloco; com --measure, --isotherm ou --hotspots, grava só as medições, as máscaras ou as
+// regiões. Com --format arrow, cada matriz vira uma linha de `arrow` e `out` pode ser NULL.
+// `frames` (opcional) recebe um quadro
+// por variante e retângulo, para o resumo. Em erro, o motivo fica em engine_last_error().
+static bool serialize_regions(OutBuf *out, ACS_ThermalImage *img, const RawSignal *raw, const ACS_Rectangle *rects,
+                              size_t count, long index, const Options *opt, Workspace *ws, DeltaEncoder *delta,
+                              uint64_t stride, RowBands *bands, const ArrowTarget *arrow, Frame *frames,
+                              size_t *clipped) {
+    *clipped = 0;
+    if (opt->measure.count)
+        return measure_eval_json(&opt->measure, img, opt->extract.unit, index, out);
+    if (opt->isotherm.count) {
+        for (size_t i = 0; i < count; ++i)
+            if (!isotherm_eval_json(&opt->isotherm, img, &rects[i], opt->extract.unit, ws, index, out))
+                return false;
+        return true;
+    }
+    if (opt->hotspots.enabled) {
+        for (size_t i = 0; i < count; ++i) {
+            SignalWindow win;
+            if (img ? !engine_signal_window(img, &rects[i], ws, &win) : !engine_signal_window_raw(raw, &rects[i], &win))
+                return false;
+            if (!hotspot_eval_json(&opt->hotspots, &win, &rects[i], opt->extract.unit, ws, index, out))
+                return false;
+        }
+        return true;
+    }
+    ParamState params;
+    if (opt->variant_count && !params_begin(img, &params))
+        return false;
+    size_t variants = opt->variant_count ? opt->variant_count : 1;
+    bool array = (opt->multi_roi || opt->variant_count) && opt->output.format == FORMAT_JSON;
+    bool ok = true;
+    if (array)
+        out_char(out, '[');
+    for (size_t v = 0; ok && v < variants; ++v) {
+        const ParamSet *variant = opt->variant_count ? &opt->variants[v] : NULL;
+        if (variant && !(ok = params_apply(&params, variant)))
+            break;
+        for (size_t i = 0; ok && i < count; ++i) {
+            Frame frame;
+            uint64_t t0 = profiling ? now_ns() : 0;
+            if (img ? !engine_extract(img, &rects[i], &opt->extract, ws, &frame)
+                    : !engine_extract_raw(raw, &rects[i], &opt->extract, ws, &frame)) {
+                ok = false;
+                break;
+            }
+            if (profiling)
+                profiling->extract_ns += now_ns() - t0;
+            frame.index = index;
+            frame.tag_roi = opt->multi_roi;
+            frame.params = variant ? variant->label : NULL;
+            if (array && (v || i))
+                out_char(out, ',');
+            size_t n;
+            if (!serialize_frame(out, img, &frame, opt, ws, delta, stride, bands, arrow, &n)) {
+                ok = opt->output.format == FORMAT_DELTA || opt->output.format == FORMAT_ARROW
+                         ? false
+                         : engine_fail("sem memória ao serializar");
+                break;
+            }
+            *clipped += n;
+            if (frames)
+                frames[v * count + i] = frame;
         }
-        fprintf(fp, "\n");
     }
+    if (opt->variant_count && !params_restore(&params))
+        ok = false;
+    if (!ok)
+        return false;
+    if (array)
+        out_str(out, "]\n");
+    return !out || !out->failed || engine_fail("sem memória ao serializar");
+}
+
+// Uma linha de estatísticas por retângulo (--stats-only); `summaries` (opcional) recebe
+// o resumo de cada um
+static bool summarize_regions(OutBuf *out, ACS_ThermalImage *img, const RawSignal *raw, const ACS_Rectangle *rects,
+                              size_t count, long index, const Options *opt, Workspace *ws, FrameSummary *summaries) {
+    for (size_t i = 0; i < count; ++i) {
+        FrameSummary sm;
+        if (img ? !engine_summarize(img, &rects[i], &opt->extract, ws, &sm)
+                : !engine_summarize_raw(raw, &rects[i], &opt->extract, ws, &sm))
+            return false;
+        serialize_summary(out, opt->output.format, &sm, index, opt->multi_roi);
+        if (summaries)
+            summaries[i] = sm;
+    }
+    return !out->failed || engine_fail("sem memória ao serializar");
+}
+
+// Grava os retângulos em `path` pelo buffer de 1 MiB (faixas paralelas com `bands`); com
+// --format arrow, um arquivo com uma linha por matriz. `source` é a entrada, para a coluna
+// "file". Em erro, motivo em engine_last_error()
+static bool write_output(ACS_ThermalImage *img, const ACS_Rectangle *rects, size_t count, const Options *opt,
+                         Workspace *ws, RowBands *bands, const char *source, const char *path, Frame *frames,
+                         size_t *clipped) {
+    FILE *fp = fopen(path, output_is_binary(opt->output.format) ? "wb" : "w");
+    if (!fp)
+        return engine_fail("erro ao criar %s: %s", path, strerror(errno));
+
+    OutBuf out;
+    out_init_file(&out, fp, OUT_DEFAULT_CAPACITY);
+    bool ok;
+    if (opt->output.format == FORMAT_ARROW) {
+        ArrowWriter writer;
+        ArrowTarget arrow = { &writer, source };
+        ok = arrow_begin(&writer, &out, opt->extract.unit) &&
+             serialize_regions(&out, img, NULL, rects, count, -1, opt, ws, NULL, 0, bands, &arrow, frames, clipped) &&
+             arrow_finish(&writer);
+        arrow_free(&writer);
+    } else {
+        ok = serialize_regions(&out, img, NULL, rects, count, -1, opt, ws, NULL, 0, bands, NULL, frames, clipped);
+    }
+    if (!out_flush(&out) && ok)
+        ok = engine_fail("erro ao gravar %s: %s", path, strerror(errno));
+    out_free(&out);
+    if (fclose(fp) != 0 && ok)
+        ok = engine_fail("erro ao gravar %s: %s", path, strerror(errno));
+    return ok;
+}
 
+static void warn_clipped(const char *path, size_t clipped, const Options *opt) {
+    if (clipped)
+        fprintf(stderr, "⚠️ %s: %zu pixels fora da faixa uint16 (scale=%g, offset=%g) foram saturados.\n",
+                path, clipped, opt->output.scale, opt->output.offset);
+}
+
+// Abre `path` em `img` pelo modo pedido. Com mmap, o mapeamento fica em `map` até
+// a imagem deixar de ser usada. Em erro, errno != 0 indica falha de E/S; senão,
+// o motivo está em ACS_getLastErrorMessage().
+static bool open_input(ACS_ThermalImage *img, const char *path, InputMode mode, MappedFile *map) {
+    errno = 0;
+    if (mode == INPUT_MMAP) {
+        if (!input_map(path, map))
+            return false;
+        ACS_ThermalImage_openFromMemory(img, map->data, map->len);
+    } else {
+        ACS_ThermalImage_openFromFile(img, path);
+    }
+    errno = 0;
+    return ACS_getLastErrorCode() == 0;
+}
+
+// Lista de caminhos de entrada do lote
+typedef struct {
+    char **items;
+    size_t len;
+    size_t capacity;
+} PathList;
+
+static bool paths_push(PathList *list, const char *path) {
+    if (list->len == list->capacity) {
+        size_t cap = list->capacity ? list->capacity * 2 : 256;
+        char **grown = realloc(list->items, cap * sizeof(*grown));
+        if (!grown)
+            return false;
+        list->items = grown;
+        list->capacity = cap;
+    }
+    if (!(list->items[list->len] = strdup(path)))
+        return false;
+    list->len++;
+    return true;
+}
+
+static void paths_free(PathList *list) {
+    for (size_t i = 0; i < list->len; ++i)
+        free(list->items[i]);
+    free(list->items);
+    memset(list, 0, sizeof(*list));
+}
+
+static int compare_paths(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+// Arquivos regulares do diretório (sem ocultos), em ordem alfabética
+static bool collect_directory(const char *dir, PathList *list) {
+    DIR *d = opendir(dir);
+    if (!d)
+        return false;
+    bool ok = true;
+    struct dirent *e;
+    char path[4096];
+    while (ok && (e = readdir(d))) {
+        if (e->d_name[0] == '.')
+            continue;
+        struct stat st;
+        if (snprintf(path, sizeof(path), "%s/%s", dir, e->d_name) >= (int)sizeof(path) ||
+            stat(path, &st) != 0 || !S_ISREG(st.st_mode))
+            continue;
+        ok = paths_push(list, path);
+    }
+    closedir(d);
+    if (ok)
+        qsort(list->items, list->len, sizeof(*list->items), compare_paths);
+    return ok;
+}
+
+static bool collect_glob(const char *pattern, PathList *list) {
+    glob_t g;
+    int rc = glob(pattern, 0, NULL, &g);
+    if (rc == GLOB_NOMATCH)
+        return true;
+    if (rc != 0)
+        return false;
+    bool ok = true;
+    for (size_t i = 0; ok && i < g.gl_pathc; ++i)
+        ok = paths_push(list, g.gl_pathv[i]);
+    globfree(&g);
+    return ok;
+}
+
+// Manifesto: um caminho por linha; linhas vazias e iniciadas por '#' são ignoradas
+static bool collect_manifest(const char *manifest, PathList *list) {
+    FILE *fp = fopen(manifest, "r");
+    if (!fp)
+        return false;
+    bool ok = true;
+    char *line = NULL;
+    size_t cap = 0;
+    ssize_t n;
+    while (ok && (n = getline(&line, &cap, fp)) >= 0) {
+        while (n > 0 && (line[n - 1] == '\n' || line[n - 1] == '\r'))
+            line[--n] = 0;
+        if (n == 0 || line[0] == '#')
+            continue;
+        ok = paths_push(list, line);
+    }
+    ok = ok && !ferror(fp);
+    free(line);
     fclose(fp);
-    printf("✅ CSV gerado com sucesso: %s\n", csv_path);
+    return ok;
+}
+
+static bool collect_inputs(const char *source, PathList *list) {
+    struct stat st;
+    if (stat(source, &st) == 0 && S_ISDIR(st.st_mode))
+        return collect_directory(source, list);
+    if (strpbrk(source, "*?["))
+        return collect_glob(source, list);
+    return collect_manifest(source, list);
+}
+
+// <dir>/<nome da entrada sem extensão>.csv|.bin|.json
+static char *batch_output_path(const char *dir, const char *input, OutputFormat format) {
+    const char *name = strrchr(input, '/');
+    name = name ? name + 1 : input;
+    const char *dot = strrchr(name, '.');
+    int stem = dot && dot != name ? (int)(dot - name) : (int)strlen(name);
+    const char *ext = output_extension(format);
+    size_t size = strlen(dir) + (size_t)stem + 7;
+    char *path = malloc(size);
+    if (path)
+        snprintf(path, size, "%s/%.*s.%s", dir, stem, name, ext);
+    return path;
+}
+
+// Estado próprio de cada thread do lote, reaproveitado entre arquivos
+typedef struct {
+    ACS_ThermalImage *img;
+    Workspace ws;
+    MappedFile map; // arquivo atual com --input mmap
+    OutBuf line;    // --metadata-only: documento da imagem atual
+} BatchWorker;
+
+typedef struct {
+    const Options *opt;
+    const PathList *inputs;
+    char **outputs;       // um por entrada; NULL com arrow
+    ArrowWriter *arrow;   // --format arrow: todas as entradas no mesmo arquivo
+    BatchWorker *workers;
+    unsigned jobs;
+    atomic_size_t failed;
+} Batch;
+
+// Converte um arquivo do lote (com `arrow`, em linhas do arquivo comum, na ordem em que
+// terminam); em erro, imprime o motivo e retorna false
+static bool batch_convert(BatchWorker *w, const Options *opt, const char *in, const char *out, ArrowWriter *arrow) {
+    if (!w->img && !(w->img = ACS_ThermalImage_alloc())) {
+        fprintf(stderr, "❌ %s: falha ao alocar imagem: %s\n", in, ACS_getLastErrorMessage());
+        return false;
+    }
+    if (!open_input(w->img, in, opt->input_mode, &w->map)) {
+        fprintf(stderr, "❌ %s: %s\n", in, errno ? strerror(errno) : ACS_getLastErrorMessage());
+        return false;
+    }
+    if (!engine_prepare(w->img, &opt->extract)) {
+        fprintf(stderr, "❌ %s: %s\n", in, engine_last_error());
+        return false;
+    }
+
+    ACS_Rectangle rects[ROI_MAX];
+    size_t count;
+    size_t clipped;
+    ArrowTarget target = { arrow, in };
+    if (!resolve_rois(opt, ACS_ThermalImage_getWidth(w->img), ACS_ThermalImage_getHeight(w->img), rects, &count) ||
+        !(arrow ? serialize_regions(NULL, w->img, NULL, rects, count, -1, opt, &w->ws, NULL, 0, NULL, &target, NULL,
+                                    &clipped)
+                : write_output(w->img, rects, count, opt, &w->ws, NULL, in, out, NULL, &clipped))) {
+        fprintf(stderr, "❌ %s: %s\n", in, engine_last_error());
+        return false;
+    }
+    if (out)
+        warn_clipped(out, clipped, opt);
+    return true;
+}
+
+static void batch_task(void *ctx, unsigned worker, size_t index) {
+    Batch *batch = ctx;
+    BatchWorker *w = &batch->workers[worker];
+
+    // Os índices saem em ordem entre as threads: o próximo desta thread deve ser
+    // index + jobs. Começa a lê-lo enquanto o atual decodifica.
+    if (batch->opt->input_mode == INPUT_MMAP && index + batch->jobs < batch->inputs->len)
+        input_prefetch(batch->inputs->items[index + batch->jobs]);
+
+    if (!batch_convert(w, batch->opt, batch->inputs->items[index],
+                       batch->outputs ? batch->outputs[index] : NULL, batch->arrow))
+        atomic_fetch_add(&batch->failed, 1);
+    input_unmap(&w->map);
+}
+
+// Modo lote: SDK carregado uma vez, arquivos distribuídos entre as threads
+static int run_batch(const Options *opt) {
+    PathList inputs = { 0 };
+    if (!collect_inputs(opt->input_path, &inputs)) {
+        perror("Erro ao listar entradas do lote");
+        return 1;
+    }
+    // Arrow: um único arquivo de saída, aberto antes das threads, em vez do diretório
+    bool arrow = opt->output.format == FORMAT_ARROW;
+    char **outputs = NULL;
+    if (!arrow) {
+        if (mkdir(opt->output_path, 0777) != 0 && errno != EEXIST) {
+            perror("Erro ao criar diretório de saída");
+            return 1;
+        }
+        outputs = calloc(inputs.len ? inputs.len : 1, sizeof(*outputs));
+        char **sorted = calloc(inputs.len ? inputs.len : 1, sizeof(*sorted));
+        if (!outputs || !sorted) {
+            perror("Erro ao preparar lote");
+            return 1;
+        }
+        for (size_t i = 0; i < inputs.len; ++i) {
+            if (!(outputs[i] = batch_output_path(opt->output_path, inputs.items[i], opt->output.format))) {
+                perror("Erro ao preparar lote");
+                return 1;
+            }
+            sorted[i] = outputs[i];
+        }
+        // Duas entradas com o mesmo nome (ex.: manifesto com pastas diferentes) gravariam
+        // no mesmo arquivo de saída
+        qsort(sorted, inputs.len, sizeof(*sorted), compare_paths);
+        for (size_t i = 1; i < inputs.len; ++i) {
+            if (strcmp(sorted[i - 1], sorted[i]) == 0) {
+                fprintf(stderr, "Entradas diferentes gerariam a mesma saída: %s\n", sorted[i]);
+                return 1;
+            }
+        }
+        free(sorted);
+    }
+    FILE *fp = NULL;
+    OutBuf out;
+    ArrowWriter writer;
+    if (arrow) {
+        if (!(fp = fopen(opt->output_path, "wb"))) {
+            perror("Erro ao criar arquivo de saída");
+            return 1;
+        }
+        out_init_file(&out, fp, OUT_DEFAULT_CAPACITY);
+        if (!arrow_begin(&writer, &out, opt->extract.unit)) {
+            fprintf(stderr, "%s\n", engine_last_error());
+            return 1;
+        }
+    }
+
+    unsigned jobs = opt->jobs ? opt->jobs : pool_default_workers();
+    Batch batch = { opt, &inputs, outputs, arrow ? &writer : NULL, calloc(jobs, sizeof(BatchWorker)), jobs, 0 };
+    if (!batch.workers) {
+        perror("Erro ao preparar lote");
+        return 1;
+    }
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    unsigned used = pool_run(inputs.len, jobs, batch_task, &batch);
+    bool written = true;
+    if (arrow) {
+        written = arrow_finish(&writer) &&
+                  (out_flush(&out) || engine_fail("erro ao gravar %s: %s", opt->output_path, strerror(errno)));
+        arrow_free(&writer);
+        out_free(&out);
+        if (fclose(fp) != 0 && written)
+            written = engine_fail("erro ao gravar %s: %s", opt->output_path, strerror(errno));
+        if (!written)
+            fprintf(stderr, "❌ %s\n", engine_last_error());
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double seconds = (double)(t1.tv_sec - t0.tv_sec) + (double)(t1.tv_nsec - t0.tv_nsec) * 1e-9;
+
+    size_t failed = atomic_load(&batch.failed);
+    OutBuf summary;
+    out_init_file(&summary, stdout, 4096);
+    out_str(&summary, failed || !written ? "{\"status\": \"error\", \"message\": \"Lote concluído com falhas.\""
+                             : "{\"status\": \"ok\", \"message\": \"Lote concluído com sucesso!\"");
+    out_str(&summary, ", \"simd\": \"");
+    out_str(&summary, kernel_isa());
+    out_str(&summary, "\", \"files\": ");
+    out_uint(&summary, inputs.len);
+    out_str(&summary, ", \"failed\": ");
+    out_uint(&summary, failed);
+    out_str(&summary, ", \"workers\": ");
+    out_uint(&summary, used);
+    out_str(&summary, ", \"seconds\": ");
+    out_json_number(&summary, seconds, 3);
+    out_str(&summary, "}\n");
+    out_flush(&summary);
+    out_free(&summary);
+
+    for (unsigned i = 0; i < jobs; ++i) {
+        if (batch.workers[i].img)
+            ACS_ThermalImage_free(batch.workers[i].img);
+        workspace_free(&batch.workers[i].ws);
+    }
+    free(batch.workers);
+    for (size_t i = 0; outputs && i < inputs.len; ++i)
+        free(outputs[i]);
+    free(outputs);
+    paths_free(&inputs);
+    return failed || !written ? 1 : 0;
+}
+
+typedef struct {
+    const Options *opt;
+    const PathList *inputs;
+    BatchWorker *workers;
+    unsigned jobs;
+    pthread_mutex_t lock; // `out` é do arquivo comum
+    OutBuf *out;
+    atomic_size_t failed;
+} MetadataJob;
+
+// Abre a imagem e lê só os metadados: sem engine_prepare, nada de LUT nem de matriz
+static void metadata_task(void *ctx, unsigned worker, size_t index) {
+    MetadataJob *job = ctx;
+    BatchWorker *w = &job->workers[worker];
+    const char *in = job->inputs->items[index];
+    if (job->opt->input_mode == INPUT_MMAP && index + job->jobs < job->inputs->len)
+        input_prefetch(job->inputs->items[index + job->jobs]);
+
+    bool ok = false;
+    w->line.len = 0;
+    if (!w->img && !(w->img = ACS_ThermalImage_alloc()))
+        fprintf(stderr, "❌ %s: falha ao alocar imagem: %s\n", in, ACS_getLastErrorMessage());
+    else if (!open_input(w->img, in, job->opt->input_mode, &w->map))
+        fprintf(stderr, "❌ %s: %s\n", in, errno ? strerror(errno) : ACS_getLastErrorMessage());
+    else if (!serialize_metadata_json(&w->line, w->img, in, job->opt->extract.unit))
+        fprintf(stderr, "❌ %s: sem memória ao serializar\n", in);
+    else
+        ok = true;
+    input_unmap(&w->map);
+    if (!ok) {
+        atomic_fetch_add(&job->failed, 1);
+        return;
+    }
+    pthread_mutex_lock(&job->lock);
+    out_write(job->out, w->line.data, w->line.len);
+    pthread_mutex_unlock(&job->lock);
+}
+
+// --metadata-only: a imagem, ou cada entrada do lote na ordem em que termina, vira uma
+// linha JSON do arquivo de saída
+static int run_metadata(const Options *opt) {
+    PathList inputs = { 0 };
+    if (opt->batch ? !collect_inputs(opt->input_path, &inputs) : !paths_push(&inputs, opt->input_path)) {
+        perror("Erro ao listar entradas");
+        return 1;
+    }
+    FILE *fp = fopen(opt->output_path, "w");
+    if (!fp) {
+        perror("Erro ao criar arquivo de metadados");
+        return 1;
+    }
+    unsigned jobs = !opt->batch ? 1 : opt->jobs ? opt->jobs : pool_default_workers();
+    OutBuf out;
+    out_init_file(&out, fp, OUT_DEFAULT_CAPACITY);
+    MetadataJob job = { opt, &inputs, calloc(jobs, sizeof(BatchWorker)), jobs, PTHREAD_MUTEX_INITIALIZER, &out, 0 };
+    if (!job.workers) {
+        perror("Erro ao preparar lote");
+        return 1;
+    }
+    for (unsigned i = 0; i < jobs; ++i)
+        out_init_memory(&job.workers[i].line, 4096);
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    unsigned used = pool_run(inputs.len, jobs, metadata_task, &job);
+    bool written = out_flush(&out);
+    out_free(&out);
+    written = fclose(fp) == 0 && written;
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    if (!written)
+        fprintf(stderr, "❌ erro ao gravar %s: %s\n", opt->output_path, strerror(errno));
+    for (unsigned i = 0; i < jobs; ++i) {
+        if (job.workers[i].img)
+            ACS_ThermalImage_free(job.workers[i].img);
+        out_free(&job.workers[i].line);
+    }
+    free(job.workers);
+    pthread_mutex_destroy(&job.lock);
+
+    size_t failed = atomic_load(&job.failed);
+    if (!opt->batch) {
+        paths_free(&inputs);
+        if (failed || !written)
+            return 1;
+        printf("✅ Metadados gerados com sucesso: %s\n", opt->output_path);
+        return 0;
+    }
+    double seconds = (double)(t1.tv_sec - t0.tv_sec) + (double)(t1.tv_nsec - t0.tv_nsec) * 1e-9;
+    OutBuf summary;
+    out_init_file(&summary, stdout, 4096);
+    out_str(&summary, failed || !written ? "{\"status\": \"error\", \"message\": \"Lote concluído com falhas.\""
+                                         : "{\"status\": \"ok\", \"message\": \"Lote concluído com sucesso!\"");
+    out_str(&summary, ", \"files\": ");
+    out_uint(&summary, inputs.len);
+    out_str(&summary, ", \"failed\": ");
+    out_uint(&summary, failed);
+    out_str(&summary, ", \"workers\": ");
+    out_uint(&summary, used);
+    out_str(&summary, ", \"seconds\": ");
+    out_json_number(&summary, seconds, 3);
+    out_str(&summary, "}\n");
+    out_flush(&summary);
+    out_free(&summary);
+    paths_free(&inputs);
+    return failed || !written ? 1 : 0;
+}
+
+// --stats-only numa imagem única: cabeçalho + uma linha por retângulo
+static int write_summary_only(ACS_ThermalImage *img, const ACS_Rectangle *rects, size_t count, const Options *opt,
+                              Workspace *ws) {
+    FILE *fp = fopen(opt->output_path, "w");
+    if (!fp) {
+        perror("Erro ao criar arquivo de estatísticas");
+        return 1;
+    }
+    OutBuf out;
+    out_init_file(&out, fp, 4096);
+    serialize_summary_header(&out, opt->output.format, opt->multi_roi);
+    if (!summarize_regions(&out, img, NULL, rects, count, 0, opt, ws, NULL)) {
+        fprintf(stderr, "%s\n", engine_last_error());
+        out_free(&out);
+        fclose(fp);
+        return 1;
+    }
+    bool ok = out_flush(&out);
+    out_free(&out);
+    if (fclose(fp) != 0 || !ok) {
+        perror("Erro ao gravar arquivo de estatísticas");
+        return 1;
+    }
+    printf("✅ Estatísticas geradas com sucesso: %s\n", opt->output_path);
+    workspace_free(ws);
+    ACS_ThermalImage_free(img);
+    return 0;
+}
+
+typedef struct {
+    const Options *opt;
+    Workspace *workspaces; // um por thread
+    DeltaEncoder *deltas;  // um por thread, com --format delta
+    atomic_size_t clipped;
+    SequenceIndex *index;     // --write-index
+    Frame *frames;            // `slots` por thread (um por retângulo e variante), com --write-index
+    size_t slots;
+    FrameSummary *summaries;  // ROI_MAX por thread, com --write-index e --stats-only
+} SequenceJob;
+
+// Linha do índice para o quadro: extremos de todas as regiões e média ponderada pela área
+static bool index_frame(SequenceJob *job, unsigned worker, size_t index, ACS_ThermalImage *img, size_t count) {
+    const Options *opt = job->opt;
+    SequenceIndexEntry e = { .frame = index };
+    double sum = 0, weight = 0;
+    size_t n = opt->stats_only ? count : count * (opt->variant_count ? opt->variant_count : 1);
+    for (size_t i = 0; i < n; ++i) {
+        double min, max, mean, area;
+        if (opt->stats_only) {
+            const FrameSummary *sm = &job->summaries[(size_t)worker * ROI_MAX + i];
+            min = sm->min, max = sm->max, mean = sm->mean, area = (double)sm->count;
+        } else {
+            const Frame *f = &job->frames[(size_t)worker * job->slots + i];
+            min = f->stats.min, max = f->stats.max, mean = f->stats.mean;
+            area = (double)f->rect.width * (double)f->rect.height;
+        }
+        e.min = i && e.min < min ? e.min : min;
+        e.max = i && e.max > max ? e.max : max;
+        sum += mean * area;
+        weight += area;
+    }
+    e.mean = weight > 0 ? sum / weight : 0;
+    ACS_Image_CameraInformation *info = ACS_ThermalImage_getCameraInformation(img);
+    if (info && !ACS_getLastErrorCode()) {
+        const char *date = ACS_Image_CameraInformation_getArcDateTime(info);
+        snprintf(e.time, sizeof(e.time), "%s", date ? date : "");
+    }
+    if (info)
+        ACS_Image_CameraInformation_free(info);
+    return sequence_index_add(job->index, &e) || engine_fail("sem memória para o índice");
+}
+
+static bool sequence_frame(void *ctx, unsigned worker, size_t index, ACS_ThermalImage *img, OutBuf *out) {
+    SequenceJob *job = ctx;
+    const Options *opt = job->opt;
+    Workspace *ws = &job->workspaces[worker];
+    if (!engine_prepare(img, &opt->extract)) {
+        fprintf(stderr, "❌ quadro %zu: %s\n", index, engine_last_error());
+        return false;
+    }
+    ACS_Rectangle rects[ROI_MAX];
+    size_t count;
+    size_t clipped = 0;
+    DeltaEncoder *delta = job->deltas ? &job->deltas[worker] : NULL;
+    bool ok = resolve_rois(opt, ACS_ThermalImage_getWidth(img), ACS_ThermalImage_getHeight(img), rects, &count) &&
+              (opt->stats_only
+                   ? summarize_regions(out, img, NULL, rects, count, (long)index, opt, ws,
+                                       job->summaries ? job->summaries + (size_t)worker * ROI_MAX : NULL)
+                   : serialize_regions(out, img, NULL, rects, count, (long)index, opt, ws, delta,
+                                       opt->frames.stride, NULL, NULL,
+                                       job->frames ? job->frames + (size_t)worker * job->slots : NULL,
+                                       &clipped)) &&
+              (!job->index || index_frame(job, worker, index, img, count));
+    if (!ok) {
+        fprintf(stderr, "❌ quadro %zu: %s\n", index, engine_last_error());
+        return false;
+    }
+    atomic_fetch_add(&job->clipped, clipped);
+    return true;
+}
+
+// Quadros de --frames ou, com --index, só os listados que atendem --where, buscados
+// direto pela posição; *list (free com o chamador) guarda a lista de `range`
+static bool selected_frames(const Options *opt, FrameRange *range, size_t **list) {
+    *range = opt->frames;
+    *list = NULL;
+    if (!opt->index_path)
+        return true;
+    SequenceIndex in;
+    sequence_index_init(&in, opt->extract.unit);
+    bool ok = sequence_index_read(&in, opt->index_path, opt->input_path) &&
+              sequence_index_select(&in, opt->where.count ? &opt->where : NULL, &opt->frames, list, &range->list_len);
+    sequence_index_free(&in);
+    range->list = *list;
+    return ok;
+}
+
+// Modo sequência: quadros decodificados em paralelo, gravados em ordem num único arquivo
+static int run_sequence(const Options *opt) {
+    FrameRange range;
+    size_t *selected;
+    if (!selected_frames(opt, &range, &selected)) {
+        fprintf(stderr, "%s\n", engine_last_error());
+        return 1;
+    }
+
+    FILE *fp = fopen(opt->output_path, output_is_binary(opt->output.format) ? "wb" : "w");
+    if (!fp) {
+        perror("Erro ao criar arquivo de saída");
+        free(selected);
+        return 1;
+    }
+    unsigned jobs = opt->jobs ? opt->jobs : pool_default_workers();
+    SequenceJob job = { opt, calloc(jobs, sizeof(Workspace)), NULL, 0, NULL, NULL, 0, NULL };
+    SequenceIndex index;
+    if (opt->write_index) {
+        sequence_index_init(&index, opt->extract.unit);
+        job.index = &index;
+        job.slots = ROI_MAX * (opt->variant_count ? opt->variant_count : 1);
+        if (opt->stats_only)
+            job.summaries = calloc((size_t)jobs * ROI_MAX, sizeof(FrameSummary));
+        else
+            job.frames = calloc((size_t)jobs * job.slots, sizeof(Frame));
+    }
+    // Delta: cada bloco começa num quadro-chave, então o bloco tem o tamanho do intervalo
+    size_t chunk = 0;
+    if (opt->output.format == FORMAT_DELTA && (job.deltas = calloc(jobs, sizeof(DeltaEncoder)))) {
+        for (unsigned i = 0; i < jobs; ++i)
+            delta_init(&job.deltas[i], opt->keyframe);
+        chunk = opt->keyframe;
+    }
+    // Sem memória para algum dos buffers: nada é extraído, mas a limpeza abaixo é a mesma
+    bool prepared = job.workspaces && (opt->output.format != FORMAT_DELTA || job.deltas) &&
+                    (!opt->write_index || job.summaries || job.frames);
+    if (!prepared)
+        perror("Erro ao preparar sequência");
+
+    struct timespec t0, t1;
+    SequenceResult res = { 0 };
+    bool ok = false;
+    if (prepared) {
+        OutBuf out;
+        out_init_file(&out, fp, OUT_DEFAULT_CAPACITY);
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        if (opt->stats_only)
+            serialize_summary_header(&out, opt->output.format, opt->multi_roi);
+        ok = sequence_run(opt->input_path, &range, jobs, chunk, sequence_frame, &job, &out, &res, NULL);
+        ok = out_flush(&out) && ok;
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        out_free(&out);
+    }
+    if (fclose(fp) != 0 && ok)
+        ok = engine_fail("erro ao gravar %s", opt->output_path);
+    for (unsigned i = 0; job.workspaces && i < jobs; ++i)
+        workspace_free(&job.workspaces[i]);
+    for (unsigned i = 0; job.deltas && i < jobs; ++i)
+        delta_free(&job.deltas[i]);
+    free(job.workspaces);
+    free(job.deltas);
+    free(job.frames);
+    free(job.summaries);
+    free(selected);
+    if (opt->write_index) {
+        if (ok && !sequence_index_write(&index, opt->write_index, opt->input_path, res.total))
+            ok = false;
+        sequence_index_free(&index);
+    }
+    if (!ok) {
+        if (prepared)
+            fprintf(stderr, "%s\n", engine_last_error());
+        return 1;
+    }
+    warn_clipped(opt->output_path, atomic_load(&job.clipped), opt);
+
+    double seconds = (double)(t1.tv_sec - t0.tv_sec) + (double)(t1.tv_nsec - t0.tv_nsec) * 1e-9;
+    OutBuf summary;
+    out_init_file(&summary, stdout, 4096);
+    out_str(&summary, res.failed ? "{\"status\": \"error\", \"message\": \"Sequência extraída com falhas.\""
+                                 : "{\"status\": \"ok\", \"message\": \"Sequência extraída com sucesso!\"");
+    out_str(&summary, ", \"simd\": \"");
+    out_str(&summary, kernel_isa());
+    out_str(&summary, "\", \"total_frames\": ");
+    out_uint(&summary, res.total);
+    out_str(&summary, ", \"frames\": ");
+    out_uint(&summary, res.frames);
+    out_str(&summary, ", \"failed\": ");
+    out_uint(&summary, res.failed);
+    out_str(&summary, ", \"workers\": ");
+    out_uint(&summary, res.workers);
+    if (opt->write_index) {
+        out_str(&summary, ", \"index\": ");
+        out_json_string(&summary, opt->write_index);
+    }
+    out_str(&summary, ", \"seconds\": ");
+    out_json_number(&summary, seconds, 3);
+    out_str(&summary, "}\n");
+    out_flush(&summary);
+    out_free(&summary);
+    return res.failed ? 1 : 0;
+}
+
+typedef struct {
+    const Options *opt;
+    ExtractOptions extract; // sem u16 direto: o acúmulo usa a matriz em double
+    Workspace *workspaces;  // um por thread
+    Workspace ws;           // serialização das matrizes agregadas
+    RowBands bands;
+    size_t clipped;
+} AggregateJob;
+
+static bool aggregate_frame(void *ctx, unsigned worker, size_t index, ACS_ThermalImage *img, Frame *frame) {
+    AggregateJob *job = ctx;
+    ACS_Rectangle rects[ROI_MAX];
+    size_t count;
+    if (!engine_prepare(img, &job->extract) ||
+        !resolve_rois(job->opt, ACS_ThermalImage_getWidth(img), ACS_ThermalImage_getHeight(img), rects, &count) ||
+        !engine_extract(img, &rects[0], &job->extract, &job->workspaces[worker], frame)) {
+        fprintf(stderr, "❌ quadro %zu: %s\n", index, engine_last_error());
+        return false;
+    }
+    return true;
+}
+
+static bool aggregate_emit(void *ctx, const Frame *frame, OutBuf *out) {
+    AggregateJob *job = ctx;
+    size_t clipped;
+    if (!serialize_frame(out, NULL, frame, job->opt, &job->ws, NULL, 0, &job->bands, NULL, &clipped))
+        return engine_fail("sem memória ao serializar");
+    job->clipped += clipped;
+    return true;
+}
+
+// Modo agregados: mapas temporais por pixel de cada janela da sequência, num único arquivo
+static int run_aggregate(const Options *opt) {
+    FrameRange range;
+    size_t *selected;
+    if (!selected_frames(opt, &range, &selected)) {
+        fprintf(stderr, "%s\n", engine_last_error());
+        return 1;
+    }
+
+    FILE *fp = fopen(opt->output_path, output_is_binary(opt->output.format) ? "wb" : "w");
+    if (!fp) {
+        perror("Erro ao criar arquivo de saída");
+        free(selected);
+        return 1;
+    }
+    unsigned jobs = opt->jobs ? opt->jobs : pool_default_workers();
+    AggregateJob job = { .opt = opt, .extract = opt->extract, .workspaces = calloc(jobs, sizeof(Workspace)) };
+    job.extract.fixed_u16 = false;
+    if (!job.workspaces) {
+        perror("Erro ao preparar sequência");
+        fclose(fp);
+        free(selected);
+        return 1;
+    }
+
+    OutBuf out;
+    out_init_file(&out, fp, OUT_DEFAULT_CAPACITY);
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    AggregateResult res;
+    bool ok = aggregate_run(opt->input_path, &range, opt->window, opt->aggregate, jobs, aggregate_frame,
+                            aggregate_emit, &job, &out, &res);
+    ok = out_flush(&out) && ok;
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    out_free(&out);
+    if (fclose(fp) != 0 && ok)
+        ok = engine_fail("erro ao gravar %s", opt->output_path);
+    for (unsigned i = 0; i < jobs; ++i)
+        workspace_free(&job.workspaces[i]);
+    free(job.workspaces);
+    workspace_free(&job.ws);
+    row_bands_free(&job.bands);
+    free(selected);
+    if (!ok) {
+        fprintf(stderr, "%s\n", engine_last_error());
+        return 1;
+    }
+    warn_clipped(opt->output_path, job.clipped, opt);
+
+    double seconds = (double)(t1.tv_sec - t0.tv_sec) + (double)(t1.tv_nsec - t0.tv_nsec) * 1e-9;
+    OutBuf summary;
+    out_init_file(&summary, stdout, 4096);
+    out_str(&summary, res.failed ? "{\"status\": \"error\", \"message\": \"Agregados gerados com falhas.\""
+                                 : "{\"status\": \"ok\", \"message\": \"Agregados gerados com sucesso!\"");
+    out_str(&summary, ", \"simd\": \"");
+    out_str(&summary, kernel_isa());
+    out_str(&summary, "\", \"total_frames\": ");
+    out_uint(&summary, res.total);
+    out_str(&summary, ", \"frames\": ");
+    out_uint(&summary, res.frames);
+    out_str(&summary, ", \"windows\": ");
+    out_uint(&summary, res.windows);
+    out_str(&summary, ", \"failed\": ");
+    out_uint(&summary, res.failed);
+    out_str(&summary, ", \"workers\": ");
+    out_uint(&summary, res.workers);
+    out_str(&summary, ", \"seconds\": ");
+    out_json_number(&summary, seconds, 3);
+    out_str(&summary, "}\n");
+    out_flush(&summary);
+    out_free(&summary);
+    return res.failed ? 1 : 0;
+}
+
+static volatile sig_atomic_t live_stop;
+
+static void live_on_signal(int sig) {
+    (void)sig;
+    live_stop = 1;
+}
+
+// Saída de uma câmera no modo ao vivo; só um worker de cada vez escreve nela
+typedef struct {
+    char *path;
+    FILE *fp;
+    OutBuf out;
+    Workspace ws;
+    DeltaEncoder delta;
+    size_t clipped;
+} LiveOutput;
+
+typedef struct {
+    const Options *opt;
+    const char *const *addresses;
+    LiveOutput *outputs;
+} LiveJob;
+
+// Cada quadro vai direto para o arquivo da câmera, sem ACS_ThermalImage: a matriz sai
+// do sinal copiado na fila e da LUT capturada junto com ele
+static bool live_frame(void *ctx, size_t camera, uint64_t seq, const RawSignal *raw) {
+    LiveJob *job = ctx;
+    const Options *opt = job->opt;
+    LiveOutput *o = &job->outputs[camera];
+    const char *ip = job->addresses[camera];
+    ACS_Rectangle rects[ROI_MAX];
+    size_t count;
+    size_t clipped = 0;
+    // Com delta, quadros descartados na fila não quebram a referência ao quadro-chave (stride 0)
+    bool ok = resolve_rois(opt, raw->width, raw->height, rects, &count) &&
+              (opt->stats_only
+                   ? summarize_regions(&o->out, NULL, raw, rects, count, (long)seq, opt, &o->ws, NULL)
+                   : serialize_regions(&o->out, NULL, raw, rects, count, (long)seq, opt, &o->ws, &o->delta, 0,
+                                       NULL, NULL, NULL, &clipped));
+    if (!ok) {
+        fprintf(stderr, "❌ %s quadro %llu: %s\n", ip, (unsigned long long)seq, engine_last_error());
+        return false;
+    }
+    o->clipped += clipped;
+    // Cada quadro fica visível no arquivo assim que processado
+    if (!out_flush(&o->out)) {
+        fprintf(stderr, "❌ %s: erro ao gravar %s: %s\n", ip, o->path, strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+static void live_outputs_free(LiveOutput *outputs, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        out_free(&outputs[i].out);
+        if (outputs[i].fp)
+            fclose(outputs[i].fp);
+        workspace_free(&outputs[i].ws);
+        delta_free(&outputs[i].delta);
+        free(outputs[i].path);
+    }
+    free(outputs);
+}
+
+// Modo ao vivo: uma fila por câmera, processadas pelos workers do live.c até SIGINT/SIGTERM
+static int run_live(const Options *opt) {
+    PathList ips = { 0 };
+    char *list = strdup(opt->live);
+    for (char *save = NULL, *ip = list ? strtok_r(list, ",", &save) : NULL; ip; ip = strtok_r(NULL, ",", &save))
+        if (*ip && !paths_push(&ips, ip)) {
+            perror("Erro ao preparar câmeras");
+            return 1;
+        }
+    free(list);
+    if (!ips.len) {
+        fprintf(stderr, "Nenhuma câmera em --live\n");
+        return 1;
+    }
+    if (mkdir(opt->output_path, 0777) != 0 && errno != EEXIST) {
+        perror("Erro ao criar diretório de saída");
+        return 1;
+    }
+
+    LiveOutput *outputs = calloc(ips.len, sizeof(*outputs));
+    if (!outputs) {
+        perror("Erro ao preparar câmeras");
+        return 1;
+    }
+    const char *ext = output_extension(opt->output.format);
+    for (size_t i = 0; i < ips.len; ++i) {
+        LiveOutput *o = &outputs[i];
+        size_t size = strlen(opt->output_path) + strlen(ips.items[i]) + 7;
+        if (!(o->path = malloc(size))) {
+            perror("Erro ao preparar câmeras");
+            live_outputs_free(outputs, ips.len);
+            return 1;
+        }
+        snprintf(o->path, size, "%s/%s.%s", opt->output_path, ips.items[i], ext);
+        if (!(o->fp = fopen(o->path, output_is_binary(opt->output.format) ? "wb" : "w"))) {
+            fprintf(stderr, "Erro ao criar %s: %s\n", o->path, strerror(errno));
+            live_outputs_free(outputs, ips.len);
+            return 1;
+        }
+        out_init_file(&o->out, o->fp, OUT_DEFAULT_CAPACITY);
+        delta_init(&o->delta, opt->keyframe);
+        if (opt->stats_only)
+            serialize_summary_header(&o->out, opt->output.format, opt->multi_roi);
+    }
+
+    struct sigaction sa = { 0 };
+    sa.sa_handler = live_on_signal;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    LiveJob job = { opt, (const char *const *)ips.items, outputs };
+    LiveOptions live = { job.addresses, ips.len, opt->live_ring, opt->live_drop, live_frame, &job, opt->jobs };
+    LiveCounters *counters = calloc(ips.len, sizeof(*counters));
+    if (!counters) {
+        perror("Erro ao preparar câmeras");
+        live_outputs_free(outputs, ips.len);
+        return 1;
+    }
+    printf("📡 Recebendo de %zu câmera(s); Ctrl+C para encerrar\n", ips.len);
+    fflush(stdout);
+    bool ok = live_run(&live, &live_stop, counters);
+    if (!ok)
+        fprintf(stderr, "%s\n", engine_last_error());
+
+    // Resumo por câmera, no formato dos demais modos
+    OutBuf summary;
+    out_init_file(&summary, stdout, 4096);
+    out_str(&summary, "{\"status\": \"");
+    out_str(&summary, ok ? "ok" : "error");
+    out_str(&summary, "\", \"cameras\": [");
+    bool lossy = false;
+    for (size_t i = 0; i < ips.len; ++i) {
+        const LiveCounters *c = &counters[i];
+        if (!c->connected)
+            fprintf(stderr, "❌ %s\n", c->error);
+        lossy = lossy || !c->connected || c->lost || c->failed;
+        warn_clipped(outputs[i].path, outputs[i].clipped, opt);
+        out_str(&summary, i ? ", {\"ip\": " : "{\"ip\": ");
+        out_json_string(&summary, ips.items[i]);
+        out_str(&summary, ", \"connected\": ");
+        out_str(&summary, c->connected ? "true" : "false");
+        out_str(&summary, ", \"lost\": ");
+        out_str(&summary, c->lost ? "true" : "false");
+        out_str(&summary, ", \"received\": ");
+        out_uint(&summary, c->received);
+        out_str(&summary, ", \"processed\": ");
+        out_uint(&summary, c->processed);
+        out_str(&summary, ", \"dropped\": ");
+        out_uint(&summary, c->dropped);
+        out_str(&summary, ", \"failed\": ");
+        out_uint(&summary, c->failed);
+        out_str(&summary, ", \"stolen\": ");
+        out_uint(&summary, c->stolen);
+        out_str(&summary, ", \"worker\": ");
+        out_uint(&summary, c->worker);
+        out_char(&summary, '}');
+    }
+    out_str(&summary, "]}\n");
+    out_flush(&summary);
+    out_free(&summary);
+
+    free(counters);
+    live_outputs_free(outputs, ips.len);
+    paths_free(&ips);
+    return ok && !lossy ? 0 : 1;
+}
+
+// "stats": {...} do quadro, ou com várias ROIs "regions": [...] por retângulo, na ordem da saída
+static void write_frame_stats(OutBuf *summary, const Frame *frames, size_t count, bool multi_roi) {
+    out_str(summary, multi_roi ? "\"regions\": [" : "\"stats\": ");
+    for (size_t i = 0; i < count; ++i) {
+        const Frame *f = &frames[i];
+        if (i)
+            out_str(summary, ", ");
+        out_char(summary, '{');
+        if (multi_roi) {
+            out_str(summary, "\"roi\": [");
+            out_int(summary, f->rect.x);
+            out_str(summary, ", ");
+            out_int(summary, f->rect.y);
+            out_str(summary, ", ");
+            out_int(summary, f->rect.width);
+            out_str(summary, ", ");
+            out_int(summary, f->rect.height);
+            out_str(summary, "], ");
+        }
+        out_str(summary, "\"min\": ");
+        out_json_number(summary, f->stats.min, 4);
+        out_str(summary, ", \"max\": ");
+        out_json_number(summary, f->stats.max, 4);
+        out_str(summary, ", \"mean\": ");
+        out_json_number(summary, f->stats.mean, 4);
+        out_char(summary, '}');
+    }
+    if (multi_roi)
+        out_char(summary, ']');
+}
+
+static int count_object(struct dl_phdr_info *info, size_t size, void *ctx) {
+    (void)size;
+    // O executável e o vDSO não são bibliotecas carregadas do disco
+    if (info->dlpi_name[0] && !strstr(info->dlpi_name, "linux-vdso"))
+        ++*(size_t *)ctx;
+    return 0;
+}
+
+static void write_phase_us(OutBuf *summary, const char *name, uint64_t ns) {
+    out_str(summary, name);
+    out_json_number(summary, (double)ns / 1e3, 1);
+}
+
+// Objeto "profile" do resumo: partida, primeira chamada ao SDK e, por fase, a primeira
+// conversão (fria) e a média e o mínimo das repetições seguintes
+static void write_profile(OutBuf *summary, const Profile *prof) {
+    write_phase_us(summary, ", \"profile\": {\"load_cpu_us\": ", prof->load_cpu_ns);
+    out_str(summary, ", \"shared_objects\": ");
+    out_uint(summary, prof->shared_objects);
+    write_phase_us(summary, ", \"sdk_init_us\": ", prof->sdk_init_ns);
+    out_str(summary, ", \"repeat\": ");
+    out_uint(summary, prof->count);
+    out_str(summary, ", \"phases\": {");
+    for (int p = 0; p <= PHASE_COUNT; ++p) {
+        // A última coluna é a conversão inteira
+        uint64_t cold = 0, sum = 0, min = UINT64_MAX;
+        for (size_t r = 0; r < prof->count; ++r) {
+            uint64_t ns = 0;
+            for (int q = 0; q < PHASE_COUNT; ++q)
+                ns += p == PHASE_COUNT || p == q ? prof->samples[r][q] : 0;
+            if (!r) {
+                cold = ns;
+                continue;
+            }
+            sum += ns;
+            if (ns < min)
+                min = ns;
+        }
+        out_str(summary, p ? ", \"" : "\"");
+        out_str(summary, p < PHASE_COUNT ? phase_names[p] : "total");
+        write_phase_us(summary, "\": {\"cold_us\": ", cold);
+        if (prof->count > 1) {
+            write_phase_us(summary, ", \"steady_mean_us\": ", sum / (prof->count - 1));
+            write_phase_us(summary, ", \"steady_min_us\": ", min);
+        }
+        out_char(summary, '}');
+    }
+    out_str(summary, "}}");
+}
+
+// Repetições 2..N de --repeat: reabre o arquivo na mesma ACS_ThermalImage e refaz a
+// conversão com os buffers já dimensionados, como um processo que fica no ar
+static bool repeat_conversion(ACS_ThermalImage *img, MappedFile *map, const Options *opt, Workspace *ws,
+                              RowBands *bands, Frame *frames, size_t *clipped, Profile *prof) {
+    for (size_t r = 1; r < opt->repeat; ++r) {
+        uint64_t *sample = prof->samples[r];
+        uint64_t t0 = now_ns();
+        input_unmap(map);
+        if (!open_input(img, opt->input_path, opt->input_mode, map))
+            return engine_fail("repetição %zu: %s", r + 1, errno ? strerror(errno) : ACS_getLastErrorMessage());
+        uint64_t t1 = now_ns();
+        ACS_Rectangle rects[ROI_MAX];
+        size_t count;
+        if (!engine_prepare(img, &opt->extract) ||
+            !resolve_rois(opt, ACS_ThermalImage_getWidth(img), ACS_ThermalImage_getHeight(img), rects, &count))
+            return false;
+        uint64_t t2 = now_ns();
+        prof->extract_ns = 0;
+        if (!write_output(img, rects, count, opt, ws, bands, opt->input_path, opt->output_path, frames, clipped))
+            return false;
+        uint64_t t3 = now_ns();
+        sample[PHASE_OPEN] = t1 - t0;
+        sample[PHASE_PREPARE] = t2 - t1;
+        sample[PHASE_EXTRACT] = prof->extract_ns;
+        sample[PHASE_WRITE] = t3 - t2 - prof->extract_ns;
+        prof->count = r + 1;
+    }
+    return true;
 }
 
 // Função principal de extração
 int main(int argc, char **argv) {
-    if (argc < 3) {
-        fprintf(stderr, "Uso: %s <imagem_radiometrica> <saida_csv>\n", argv[0]);
+    // Antes de qualquer outra coisa: o que o processo já gastou até chegar aqui
+    struct timespec started;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &started);
+    Options opt;
+    if (!parse_options(argc, argv, &opt)) {
+        usage(argv[0]);
         return 1;
     }
+    if (opt.metadata_only)
+        return run_metadata(&opt);
+    if (opt.live)
+        return run_live(&opt);
+    if (opt.batch)
+        return run_batch(&opt);
+    if (opt.sequence)
+        return opt.aggregate ? run_aggregate(&opt) : run_sequence(&opt);
 
-    const char *input_path = argv[1];
-    const char *csv_path = argv[2];
+    Profile prof = { .load_cpu_ns = (uint64_t)started.tv_sec * 1000000000u + (uint64_t)started.tv_nsec };
+    if (opt.profile) {
+        dl_iterate_phdr(count_object, &prof.shared_objects);
+        if (!(prof.samples = calloc(opt.repeat, sizeof(*prof.samples)))) {
+            perror("Erro ao preparar o perfil");
+            return 1;
+        }
+        profiling = &prof;
+    }
 
-    ACS_ThermalImage *img = ACS_ThermalImage_createFromFile(input_path);
+    uint64_t t0 = now_ns();
+    ACS_ThermalImage *img = ACS_ThermalImage_alloc();
+    checkAcs();
+    uint64_t t1 = now_ns();
+    MappedFile map = { 0 };
+    if (!open_input(img, opt.input_path, opt.input_mode, &map) && errno) {
+        perror("Erro ao mapear a imagem");
+        return 1;
+    }
     checkAcs();
+    uint64_t t2 = now_ns();
+    if (!engine_prepare(img, &opt.extract)) {
+        fprintf(stderr, "%s\n", engine_last_error());
+        return 1;
+    }
+
+    ACS_Rectangle rects[ROI_MAX];
+    size_t count;
+    if (!resolve_rois(&opt, ACS_ThermalImage_getWidth(img), ACS_ThermalImage_getHeight(img), rects, &count)) {
+        fprintf(stderr, "%s (esperado x,y,w,h)\n", engine_last_error());
+        return 1;
+    }
+    uint64_t t3 = now_ns();
 
-    write_temperature_csv(img, csv_path);
+    Workspace ws = { 0 };
+    if (opt.stats_only)
+        return write_summary_only(img, rects, count, &opt, &ws);
+    RowBands bands = { 0 };
+    static const char *const kinds[] = { [FORMAT_CSV] = "CSV", [FORMAT_BIN] = "binário", [FORMAT_JSON] = "JSON",
+                                         [FORMAT_DELTA] = "delta", [FORMAT_ARROW] = "Arrow" };
+    static const char *const titles[] = { [FORMAT_CSV] = "CSV", [FORMAT_BIN] = "Binário", [FORMAT_JSON] = "JSON",
+                                          [FORMAT_DELTA] = "Delta", [FORMAT_ARROW] = "Arrow" };
+    // Um quadro por variante e retângulo, para o resumo
+    Frame *frames = calloc(count * (opt.variant_count ? opt.variant_count : 1), sizeof(*frames));
+    size_t clipped;
+    if (!frames) {
+        perror("Erro ao preparar extração");
+        return 1;
+    }
+    uint64_t t4 = now_ns();
+    bool written = write_output(img, rects, count, &opt, &ws, &bands, opt.input_path, opt.output_path, frames,
+                                &clipped);
+    if (written && opt.profile) {
+        uint64_t t5 = now_ns();
+        prof.sdk_init_ns = t1 - t0;
+        prof.samples[0][PHASE_OPEN] = t2 - t1;
+        prof.samples[0][PHASE_PREPARE] = t3 - t2;
+        prof.samples[0][PHASE_EXTRACT] = prof.extract_ns;
+        prof.samples[0][PHASE_WRITE] = t5 - t4 - prof.extract_ns;
+        prof.count = 1;
+        written = repeat_conversion(img, &map, &opt, &ws, &bands, frames, &clipped, &prof);
+    }
+    row_bands_free(&bands);
+    if (!written) {
+        fprintf(stderr, "Erro ao gerar arquivo %s: %s\n", kinds[opt.output.format], engine_last_error());
+        return 1;
+    }
+    if (opt.measure.count || opt.isotherm.count || opt.hotspots.enabled) {
+        const char *what = opt.measure.count ? "Medições" : opt.isotherm.count ? "Isotermas" : "Regiões quentes";
+        printf("✅ %s geradas com sucesso: %s\n", what, opt.output_path);
+        measure_free(&opt.measure);
+        workspace_free(&ws);
+        ACS_ThermalImage_free(img);
+        input_unmap(&map);
+        return 0;
+    }
+    warn_clipped(opt.output_path, clipped, &opt);
+    printf("✅ %s gerado com sucesso: %s\n", titles[opt.output.format], opt.output_path);
+
+    // Resumo final em JSON, com as estatísticas calculadas na mesma passada da conversão
+    OutBuf summary;
+    out_init_file(&summary, stdout, 4096);
+    out_str(&summary, "{\"status\": \"ok\", \"message\": \"Extração concluída com sucesso!\", \"simd\": \"");
+    out_str(&summary, frames[0].used_signal ? kernel_isa() : "none");
+    out_str(&summary, "\", \"unit\": \"");
+    out_str(&summary, unit_symbol(frames[0].unit));
+    if (opt.variant_count) {
+        out_str(&summary, "\", \"variants\": [");
+        for (size_t v = 0; v < opt.variant_count; ++v) {
+            out_str(&summary, v ? ", {\"params\": " : "{\"params\": ");
+            out_json_string(&summary, opt.variants[v].label);
+            out_str(&summary, ", ");
+            write_frame_stats(&summary, frames + v * count, count, opt.multi_roi);
+            out_char(&summary, '}');
+        }
+        out_char(&summary, ']');
+    } else {
+        out_str(&summary, "\", ");
+        write_frame_stats(&summary, frames, count, opt.multi_roi);
+    }
+    if (opt.histogram_bins)
+        serialize_histogram_json(&summary, &ws.lut, frames[0].unit, &frames[0].stats, opt.histogram_bins);
+    if (opt.profile)
+        write_profile(&summary, &prof);
+    out_str(&summary, "}\n");
+    out_flush(&summary);
+    out_free(&summary);
 
+    free(prof.samples);
+    free(frames);
+    workspace_free(&ws);
     ACS_ThermalImage_free(img);
-    printf("{\"status\": \"ok\", \"message\": \"Extração concluída com sucesso!\"}\n");
+    input_unmap(&map);
     return 0;
 }
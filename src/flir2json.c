@@ -0,0 +1,247 @@
+#include "flir2json.h"
+#include "engine.h"
+#include "kernels.h"
+#include "output.h"
+#include "serialize.h"
+
+#include <acs/thermal_image.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Fachada pública sobre engine/serialize: converte as opções estáveis nas internas e
+// guarda no handle a imagem ACS e os buffers reaproveitados entre extrações
+
+struct flir2json_image {
+    ACS_ThermalImage *image;
+    bool open;
+    Workspace ws;
+    RowBands bands;
+};
+
+unsigned flir2json_api_version(void) {
+    return FLIR2JSON_API_VERSION;
+}
+
+const char *flir2json_simd(void) {
+    return kernel_isa();
+}
+
+const char *flir2json_last_error(void) {
+    return engine_last_error();
+}
+
+void flir2json_options_init(flir2json_options *opt) {
+    memset(opt, 0, sizeof(*opt));
+    opt->size = sizeof(*opt);
+    opt->unit = FLIR2JSON_UNIT_CELSIUS;
+    opt->engine = FLIR2JSON_ENGINE_SIGNAL;
+    opt->pool = FLIR2JSON_POOL_MAX;
+}
+
+void flir2json_output_init(flir2json_output *out) {
+    memset(out, 0, sizeof(*out));
+    out->size = sizeof(*out);
+    out->format = FLIR2JSON_FORMAT_CSV;
+    out->dtype = FLIR2JSON_DTYPE_F32;
+    out->scale = 0.01;
+    out->offset = NAN;
+    CsvDialect csv = CSV_DEFAULT_DIALECT;
+    out->csv_delimiter = csv.delimiter;
+    out->csv_decimals = csv.decimals;
+    out->csv_header = csv.header;
+}
+
+void flir2json_frame_init(flir2json_frame *frame) {
+    memset(frame, 0, sizeof(*frame));
+    frame->size = sizeof(*frame);
+}
+
+void flir2json_stats_init(flir2json_stats *stats) {
+    memset(stats, 0, sizeof(*stats));
+    stats->size = sizeof(*stats);
+}
+
+// Struct de um chamador com cabeçalho mais antigo (menor): os campos que faltam ficam
+// com os padrões
+static void adopt(void *dst, size_t dst_size, const void *src, uint32_t src_size) {
+    memcpy(dst, src, src_size < dst_size ? src_size : dst_size);
+}
+
+// O contrário, para os resultados: só os campos que a struct do chamador conhece
+static void deliver(void *dst, uint32_t dst_size, const void *src, size_t src_size) {
+    memcpy(dst, src, dst_size < src_size ? dst_size : src_size);
+}
+
+flir2json_image *flir2json_image_new(void) {
+    flir2json_image *img = calloc(1, sizeof(*img));
+    if (!img || !(img->image = ACS_ThermalImage_alloc())) {
+        free(img);
+        engine_fail("sem memória para a imagem");
+        return NULL;
+    }
+    return img;
+}
+
+void flir2json_image_free(flir2json_image *img) {
+    if (!img)
+        return;
+    ACS_ThermalImage_free(img->image);
+    workspace_free(&img->ws);
+    row_bands_free(&img->bands);
+    free(img);
+}
+
+static bool opened(flir2json_image *img) {
+    img->open = !ACS_getLastErrorCode();
+    return img->open || engine_fail("%s", ACS_getLastErrorMessage());
+}
+
+bool flir2json_open_file(flir2json_image *img, const char *path) {
+    ACS_ThermalImage_openFromFile(img->image, path);
+    return opened(img);
+}
+
+bool flir2json_open_memory(flir2json_image *img, const void *data, size_t len) {
+    ACS_ThermalImage_openFromMemory(img->image, data, len);
+    return opened(img);
+}
+
+int flir2json_width(const flir2json_image *img) {
+    return img->open ? ACS_ThermalImage_getWidth(img->image) : 0;
+}
+
+int flir2json_height(const flir2json_image *img) {
+    return img->open ? ACS_ThermalImage_getHeight(img->image) : 0;
+}
+
+// Opções públicas → ExtractOptions e retângulo validado, com a imagem preparada
+static bool prepare(flir2json_image *img, const flir2json_options *in, ExtractOptions *ext, ACS_Rectangle *rect) {
+    flir2json_options opt;
+    flir2json_options_init(&opt);
+    if (in)
+        adopt(&opt, sizeof(opt), in, in->size);
+    if (!img->open)
+        return engine_fail("nenhuma imagem aberta");
+    if ((unsigned)opt.unit > FLIR2JSON_UNIT_FAHRENHEIT || (unsigned)opt.engine > FLIR2JSON_ENGINE_VALUES ||
+        (unsigned)opt.pool > FLIR2JSON_POOL_AVG)
+        return engine_fail("opção de extração inválida");
+    if (opt.downsample > DOWNSAMPLE_MAX)
+        return engine_fail("downsample deve ficar entre 1 e %d", DOWNSAMPLE_MAX);
+    // Os enums públicos têm a mesma ordem dos internos
+    *ext = (ExtractOptions){ .engine = (Engine)opt.engine, .unit = (TempUnit)opt.unit,
+                             .downsample = opt.downsample, .pool = (PoolMode)opt.pool };
+
+    int w = ACS_ThermalImage_getWidth(img->image), h = ACS_ThermalImage_getHeight(img->image);
+    *rect = (ACS_Rectangle){ 0, 0, w, h };
+    if (opt.roi_width || opt.roi_height) {
+        ACS_Rectangle r = { opt.roi_x, opt.roi_y, opt.roi_width, opt.roi_height };
+        if (r.x < 0 || r.y < 0 || r.width <= 0 || r.height <= 0 || r.x > w - r.width || r.y > h - r.height)
+            return engine_fail("ROI %d,%d,%d,%d fora da imagem %dx%d", r.x, r.y, r.width, r.height, w, h);
+        *rect = r;
+    }
+    return engine_prepare(img->image, ext);
+}
+
+bool flir2json_extract(flir2json_image *img, const flir2json_options *opt, flir2json_frame *out) {
+    ExtractOptions ext;
+    ACS_Rectangle rect;
+    Frame frame;
+    if (!prepare(img, opt, &ext, &rect) || !engine_extract(img->image, &rect, &ext, &img->ws, &frame))
+        return false;
+    flir2json_frame result = {
+        .size = out->size,
+        .roi_x = frame.rect.x, .roi_y = frame.rect.y, .roi_width = frame.rect.width, .roi_height = frame.rect.height,
+        .width = frame.width, .height = frame.height, .unit = (flir2json_unit)frame.unit, .values = frame.values,
+        .min = frame.stats.min, .max = frame.stats.max, .mean = frame.stats.mean,
+    };
+    deliver(out, out->size, &result, sizeof(result));
+    return true;
+}
+
+bool flir2json_summarize(flir2json_image *img, const flir2json_options *opt, flir2json_stats *out) {
+    ExtractOptions ext;
+    ACS_Rectangle rect;
+    FrameSummary sm;
+    if (!prepare(img, opt, &ext, &rect) || !engine_summarize(img->image, &rect, &ext, &img->ws, &sm))
+        return false;
+    flir2json_stats result = {
+        .size = out->size,
+        .unit = (flir2json_unit)sm.unit, .count = sm.count, .min = sm.min, .max = sm.max, .mean = sm.mean,
+        .stddev = sm.stddev, .hot_x = sm.hot_x, .hot_y = sm.hot_y, .cold_x = sm.cold_x, .cold_y = sm.cold_y,
+    };
+    deliver(out, out->size, &result, sizeof(result));
+    return true;
+}
+
+// Opções públicas → OutputOptions; `threads` não tem par nelas
+static bool output_options(const flir2json_output *in, OutputOptions *oo, unsigned *threads) {
+    flir2json_output opt;
+    flir2json_output_init(&opt);
+    if (in)
+        adopt(&opt, sizeof(opt), in, in->size);
+    if ((unsigned)opt.format > FLIR2JSON_FORMAT_JSON || (unsigned)opt.dtype > FLIR2JSON_DTYPE_U16)
+        return engine_fail("opção de saída inválida");
+    if (!opt.csv_delimiter || !strchr(",;|: \t", opt.csv_delimiter))
+        return engine_fail("separador do CSV inválido");
+    if (opt.csv_decimals < 0 || opt.csv_decimals > OUT_ROW_MAX_DECIMALS)
+        return engine_fail("casas decimais do CSV devem ficar entre 0 e %d", OUT_ROW_MAX_DECIMALS);
+    if (opt.dtype == FLIR2JSON_DTYPE_U16 && !(opt.scale > 0))
+        return engine_fail("scale do u16 deve ser positivo");
+    *oo = (OutputOptions){
+        .format = (OutputFormat)opt.format, .dtype = (BinaryDType)opt.dtype, .scale = opt.scale,
+        .offset = opt.offset, .csv = { opt.csv_delimiter, opt.csv_decimals, opt.csv_header },
+    };
+    *threads = opt.threads;
+    return true;
+}
+
+static bool serialize(flir2json_image *img, const flir2json_options *opt, const flir2json_output *out_opt,
+                      OutBuf *out) {
+    ExtractOptions ext;
+    OutputOptions oo;
+    unsigned threads = 0;
+    ACS_Rectangle rect;
+    Frame frame;
+    if (!output_options(out_opt, &oo, &threads) || !prepare(img, opt, &ext, &rect))
+        return false;
+    if (isnan(oo.offset))
+        oo.offset = unit_absolute_zero(ext.unit);
+    output_configure_extract(&oo, &ext);
+    if (!engine_extract(img->image, &rect, &ext, &img->ws, &frame))
+        return false;
+    size_t clipped;
+    bool ok = oo.format == FORMAT_BIN
+                  ? serialize_bin(out, img->image, &frame, &oo, &img->ws, &clipped)
+                  : serialize_banded(out, img->image, &frame, oo.format, &oo.csv, &img->bands, threads);
+    if (!ok || out->failed)
+        return engine_fail("erro ao gravar a saída");
+    return true;
+}
+
+bool flir2json_serialize(flir2json_image *img, const flir2json_options *opt, const flir2json_output *out_opt,
+                         char **data, size_t *len) {
+    OutBuf out;
+    out_init_memory(&out, 64 * 1024);
+    if (!serialize(img, opt, out_opt, &out)) {
+        out_free(&out);
+        return false;
+    }
+    *data = out.data;
+    *len = out.len;
+    return true;
+}
+
+bool flir2json_serialize_file(flir2json_image *img, const flir2json_options *opt, const flir2json_output *out_opt,
+                              FILE *fp) {
+    OutBuf out;
+    out_init_file(&out, fp, OUT_DEFAULT_CAPACITY);
+    bool ok = serialize(img, opt, out_opt, &out);
+    ok = out_flush(&out) ? ok : ok && engine_fail("erro ao gravar a saída");
+    out_free(&out);
+    return ok;
+}
+
+void flir2json_free(void *data) {
+    free(data);
+}
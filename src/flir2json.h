@@ -0,0 +1,157 @@
+#ifndef FLIR2JSON_H
+#define FLIR2JSON_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// libflir2json: API C estável do núcleo de extração usado pelo extract, pelo flir2json e
+// pelo servidor, para ser ligada também por outros serviços (C ou C++). Só este
+// cabeçalho é público: não depende dos cabeçalhos do SDK nem dos módulos internos.
+//
+// Estabilidade: os enums têm valores fixos e todas as structs públicas começam com `size`
+// (preenchido pelas funções *_init); campos novos só entram no fim, então um binário
+// compilado com um cabeçalho antigo continua funcionando com uma biblioteca nova. Nas
+// structs de resultado, a biblioteca só grava os primeiros `size` bytes.
+//
+// As funções que retornam bool deixam o motivo de uma falha em flir2json_last_error()
+// (por thread). Um flir2json_image não é thread-safe: use um por thread, reaproveitado
+// entre imagens (os buffers da extração só crescem).
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__GNUC__)
+#define FLIR2JSON_API __attribute__((visibility("default")))
+#else
+#define FLIR2JSON_API
+#endif
+
+// Incrementado a cada mudança compatível da API (funções ou campos novos)
+#define FLIR2JSON_API_VERSION 1
+
+typedef struct flir2json_image flir2json_image;
+
+typedef enum {
+    FLIR2JSON_UNIT_CELSIUS = 0,
+    FLIR2JSON_UNIT_KELVIN = 1,
+    FLIR2JSON_UNIT_FAHRENHEIT = 2
+} flir2json_unit;
+
+typedef enum {
+    FLIR2JSON_ENGINE_SIGNAL = 0, // sinal bruto + LUT (padrão)
+    FLIR2JSON_ENGINE_VALUES = 1  // getValues do SDK
+} flir2json_engine;
+
+typedef enum {
+    FLIR2JSON_POOL_MAX = 0, // célula do downsample com o máximo do bloco (padrão)
+    FLIR2JSON_POOL_AVG = 1
+} flir2json_pool;
+
+typedef enum {
+    FLIR2JSON_FORMAT_CSV = 0,
+    FLIR2JSON_FORMAT_BIN = 1, // cabeçalho JSON + payload little-endian alinhado
+    FLIR2JSON_FORMAT_JSON = 2
+} flir2json_format;
+
+typedef enum {
+    FLIR2JSON_DTYPE_F32 = 0,
+    FLIR2JSON_DTYPE_U16 = 1 // temperatura = valor * scale + offset
+} flir2json_dtype;
+
+// O que extrair de uma imagem
+typedef struct {
+    uint32_t size;           // sizeof(flir2json_options)
+    flir2json_unit unit;
+    flir2json_engine engine;
+    int roi_x, roi_y;        // retângulo em pixels da imagem;
+    int roi_width;           // largura ou altura 0: a imagem inteira
+    int roi_height;
+    unsigned downsample;     // células de N x N pixels (0 ou 1: resolução cheia)
+    flir2json_pool pool;
+} flir2json_options;
+
+// Como serializar a extração
+typedef struct {
+    uint32_t size;           // sizeof(flir2json_output)
+    flir2json_format format;
+    flir2json_dtype dtype;
+    double scale;            // u16
+    double offset;           // u16, na unidade de saída; NAN: o zero absoluto dela
+    char csv_delimiter;      // csv: , ; | : tab ou espaço
+    int csv_decimals;        // csv: 0 a 3
+    bool csv_header;         // csv: primeira linha com a coluna x de cada valor
+    unsigned threads;        // csv/json de matrizes grandes em faixas paralelas (0 ou 1: uma thread)
+} flir2json_output;
+
+// Matriz extraída; `values` pertence à imagem e vale até a próxima extração ou
+// flir2json_image_free
+typedef struct {
+    uint32_t size;                           // sizeof(flir2json_frame), do chamador
+    int roi_x, roi_y, roi_width, roi_height; // retângulo extraído
+    int width, height;                       // dimensões da matriz (a grade reduzida com downsample)
+    flir2json_unit unit;
+    const double *values;                    // width * height, por linha
+    double min, max, mean;                   // da resolução cheia
+} flir2json_frame;
+
+// Estatísticas sem gerar a matriz (caminho mais rápido quando só o resumo interessa)
+typedef struct {
+    uint32_t size;                           // sizeof(flir2json_stats), do chamador
+    flir2json_unit unit;
+    size_t count;
+    double min, max, mean;
+    double stddev;                           // populacional
+    int hot_x, hot_y;                        // relativos ao retângulo
+    int cold_x, cold_y;
+} flir2json_stats;
+
+FLIR2JSON_API unsigned flir2json_api_version(void);
+
+// Conjunto de instruções em uso pelos kernels ("scalar", "sse2", "avx2")
+FLIR2JSON_API const char *flir2json_simd(void);
+
+FLIR2JSON_API const char *flir2json_last_error(void);
+
+// Padrões: °C, engine signal, imagem inteira, sem downsample / CSV `;` com 2 casas,
+// u16 em centésimos a partir do zero absoluto
+FLIR2JSON_API void flir2json_options_init(flir2json_options *opt);
+FLIR2JSON_API void flir2json_output_init(flir2json_output *out);
+
+// Zeram o resultado e preenchem `size`, antes de flir2json_extract/flir2json_summarize
+FLIR2JSON_API void flir2json_frame_init(flir2json_frame *frame);
+FLIR2JSON_API void flir2json_stats_init(flir2json_stats *stats);
+
+// Imagem vazia, para ser aberta (e reaberta) com flir2json_open_*; NULL sem memória
+FLIR2JSON_API flir2json_image *flir2json_image_new(void);
+FLIR2JSON_API void flir2json_image_free(flir2json_image *img);
+
+// A imagem anterior do handle é descartada. Em open_memory, `data` precisa continuar
+// válido enquanto a imagem estiver aberta (o SDK decodifica sem copiar).
+FLIR2JSON_API bool flir2json_open_file(flir2json_image *img, const char *path);
+FLIR2JSON_API bool flir2json_open_memory(flir2json_image *img, const void *data, size_t len);
+
+// Dimensões da imagem aberta (0 sem imagem)
+FLIR2JSON_API int flir2json_width(const flir2json_image *img);
+FLIR2JSON_API int flir2json_height(const flir2json_image *img);
+
+// `opt` NULL: os padrões
+FLIR2JSON_API bool flir2json_extract(flir2json_image *img, const flir2json_options *opt, flir2json_frame *frame);
+FLIR2JSON_API bool flir2json_summarize(flir2json_image *img, const flir2json_options *opt, flir2json_stats *stats);
+
+// Extrai conforme `opt` e serializa no formato de `out` (u16 sai direto do sinal).
+// Em memória: `*data` alocado por malloc, liberado com flir2json_free. Em arquivo:
+// gravado em `fp` com escrita bufferizada (o chamador fecha).
+FLIR2JSON_API bool flir2json_serialize(flir2json_image *img, const flir2json_options *opt,
+                                       const flir2json_output *out, char **data, size_t *len);
+FLIR2JSON_API bool flir2json_serialize_file(flir2json_image *img, const flir2json_options *opt,
+                                            const flir2json_output *out, FILE *fp);
+FLIR2JSON_API void flir2json_free(void *data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,222 @@
+#include "hotspot.h"
+#include "kernels.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Corrida de pixels quentes [x0, x1] da linha y; as estatísticas valem na raiz da região
+struct HotspotRun {
+    int x0, x1, y;
+    size_t parent;
+    size_t area;
+    double sum_x, sum_y; // centróide
+    double sum_t;        // °C, para a média
+    int left, top, right, bottom;
+    unsigned peak;       // sinal do pixel mais quente (o primeiro em ordem de linhas)
+    int peak_x, peak_y;
+};
+
+typedef struct HotspotRun Run;
+
+// Corridas de uma linha a mais (no máximo uma a cada dois pixels), preservando as anteriores
+static bool reserve_runs(Workspace *ws, size_t count, size_t width) {
+    size_t need = count + (width + 1) / 2;
+    if (need <= ws->runs_capacity)
+        return true;
+    size_t capacity = ws->runs_capacity ? ws->runs_capacity : 1024;
+    while (capacity < need)
+        capacity *= 2;
+    Run *grown = realloc(ws->runs, capacity * sizeof(*grown));
+    if (!grown)
+        return engine_fail("sem memória para %zu corridas", capacity);
+    ws->runs = grown;
+    ws->runs_capacity = capacity;
+    return true;
+}
+
+// Raiz com meio caminho comprimido (cada nó passa a apontar para o avô)
+static size_t find_root(Run *runs, size_t i) {
+    while (runs[i].parent != i) {
+        runs[i].parent = runs[runs[i].parent].parent;
+        i = runs[i].parent;
+    }
+    return i;
+}
+
+static void merge(Run *runs, size_t a, size_t b) {
+    a = find_root(runs, a);
+    b = find_root(runs, b);
+    if (a == b)
+        return;
+    // A raiz fica com o menor índice, a corrida mais antiga da região
+    if (b < a) {
+        size_t t = a;
+        a = b;
+        b = t;
+    }
+    Run *root = &runs[a], *other = &runs[b];
+    other->parent = a;
+    root->area += other->area;
+    root->sum_x += other->sum_x;
+    root->sum_y += other->sum_y;
+    root->sum_t += other->sum_t;
+    if (other->left < root->left) root->left = other->left;
+    if (other->right > root->right) root->right = other->right;
+    if (other->top < root->top) root->top = other->top;
+    if (other->bottom > root->bottom) root->bottom = other->bottom;
+    if (other->peak > root->peak ||
+        (other->peak == root->peak &&
+         (other->peak_y < root->peak_y || (other->peak_y == root->peak_y && other->peak_x < root->peak_x)))) {
+        root->peak = other->peak;
+        root->peak_x = other->peak_x;
+        root->peak_y = other->peak_y;
+    }
+}
+
+// Próximo bit igual a `value` a partir de `x`; `width` se não houver
+static size_t next_bit(const uint64_t *bits, size_t width, size_t x, bool value) {
+    while (x < width) {
+        uint64_t word = (value ? bits[x / 64] : ~bits[x / 64]) >> (x % 64);
+        if (word)
+            return x + (size_t)__builtin_ctzll(word) < width ? x + (size_t)__builtin_ctzll(word) : width;
+        x = (x / 64 + 1) * 64;
+    }
+    return width;
+}
+
+static void init_run(Run *r, size_t index, const uint16_t *row, const double *lut, unsigned base, int x0, int x1,
+                     int y) {
+    unsigned peak = 0;
+    int peak_x = x0;
+    double sum_t = 0.0;
+    for (int x = x0; x <= x1; ++x) {
+        unsigned s = row[x];
+        sum_t += lut[s - base];
+        if (s > peak) {
+            peak = s;
+            peak_x = x;
+        }
+    }
+    size_t len = (size_t)(x1 - x0 + 1);
+    *r = (Run){ x0, x1, y, index, len, (double)(x0 + x1) * (double)len / 2.0, (double)y * (double)len, sum_t,
+                x0, y, x1, y, peak, peak_x, y };
+}
+
+static int by_peak(const void *a, const void *b) {
+    const Run *x = *(const Run *const *)a, *y = *(const Run *const *)b;
+    if (x->peak != y->peak)
+        return x->peak > y->peak ? -1 : 1;
+    return x->area > y->area ? -1 : x->area < y->area;
+}
+
+static void write_pair(OutBuf *out, double a, double b, int decimals) {
+    out_char(out, '[');
+    out_json_number(out, a, decimals);
+    out_char(out, ',');
+    out_json_number(out, b, decimals);
+    out_char(out, ']');
+}
+
+bool hotspot_eval_json(const HotspotOptions *opt, const SignalWindow *win, const ACS_Rectangle *rect, TempUnit unit,
+                       Workspace *ws, long index, OutBuf *out) {
+    UnitConv conv = unit_conv(unit);
+    size_t width = (size_t)win->width, height = (size_t)win->height;
+    size_t first = signal_window_search(win, (opt->threshold - conv.add) / conv.mul, false);
+    unsigned cutoff = win->lut_base + (unsigned)first;
+
+    // Rotulação: corridas da linha atual em [row_begin, count), as da anterior em [prev_begin, row_begin)
+    size_t count = 0;
+    if (first < win->lut_len) {
+        uint64_t *bits = (uint64_t *)workspace_scratch(ws, (width + 63) / 64 * sizeof(uint64_t));
+        if (!bits)
+            return false;
+        size_t prev_begin = 0, row_begin = 0;
+        for (size_t y = 0; y < height; ++y) {
+            const uint16_t *row = signal_window_row(win, y);
+            if (!kernel_mask_u16(row, width, cutoff, 0xffff, bits)) {
+                prev_begin = row_begin = count;
+                continue;
+            }
+            if (!reserve_runs(ws, count, width))
+                return false;
+            Run *runs = ws->runs;
+            size_t j = prev_begin;
+            for (size_t x = next_bit(bits, width, 0, true); x < width; x = next_bit(bits, width, x, true)) {
+                size_t end = next_bit(bits, width, x, false);
+                init_run(&runs[count], count, row, win->lut, win->lut_base, (int)x, (int)end - 1, (int)y);
+                // Vizinhança de 8: corridas da linha de cima que tocam [x - 1, end]
+                while (j < row_begin && (size_t)runs[j].x1 + 1 < x)
+                    ++j;
+                for (size_t k = j; k < row_begin && (size_t)runs[k].x0 <= end; ++k)
+                    merge(runs, k, count);
+                ++count;
+                x = end;
+            }
+            prev_begin = row_begin;
+            row_begin = count;
+        }
+    }
+
+    // Raízes que passam da área mínima, da mais quente para a mais fria
+    const Run **regions = count ? (const Run **)workspace_scratch(ws, count * sizeof(*regions)) : NULL;
+    if (count && !regions)
+        return false;
+    size_t found = 0;
+    for (size_t i = 0; i < count; ++i)
+        if (ws->runs[i].parent == i && ws->runs[i].area >= opt->min_area)
+            regions[found++] = &ws->runs[i];
+    if (found > 1)
+        qsort(regions, found, sizeof(*regions), by_peak);
+
+    out_char(out, '{');
+    if (index >= 0) {
+        out_str(out, "\"frame\":");
+        out_int(out, index);
+        out_char(out, ',');
+    }
+    out_str(out, "\"unit\":\"");
+    out_str(out, unit_symbol(unit));
+    out_str(out, "\",\"roi\":[");
+    out_int(out, rect->x);
+    out_char(out, ',');
+    out_int(out, rect->y);
+    out_char(out, ',');
+    out_int(out, rect->width);
+    out_char(out, ',');
+    out_int(out, rect->height);
+    out_str(out, "],\"threshold\":");
+    out_json_number(out, opt->threshold, 4);
+    out_str(out, ",\"count\":");
+    out_uint(out, found);
+    out_str(out, ",\"regions\":[");
+    for (size_t i = 0; i < found; ++i) {
+        const Run *r = regions[i];
+        double area = (double)r->area;
+        if (i)
+            out_char(out, ',');
+        out_str(out, "{\"area\":");
+        out_uint(out, r->area);
+        out_str(out, ",\"peak\":");
+        out_json_number(out, win->lut[r->peak - win->lut_base] * conv.mul + conv.add, 4);
+        out_str(out, ",\"peak_at\":[");
+        out_int(out, r->peak_x);
+        out_char(out, ',');
+        out_int(out, r->peak_y);
+        out_str(out, "],\"mean\":");
+        out_json_number(out, r->sum_t / area * conv.mul + conv.add, 4);
+        out_str(out, ",\"centroid\":");
+        write_pair(out, r->sum_x / area, r->sum_y / area, 2);
+        out_str(out, ",\"bbox\":[");
+        out_int(out, r->left);
+        out_char(out, ',');
+        out_int(out, r->top);
+        out_char(out, ',');
+        out_int(out, r->right - r->left + 1);
+        out_char(out, ',');
+        out_int(out, r->bottom - r->top + 1);
+        out_str(out, "]}");
+    }
+    out_str(out, "]}\n");
+    return !out->failed || engine_fail("sem memória ao serializar as regiões quentes");
+}
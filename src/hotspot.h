@@ -0,0 +1,29 @@
+#ifndef FLIR2JSON_HOTSPOT_H
+#define FLIR2JSON_HOTSPOT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "engine.h"
+#include "output.h"
+
+// Regiões quentes: todas as áreas conectadas (vizinhança de 8) acima de um limite, e não
+// só o ponto quente único de ACS_ImageStatistics_getHotSpot. O limite vira sinal uma vez
+// por imagem, a máscara de cada linha sai do kernel de faixa (kernel_mask_u16) e as
+// corridas da linha são rotuladas na mesma passada, com union-find contra as corridas
+// da linha anterior; área, pico, média, centróide e retângulo envolvente se acumulam na
+// raiz de cada região. Posições relativas ao retângulo avaliado.
+
+typedef struct {
+    bool enabled;
+    double threshold; // unidade de saída: pixels com t >= threshold
+    size_t min_area;  // regiões menores ficam de fora (padrão 1)
+} HotspotOptions;
+
+// Grava uma linha JSON {"frame":N,"unit":...,"roi":[x,y,w,h],"threshold":T,"count":K,
+// "regions":[...]} com as regiões da mais quente para a mais fria; `index` < 0 omite
+// "frame". `win` vem de engine_signal_window(_raw) sobre `rect`.
+bool hotspot_eval_json(const HotspotOptions *opt, const SignalWindow *win, const ACS_Rectangle *rect, TempUnit unit,
+                       Workspace *ws, long index, OutBuf *out);
+
+#endif
@@ -0,0 +1,118 @@
+#include "input.h"
+
+#include <acs/thermal_image.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool input_mode_parse(const char *s, InputMode *mode) {
+    if (strcmp(s, "file") == 0) *mode = INPUT_FILE;
+    else if (strcmp(s, "mmap") == 0) *mode = INPUT_MMAP;
+    else return false;
+    return true;
+}
+
+bool input_map(const char *path, MappedFile *file) {
+    file->data = NULL;
+    file->len = 0;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return false;
+    }
+    if (!S_ISREG(st.st_mode) || st.st_size == 0) {
+        close(fd);
+        errno = S_ISDIR(st.st_mode) ? EISDIR : S_ISREG(st.st_mode) ? EINVAL : ENODEV;
+        return false;
+    }
+
+    void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    int saved = errno;
+    close(fd); // o mapeamento continua válido sem o descritor
+    if (data == MAP_FAILED) {
+        errno = saved;
+        return false;
+    }
+    // O decodificador percorre o arquivo do início ao fim
+    madvise(data, (size_t)st.st_size, MADV_SEQUENTIAL);
+    file->data = data;
+    file->len = (size_t)st.st_size;
+    return true;
+}
+
+void input_unmap(MappedFile *file) {
+    if (file->data)
+        munmap((void *)file->data, file->len);
+    file->data = NULL;
+    file->len = 0;
+}
+
+void input_prefetch(const char *path) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return;
+    // WILLNEED agenda a leitura e retorna sem esperar o I/O
+    posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+    close(fd);
+}
+
+bool input_read_file(const char *path, unsigned char **data, size_t *len) {
+    *data = NULL;
+    FILE *fp = fopen(path, "rb");
+    if (!fp)
+        return false;
+    bool ok = fseek(fp, 0, SEEK_END) == 0;
+    long size = ok ? ftell(fp) : -1;
+    ok = size > 0 && fseek(fp, 0, SEEK_SET) == 0 && (*data = malloc((size_t)size)) &&
+         fread(*data, 1, (size_t)size, fp) == (size_t)size;
+    fclose(fp);
+    if (!ok) {
+        free(*data);
+        *data = NULL;
+    }
+    *len = ok ? (size_t)size : 0;
+    return ok;
+}
+
+bool input_synthetic(int width, int height, unsigned char **data, size_t *len) {
+    *data = NULL;
+    *len = 0;
+    // O SDK só grava em arquivo: passa por um temporário
+    char path[] = "/tmp/flir2json-synthetic-XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0)
+        return false;
+    close(fd);
+    ACS_ThermalImage *img = ACS_ThermalImage_create(width, height);
+    ACS_ImageBuffer *buf = img ? ACS_ThermalImage_getSignalData(img) : NULL;
+    bool ok = buf && ACS_ImageBuffer_getBytesPerPixel(buf) == 2;
+    if (ok) {
+        unsigned char *base = (unsigned char *)ACS_ImageBuffer_getData(buf);
+        size_t stride = (size_t)ACS_ImageBuffer_getStride(buf);
+        unsigned seed = 3;
+        for (int y = 0; y < height; ++y) {
+            uint16_t *row = (uint16_t *)(base + (size_t)y * stride);
+            for (int x = 0; x < width; ++x) {
+                int dx = x - width / 2, dy = y - height / 3;
+                seed = seed * 1103515245u + 12345u;
+                row[x] = (uint16_t)(30000 + x * 10 + y * 5 + (seed >> 16) % 50 +
+                                    (dx * dx + dy * dy < width * width / 400 ? 15000 : 0));
+            }
+        }
+        ACS_ThermalImage_saveAs(img, path, ACS_FileFormat_jpeg);
+        ok = !ACS_getLastErrorCode() && input_read_file(path, data, len);
+    }
+    if (img)
+        ACS_ThermalImage_free(img);
+    unlink(path);
+    return ok;
+}
@@ -0,0 +1,40 @@
+#ifndef FLIR2JSON_INPUT_H
+#define FLIR2JSON_INPUT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Entrada de arquivos locais via mmap, entregue ao SDK com openFromMemory:
+// evita a cópia das leituras bufferizadas do SDK e deixa o page cache servir
+// reprocessamentos direto.
+
+// Como o extrator lê cada arquivo
+typedef enum {
+    INPUT_FILE, // ACS_ThermalImage_openFromFile (padrão)
+    INPUT_MMAP  // mmap + openFromMemory
+} InputMode;
+
+typedef struct {
+    const unsigned char *data;
+    size_t len;
+} MappedFile;
+
+bool input_mode_parse(const char *s, InputMode *mode);
+
+// Mapeia o arquivo inteiro só para leitura (MADV_SEQUENTIAL); em erro, errno indica a causa
+bool input_map(const char *path, MappedFile *file);
+void input_unmap(MappedFile *file);
+
+// Pede ao kernel para começar a ler o arquivo em segundo plano (readahead),
+// para que ele já esteja no page cache quando for mapeado. Falhas são ignoradas.
+void input_prefetch(const char *path);
+
+// Arquivo inteiro em memória alocada com malloc (para openFromMemory repetido)
+bool input_read_file(const char *path, unsigned char **data, size_t *len);
+
+// JPEG radiométrico width x height gerado pelo SDK (gradiente com ruído e um ponto
+// quente), em memória alocada com malloc; para aquecimento e benchmarks sem arquivos.
+// Em erro, a causa fica em ACS_getLastErrorMessage() ou errno.
+bool input_synthetic(int width, int height, unsigned char **data, size_t *len);
+
+#endif
@@ -0,0 +1,281 @@
+#include "isotherm.h"
+#include "kernels.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const struct {
+    const char *name;
+    IsothermKind kind;
+    size_t values;
+} kinds[] = {
+    { "above", ISOTHERM_ABOVE, 1 },
+    { "below", ISOTHERM_BELOW, 1 },
+    { "interval", ISOTHERM_INTERVAL, 2 },
+};
+
+// `item` é "tipo:T" ou "interval:A,B" sem ';'
+static bool parse_band(const char *item, size_t len, IsothermBand *band) {
+    const char *colon = memchr(item, ':', len);
+    size_t k = 0;
+    while (k < sizeof(kinds) / sizeof(kinds[0]) &&
+           !(colon && (size_t)(colon - item) == strlen(kinds[k].name) &&
+             strncmp(item, kinds[k].name, (size_t)(colon - item)) == 0))
+        ++k;
+    if (k == sizeof(kinds) / sizeof(kinds[0]))
+        return engine_fail("isoterma inválida (above|below|interval): %.*s", (int)len, item);
+
+    double values[2];
+    size_t n = 0;
+    const char *p = colon + 1, *end = item + len;
+    while (p < end) {
+        char *next;
+        double v = strtod(p, &next);
+        if (next == p || next > end || v != v || n == kinds[k].values)
+            return engine_fail("temperaturas inválidas na isoterma: %.*s", (int)len, item);
+        values[n++] = v;
+        p = next;
+        if (p < end && *p++ != ',')
+            return engine_fail("temperaturas inválidas na isoterma: %.*s", (int)len, item);
+    }
+    if (n != kinds[k].values || (n == 2 && values[0] > values[1]))
+        return engine_fail("temperaturas inválidas na isoterma: %.*s", (int)len, item);
+
+    band->kind = kinds[k].kind;
+    band->min = band->kind == ISOTHERM_BELOW ? -__builtin_inf() : values[0];
+    band->max = band->kind == ISOTHERM_ABOVE ? __builtin_inf() : values[n - 1];
+    return true;
+}
+
+bool isotherm_parse(const char *spec, IsothermSet *set) {
+    const char *p = spec;
+    for (;;) {
+        size_t len = strcspn(p, ";");
+        if (set->count == ISOTHERM_MAX_BANDS)
+            return engine_fail("no máximo %d isotermas", ISOTHERM_MAX_BANDS);
+        if (!parse_band(p, len, &set->bands[set->count]))
+            return false;
+        set->count++;
+        if (!p[len])
+            return true;
+        p += len + 1;
+    }
+}
+
+bool isotherm_encoding_parse(const char *s, IsothermEncoding *encoding) {
+    if (strcmp(s, "rle") == 0) *encoding = ISOTHERM_RLE;
+    else if (strcmp(s, "bits") == 0) *encoding = ISOTHERM_BITS;
+    else return false;
+    return true;
+}
+
+const char *isotherm_encoding_name(IsothermEncoding encoding) {
+    return encoding == ISOTHERM_BITS ? "bits" : "rle";
+}
+
+// Faixa de sinais [lo, hi] da isoterma; false se nenhum sinal da imagem cai nela.
+// Fora da LUT não há pixels, então os extremos abertos vão até 0 e 0xffff.
+static bool band_signals(const SignalWindow *win, const IsothermBand *band, UnitConv conv, unsigned *lo,
+                         unsigned *hi) {
+    size_t first = 0, last = win->lut_len; // posições [first, last) da LUT
+    if (band->kind != ISOTHERM_BELOW)
+        first = signal_window_search(win, (band->min - conv.add) / conv.mul, false);
+    if (band->kind != ISOTHERM_ABOVE)
+        last = signal_window_search(win, (band->max - conv.add) / conv.mul, true);
+    if (first >= last)
+        return false;
+    *lo = band->kind == ISOTHERM_BELOW ? 0 : win->lut_base + (unsigned)first;
+    *hi = band->kind == ISOTHERM_ABOVE ? 0xffff : win->lut_base + (unsigned)last - 1;
+    return true;
+}
+
+// Retângulo envolvente [x0, x1] x [y0, y1] da máscara com `words` palavras por linha
+static void mask_bbox(const uint64_t *plane, size_t words, size_t height, ACS_Rectangle *box) {
+    size_t x0 = SIZE_MAX, x1 = 0, y0 = SIZE_MAX, y1 = 0;
+    for (size_t y = 0; y < height; ++y) {
+        const uint64_t *row = plane + y * words;
+        size_t first = 0, last = words;
+        while (first < words && !row[first])
+            ++first;
+        if (first == words)
+            continue;
+        while (!row[last - 1])
+            --last;
+        size_t a = first * 64 + (size_t)__builtin_ctzll(row[first]);
+        size_t b = (last - 1) * 64 + 63 - (size_t)__builtin_clzll(row[last - 1]);
+        if (a < x0) x0 = a;
+        if (b > x1) x1 = b;
+        if (y0 == SIZE_MAX) y0 = y;
+        y1 = y;
+    }
+    *box = (ACS_Rectangle){ (int)x0, (int)y0, (int)(x1 - x0 + 1), (int)(y1 - y0 + 1) };
+}
+
+typedef struct {
+    OutBuf *out;
+    bool inside; // valor dos pixels da corrida atual
+    uint64_t run;
+    bool first;
+} RleWriter;
+
+static void rle_emit(RleWriter *w) {
+    if (!w->first)
+        out_char(w->out, ',');
+    out_uint(w->out, w->run);
+    w->first = false;
+    w->run = 0;
+    w->inside = !w->inside;
+}
+
+// Corridas de `nbits` pixels de uma palavra: acha cada troca com ctz, sem ler bit a bit
+static void rle_word(RleWriter *w, uint64_t word, unsigned nbits) {
+    uint64_t valid = nbits == 64 ? ~(uint64_t)0 : ((uint64_t)1 << nbits) - 1;
+    unsigned pos = 0;
+    while (pos < nbits) {
+        uint64_t pending = (w->inside ? ~word & valid : word) >> pos;
+        if (!pending) {
+            w->run += nbits - pos;
+            return;
+        }
+        unsigned t = (unsigned)__builtin_ctzll(pending);
+        w->run += t;
+        pos += t;
+        rle_emit(w);
+    }
+}
+
+// Sem `plane`, a máscara é toda vazia
+static void write_rle(OutBuf *out, const uint64_t *plane, size_t words, size_t width, size_t height) {
+    out_char(out, '[');
+    RleWriter w = { out, false, 0, true };
+    if (!plane) {
+        w.run = (uint64_t)width * height;
+    } else {
+        for (size_t y = 0; y < height; ++y)
+            for (size_t i = 0; i < words; ++i)
+                rle_word(&w, plane[y * words + i], i + 1 < words || width % 64 == 0 ? 64 : (unsigned)(width % 64));
+    }
+    rle_emit(&w);
+    out_char(out, ']');
+}
+
+static void write_bits(OutBuf *out, const uint64_t *plane, size_t words, size_t width, size_t height) {
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    size_t row_bytes = (width + 7) / 8, total = row_bytes * height;
+    if (!out_reserve(out, (total + 2) / 3 * 4 + 2))
+        return;
+    out_char(out, '"');
+    uint32_t group = 0;
+    size_t held = 0;
+    for (size_t y = 0; y < height; ++y) {
+        for (size_t k = 0; k < row_bytes; ++k) {
+            unsigned char byte = plane ? (unsigned char)(plane[y * words + k / 8] >> (8 * (k % 8))) : 0;
+            group = group << 8 | byte;
+            if (++held == 3) {
+                char quad[4] = { alphabet[group >> 18 & 63], alphabet[group >> 12 & 63], alphabet[group >> 6 & 63],
+                                 alphabet[group & 63] };
+                out_write(out, quad, 4);
+                group = 0;
+                held = 0;
+            }
+        }
+    }
+    if (held) {
+        group <<= 8 * (3 - held);
+        char quad[4] = { alphabet[group >> 18 & 63], alphabet[group >> 12 & 63],
+                         held == 2 ? alphabet[group >> 6 & 63] : '=', '=' };
+        out_write(out, quad, 4);
+    }
+    out_char(out, '"');
+}
+
+static void write_rect(OutBuf *out, const ACS_Rectangle *r) {
+    out_char(out, '[');
+    out_int(out, r->x);
+    out_char(out, ',');
+    out_int(out, r->y);
+    out_char(out, ',');
+    out_int(out, r->width);
+    out_char(out, ',');
+    out_int(out, r->height);
+    out_char(out, ']');
+}
+
+bool isotherm_eval_json(const IsothermSet *set, ACS_ThermalImage *img, const ACS_Rectangle *rect, TempUnit unit,
+                        Workspace *ws, long index, OutBuf *out) {
+    SignalWindow win;
+    if (!engine_signal_window(img, rect, ws, &win))
+        return false;
+    UnitConv conv = unit_conv(unit);
+    unsigned lo[ISOTHERM_MAX_BANDS], hi[ISOTHERM_MAX_BANDS];
+    bool any[ISOTHERM_MAX_BANDS];
+    for (size_t b = 0; b < set->count; ++b)
+        any[b] = band_signals(&win, &set->bands[b], conv, &lo[b], &hi[b]);
+
+    // Uma máscara por faixa; cada linha de sinal é lida uma vez e comparada com todas
+    // as faixas enquanto está no cache
+    size_t width = (size_t)win.width, height = (size_t)win.height;
+    size_t words = (width + 63) / 64, plane = words * height;
+    uint64_t *masks = (uint64_t *)workspace_scratch(ws, plane * set->count * sizeof(uint64_t));
+    if (!masks)
+        return false;
+    size_t pixels[ISOTHERM_MAX_BANDS] = { 0 };
+    for (size_t y = 0; y < height; ++y) {
+        const uint16_t *row = signal_window_row(&win, y);
+        for (size_t b = 0; b < set->count; ++b)
+            if (any[b])
+                pixels[b] += kernel_mask_u16(row, width, lo[b], hi[b], masks + b * plane + y * words);
+    }
+
+    out_char(out, '{');
+    if (index >= 0) {
+        out_str(out, "\"frame\":");
+        out_int(out, index);
+        out_char(out, ',');
+    }
+    out_str(out, "\"unit\":\"");
+    out_str(out, unit_symbol(unit));
+    out_str(out, "\",\"roi\":");
+    write_rect(out, rect);
+    out_str(out, ",\"encoding\":\"");
+    out_str(out, isotherm_encoding_name(set->encoding));
+    out_str(out, "\",\"isotherms\":[");
+    for (size_t b = 0; b < set->count; ++b) {
+        const IsothermBand *band = &set->bands[b];
+        const uint64_t *mask = pixels[b] ? masks + b * plane : NULL;
+        if (b)
+            out_char(out, ',');
+        out_str(out, "{\"type\":\"");
+        out_str(out, kinds[band->kind].name);
+        out_char(out, '"');
+        if (band->kind != ISOTHERM_BELOW) {
+            out_str(out, ",\"min\":");
+            out_json_number(out, band->min, 4);
+        }
+        if (band->kind != ISOTHERM_ABOVE) {
+            out_str(out, ",\"max\":");
+            out_json_number(out, band->max, 4);
+        }
+        out_str(out, ",\"pixels\":");
+        out_uint(out, pixels[b]);
+        out_str(out, ",\"fraction\":");
+        out_json_number(out, (double)pixels[b] / (double)(width * height), 6);
+        out_str(out, ",\"bbox\":");
+        if (mask) {
+            ACS_Rectangle box;
+            mask_bbox(mask, words, height, &box);
+            write_rect(out, &box);
+        } else {
+            out_str(out, "null");
+        }
+        out_str(out, set->encoding == ISOTHERM_BITS ? ",\"bits\":" : ",\"rle\":");
+        if (set->encoding == ISOTHERM_BITS)
+            write_bits(out, mask, words, width, height);
+        else
+            write_rle(out, mask, words, width, height);
+        out_char(out, '}');
+    }
+    out_str(out, "]}\n");
+    return !out->failed || engine_fail("sem memória ao serializar as isotermas");
+}
@@ -0,0 +1,59 @@
+#ifndef FLIR2JSON_ISOTHERM_H
+#define FLIR2JSON_ISOTHERM_H
+
+#include <acs/thermal_image.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "engine.h"
+#include "output.h"
+
+// Isotermas nos moldes de isotherms.h do SDK (above/below/interval), avaliadas sem gerar
+// a matriz: cada limite vira um sinal uma única vez por imagem (pela LUT, que cresce com
+// a temperatura) e as máscaras saem de comparações u16 vetorizadas numa passada pelo
+// buffer de sinal. Por faixa, a saída traz a contagem, o retângulo envolvente e a
+// máscara em RLE ou em bits, nunca a matriz; retângulo envolvente e máscara são
+// relativos ao retângulo avaliado.
+//
+// Especificação: faixas separadas por ';', temperaturas na unidade de saída
+//   above:T        t >= T
+//   below:T        t <= T
+//   interval:A,B   A <= t <= B
+
+#define ISOTHERM_MAX_BANDS 16
+
+typedef enum {
+    ISOTHERM_ABOVE,
+    ISOTHERM_BELOW,
+    ISOTHERM_INTERVAL
+} IsothermKind;
+
+typedef enum {
+    ISOTHERM_RLE, // comprimentos alternados em ordem de linhas, começando pelos pixels fora (pode ser 0)
+    ISOTHERM_BITS // base64 das linhas, ceil(w/8) bytes cada, bit menos significativo primeiro
+} IsothermEncoding;
+
+typedef struct {
+    IsothermKind kind;
+    double min; // above e interval
+    double max; // below e interval
+} IsothermBand;
+
+typedef struct {
+    IsothermBand bands[ISOTHERM_MAX_BANDS];
+    size_t count;
+    IsothermEncoding encoding;
+} IsothermSet;
+
+// Acrescenta as faixas de `spec` ao conjunto (zerado na primeira chamada)
+bool isotherm_parse(const char *spec, IsothermSet *set);
+bool isotherm_encoding_parse(const char *s, IsothermEncoding *encoding);
+const char *isotherm_encoding_name(IsothermEncoding encoding);
+
+// Avalia as faixas no retângulo da imagem já preparada (engine_prepare, caminho de sinal)
+// e grava uma linha JSON {"frame":N,"unit":...,"roi":[x,y,w,h],"isotherms":[...]};
+// `index` < 0 omite "frame". As máscaras ocupam a área temporária do Workspace.
+bool isotherm_eval_json(const IsothermSet *set, ACS_ThermalImage *img, const ACS_Rectangle *rect, TempUnit unit,
+                        Workspace *ws, long index, OutBuf *out);
+
+#endif
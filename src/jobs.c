@@ -0,0 +1,337 @@
+#include "jobs.h"
+#include "delta.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/random.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#define JOB_INPUT "input.seq" // o player reconhece .seq/.csq pelo conteúdo
+#define JOB_ID_ATTEMPTS 8     // sorteios de id antes de desistir da pasta
+
+const char *job_state_name(JobState state) {
+    switch (state) {
+    case JOB_UPLOADING: return "uploading";
+    case JOB_QUEUED: return "queued";
+    case JOB_RUNNING: return "running";
+    case JOB_DONE: return "done";
+    default: return "failed";
+    }
+}
+
+static double wall_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void job_path(const Job *job, const char *name, char *path, size_t size) {
+    snprintf(path, size, "%s/%s", job->dir, name);
+}
+
+static void result_name(const Job *job, char *name, size_t size) {
+    snprintf(name, size, "result.%s", output_extension(job->opt.output.format));
+}
+
+// Estado de uma execução: um Workspace (e um codificador delta) por thread da sequência
+typedef struct {
+    const JobOptions *opt;
+    Workspace *workspaces;
+    DeltaEncoder *deltas;
+    atomic_bool reported;
+    char error[256]; // primeira falha de quadro
+} JobRun;
+
+static bool job_frame(void *ctx, unsigned worker, size_t index, ACS_ThermalImage *img, OutBuf *out) {
+    JobRun *run = ctx;
+    const JobOptions *opt = run->opt;
+    Workspace *ws = &run->workspaces[worker];
+    ACS_Rectangle rect = { 0, 0, ACS_ThermalImage_getWidth(img), ACS_ThermalImage_getHeight(img) };
+    Frame frame;
+    size_t clipped;
+    bool ok = engine_prepare(img, &opt->extract) && engine_extract(img, &rect, &opt->extract, ws, &frame);
+    if (ok) {
+        frame.index = (long)index;
+        switch (opt->output.format) {
+        case FORMAT_DELTA:
+            ok = delta_encode(&run->deltas[worker], out, &frame, &opt->output, index, opt->frames.stride);
+            break;
+        case FORMAT_BIN: ok = serialize_bin(out, img, &frame, &opt->output, ws, &clipped); break;
+        case FORMAT_JSON: ok = serialize_json(out, img, &frame); break;
+        default: ok = serialize_csv(out, &frame, &opt->output.csv); break;
+        }
+        if (!ok && opt->output.format != FORMAT_DELTA)
+            engine_fail("sem memória ao serializar");
+    }
+    if (!ok && !atomic_exchange(&run->reported, true))
+        snprintf(run->error, sizeof(run->error), "quadro %zu: %s", index, engine_last_error());
+    return ok;
+}
+
+static void job_run(JobQueue *q, Job *job) {
+    const JobOptions *opt = &job->opt;
+    char input[JOB_FILE_MAX], result[JOB_FILE_MAX], name[32];
+    job_path(job, JOB_INPUT, input, sizeof(input));
+    result_name(job, name, sizeof(name));
+    job_path(job, name, result, sizeof(result));
+
+    JobRun run = { .opt = opt };
+    run.workspaces = calloc(q->threads, sizeof(*run.workspaces));
+    // Delta: cada bloco começa num quadro-chave, como no extrator
+    size_t chunk = 0;
+    if (opt->output.format == FORMAT_DELTA && (run.deltas = calloc(q->threads, sizeof(*run.deltas)))) {
+        for (unsigned i = 0; i < q->threads; ++i)
+            delta_init(&run.deltas[i], opt->keyframe);
+        chunk = opt->keyframe;
+    }
+    bool ok;
+    SequenceResult res = { 0 };
+    FILE *fp = NULL;
+    if (!run.workspaces || (opt->output.format == FORMAT_DELTA && !run.deltas)) {
+        ok = engine_fail("sem memória para o job");
+    } else if (!(fp = fopen(result, output_is_binary(opt->output.format) ? "wb" : "w"))) {
+        ok = engine_fail("erro ao criar %s: %s", result, strerror(errno));
+    } else {
+        OutBuf out;
+        out_init_file(&out, fp, OUT_DEFAULT_CAPACITY);
+        ok = sequence_run(input, &opt->frames, q->threads, chunk, job_frame, &run, &out, &res, &job->progress);
+        if (!out_flush(&out) && ok)
+            ok = engine_fail("erro ao gravar %s: %s", result, strerror(errno));
+        out_free(&out);
+        if (fclose(fp) != 0 && ok)
+            ok = engine_fail("erro ao gravar %s: %s", result, strerror(errno));
+    }
+    // Sem nenhum quadro bom o job falha, com o motivo do primeiro
+    if (ok && res.frames && res.failed == res.frames)
+        ok = engine_fail("%s", run.error[0] ? run.error : "todos os quadros falharam");
+
+    for (unsigned i = 0; i < q->threads; ++i) {
+        if (run.workspaces)
+            workspace_free(&run.workspaces[i]);
+        if (run.deltas)
+            delta_free(&run.deltas[i]);
+    }
+    free(run.workspaces);
+    free(run.deltas);
+    unlink(input);
+
+    pthread_mutex_lock(&q->lock);
+    job->state = ok ? JOB_DONE : JOB_FAILED;
+    job->finished_at = wall_seconds();
+    snprintf(job->error, sizeof(job->error), "%s", ok ? run.error : engine_last_error());
+    pthread_mutex_unlock(&q->lock);
+}
+
+static void *job_runner(void *arg) {
+    JobQueue *q = arg;
+    // As threads da sequência, criadas por esta, herdam a prioridade
+    setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), JOBS_NICE);
+    for (;;) {
+        pthread_mutex_lock(&q->lock);
+        while (!q->head)
+            pthread_cond_wait(&q->wake, &q->lock);
+        Job *job = q->head;
+        if (!(q->head = job->next))
+            q->tail = NULL;
+        job->state = JOB_RUNNING;
+        job->started_at = wall_seconds();
+        pthread_mutex_unlock(&q->lock);
+        job_run(q, job);
+    }
+    return NULL;
+}
+
+bool jobs_init(JobQueue *q, const char *dir, unsigned max_running, unsigned threads) {
+    memset(q, 0, sizeof(*q));
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST)
+        return engine_fail("erro ao criar %s: %s", dir, strerror(errno));
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->wake, NULL);
+    q->dir = dir;
+    q->max_running = max_running;
+    q->threads = threads ? threads : 1;
+    if (!(q->runners = calloc(max_running, sizeof(*q->runners))))
+        return engine_fail("sem memória para a fila de jobs");
+    for (unsigned i = 0; i < max_running; ++i)
+        if (pthread_create(&q->runners[i], NULL, job_runner, q) != 0)
+            return engine_fail("falha ao iniciar a fila de jobs");
+    return true;
+}
+
+// Tira do registro os terminados além de JOBS_KEEP (sob a trava)
+static void prune(JobQueue *q) {
+    size_t i = 0;
+    for (Job **link = &q->newest; *link;) {
+        Job *job = *link;
+        if (i++ >= JOBS_KEEP && (job->state == JOB_DONE || job->state == JOB_FAILED)) {
+            *link = job->older;
+            q->count--;
+            free(job);
+            continue;
+        }
+        link = &job->older;
+    }
+}
+
+Job *jobs_create(JobQueue *q, const JobOptions *opt) {
+    Job *job = calloc(1, sizeof(*job));
+    if (!job) {
+        engine_fail("sem memória para o job");
+        return NULL;
+    }
+    job->opt = *opt;
+    job->created_at = wall_seconds();
+    // 64 bits aleatórios: o id é a única credencial de GET /jobs/{id}, então não pode ser
+    // adivinhado a partir de outro. A pasta já existir (colisão ou job de antes de um
+    // reinício) só faz sortear de novo
+    bool made = false;
+    for (int attempt = 0; !made && attempt < JOB_ID_ATTEMPTS; ++attempt) {
+        uint64_t r;
+        if (getrandom(&r, sizeof(r), 0) != (ssize_t)sizeof(r))
+            break;
+        snprintf(job->id, sizeof(job->id), "%016llx", (unsigned long long)r);
+        snprintf(job->dir, sizeof(job->dir), "%s/%s", q->dir, job->id);
+        if (!(made = mkdir(job->dir, 0755) == 0) && errno != EEXIST)
+            break;
+    }
+
+    char input[JOB_FILE_MAX];
+    job_path(job, JOB_INPUT, input, sizeof(input));
+    if (!made || !(job->upload = fopen(input, "wb"))) {
+        engine_fail("erro ao criar a pasta do job em %s: %s", q->dir, strerror(errno));
+        if (made)
+            rmdir(job->dir);
+        free(job);
+        return NULL;
+    }
+    pthread_mutex_lock(&q->lock);
+    job->older = q->newest;
+    q->newest = job;
+    q->count++;
+    if (q->count > JOBS_KEEP)
+        prune(q);
+    pthread_mutex_unlock(&q->lock);
+    return job;
+}
+
+bool jobs_append(Job *job, const void *data, size_t len) {
+    if (fwrite(data, 1, len, job->upload) != len)
+        return engine_fail("erro ao gravar a sequência do job: %s", strerror(errno));
+    atomic_fetch_add(&job->uploaded, len);
+    return true;
+}
+
+bool jobs_submit(JobQueue *q, Job *job) {
+    bool ok = fclose(job->upload) == 0;
+    job->upload = NULL;
+    pthread_mutex_lock(&q->lock);
+    if (ok) {
+        job->state = JOB_QUEUED;
+        job->next = NULL;
+        if (q->tail)
+            q->tail->next = job;
+        else
+            q->head = job;
+        q->tail = job;
+        pthread_cond_signal(&q->wake);
+    } else {
+        job->state = JOB_FAILED;
+        job->finished_at = wall_seconds();
+        snprintf(job->error, sizeof(job->error), "erro ao gravar a sequência do job: %s", strerror(errno));
+    }
+    pthread_mutex_unlock(&q->lock);
+    return ok || engine_fail("%s", job->error);
+}
+
+void jobs_discard(JobQueue *q, Job *job) {
+    pthread_mutex_lock(&q->lock);
+    for (Job **link = &q->newest; *link; link = &(*link)->older) {
+        if (*link == job) {
+            *link = job->older;
+            q->count--;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&q->lock);
+    char input[JOB_FILE_MAX];
+    job_path(job, JOB_INPUT, input, sizeof(input));
+    if (job->upload)
+        fclose(job->upload);
+    unlink(input);
+    rmdir(job->dir);
+    free(job);
+}
+
+static Job *find(JobQueue *q, const char *id) {
+    for (Job *job = q->newest; job; job = job->older)
+        if (strcmp(job->id, id) == 0)
+            return job;
+    return NULL;
+}
+
+bool jobs_status_json(JobQueue *q, const char *id, OutBuf *out) {
+    pthread_mutex_lock(&q->lock);
+    Job *job = find(q, id);
+    if (!job) {
+        pthread_mutex_unlock(&q->lock);
+        return false;
+    }
+    size_t total = atomic_load(&job->progress.total), frames = atomic_load(&job->progress.frames);
+    size_t done = atomic_load(&job->progress.done), failed = atomic_load(&job->progress.failed);
+    double end = job->finished_at ? job->finished_at : wall_seconds();
+    out_str(out, "{\"id\":\"");
+    out_str(out, job->id);
+    out_str(out, "\",\"state\":\"");
+    out_str(out, job_state_name(job->state));
+    out_str(out, "\",\"format\":\"");
+    out_str(out, output_extension(job->opt.output.format));
+    out_str(out, "\",\"frames_total\":");
+    out_uint(out, total);
+    out_str(out, ",\"frames_selected\":");
+    out_uint(out, frames);
+    out_str(out, ",\"frames_done\":");
+    out_uint(out, done);
+    out_str(out, ",\"frames_failed\":");
+    out_uint(out, failed);
+    out_str(out, ",\"progress\":");
+    out_json_number(out, job->state == JOB_DONE ? 1.0 : frames ? (double)done / (double)frames : 0.0, 4);
+    out_str(out, ",\"uploaded_bytes\":");
+    out_uint(out, atomic_load(&job->uploaded));
+    out_str(out, ",\"created_at\":");
+    out_json_number(out, job->created_at, 3);
+    if (job->started_at) {
+        out_str(out, ",\"run_seconds\":");
+        out_json_number(out, end - job->started_at, 3);
+    }
+    if (job->state == JOB_DONE) {
+        out_str(out, ",\"result\":\"/jobs/");
+        out_str(out, job->id);
+        out_str(out, "/result\"");
+    }
+    if (job->error[0]) {
+        out_str(out, ",\"error\":");
+        out_json_string(out, job->error);
+    }
+    out_str(out, "}\n");
+    pthread_mutex_unlock(&q->lock);
+    return !out->failed;
+}
+
+bool jobs_result(JobQueue *q, const char *id, JobState *state, OutputFormat *format, char *path, size_t size) {
+    pthread_mutex_lock(&q->lock);
+    Job *job = find(q, id);
+    if (job) {
+        char name[32];
+        *state = job->state;
+        *format = job->opt.output.format;
+        result_name(job, name, sizeof(name));
+        job_path(job, name, path, size);
+    }
+    pthread_mutex_unlock(&q->lock);
+    return job != NULL;
+}
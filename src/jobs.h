@@ -0,0 +1,97 @@
+#ifndef FLIR2JSON_JOBS_H
+#define FLIR2JSON_JOBS_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "engine.h"
+#include "output.h"
+#include "sequence.h"
+#include "serialize.h"
+
+// Fila de extrações de sequência em segundo plano (POST /jobs do servidor). Cada job
+// tem a pasta DIR/<id>/: a sequência recebida é gravada lá (e apagada ao terminar) e o
+// resultado fica em DIR/<id>/result.<ext>. No máximo `max_running` jobs rodam ao mesmo
+// tempo, cada um com `threads` threads de decodificação em prioridade baixa (nice),
+// para que as requisições interativas continuem na frente dos lotes longos.
+
+#define JOB_ID_LEN 16 // 64 bits aleatórios em hexadecimal
+#define JOB_PATH_MAX 4096
+#define JOB_FILE_MAX (JOB_PATH_MAX + 64) // pasta do job + nome de arquivo
+
+// Jobs terminados lembrados para GET /jobs/{id}; os mais antigos saem do registro
+// (os arquivos ficam)
+#define JOBS_KEEP 1024
+
+// Ajuste de nice das threads dos jobs
+#define JOBS_NICE 10
+
+typedef enum {
+    JOB_UPLOADING, // corpo ainda chegando
+    JOB_QUEUED,
+    JOB_RUNNING,
+    JOB_DONE,      // resultado pronto (quadros com falha contam em progress.failed)
+    JOB_FAILED
+} JobState;
+
+typedef struct {
+    ExtractOptions extract;
+    OutputOptions output;
+    FrameRange frames;
+    unsigned keyframe; // delta: quadros por quadro-chave
+} JobOptions;
+
+typedef struct Job {
+    char id[JOB_ID_LEN + 1];
+    JobOptions opt;
+    char dir[JOB_PATH_MAX];
+    FILE *upload;
+    atomic_uint_fast64_t uploaded; // gravado pela thread do upload, lido pelo status
+    SequenceProgress progress;
+    // Sob a trava da fila
+    JobState state;
+    double created_at; // segundos desde a época
+    double started_at;
+    double finished_at;
+    char error[256];
+    struct Job *next;  // fila de espera
+    struct Job *older; // registro, do mais novo para o mais antigo
+} Job;
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    const char *dir;
+    unsigned max_running;
+    unsigned threads;
+    Job *head, *tail; // esperando, em ordem de chegada
+    Job *newest;      // registro
+    size_t count;
+    pthread_t *runners;
+} JobQueue;
+
+const char *job_state_name(JobState state);
+
+// Cria DIR se preciso e inicia as threads executoras; erros em engine_last_error()
+bool jobs_init(JobQueue *q, const char *dir, unsigned max_running, unsigned threads);
+
+// Novo job (JOB_UPLOADING) com a pasta criada e a entrada aberta para jobs_append
+Job *jobs_create(JobQueue *q, const JobOptions *opt);
+bool jobs_append(Job *job, const void *data, size_t len);
+
+// Fecha a entrada e põe o job na fila
+bool jobs_submit(JobQueue *q, Job *job);
+
+// Desiste de um job que não chegou à fila (upload interrompido), apagando os arquivos
+void jobs_discard(JobQueue *q, Job *job);
+
+// Documento de GET /jobs/{id}; false se o id não existe
+bool jobs_status_json(JobQueue *q, const char *id, OutBuf *out);
+
+// Estado, formato e caminho do resultado; false se o id não existe
+bool jobs_result(JobQueue *q, const char *id, JobState *state, OutputFormat *format, char *path, size_t size);
+
+#endif
@@ -0,0 +1,560 @@
+#include "kernels.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define KERNELS_X86 1
+#else
+#define KERNELS_X86 0
+#endif
+
+typedef struct {
+    const char *name;
+    void (*minmax_u16)(const uint16_t *, size_t, unsigned *, unsigned *);
+    void (*map_f64)(const SignalMap *, const uint16_t *, size_t, double *, KernelStats *);
+    size_t (*map_u16)(const SignalMap *, const uint16_t *, size_t, uint16_t *, KernelStats *);
+    void (*stats_f64)(const double *, size_t, KernelStats *);
+    size_t (*mask_u16)(const uint16_t *, size_t, unsigned, unsigned, uint64_t *);
+    void (*extremes_f64)(const double *, size_t, double *, double *);
+    void (*welford_f64)(const double *, size_t, double, double *, double *);
+} KernelTable;
+
+void kernel_stats_init(KernelStats *st, uint32_t *histogram) {
+    st->min = __builtin_inf();
+    st->max = -__builtin_inf();
+    st->sum = 0.0;
+    st->count = 0;
+    st->histogram = histogram;
+}
+
+static inline void stats_add(KernelStats *st, double v) {
+    if (v < st->min) st->min = v;
+    if (v > st->max) st->max = v;
+    st->sum += v;
+}
+
+// Histograma do acumulador, ou NULL: testado uma vez por bloco de pixels no laço principal
+static inline uint32_t *histogram_of(const KernelStats *st) {
+    return st ? st->histogram : NULL;
+}
+
+// Conta os `n` sinais do bloco que o laço acabou de converter (ainda no L1)
+static inline void histogram_count(uint32_t *hist, const uint16_t *sig, size_t n, unsigned base) {
+    for (size_t i = 0; i < n; ++i)
+        hist[sig[i] - base]++;
+}
+
+// ---------------------------------------------------------------------------
+// Escalar: referência e fallback para arquiteturas sem SIMD x86
+
+static void minmax_u16_scalar(const uint16_t *sig, size_t n, unsigned *lo, unsigned *hi) {
+    unsigned l = *lo, h = *hi;
+    for (size_t i = 0; i < n; ++i) {
+        if (sig[i] < l) l = sig[i];
+        if (sig[i] > h) h = sig[i];
+    }
+    *lo = l;
+    *hi = h;
+}
+
+static void map_f64_scalar(const SignalMap *map, const uint16_t *sig, size_t n, double *out, KernelStats *st) {
+    const double *table = map->table;
+    uint32_t *hist = histogram_of(st);
+    for (size_t i = 0; i < n; ++i) {
+        double v = table[sig[i] - map->base] * map->mul + map->add;
+        out[i] = v;
+        if (st) stats_add(st, v);
+        if (hist) hist[sig[i] - map->base]++;
+    }
+    if (st) st->count += n;
+}
+
+static inline uint16_t quantize_u16(double v, size_t *clipped) {
+    double q = v + 0.5;
+    if (q >= 0.0 && q < 65536.0)
+        return (uint16_t)q;
+    ++*clipped;
+    return q >= 65536.0 ? 65535 : 0; // NaN também vira 0
+}
+
+static size_t map_u16_scalar(const SignalMap *map, const uint16_t *sig, size_t n, uint16_t *out, KernelStats *st) {
+    const double *table = map->table;
+    uint32_t *hist = histogram_of(st);
+    size_t clipped = 0;
+    for (size_t i = 0; i < n; ++i) {
+        double v = table[sig[i] - map->base] * map->mul + map->add;
+        out[i] = quantize_u16(v, &clipped);
+        if (st) stats_add(st, v);
+        if (hist) hist[sig[i] - map->base]++;
+    }
+    if (st) st->count += n;
+    return clipped;
+}
+
+static void stats_f64_scalar(const double *values, size_t n, KernelStats *st) {
+    for (size_t i = 0; i < n; ++i)
+        stats_add(st, values[i]);
+    st->count += n;
+}
+
+// Também completa a última palavra (menos de 64 pixels) das variantes SIMD
+static size_t mask_u16_scalar(const uint16_t *sig, size_t n, unsigned lo, unsigned hi, uint64_t *bits) {
+    size_t count = 0;
+    for (size_t i = 0; i < n; i += 64) {
+        size_t end = n - i < 64 ? n - i : 64;
+        uint64_t word = 0;
+        for (size_t j = 0; j < end; ++j)
+            word |= (uint64_t)(sig[i + j] >= lo && sig[i + j] <= hi) << j;
+        bits[i / 64] = word;
+        count += (size_t)__builtin_popcountll(word);
+    }
+    return count;
+}
+
+static void extremes_f64_scalar(const double *values, size_t n, double *min, double *max) {
+    for (size_t i = 0; i < n; ++i) {
+        if (values[i] < min[i]) min[i] = values[i];
+        if (values[i] > max[i]) max[i] = values[i];
+    }
+}
+
+// `inv` = 1 / número do quadro; sem m2 o laço fica só com a média
+static void welford_f64_scalar(const double *values, size_t n, double inv, double *mean, double *m2) {
+    if (!m2) {
+        for (size_t i = 0; i < n; ++i)
+            mean[i] += (values[i] - mean[i]) * inv;
+        return;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        double delta = values[i] - mean[i];
+        mean[i] += delta * inv;
+        m2[i] += delta * (values[i] - mean[i]);
+    }
+}
+
+static const KernelTable scalar_table = {
+    "scalar", minmax_u16_scalar, map_f64_scalar, map_u16_scalar, stats_f64_scalar, mask_u16_scalar,
+    extremes_f64_scalar, welford_f64_scalar
+};
+
+#if KERNELS_X86
+// ---------------------------------------------------------------------------
+// SSE2: sem gather, carrega da LUT por escalar e processa 2 doubles por vez.
+// min/max recebem o valor novo como 1º operando: com NaN devolvem o acumulado,
+// o mesmo comportamento das comparações escalares.
+
+static inline double hmin_sse2(__m128d v) { return _mm_cvtsd_f64(_mm_min_sd(v, _mm_unpackhi_pd(v, v))); }
+static inline double hmax_sse2(__m128d v) { return _mm_cvtsd_f64(_mm_max_sd(v, _mm_unpackhi_pd(v, v))); }
+static inline double hsum_sse2(__m128d v) { return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v))); }
+
+static void minmax_u16_sse2(const uint16_t *sig, size_t n, unsigned *lo, unsigned *hi) {
+    // SSE2 só compara int16 com sinal: desloca o domínio com xor 0x8000
+    const __m128i bias = _mm_set1_epi16((short)0x8000);
+    __m128i vlo = _mm_set1_epi16(0x7fff), vhi = _mm_set1_epi16((short)0x8000);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i s = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(sig + i)), bias);
+        vlo = _mm_min_epi16(vlo, s);
+        vhi = _mm_max_epi16(vhi, s);
+    }
+    uint16_t lanes_lo[8], lanes_hi[8];
+    _mm_storeu_si128((__m128i *)lanes_lo, _mm_xor_si128(vlo, bias));
+    _mm_storeu_si128((__m128i *)lanes_hi, _mm_xor_si128(vhi, bias));
+    if (i > 0) {
+        minmax_u16_scalar(lanes_lo, 8, lo, hi);
+        minmax_u16_scalar(lanes_hi, 8, lo, hi);
+    }
+    minmax_u16_scalar(sig + i, n - i, lo, hi);
+}
+
+static void map_f64_sse2(const SignalMap *map, const uint16_t *sig, size_t n, double *out, KernelStats *st) {
+    const double *table = map->table;
+    const unsigned base = map->base;
+    const __m128d vmul = _mm_set1_pd(map->mul), vadd = _mm_set1_pd(map->add);
+    __m128d vmin = _mm_set1_pd(__builtin_inf()), vmax = _mm_set1_pd(-__builtin_inf()), vsum = _mm_setzero_pd();
+    uint32_t *hist = histogram_of(st);
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128d v = _mm_set_pd(table[sig[i + 1] - base], table[sig[i] - base]);
+        v = _mm_add_pd(_mm_mul_pd(v, vmul), vadd);
+        _mm_storeu_pd(out + i, v);
+        vmin = _mm_min_pd(v, vmin);
+        vmax = _mm_max_pd(v, vmax);
+        vsum = _mm_add_pd(vsum, v);
+        if (hist) histogram_count(hist, sig + i, 2, base);
+    }
+    if (st && i > 0) {
+        double mn = hmin_sse2(vmin), mx = hmax_sse2(vmax);
+        if (mn < st->min) st->min = mn;
+        if (mx > st->max) st->max = mx;
+        st->sum += hsum_sse2(vsum);
+        st->count += i;
+    }
+    map_f64_scalar(map, sig + i, n - i, out + i, st);
+}
+
+static size_t map_u16_sse2(const SignalMap *map, const uint16_t *sig, size_t n, uint16_t *out, KernelStats *st) {
+    const double *table = map->table;
+    const unsigned base = map->base;
+    const __m128d vmul = _mm_set1_pd(map->mul), vadd = _mm_set1_pd(map->add);
+    const __m128d half = _mm_set1_pd(0.5), zero = _mm_setzero_pd();
+    const __m128d top = _mm_set1_pd(65535.0), limit = _mm_set1_pd(65536.0);
+    __m128d vmin = _mm_set1_pd(__builtin_inf()), vmax = _mm_set1_pd(-__builtin_inf()), vsum = _mm_setzero_pd();
+    uint32_t *hist = histogram_of(st);
+    size_t clipped = 0, i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128d v = _mm_set_pd(table[sig[i + 1] - base], table[sig[i] - base]);
+        v = _mm_add_pd(_mm_mul_pd(v, vmul), vadd);
+        vmin = _mm_min_pd(v, vmin);
+        vmax = _mm_max_pd(v, vmax);
+        vsum = _mm_add_pd(vsum, v);
+        if (hist) histogram_count(hist, sig + i, 2, base);
+
+        __m128d q = _mm_add_pd(v, half);
+        // Fora de [0, 65536) inclui NaN, que falha ambas as comparações
+        __m128d inside = _mm_and_pd(_mm_cmpge_pd(q, zero), _mm_cmplt_pd(q, limit));
+        clipped += (size_t)__builtin_popcount((unsigned)(~_mm_movemask_pd(inside) & 0x3));
+        // max_pd devolve o 2º operando quando o 1º é NaN: NaN satura em 0
+        q = _mm_min_pd(_mm_max_pd(q, zero), top);
+        __m128i t = _mm_cvttpd_epi32(q);
+        out[i] = (uint16_t)_mm_cvtsi128_si32(t);
+        out[i + 1] = (uint16_t)_mm_cvtsi128_si32(_mm_srli_si128(t, 4));
+    }
+    if (st && i > 0) {
+        double mn = hmin_sse2(vmin), mx = hmax_sse2(vmax);
+        if (mn < st->min) st->min = mn;
+        if (mx > st->max) st->max = mx;
+        st->sum += hsum_sse2(vsum);
+        st->count += i;
+    }
+    return clipped + map_u16_scalar(map, sig + i, n - i, out + i, st);
+}
+
+static void stats_f64_sse2(const double *values, size_t n, KernelStats *st) {
+    __m128d vmin = _mm_set1_pd(__builtin_inf()), vmax = _mm_set1_pd(-__builtin_inf()), vsum = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128d v = _mm_loadu_pd(values + i);
+        vmin = _mm_min_pd(v, vmin);
+        vmax = _mm_max_pd(v, vmax);
+        vsum = _mm_add_pd(vsum, v);
+    }
+    if (i > 0) {
+        double mn = hmin_sse2(vmin), mx = hmax_sse2(vmax);
+        if (mn < st->min) st->min = mn;
+        if (mx > st->max) st->max = mx;
+        st->sum += hsum_sse2(vsum);
+        st->count += i;
+    }
+    stats_f64_scalar(values + i, n - i, st);
+}
+
+// Dentro da faixa: subs_epu16(s, hi) e subs_epu16(lo, s) ambos zero, sem o xor do
+// domínio com sinal; 16 pixels viram 16 bits com packs + movemask
+static inline unsigned mask16_sse2(const uint16_t *sig, __m128i vlo, __m128i vhi) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i a = _mm_loadu_si128((const __m128i *)sig), b = _mm_loadu_si128((const __m128i *)(sig + 8));
+    __m128i out_a = _mm_or_si128(_mm_subs_epu16(a, vhi), _mm_subs_epu16(vlo, a));
+    __m128i out_b = _mm_or_si128(_mm_subs_epu16(b, vhi), _mm_subs_epu16(vlo, b));
+    __m128i in = _mm_packs_epi16(_mm_cmpeq_epi16(out_a, zero), _mm_cmpeq_epi16(out_b, zero));
+    return (unsigned)_mm_movemask_epi8(in);
+}
+
+static size_t mask_u16_sse2(const uint16_t *sig, size_t n, unsigned lo, unsigned hi, uint64_t *bits) {
+    const __m128i vlo = _mm_set1_epi16((short)lo), vhi = _mm_set1_epi16((short)hi);
+    size_t count = 0, i = 0;
+    for (; i + 64 <= n; i += 64) {
+        uint64_t word = (uint64_t)mask16_sse2(sig + i, vlo, vhi) | (uint64_t)mask16_sse2(sig + i + 16, vlo, vhi) << 16 |
+                        (uint64_t)mask16_sse2(sig + i + 32, vlo, vhi) << 32 |
+                        (uint64_t)mask16_sse2(sig + i + 48, vlo, vhi) << 48;
+        bits[i / 64] = word;
+        count += (size_t)__builtin_popcountll(word);
+    }
+    return count + mask_u16_scalar(sig + i, n - i, lo, hi, bits + i / 64);
+}
+
+static void extremes_f64_sse2(const double *values, size_t n, double *min, double *max) {
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128d v = _mm_loadu_pd(values + i);
+        _mm_storeu_pd(min + i, _mm_min_pd(v, _mm_loadu_pd(min + i)));
+        _mm_storeu_pd(max + i, _mm_max_pd(v, _mm_loadu_pd(max + i)));
+    }
+    extremes_f64_scalar(values + i, n - i, min + i, max + i);
+}
+
+static void welford_f64_sse2(const double *values, size_t n, double inv, double *mean, double *m2) {
+    const __m128d vinv = _mm_set1_pd(inv);
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128d v = _mm_loadu_pd(values + i), m = _mm_loadu_pd(mean + i);
+        __m128d delta = _mm_sub_pd(v, m);
+        m = _mm_add_pd(m, _mm_mul_pd(delta, vinv));
+        _mm_storeu_pd(mean + i, m);
+        if (m2)
+            _mm_storeu_pd(m2 + i, _mm_add_pd(_mm_loadu_pd(m2 + i), _mm_mul_pd(delta, _mm_sub_pd(v, m))));
+    }
+    welford_f64_scalar(values + i, n - i, inv, mean + i, m2 ? m2 + i : NULL);
+}
+
+static const KernelTable sse2_table = {
+    "sse2", minmax_u16_sse2, map_f64_sse2, map_u16_sse2, stats_f64_sse2, mask_u16_sse2,
+    extremes_f64_sse2, welford_f64_sse2
+};
+
+// ---------------------------------------------------------------------------
+// AVX2: gather de 4 doubles da LUT por instrução, 8 pixels por iteração
+
+#define AVX2 __attribute__((target("avx2")))
+
+AVX2 static inline void reduce_avx2(KernelStats *st, __m256d vmin, __m256d vmax, __m256d vsum, size_t count) {
+    __m128d lo_min = _mm_min_pd(_mm256_castpd256_pd128(vmin), _mm256_extractf128_pd(vmin, 1));
+    __m128d lo_max = _mm_max_pd(_mm256_castpd256_pd128(vmax), _mm256_extractf128_pd(vmax, 1));
+    __m128d lo_sum = _mm_add_pd(_mm256_castpd256_pd128(vsum), _mm256_extractf128_pd(vsum, 1));
+    double mn = hmin_sse2(lo_min), mx = hmax_sse2(lo_max);
+    if (mn < st->min) st->min = mn;
+    if (mx > st->max) st->max = mx;
+    st->sum += hsum_sse2(lo_sum);
+    st->count += count;
+}
+
+AVX2 static void minmax_u16_avx2(const uint16_t *sig, size_t n, unsigned *lo, unsigned *hi) {
+    __m256i vlo = _mm256_set1_epi16((short)0xffff), vhi = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i s = _mm256_loadu_si256((const __m256i *)(sig + i));
+        vlo = _mm256_min_epu16(vlo, s);
+        vhi = _mm256_max_epu16(vhi, s);
+    }
+    uint16_t lanes_lo[16], lanes_hi[16];
+    _mm256_storeu_si256((__m256i *)lanes_lo, vlo);
+    _mm256_storeu_si256((__m256i *)lanes_hi, vhi);
+    if (i > 0) {
+        minmax_u16_scalar(lanes_lo, 16, lo, hi);
+        minmax_u16_scalar(lanes_hi, 16, lo, hi);
+    }
+    minmax_u16_scalar(sig + i, n - i, lo, hi);
+}
+
+AVX2 static inline __m256d gather_avx2(const double *table, __m128i vbase, const uint16_t *sig) {
+    __m128i idx = _mm_cvtepu16_epi32(_mm_loadl_epi64((const __m128i *)sig));
+    return _mm256_i32gather_pd(table, _mm_sub_epi32(idx, vbase), 8);
+}
+
+AVX2 static void map_f64_avx2(const SignalMap *map, const uint16_t *sig, size_t n, double *out, KernelStats *st) {
+    const __m128i vbase = _mm_set1_epi32((int)map->base);
+    const __m256d vmul = _mm256_set1_pd(map->mul), vadd = _mm256_set1_pd(map->add);
+    __m256d vmin = _mm256_set1_pd(__builtin_inf()), vmax = _mm256_set1_pd(-__builtin_inf()), vsum = _mm256_setzero_pd();
+    uint32_t *hist = histogram_of(st);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256d a = _mm256_add_pd(_mm256_mul_pd(gather_avx2(map->table, vbase, sig + i), vmul), vadd);
+        __m256d b = _mm256_add_pd(_mm256_mul_pd(gather_avx2(map->table, vbase, sig + i + 4), vmul), vadd);
+        _mm256_storeu_pd(out + i, a);
+        _mm256_storeu_pd(out + i + 4, b);
+        vmin = _mm256_min_pd(b, _mm256_min_pd(a, vmin));
+        vmax = _mm256_max_pd(b, _mm256_max_pd(a, vmax));
+        vsum = _mm256_add_pd(vsum, _mm256_add_pd(a, b));
+        if (hist) histogram_count(hist, sig + i, 8, map->base);
+    }
+    if (st && i > 0)
+        reduce_avx2(st, vmin, vmax, vsum, i);
+    map_f64_scalar(map, sig + i, n - i, out + i, st);
+}
+
+AVX2 static inline __m128i quantize_avx2(__m256d v, size_t *clipped) {
+    const __m256d half = _mm256_set1_pd(0.5), zero = _mm256_setzero_pd();
+    const __m256d top = _mm256_set1_pd(65535.0), limit = _mm256_set1_pd(65536.0);
+    __m256d q = _mm256_add_pd(v, half);
+    __m256d inside = _mm256_and_pd(_mm256_cmp_pd(q, zero, _CMP_GE_OQ), _mm256_cmp_pd(q, limit, _CMP_LT_OQ));
+    *clipped += (size_t)__builtin_popcount((unsigned)(~_mm256_movemask_pd(inside) & 0xf));
+    q = _mm256_min_pd(_mm256_max_pd(q, zero), top);
+    return _mm256_cvttpd_epi32(q);
+}
+
+AVX2 static size_t map_u16_avx2(const SignalMap *map, const uint16_t *sig, size_t n, uint16_t *out, KernelStats *st) {
+    const __m128i vbase = _mm_set1_epi32((int)map->base);
+    const __m256d vmul = _mm256_set1_pd(map->mul), vadd = _mm256_set1_pd(map->add);
+    __m256d vmin = _mm256_set1_pd(__builtin_inf()), vmax = _mm256_set1_pd(-__builtin_inf()), vsum = _mm256_setzero_pd();
+    uint32_t *hist = histogram_of(st);
+    size_t clipped = 0, i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256d a = _mm256_add_pd(_mm256_mul_pd(gather_avx2(map->table, vbase, sig + i), vmul), vadd);
+        __m256d b = _mm256_add_pd(_mm256_mul_pd(gather_avx2(map->table, vbase, sig + i + 4), vmul), vadd);
+        vmin = _mm256_min_pd(b, _mm256_min_pd(a, vmin));
+        vmax = _mm256_max_pd(b, _mm256_max_pd(a, vmax));
+        vsum = _mm256_add_pd(vsum, _mm256_add_pd(a, b));
+        // Valores já saturados em [0, 65535]: packus_epi32 não perde nada
+        __m128i packed = _mm_packus_epi32(quantize_avx2(a, &clipped), quantize_avx2(b, &clipped));
+        _mm_storeu_si128((__m128i *)(out + i), packed);
+        if (hist) histogram_count(hist, sig + i, 8, map->base);
+    }
+    if (st && i > 0)
+        reduce_avx2(st, vmin, vmax, vsum, i);
+    return clipped + map_u16_scalar(map, sig + i, n - i, out + i, st);
+}
+
+AVX2 static void stats_f64_avx2(const double *values, size_t n, KernelStats *st) {
+    __m256d vmin = _mm256_set1_pd(__builtin_inf()), vmax = _mm256_set1_pd(-__builtin_inf()), vsum = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d v = _mm256_loadu_pd(values + i);
+        vmin = _mm256_min_pd(v, vmin);
+        vmax = _mm256_max_pd(v, vmax);
+        vsum = _mm256_add_pd(vsum, v);
+    }
+    if (i > 0)
+        reduce_avx2(st, vmin, vmax, vsum, i);
+    stats_f64_scalar(values + i, n - i, st);
+}
+
+// 32 pixels por máscara; packs_epi16 intercala as metades de 128 bits, reordenadas pelo permute
+AVX2 static inline uint64_t mask32_avx2(const uint16_t *sig, __m256i vlo, __m256i vhi) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i a = _mm256_loadu_si256((const __m256i *)sig), b = _mm256_loadu_si256((const __m256i *)(sig + 16));
+    __m256i out_a = _mm256_or_si256(_mm256_subs_epu16(a, vhi), _mm256_subs_epu16(vlo, a));
+    __m256i out_b = _mm256_or_si256(_mm256_subs_epu16(b, vhi), _mm256_subs_epu16(vlo, b));
+    __m256i in = _mm256_packs_epi16(_mm256_cmpeq_epi16(out_a, zero), _mm256_cmpeq_epi16(out_b, zero));
+    return (uint32_t)_mm256_movemask_epi8(_mm256_permute4x64_epi64(in, 0xd8));
+}
+
+AVX2 static size_t mask_u16_avx2(const uint16_t *sig, size_t n, unsigned lo, unsigned hi, uint64_t *bits) {
+    const __m256i vlo = _mm256_set1_epi16((short)lo), vhi = _mm256_set1_epi16((short)hi);
+    size_t count = 0, i = 0;
+    for (; i + 64 <= n; i += 64) {
+        uint64_t word = mask32_avx2(sig + i, vlo, vhi) | mask32_avx2(sig + i + 32, vlo, vhi) << 32;
+        bits[i / 64] = word;
+        count += (size_t)__builtin_popcountll(word);
+    }
+    return count + mask_u16_scalar(sig + i, n - i, lo, hi, bits + i / 64);
+}
+
+AVX2 static void extremes_f64_avx2(const double *values, size_t n, double *min, double *max) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d v = _mm256_loadu_pd(values + i);
+        _mm256_storeu_pd(min + i, _mm256_min_pd(v, _mm256_loadu_pd(min + i)));
+        _mm256_storeu_pd(max + i, _mm256_max_pd(v, _mm256_loadu_pd(max + i)));
+    }
+    extremes_f64_scalar(values + i, n - i, min + i, max + i);
+}
+
+AVX2 static void welford_f64_avx2(const double *values, size_t n, double inv, double *mean, double *m2) {
+    const __m256d vinv = _mm256_set1_pd(inv);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d v = _mm256_loadu_pd(values + i), m = _mm256_loadu_pd(mean + i);
+        __m256d delta = _mm256_sub_pd(v, m);
+        m = _mm256_add_pd(m, _mm256_mul_pd(delta, vinv));
+        _mm256_storeu_pd(mean + i, m);
+        if (m2)
+            _mm256_storeu_pd(m2 + i,
+                             _mm256_add_pd(_mm256_loadu_pd(m2 + i), _mm256_mul_pd(delta, _mm256_sub_pd(v, m))));
+    }
+    welford_f64_scalar(values + i, n - i, inv, mean + i, m2 ? m2 + i : NULL);
+}
+
+static const KernelTable avx2_table = {
+    "avx2", minmax_u16_avx2, map_f64_avx2, map_u16_avx2, stats_f64_avx2, mask_u16_avx2,
+    extremes_f64_avx2, welford_f64_avx2
+};
+#endif
+
+// ---------------------------------------------------------------------------
+// Despacho: escolhido uma única vez, na primeira chamada
+
+// Variante pelo nome, se existir nesta CPU; NULL senão
+static const KernelTable *named_table(const char *name) {
+    if (strcmp(name, "scalar") == 0) return &scalar_table;
+#if KERNELS_X86
+    if (strcmp(name, "sse2") == 0) return &sse2_table;
+    if (strcmp(name, "avx2") == 0 && __builtin_cpu_supports("avx2")) return &avx2_table;
+#endif
+    return NULL;
+}
+
+static const KernelTable *select_table(void) {
+    const char *forced = getenv("FLIR2JSON_SIMD");
+    const KernelTable *t = forced ? named_table(forced) : NULL;
+    if (t)
+        return t;
+#if KERNELS_X86
+    return __builtin_cpu_supports("avx2") ? &avx2_table : &sse2_table;
+#else
+    return &scalar_table;
+#endif
+}
+
+static const KernelTable *selected;
+
+bool kernel_force(const char *isa) {
+    const KernelTable *t = isa ? named_table(isa) : select_table();
+    if (t)
+        __atomic_store_n(&selected, t, __ATOMIC_RELEASE);
+    return t != NULL;
+}
+
+static const KernelTable *kernels(void) {
+    const KernelTable *t = __atomic_load_n(&selected, __ATOMIC_ACQUIRE);
+    if (!t) {
+        t = select_table();
+        __atomic_store_n(&selected, t, __ATOMIC_RELEASE);
+    }
+    return t;
+}
+
+void kernel_minmax_u16(const uint16_t *sig, size_t n, unsigned *lo, unsigned *hi) {
+    kernels()->minmax_u16(sig, n, lo, hi);
+}
+
+void kernel_map_signal_f64(const SignalMap *map, const uint16_t *sig, size_t n, double *out, KernelStats *st) {
+    kernels()->map_f64(map, sig, n, out, st);
+}
+
+size_t kernel_map_signal_u16(const SignalMap *map, const uint16_t *sig, size_t n, uint16_t *out, KernelStats *st) {
+    return kernels()->map_u16(map, sig, n, out, st);
+}
+
+void kernel_stats_f64(const double *values, size_t n, KernelStats *st) {
+    kernels()->stats_f64(values, n, st);
+}
+
+void kernel_extremes_f64(const double *values, size_t n, double *min, double *max) {
+    kernels()->extremes_f64(values, n, min, max);
+}
+
+void kernel_welford_f64(const double *values, size_t n, uint64_t count, double *mean, double *m2) {
+    kernels()->welford_f64(values, n, 1.0 / (double)count, mean, m2);
+}
+
+size_t kernel_mask_u16(const uint16_t *sig, size_t n, unsigned lo, unsigned hi, uint64_t *bits) {
+    return kernels()->mask_u16(sig, n, lo, hi, bits);
+}
+
+void kernel_census_u16(const uint16_t *sig, size_t n, size_t offset, uint32_t *counts, SignalExtremes *ex) {
+    unsigned lo = ex->lo, hi = ex->hi;
+    size_t lo_at = ex->lo_at, hi_at = ex->hi_at;
+    for (size_t i = 0; i < n; ++i) {
+        unsigned s = sig[i];
+        counts[s]++;
+        if (s < lo) {
+            lo = s;
+            lo_at = offset + i;
+        }
+        if (s > hi) {
+            hi = s;
+            hi_at = offset + i;
+        }
+    }
+    ex->lo = lo;
+    ex->hi = hi;
+    ex->lo_at = lo_at;
+    ex->hi_at = hi_at;
+}
+
+const char *kernel_isa(void) {
+    return kernels()->name;
+}
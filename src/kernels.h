@@ -0,0 +1,77 @@
+#ifndef FLIR2JSON_KERNELS_H
+#define FLIR2JSON_KERNELS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Kernels por pixel com despacho em tempo de execução (AVX2 → SSE2 → escalar).
+// FLIR2JSON_SIMD=avx2|sse2|scalar força uma variante (benchmarks/diagnóstico).
+
+// Estatísticas acumuladas na mesma passada da conversão; iniciar com kernel_stats_init
+typedef struct {
+    double min;
+    double max;
+    double sum;
+    size_t count;
+    uint32_t *histogram; // opcional: contagem por sinal (índice sinal - base), no mesmo laço
+} KernelStats;
+
+// Mapeamento de um pixel: valor = table[sinal - base] * mul + add
+// (mul/add carregam conversão de unidade e, no caminho u16, a escala de ponto fixo)
+typedef struct {
+    const double *table;
+    unsigned base;
+    double mul;
+    double add;
+} SignalMap;
+
+void kernel_stats_init(KernelStats *st, uint32_t *histogram);
+
+// Mínimo e máximo de uma linha de sinais, acumulados em *lo/*hi
+void kernel_minmax_u16(const uint16_t *sig, size_t n, unsigned *lo, unsigned *hi);
+
+// Converte `n` sinais para double, acumulando estatísticas em `st` (pode ser NULL)
+void kernel_map_signal_f64(const SignalMap *map, const uint16_t *sig, size_t n, double *out, KernelStats *st);
+
+// Converte para ponto fixo u16: floor(valor + 0.5) saturado em [0, 65535].
+// As estatísticas ficam no domínio do mapa, antes do arredondamento.
+// Retorna quantos pixels saturaram.
+size_t kernel_map_signal_u16(const SignalMap *map, const uint16_t *sig, size_t n, uint16_t *out, KernelStats *st);
+
+// Estatísticas de temperaturas já calculadas (caminho getValues)
+void kernel_stats_f64(const double *values, size_t n, KernelStats *st);
+
+// Acúmulo por pixel ao longo de quadros (agregados temporais), elemento a elemento:
+// min[i]/max[i] recebem os extremos de values[i]; valores NaN são ignorados
+void kernel_extremes_f64(const double *values, size_t n, double *min, double *max);
+
+// Passo de Welford para o quadro de número `count` (1, 2, ...): atualiza a média e, se
+// `m2` não for NULL, a soma dos quadrados dos desvios (variância = m2 / count)
+void kernel_welford_f64(const double *values, size_t n, uint64_t count, double *mean, double *m2);
+
+// Máscara de uma faixa de sinais: bit i % 64 de bits[i / 64] ligado se lo <= sig[i] <= hi;
+// a última palavra é completada com zeros. Retorna quantos pixels caíram na faixa.
+size_t kernel_mask_u16(const uint16_t *sig, size_t n, unsigned lo, unsigned hi, uint64_t *bits);
+
+// Extremos de sinal com a posição (índice linear) onde aparecem pela primeira vez
+typedef struct {
+    unsigned lo;
+    unsigned hi;
+    size_t lo_at;
+    size_t hi_at;
+} SignalExtremes;
+
+// Contagem por sinal (counts com 65536 posições) e extremos numa única passada;
+// `offset` é o índice linear de sig[0]. Iniciar ex com lo = 0xffff, hi = 0.
+// Escalar em todas as variantes: o incremento do histograma não vetoriza.
+void kernel_census_u16(const uint16_t *sig, size_t n, size_t offset, uint32_t *counts, SignalExtremes *ex);
+
+// Nome da variante selecionada ("avx2", "sse2" ou "scalar")
+const char *kernel_isa(void);
+
+// Troca a variante em uso ("avx2", "sse2", "scalar"; NULL volta à escolha automática).
+// false se a variante não existe nesta CPU. Para benchmarks, sem extrações em andamento.
+bool kernel_force(const char *isa);
+
+#endif
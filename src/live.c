@@ -0,0 +1,597 @@
+// pthread_setaffinity_np e CPU_SET
+#define _GNU_SOURCE
+
+#include "live.h"
+#include "pool.h"
+#include "ring.h"
+
+#include <acs/camera.h>
+#include <acs/identity.h>
+#include <acs/renderer.h>
+#include <acs/stream.h>
+#include <acs/streamer.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define LIVE_SIGNALS 65536
+#define LIVE_PARAMS 8
+
+// Espera máxima de um worker entre verificações de parada
+#define LIVE_POLL_NS (100 * 1000 * 1000L)
+
+// Janela de medição da carga e desequilíbrio (maior / média) que redistribui as câmeras
+#define LIVE_REBALANCE_NS (1000 * 1000 * 1000LL)
+#define LIVE_IMBALANCE 1.5
+
+bool live_drop_parse(const char *s, LiveDropPolicy *policy) {
+    if (strcmp(s, "new") == 0) *policy = LIVE_DROP_NEW;
+    else if (strcmp(s, "latest") == 0) *policy = LIVE_DROP_LATEST;
+    else return false;
+    return true;
+}
+
+// Tabela sinal→°C completa, compartilhada pelo produtor e pelos quadros na fila.
+// O produtor só monta outra quando os parâmetros térmicos mudam.
+typedef struct {
+    atomic_uint refs;
+    double celsius[LIVE_SIGNALS];
+} LiveLut;
+
+typedef struct {
+    uint16_t *pixels; // width * height, linhas contíguas
+    int width;
+    int height;
+    uint64_t seq;
+    LiveLut *lut;
+} LiveSlot;
+
+struct LiveScheduler;
+
+typedef struct {
+    struct LiveScheduler *sched;
+    unsigned index;
+    sem_t ready;     // quadros publicados nas câmeras deste worker
+    pthread_t thread;
+} LiveWorker;
+
+typedef struct {
+    const LiveOptions *opt;
+    struct LiveScheduler *sched;
+    size_t index;
+    LiveCounters *counters;
+    ACS_Camera *camera;
+    ACS_Stream *stream;
+    ACS_ThermalStreamer *streamer;
+
+    SpscRing ring;
+    LiveSlot *slots;
+    // Capacidade de cada slot. O produtor pede (wanted_pixels) pelo primeiro quadro e o
+    // dono aloca e publica, para as páginas ficarem no nó NUMA do núcleo que as lê.
+    atomic_size_t slot_pixels;
+    atomic_size_t wanted_pixels;
+
+    // Papel de consumidor da fila: só quem troca `claimed` de false para true processa,
+    // então a câmera migra entre workers sem quebrar a ordem nem o SPSC
+    atomic_uint owner;
+    atomic_bool claimed;
+    atomic_bool active;             // conectada e ainda não caiu: entra na distribuição
+    atomic_uint_fast64_t busy_ns;   // tempo total em opt->fn
+    uint64_t window_ns;             // busy_ns no início da janela (só a thread de live_run)
+    double cost;                    // custo da última janela, para a distribuição
+
+    // Só a thread do SDK (produtor)
+    LiveLut *lut;
+    double params[LIVE_PARAMS];
+    uint64_t seq;
+
+    atomic_uint_fast64_t received;
+    atomic_uint_fast64_t dropped; // produtor (fila cheia) e consumidores (política latest)
+    atomic_uint_fast64_t stolen;
+    atomic_bool lost;
+} LiveCamera;
+
+typedef struct LiveScheduler {
+    LiveCamera *cams;
+    size_t count;
+    LiveWorker *workers;
+    unsigned worker_count;
+    atomic_bool stopping;
+} LiveScheduler;
+
+static void lut_release(LiveLut *lut) {
+    if (lut && atomic_fetch_sub_explicit(&lut->refs, 1, memory_order_acq_rel) == 1)
+        free(lut);
+}
+
+static void drop_frame(LiveCamera *cam) {
+    atomic_fetch_add_explicit(&cam->dropped, 1, memory_order_relaxed);
+}
+
+// Parâmetros que alteram a conversão sinal→temperatura
+static void thermal_params(ACS_ThermalImage *img, double params[LIVE_PARAMS]) {
+    memset(params, 0, LIVE_PARAMS * sizeof(double));
+    ACS_ThermalParameters *tp = ACS_ThermalImage_getThermalParameters(img);
+    if (!tp)
+        return;
+    params[0] = ACS_ThermalParameters_getObjectDistance(tp);
+    params[1] = ACS_ThermalParameters_getObjectEmissivity(tp);
+    params[2] = thermal_value_in(ACS_ThermalParameters_getObjectReflectedTemperature(tp), UNIT_CELSIUS);
+    params[3] = ACS_ThermalParameters_getRelativeHumidity(tp);
+    params[4] = thermal_value_in(ACS_ThermalParameters_getAtmosphericTemperature(tp), UNIT_CELSIUS);
+    params[5] = ACS_ThermalParameters_getAtmosphericTransmission(tp);
+    params[6] = thermal_value_in(ACS_ThermalParameters_getExternalOpticsTemperature(tp), UNIT_CELSIUS);
+    params[7] = ACS_ThermalParameters_getExternalOpticsTransmission(tp);
+}
+
+// Mantém cam->lut coerente com os parâmetros do quadro; as 65536 consultas ao SDK
+// só acontecem na conexão e quando a câmera muda emissividade, distância etc.
+static bool refresh_lut(LiveCamera *cam, ACS_ThermalImage *img) {
+    double params[LIVE_PARAMS];
+    thermal_params(img, params);
+    if (cam->lut && memcmp(params, cam->params, sizeof(params)) == 0)
+        return true;
+
+    LiveLut *lut = malloc(sizeof(*lut));
+    if (!lut)
+        return false;
+    ExtractOptions celsius = { .engine = ENGINE_SIGNAL, .unit = UNIT_CELSIUS };
+    if (!engine_prepare(img, &celsius)) {
+        free(lut);
+        return false;
+    }
+    for (size_t s = 0; s < LIVE_SIGNALS; ++s)
+        lut->celsius[s] = ACS_ThermalImage_getValueFromSignal(img, (unsigned short)s).value;
+    if (ACS_getLastErrorCode()) {
+        free(lut);
+        return false;
+    }
+    atomic_init(&lut->refs, 1);
+    lut_release(cam->lut);
+    cam->lut = lut;
+    memcpy(cam->params, params, sizeof(params));
+    return true;
+}
+
+// Slots dimensionados pelo primeiro quadro; quadros maiores depois disso são descartados.
+// Roda no worker que detém a câmera: o memset faz a primeira escrita das páginas nele.
+static void alloc_slots(LiveCamera *cam) {
+    size_t pixels = atomic_load_explicit(&cam->wanted_pixels, memory_order_relaxed);
+    if (!pixels || atomic_load_explicit(&cam->slot_pixels, memory_order_relaxed))
+        return;
+    for (size_t i = 0; i < cam->opt->ring; ++i) {
+        if (!(cam->slots[i].pixels = malloc(pixels * sizeof(uint16_t)))) {
+            while (i--) {
+                free(cam->slots[i].pixels);
+                cam->slots[i].pixels = NULL;
+            }
+            return;
+        }
+        memset(cam->slots[i].pixels, 0, pixels * sizeof(uint16_t));
+    }
+    atomic_store_explicit(&cam->slot_pixels, pixels, memory_order_release);
+}
+
+// Acorda o dono; se ele ainda não consumiu o aviso anterior (está ocupado com outra
+// câmera), acorda também o vizinho, que pode roubar o quadro
+static void wake_owner(LiveCamera *cam) {
+    LiveScheduler *s = cam->sched;
+    unsigned owner = atomic_load_explicit(&cam->owner, memory_order_relaxed);
+    int pending = 0;
+    sem_getvalue(&s->workers[owner].ready, &pending);
+    sem_post(&s->workers[owner].ready);
+    if (pending > 0 && s->worker_count > 1)
+        sem_post(&s->workers[(owner + 1) % s->worker_count].ready);
+}
+
+// Roda na thread do SDK: copia o sinal para o próximo slot livre e publica, sem esperar
+static void capture(ACS_ThermalImage *img, void *arg) {
+    LiveCamera *cam = arg;
+    uint64_t seq = cam->seq++;
+    atomic_fetch_add_explicit(&cam->received, 1, memory_order_relaxed);
+
+    size_t index;
+    if (!img || !spsc_reserve(&cam->ring, &index)) {
+        drop_frame(cam);
+        return;
+    }
+    ACS_ImageBuffer *signal = ACS_ThermalImage_getSignalData(img);
+    if (ACS_getLastErrorCode() || !signal || ACS_ImageBuffer_getBytesPerPixel(signal) != 2) {
+        drop_frame(cam);
+        return;
+    }
+    int width = ACS_ImageBuffer_getWidth(signal);
+    int height = ACS_ImageBuffer_getHeight(signal);
+    size_t pixels = (size_t)width * (size_t)height;
+    size_t capacity = atomic_load_explicit(&cam->slot_pixels, memory_order_acquire);
+    if (!capacity && pixels) {
+        // Fila ainda sem slots: pede ao dono e perde este quadro
+        atomic_store_explicit(&cam->wanted_pixels, pixels, memory_order_relaxed);
+        drop_frame(cam);
+        wake_owner(cam);
+        return;
+    }
+    if (!pixels || pixels > capacity || !refresh_lut(cam, img)) {
+        drop_frame(cam);
+        return;
+    }
+
+    LiveSlot *slot = &cam->slots[index];
+    const unsigned char *src = ACS_ImageBuffer_getData(signal);
+    size_t stride = (size_t)ACS_ImageBuffer_getStride(signal);
+    for (int y = 0; y < height; ++y)
+        memcpy(slot->pixels + (size_t)y * width, src + (size_t)y * stride, (size_t)width * sizeof(uint16_t));
+    slot->width = width;
+    slot->height = height;
+    slot->seq = seq;
+    atomic_fetch_add_explicit(&cam->lut->refs, 1, memory_order_relaxed);
+    slot->lut = cam->lut;
+    spsc_publish(&cam->ring);
+    wake_owner(cam);
+}
+
+static void on_image_received(void *arg) {
+    LiveCamera *cam = arg;
+    ACS_Renderer_update(ACS_Streamer_asRenderer(ACS_ThermalStreamer_asStreamer(cam->streamer)));
+    ACS_ThermalStreamer_withThermalImage(cam->streamer, capture, cam);
+}
+
+static void on_stream_error(ACS_Error err, void *arg) {
+    (void)err;
+    LiveCamera *cam = arg;
+    atomic_store(&cam->lost, true);
+}
+
+static void on_disconnected(ACS_Error err, void *arg) {
+    (void)err;
+    LiveCamera *cam = arg;
+    atomic_store(&cam->lost, true);
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Processa até `max` quadros da câmera se nenhum outro worker estiver nela.
+// Retorna quantos saíram da fila (processados ou pulados pela política).
+static size_t drain(LiveCamera *cam, const LiveWorker *w, size_t max) {
+    // Olhada sem a posse, só para não disputar câmeras vazias
+    bool needs_slots = !atomic_load_explicit(&cam->slot_pixels, memory_order_relaxed) &&
+                       atomic_load_explicit(&cam->wanted_pixels, memory_order_relaxed);
+    if (!needs_slots && !spsc_pending(&cam->ring))
+        return 0;
+    if (atomic_exchange_explicit(&cam->claimed, true, memory_order_acquire))
+        return 0;
+    if (needs_slots)
+        alloc_slots(cam);
+
+    const LiveOptions *opt = cam->opt;
+    size_t done = 0, index;
+    uint64_t processed = 0, busy = 0;
+    while (done < max && spsc_peek(&cam->ring, &index)) {
+        if (opt->policy == LIVE_DROP_LATEST) {
+            // Atrasado: descarta o acúmulo e fica só com o quadro mais recente
+            while (spsc_pending(&cam->ring) > 1) {
+                lut_release(cam->slots[index].lut);
+                spsc_release(&cam->ring);
+                drop_frame(cam);
+                spsc_peek(&cam->ring, &index);
+                ++done;
+            }
+        }
+
+        LiveSlot *slot = &cam->slots[index];
+        RawSignal raw = { slot->pixels, (size_t)slot->width * sizeof(uint16_t), slot->width, slot->height,
+                          slot->lut->celsius };
+        uint64_t start = now_ns();
+        if (opt->fn(opt->ctx, cam->index, slot->seq, &raw))
+            cam->counters->processed++;
+        else
+            cam->counters->failed++;
+        busy += now_ns() - start;
+        lut_release(slot->lut);
+        spsc_release(&cam->ring);
+        ++processed;
+        ++done;
+    }
+    atomic_fetch_add_explicit(&cam->busy_ns, busy, memory_order_relaxed);
+    if (processed && atomic_load_explicit(&cam->owner, memory_order_relaxed) != w->index)
+        atomic_fetch_add_explicit(&cam->stolen, processed, memory_order_relaxed);
+    atomic_store_explicit(&cam->claimed, false, memory_order_release);
+    return done;
+}
+
+// i-ésimo núcleo permitido ao processo (com volta), ou -1
+static int worker_cpu(unsigned index) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) != 0 || !CPU_COUNT(&set))
+        return -1;
+    unsigned k = index % (unsigned)CPU_COUNT(&set);
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+        if (CPU_ISSET(cpu, &set) && k-- == 0)
+            return cpu;
+    return -1;
+}
+
+static void *work(void *arg) {
+    LiveWorker *w = arg;
+    LiveScheduler *s = w->sched;
+    int cpu = worker_cpu(w->index);
+    if (cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set); // sem afinidade continua funcionando
+    }
+
+    for (;;) {
+        // `stopping` antes das filas: depois da parada nenhum quadro novo é publicado
+        bool stopping = atomic_load(&s->stopping);
+        size_t done = 0;
+        // Próprias primeiro, com a fila inteira de cada uma enquanto os dados estão quentes
+        for (size_t i = 0; i < s->count; ++i)
+            if (atomic_load_explicit(&s->cams[i].owner, memory_order_relaxed) == w->index)
+                done += drain(&s->cams[i], w, s->cams[i].opt->ring);
+        // Ocioso: rouba um quadro de cada câmera cujo dono está em outra
+        if (!done)
+            for (size_t i = 0; i < s->count; ++i)
+                if (atomic_load_explicit(&s->cams[i].owner, memory_order_relaxed) != w->index)
+                    done += drain(&s->cams[i], w, 1);
+        if (done)
+            continue;
+        if (stopping)
+            break;
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += LIVE_POLL_NS;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        sem_timedwait(&w->ready, &deadline);
+    }
+    return NULL;
+}
+
+static int by_cost(const void *a, const void *b) {
+    const LiveCamera *x = *(const LiveCamera *const *)a, *y = *(const LiveCamera *const *)b;
+    return (x->cost < y->cost) - (x->cost > y->cost);
+}
+
+// Custo de cada câmera ativa na janela que termina agora; as que ainda não
+// processaram nada entram com a média, para contarem na distribuição
+static void measure(LiveScheduler *s, LiveCamera **active, size_t *count) {
+    double total = 0;
+    size_t measured = 0, n = 0;
+    for (size_t i = 0; i < s->count; ++i) {
+        LiveCamera *cam = &s->cams[i];
+        if (!atomic_load(&cam->active))
+            continue;
+        uint64_t busy = atomic_load_explicit(&cam->busy_ns, memory_order_relaxed);
+        cam->cost = (double)(busy - cam->window_ns);
+        cam->window_ns = busy;
+        if (cam->cost > 0) {
+            total += cam->cost;
+            ++measured;
+        }
+        active[n++] = cam;
+    }
+    double fallback = measured ? total / (double)measured : 1;
+    for (size_t i = 0; i < n; ++i)
+        if (active[i]->cost <= 0)
+            active[i]->cost = fallback;
+    *count = n;
+}
+
+// Maior carga de worker sobre a média, com as câmeras onde estão hoje
+static double imbalance(const LiveScheduler *s, LiveCamera *const *active, size_t count, double *loads) {
+    double total = 0, peak = 0;
+    memset(loads, 0, s->worker_count * sizeof(*loads));
+    for (size_t i = 0; i < count; ++i) {
+        loads[atomic_load(&active[i]->owner)] += active[i]->cost;
+        total += active[i]->cost;
+    }
+    for (unsigned w = 0; w < s->worker_count; ++w)
+        if (loads[w] > peak)
+            peak = loads[w];
+    return total > 0 ? peak * s->worker_count / total : 1;
+}
+
+// Maior custo primeiro, sempre para o worker menos carregado (LPT); no empate fica
+// com o dono atual, para não mover câmeras à toa
+static void assign(LiveScheduler *s, LiveCamera **active, size_t count, double *loads) {
+    qsort(active, count, sizeof(*active), by_cost);
+    memset(loads, 0, s->worker_count * sizeof(*loads));
+    for (size_t i = 0; i < count; ++i) {
+        unsigned best = atomic_load(&active[i]->owner);
+        for (unsigned w = 0; w < s->worker_count; ++w)
+            if (loads[w] < loads[best])
+                best = w;
+        loads[best] += active[i]->cost;
+        atomic_store_explicit(&active[i]->owner, best, memory_order_relaxed);
+    }
+}
+
+static bool camera_fail(LiveCamera *cam, const char *what, ACS_Error err) {
+    if (err.code) {
+        ACS_String *msg = ACS_getErrorMessage(err);
+        engine_fail("%s: %s: %s", cam->opt->addresses[cam->index], what, msg ? ACS_String_get(msg) : "?");
+        ACS_String_free(msg);
+    } else {
+        engine_fail("%s: %s", cam->opt->addresses[cam->index], what);
+    }
+    return false;
+}
+
+// Conecta, acha o stream térmico e começa a receber quadros
+static bool camera_start(LiveCamera *cam) {
+    ACS_Identity *identity = ACS_Identity_fromIpAddress(cam->opt->addresses[cam->index]);
+    if (!identity)
+        return camera_fail(cam, "endereço inválido", ACS_getLastError());
+    if (!(cam->camera = ACS_Camera_alloc())) {
+        ACS_Identity_free(identity);
+        return camera_fail(cam, "falha ao alocar a câmera", ACS_getLastError());
+    }
+    ACS_Error err = ACS_Camera_connect(cam->camera, identity, NULL, on_disconnected, cam, NULL);
+    ACS_Identity_free(identity);
+    if (err.code)
+        return camera_fail(cam, "falha ao conectar", err);
+
+    size_t streams = ACS_Camera_getStreamCount(cam->camera);
+    for (size_t i = 0; i < streams && !cam->stream; ++i) {
+        ACS_Stream *stream = ACS_Camera_getStream(cam->camera, i);
+        if (stream && ACS_Stream_isThermal(stream))
+            cam->stream = stream;
+    }
+    if (!cam->stream)
+        return camera_fail(cam, "câmera sem stream térmico", (ACS_Error){ 0 });
+    if (!(cam->streamer = ACS_ThermalStreamer_alloc(cam->stream)))
+        return camera_fail(cam, "falha ao criar o streamer", ACS_getLastError());
+
+    ACS_Stream_start(cam->stream, on_image_received, on_stream_error, (ACS_CallbackContext){ cam, NULL });
+    if (ACS_getLastErrorCode()) {
+        ACS_Error start_err = ACS_getLastError();
+        cam->stream = NULL; // não chegou a transmitir: nada a parar
+        return camera_fail(cam, "falha ao iniciar o stream", start_err);
+    }
+    return true;
+}
+
+// Libera a câmera depois que os streams pararam e os workers terminaram
+static void camera_free(LiveCamera *cam) {
+    if (cam->streamer)
+        ACS_ThermalStreamer_free(cam->streamer);
+    if (cam->camera)
+        ACS_Camera_free(cam->camera);
+    for (size_t i = 0; cam->slots && i < cam->opt->ring; ++i)
+        free(cam->slots[i].pixels);
+    free(cam->slots);
+    lut_release(cam->lut);
+
+    cam->counters->received = atomic_load(&cam->received);
+    cam->counters->dropped = atomic_load(&cam->dropped);
+    cam->counters->stolen = atomic_load(&cam->stolen);
+    cam->counters->worker = atomic_load(&cam->owner);
+    cam->counters->lost = atomic_load(&cam->lost);
+}
+
+bool live_run(const LiveOptions *opt, volatile sig_atomic_t *stop, LiveCounters *counters) {
+    memset(counters, 0, opt->count * sizeof(*counters));
+    unsigned workers = opt->workers ? opt->workers : pool_default_workers();
+    if (workers > opt->count)
+        workers = (unsigned)opt->count;
+    if (workers > POOL_MAX_WORKERS)
+        workers = POOL_MAX_WORKERS;
+    if (!workers)
+        workers = 1;
+
+    LiveScheduler s = { .count = opt->count };
+    atomic_init(&s.stopping, false);
+    s.cams = calloc(opt->count, sizeof(*s.cams));
+    s.workers = calloc(workers, sizeof(*s.workers));
+    LiveCamera **active = calloc(opt->count, sizeof(*active));
+    double *loads = calloc(workers, sizeof(*loads));
+    if (!s.cams || !s.workers || !active || !loads) {
+        free(s.cams);
+        free(s.workers);
+        free(active);
+        free(loads);
+        return engine_fail("sem memória para %zu câmeras", opt->count);
+    }
+    for (size_t i = 0; i < opt->count; ++i) {
+        LiveCamera *cam = &s.cams[i];
+        cam->opt = opt;
+        cam->sched = &s;
+        cam->index = i;
+        cam->counters = &counters[i];
+        spsc_init(&cam->ring, opt->ring);
+    }
+
+    // Workers antes das câmeras: os quadros começam a chegar logo na conexão
+    for (unsigned w = 0; w < workers; ++w) {
+        LiveWorker *worker = &s.workers[w];
+        worker->sched = &s;
+        worker->index = w;
+        sem_init(&worker->ready, 0, 0);
+        if (pthread_create(&worker->thread, NULL, work, worker) != 0) {
+            sem_destroy(&worker->ready);
+            break;
+        }
+        s.worker_count = w + 1;
+    }
+
+    size_t connected = 0, count;
+    for (size_t i = 0; i < opt->count && s.worker_count; ++i) {
+        LiveCamera *cam = &s.cams[i];
+        // Entra na distribuição antes do stream: o primeiro quadro já tem dono
+        atomic_store(&cam->active, true);
+        measure(&s, active, &count);
+        assign(&s, active, count, loads);
+        bool ok = (cam->slots = calloc(opt->ring, sizeof(*cam->slots))) != NULL
+                      ? camera_start(cam)
+                      : engine_fail("%s: sem memória para a fila", opt->addresses[i]);
+        if (ok) {
+            counters[i].connected = true;
+            ++connected;
+        } else {
+            atomic_store(&cam->active, false);
+            snprintf(counters[i].error, sizeof(counters[i].error), "%s", engine_last_error());
+        }
+    }
+
+    // Espera o sinal de parada; as câmeras que caem continuam contadas como perdidas e
+    // saem da distribuição, que também se refaz quando a carga fica desigual
+    struct timespec tick = { 0, LIVE_POLL_NS };
+    uint64_t window = now_ns();
+    while (connected && !*stop) {
+        size_t lost = 0;
+        bool changed = false;
+        for (size_t i = 0; i < opt->count; ++i) {
+            LiveCamera *cam = &s.cams[i];
+            bool down = !counters[i].connected || atomic_load(&cam->lost);
+            lost += down;
+            if (down && atomic_load(&cam->active)) {
+                atomic_store(&cam->active, false);
+                changed = true;
+            }
+        }
+        if (lost == opt->count)
+            break;
+        if (changed || now_ns() - window >= LIVE_REBALANCE_NS) {
+            measure(&s, active, &count);
+            if (changed || imbalance(&s, active, count, loads) > LIVE_IMBALANCE)
+                assign(&s, active, count, loads);
+            window = now_ns();
+        }
+        nanosleep(&tick, NULL);
+    }
+
+    // Sem mais callbacks; os workers esvaziam as filas que sobraram e terminam
+    for (size_t i = 0; i < opt->count; ++i)
+        if (s.cams[i].stream)
+            ACS_Stream_stop(s.cams[i].stream);
+    atomic_store(&s.stopping, true);
+    for (unsigned w = 0; w < s.worker_count; ++w)
+        sem_post(&s.workers[w].ready);
+    for (unsigned w = 0; w < s.worker_count; ++w) {
+        pthread_join(s.workers[w].thread, NULL);
+        sem_destroy(&s.workers[w].ready);
+    }
+    for (size_t i = 0; i < opt->count; ++i)
+        camera_free(&s.cams[i]);
+    free(s.cams);
+    free(s.workers);
+    free(active);
+    free(loads);
+    if (!s.worker_count)
+        return engine_fail("falha ao criar as threads do modo ao vivo");
+    return connected > 0 || engine_fail("nenhuma câmera conectada");
+}
@@ -0,0 +1,68 @@
+#ifndef FLIR2JSON_LIVE_H
+#define FLIR2JSON_LIVE_H
+
+#include <signal.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "engine.h"
+
+// Ingestão ao vivo de câmeras de rede (ACS_Camera + ACS_Stream). O callback do SDK
+// só copia o sinal do quadro para um slot pré-alocado de uma fila SPSC sem trava
+// (ring.h) e acorda o worker dono da câmera. O callback nunca espera: com a fila
+// cheia o quadro é descartado e contado.
+//
+// Os quadros são processados por um conjunto fixo de workers, cada um fixado num
+// núcleo. Cada câmera tem um worker dono, que aloca os slots da fila (a primeira
+// escrita põe as páginas no nó NUMA dele) e esvazia a fila inteira a cada visita.
+// Um worker sem quadros próprios rouba um quadro por vez das câmeras cujo dono está
+// ocupado; uma câmera nunca é processada por dois workers ao mesmo tempo, então a
+// ordem dos quadros se mantém. As câmeras são redistribuídas entre os workers pelo
+// custo medido quando entram, quando caem e quando a carga fica desigual.
+
+// Fila padrão por câmera (quadros, potência de 2)
+#define LIVE_DEFAULT_RING 8
+
+typedef enum {
+    LIVE_DROP_NEW,    // fila cheia: descarta o quadro que chega
+    LIVE_DROP_LATEST  // consumidor atrasado pula direto para o quadro mais recente
+} LiveDropPolicy;
+
+// "new" ou "latest"
+bool live_drop_parse(const char *s, LiveDropPolicy *policy);
+
+// Processa o quadro `seq` (numeração da câmera desde a conexão, inclui os descartados).
+// Chamada por um worker de cada vez para a câmera `camera` (normalmente o dono), em
+// ordem de `seq`; false conta como falha.
+typedef bool (*LiveFrameFn)(void *ctx, size_t camera, uint64_t seq, const RawSignal *raw);
+
+typedef struct {
+    const char *const *addresses; // IPs das câmeras
+    size_t count;
+    size_t ring;                  // slots por câmera, potência de 2
+    LiveDropPolicy policy;
+    LiveFrameFn fn;
+    void *ctx;
+    unsigned workers;             // 0: pool_default_workers(); nunca mais que uma por câmera
+} LiveOptions;
+
+// Contadores por câmera ao fim da execução
+typedef struct {
+    uint64_t received;  // quadros entregues pelo SDK
+    uint64_t processed;
+    uint64_t failed;
+    uint64_t dropped;   // fila cheia, quadro maior que o slot, fila ainda sem slots ou pulado pela política
+    uint64_t stolen;    // quadros processados por um worker que não era o dono
+    unsigned worker;    // dono ao fim da execução
+    bool connected;
+    bool lost;          // desconectada ou erro de stream durante a execução
+    char error[256];    // motivo da falha de conexão
+} LiveCounters;
+
+// Conecta as câmeras e processa os quadros até *stop ficar não nulo (ex.: SIGINT)
+// ou todas as câmeras caírem; então para os streams e esvazia as filas.
+// `counters` tem `count` posições. false só se nenhuma câmera conectar.
+bool live_run(const LiveOptions *opt, volatile sig_atomic_t *stop, LiveCounters *counters);
+
+#endif
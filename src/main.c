@@ -1,6 +1,98 @@
-#include <stdio.h>
-
-int main() {
-    printf("{\"status\":\"ok\",\"message\":\"FLIR container is working!\"}\n");
-    return 0;
-}
+#include "flir2json.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+// flir2json: imagem radiométrica → documento JSON (metadados + matriz por linha),
+// gerado linha a linha pelo buffer de saída, sem montar o documento em memória.
+// Usa só a API pública da libflir2json (flir2json.h).
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Uso: %s <imagem_radiometrica> [saida.json|-] [opções]\n"
+            "  --roi x,y,w,h        converte apenas o retângulo indicado\n"
+            "  --engine signal|values  sinal bruto + LUT (padrão) ou getValues do SDK\n"
+            "  --unit C|K|F         unidade das temperaturas (padrão C)\n",
+            prog);
+}
+
+int main(int argc, char **argv) {
+    const char *input = NULL, *output = "-", *roi = NULL;
+    flir2json_options ext;
+    flir2json_options_init(&ext);
+    int positional = 0;
+    for (int i = 1; i < argc; ++i) {
+        const char *arg = argv[i];
+        if (strncmp(arg, "--", 2) != 0) {
+            if (positional == 0) input = arg;
+            else if (positional == 1) output = arg;
+            else { usage(argv[0]); return 1; }
+            ++positional;
+            continue;
+        }
+        const char *val = i + 1 < argc ? argv[++i] : NULL;
+        bool ok = val != NULL;
+        if (ok && strcmp(arg, "--roi") == 0) roi = val;
+        else if (ok && strcmp(arg, "--unit") == 0) {
+            if (strcmp(val, "C") == 0) ext.unit = FLIR2JSON_UNIT_CELSIUS;
+            else if (strcmp(val, "K") == 0) ext.unit = FLIR2JSON_UNIT_KELVIN;
+            else if (strcmp(val, "F") == 0) ext.unit = FLIR2JSON_UNIT_FAHRENHEIT;
+            else ok = false;
+        } else if (ok && strcmp(arg, "--engine") == 0) {
+            if (strcmp(val, "signal") == 0) ext.engine = FLIR2JSON_ENGINE_SIGNAL;
+            else if (strcmp(val, "values") == 0) ext.engine = FLIR2JSON_ENGINE_VALUES;
+            else ok = false;
+        } else ok = false;
+        if (!ok) {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (!input) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    flir2json_image *img = flir2json_image_new();
+    if (!img || !flir2json_open_file(img, input)) {
+        fprintf(stderr, "ACS error: %s\n", flir2json_last_error());
+        flir2json_image_free(img);
+        return 1;
+    }
+
+    // Conferida antes de criar a saída (a biblioteca confere de novo na extração)
+    int width = flir2json_width(img), height = flir2json_height(img);
+    char tail;
+    if (roi && (sscanf(roi, "%d,%d,%d,%d%c", &ext.roi_x, &ext.roi_y, &ext.roi_width, &ext.roi_height, &tail) != 4 ||
+                ext.roi_x < 0 || ext.roi_y < 0 || ext.roi_width <= 0 || ext.roi_height <= 0 ||
+                ext.roi_x > width - ext.roi_width || ext.roi_y > height - ext.roi_height)) {
+        fprintf(stderr, "ROI inválida (esperado x,y,w,h dentro de %dx%d): %s\n", width, height, roi);
+        flir2json_image_free(img);
+        return 1;
+    }
+
+    bool to_stdout = strcmp(output, "-") == 0;
+    FILE *fp = to_stdout ? stdout : fopen(output, "w");
+    if (!fp) {
+        perror("Erro ao criar arquivo JSON");
+        flir2json_image_free(img);
+        return 1;
+    }
+    flir2json_output out;
+    flir2json_output_init(&out);
+    out.format = FLIR2JSON_FORMAT_JSON;
+    bool ok = flir2json_serialize_file(img, &ext, &out, fp);
+    if (!ok)
+        fprintf(stderr, "%s\n", flir2json_last_error());
+    if ((to_stdout ? fflush(fp) : fclose(fp)) != 0) {
+        perror("Erro ao gravar JSON");
+        ok = false;
+    }
+    flir2json_image_free(img);
+    if (!ok)
+        return 1;
+    if (!to_stdout)
+        fprintf(stderr, "✅ JSON gerado com sucesso: %s\n", output);
+    return 0;
+}
@@ -0,0 +1,243 @@
+#include "measure.h"
+
+#include <acs/measurements.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const struct {
+    const char *name;
+    MeasureKind kind;
+    size_t min_values; // inteiros esperados (polilinha: mínimo, em pares)
+    bool pairs;
+} kinds[] = {
+    { "spot", MEASURE_SPOT, 2, false },
+    { "box", MEASURE_BOX, 4, false },
+    { "ellipse", MEASURE_ELLIPSE, 4, false },
+    { "line", MEASURE_LINE, 4, false },
+    { "polyline", MEASURE_POLYLINE, 4, true },
+};
+
+// `item` é "tipo:n,n,..." sem ';'
+static bool parse_shape(const char *item, size_t len, MeasureShape *shape) {
+    const char *colon = memchr(item, ':', len);
+    size_t k = 0;
+    while (k < sizeof(kinds) / sizeof(kinds[0]) &&
+           !(colon && (size_t)(colon - item) == strlen(kinds[k].name) &&
+             strncmp(item, kinds[k].name, (size_t)(colon - item)) == 0))
+        ++k;
+    if (k == sizeof(kinds) / sizeof(kinds[0]))
+        return engine_fail("medição inválida (spot|box|ellipse|line|polyline): %.*s", (int)len, item);
+
+    int values[MEASURE_MAX_POINTS * 2];
+    size_t n = 0;
+    const char *p = colon + 1, *end = item + len;
+    while (p < end) {
+        char *next;
+        long v = strtol(p, &next, 10);
+        if (next == p || next > end || v < 0 || v > 1 << 20 || n == sizeof(values) / sizeof(values[0]))
+            return engine_fail("coordenadas inválidas na medição: %.*s", (int)len, item);
+        values[n++] = (int)v;
+        p = next;
+        if (p < end && *p++ != ',')
+            return engine_fail("coordenadas inválidas na medição: %.*s", (int)len, item);
+    }
+    if (kinds[k].pairs ? n < kinds[k].min_values || n % 2 : n != kinds[k].min_values)
+        return engine_fail("número de coordenadas inválido na medição: %.*s", (int)len, item);
+
+    memset(shape, 0, sizeof(*shape));
+    shape->kind = kinds[k].kind;
+    shape->npoints = n / 2;
+    for (size_t i = 0; i < shape->npoints; ++i)
+        shape->points[i] = (ACS_Point){ values[2 * i], values[2 * i + 1] };
+    if (shape->kind == MEASURE_POLYLINE) {
+        if (!(shape->list = ACS_ListPoint_create()))
+            return engine_fail("falha ao alocar polilinha: %s", ACS_getLastErrorMessage());
+        ACS_ListPoint_addPoints(shape->list, shape->points, shape->npoints);
+    }
+    return true;
+}
+
+bool measure_parse(const char *spec, MeasureSet *set) {
+    const char *p = spec;
+    for (;;) {
+        size_t len = strcspn(p, ";");
+        if (set->count == MEASURE_MAX_SHAPES)
+            return engine_fail("no máximo %d medições", MEASURE_MAX_SHAPES);
+        if (!set->shapes && !(set->shapes = calloc(MEASURE_MAX_SHAPES, sizeof(*set->shapes))))
+            return engine_fail("sem memória para as medições");
+        if (!parse_shape(p, len, &set->shapes[set->count]))
+            return false;
+        set->count++;
+        if (!p[len])
+            return true;
+        p += len + 1;
+    }
+}
+
+void measure_free(MeasureSet *set) {
+    for (size_t i = 0; i < set->count; ++i)
+        if (set->shapes[i].list)
+            ACS_ListPoint_free(set->shapes[i].list);
+    free(set->shapes);
+    memset(set, 0, sizeof(*set));
+}
+
+// A forma cabe numa imagem width x height
+static bool shape_fits(const MeasureShape *s, int width, int height) {
+    const ACS_Point *p = s->points;
+    switch (s->kind) {
+    case MEASURE_BOX:
+        return p[1].x > 0 && p[1].y > 0 && p[0].x <= width - p[1].x && p[0].y <= height - p[1].y;
+    case MEASURE_ELLIPSE:
+        return p[1].x > 0 && p[1].y > 0 && p[0].x >= p[1].x && p[0].y >= p[1].y &&
+               p[0].x + p[1].x < width && p[0].y + p[1].y < height;
+    default:
+        for (size_t i = 0; i < s->npoints; ++i)
+            if (p[i].x >= width || p[i].y >= height)
+                return false;
+        return true;
+    }
+}
+
+static void write_point(OutBuf *out, ACS_Point p) {
+    out_char(out, '[');
+    out_int(out, p.x);
+    out_char(out, ',');
+    out_int(out, p.y);
+    out_char(out, ']');
+}
+
+static void write_marker(OutBuf *out, const ACS_MeasurementMarker *marker, TempUnit unit) {
+    // A média vem desligada nas formas novas; o SDK só expõe o marcador como const
+    ACS_MeasurementMarker_setAvgCalc((ACS_MeasurementMarker *)marker, true);
+    out_str(out, ",\"min\":");
+    out_json_number(out, thermal_value_in(ACS_MeasurementMarker_getMinValue(marker), unit), 4);
+    out_str(out, ",\"max\":");
+    out_json_number(out, thermal_value_in(ACS_MeasurementMarker_getMaxValue(marker), unit), 4);
+    out_str(out, ",\"avg\":");
+    out_json_number(out, thermal_value_in(ACS_MeasurementMarker_getAvgValue(marker), unit), 4);
+    out_str(out, ",\"min_at\":");
+    write_point(out, ACS_MeasurementMarker_getMinMarkerPosition(marker));
+    out_str(out, ",\"max_at\":");
+    write_point(out, ACS_MeasurementMarker_getMaxMarkerPosition(marker));
+}
+
+// Adiciona a forma, grava o objeto dela e a remove da imagem
+static bool eval_shape(ACS_Measurements *m, const MeasureShape *s, TempUnit unit, OutBuf *out) {
+    const ACS_Point *p = s->points;
+    const ACS_MeasurementMarker *marker = NULL;
+    int id = -1;
+    out_str(out, "{\"type\":\"");
+    out_str(out, kinds[s->kind].name);
+    out_char(out, '"');
+    switch (s->kind) {
+    case MEASURE_SPOT: {
+        ACS_MeasurementSpot *spot = ACS_Measurements_addSpot(m, p[0].x, p[0].y);
+        if (!spot)
+            break;
+        id = ACS_MeasurementShape_getId(ACS_MeasurementSpot_asMeasurementShape(spot));
+        out_str(out, ",\"at\":");
+        write_point(out, p[0]);
+        out_str(out, ",\"value\":");
+        out_json_number(out, thermal_value_in(ACS_MeasurementSpot_getValue(spot), unit), 4);
+        ACS_Measurements_removeSpot(m, id);
+        break;
+    }
+    case MEASURE_BOX: {
+        ACS_MeasurementRectangle *box = ACS_Measurements_addRectangle(m, p[0].x, p[0].y, p[1].x, p[1].y, true, true);
+        if (!box)
+            break;
+        id = ACS_MeasurementShape_getId(ACS_MeasurementRectangle_asMeasurementShape(box));
+        marker = ACS_MeasurementRectangle_asMeasurementMarker(box);
+        out_str(out, ",\"roi\":[");
+        out_int(out, p[0].x);
+        out_char(out, ',');
+        out_int(out, p[0].y);
+        out_char(out, ',');
+        out_int(out, p[1].x);
+        out_char(out, ',');
+        out_int(out, p[1].y);
+        out_char(out, ']');
+        write_marker(out, marker, unit);
+        ACS_Measurements_removeRectangle(m, id);
+        break;
+    }
+    case MEASURE_ELLIPSE: {
+        ACS_MeasurementEllipse *el = ACS_Measurements_addEllipse(m, p[0].x, p[0].y, p[1].x, p[1].y, true, true);
+        if (!el)
+            break;
+        id = ACS_MeasurementShape_getId(ACS_MeasurementEllipse_asMeasurementShape(el));
+        marker = ACS_MeasurementEllipse_asMeasurementMarker(el);
+        out_str(out, ",\"center\":");
+        write_point(out, p[0]);
+        out_str(out, ",\"radius\":");
+        write_point(out, p[1]);
+        write_marker(out, marker, unit);
+        ACS_Measurements_removeEllipse(m, id);
+        break;
+    }
+    case MEASURE_LINE:
+    case MEASURE_POLYLINE: {
+        ACS_MeasurementLine *line = NULL;
+        ACS_MeasurementPolyline *poly = NULL;
+        if (s->kind == MEASURE_LINE) {
+            if (!(line = ACS_Measurements_addLine(m, p[0].x, p[0].y, p[1].x, p[1].y, true, true)))
+                break;
+            id = ACS_MeasurementShape_getId(ACS_MeasurementLine_asMeasurementShape(line));
+            marker = ACS_MeasurementLine_asMeasurementMarker(line);
+        } else {
+            if (!(poly = ACS_Measurements_addPolyline(m, s->list, true, true)))
+                break;
+            id = ACS_MeasurementShape_getId(ACS_MeasurementPolyline_asMeasurementShape(poly));
+            marker = ACS_MeasurementPolyline_asMeasurementMarker(poly);
+        }
+        out_str(out, ",\"points\":[");
+        for (size_t i = 0; i < s->npoints; ++i) {
+            if (i)
+                out_char(out, ',');
+            write_point(out, p[i]);
+        }
+        out_char(out, ']');
+        write_marker(out, marker, unit);
+        if (line)
+            ACS_Measurements_removeLine(m, id);
+        else
+            ACS_Measurements_removePolyline(m, id);
+        break;
+    }
+    }
+    if (id < 0)
+        return engine_fail("falha ao adicionar medição %s: %s", kinds[s->kind].name, ACS_getLastErrorMessage());
+    out_char(out, '}');
+    return true;
+}
+
+bool measure_eval_json(const MeasureSet *set, ACS_ThermalImage *img, TempUnit unit, long index, OutBuf *out) {
+    int width = ACS_ThermalImage_getWidth(img);
+    int height = ACS_ThermalImage_getHeight(img);
+    for (size_t i = 0; i < set->count; ++i)
+        if (!shape_fits(&set->shapes[i], width, height))
+            return engine_fail("medição %zu (%s) fora da imagem %dx%d", i + 1, kinds[set->shapes[i].kind].name,
+                               width, height);
+    ACS_Measurements *m = ACS_ThermalImage_getMeasurements(img);
+    if (!m)
+        return engine_fail("imagem sem suporte a medições: %s", ACS_getLastErrorMessage());
+
+    out_char(out, '{');
+    if (index >= 0) {
+        out_str(out, "\"frame\":");
+        out_int(out, index);
+        out_char(out, ',');
+    }
+    out_str(out, "\"unit\":\"");
+    out_str(out, unit_symbol(unit));
+    out_str(out, "\",\"measurements\":[");
+    for (size_t i = 0; i < set->count; ++i) {
+        if (i)
+            out_char(out, ',');
+        if (!eval_shape(m, &set->shapes[i], unit, out))
+            return false;
+    }
+    out_str(out, "]}\n");
+    return !out->failed || engine_fail("sem memória ao serializar as medições");
+}
@@ -0,0 +1,56 @@
+#ifndef FLIR2JSON_MEASURE_H
+#define FLIR2JSON_MEASURE_H
+
+#include <acs/thermal_image.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "engine.h"
+#include "output.h"
+
+// Medições do SDK (ACS_Measurements) avaliadas no lugar da matriz: só os valores de
+// cada forma vão para a saída. As formas são interpretadas uma vez (MeasureSet) e
+// reaplicadas em cada imagem do lote ou quadro da sequência.
+//
+// Especificação: formas separadas por ';', coordenadas em pixels da imagem
+//   spot:x,y                 valor no ponto
+//   box:x,y,w,h              retângulo
+//   ellipse:x,y,rx,ry        centro e raios
+//   line:x1,y1,x2,y2
+//   polyline:x1,y1,x2,y2,... pelo menos 2 pontos
+// Áreas e linhas trazem min/max/média e as posições do mínimo e do máximo.
+
+// Máximo de formas por conjunto e de vértices por polilinha
+#define MEASURE_MAX_SHAPES 64
+#define MEASURE_MAX_POINTS 64
+
+typedef enum {
+    MEASURE_SPOT,
+    MEASURE_BOX,
+    MEASURE_ELLIPSE,
+    MEASURE_LINE,
+    MEASURE_POLYLINE
+} MeasureKind;
+
+typedef struct {
+    MeasureKind kind;
+    ACS_Point points[MEASURE_MAX_POINTS]; // spot: 1; box/ellipse: posição + (w,h)/(rx,ry); linhas: vértices
+    size_t npoints;
+    ACS_ListPoint *list;                  // polilinha: vértices já no formato do SDK, só lidos
+} MeasureShape;
+
+typedef struct {
+    MeasureShape *shapes;
+    size_t count;
+} MeasureSet;
+
+// Acrescenta as formas de `spec` ao conjunto (zerado na primeira chamada)
+bool measure_parse(const char *spec, MeasureSet *set);
+void measure_free(MeasureSet *set);
+
+// Aplica as formas à imagem já preparada (engine_prepare) e grava uma linha JSON
+// {"frame":N,"unit":...,"measurements":[...]}; `index` < 0 omite "frame". As formas
+// são removidas da imagem depois da leitura.
+bool measure_eval_json(const MeasureSet *set, ACS_ThermalImage *img, TempUnit unit, long index, OutBuf *out);
+
+#endif
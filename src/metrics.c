@@ -0,0 +1,258 @@
+#include "metrics.h"
+
+#include <string.h>
+#include <time.h>
+
+static const char *const stage_names[STAGE_COUNT] = {
+    [STAGE_UPLOAD] = "upload",
+    [STAGE_DECODE] = "decode",
+    [STAGE_EXTRACT] = "extract",
+    [STAGE_SERIALIZE] = "serialize",
+    [STAGE_SEND] = "send",
+};
+
+static const uint64_t bucket_ns[METRICS_BUCKETS] = {
+    250000, 500000, 1000000, 2500000, 5000000, 10000000, 25000000,
+    50000000, 100000000, 250000000, 500000000, 1000000000, 2500000000, 10000000000,
+};
+
+static const char *const bucket_labels[METRICS_BUCKETS] = {
+    "0.00025", "0.0005", "0.001", "0.0025", "0.005", "0.01", "0.025",
+    "0.05", "0.1", "0.25", "0.5", "1", "2.5", "10",
+};
+
+// Um bloco por thread, alinhado à linha de cache para as threads não disputarem linhas
+typedef struct {
+    _Alignas(64) atomic_uint_fast64_t buckets[STAGE_COUNT][METRICS_BUCKETS + 1];
+    atomic_uint_fast64_t sum_ns[STAGE_COUNT];
+    atomic_uint_fast64_t started;
+    atomic_uint_fast64_t completed;
+    atomic_uint_fast64_t responses[6]; // por classe: status / 100
+    atomic_uint_fast64_t bytes_out;
+    atomic_uint_fast64_t busy_ns;
+} MetricsShard;
+
+static MetricsShard shards[METRICS_MAX_SHARDS];
+static atomic_uint shard_count;
+static __thread MetricsShard *own;
+static uint64_t started_at;
+
+uint64_t metrics_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+void metrics_init(void) {
+    started_at = metrics_now();
+}
+
+static MetricsShard *shard(void) {
+    if (!own) {
+        unsigned i = atomic_fetch_add_explicit(&shard_count, 1, memory_order_relaxed);
+        own = &shards[i < METRICS_MAX_SHARDS ? i : METRICS_MAX_SHARDS - 1];
+    }
+    return own;
+}
+
+// Só a thread dona escreve no bloco: load + store relaxados bastam. O último bloco
+// pode ter várias threads (excedentes) e aí precisa da soma atômica
+static inline void bump(MetricsShard *s, atomic_uint_fast64_t *c, uint64_t v) {
+    if (s != &shards[METRICS_MAX_SHARDS - 1])
+        atomic_store_explicit(c, atomic_load_explicit(c, memory_order_relaxed) + v, memory_order_relaxed);
+    else
+        atomic_fetch_add_explicit(c, v, memory_order_relaxed);
+}
+
+void metrics_observe(MetricsStage stage, uint64_t ns) {
+    MetricsShard *s = shard();
+    size_t b = 0;
+    while (b < METRICS_BUCKETS && ns > bucket_ns[b])
+        ++b;
+    bump(s, &s->buckets[stage][b], 1);
+    bump(s, &s->sum_ns[stage], ns);
+}
+
+void metrics_request_started(void) {
+    MetricsShard *s = shard();
+    bump(s, &s->started, 1);
+}
+
+void metrics_request_completed(void) {
+    MetricsShard *s = shard();
+    bump(s, &s->completed, 1);
+}
+
+void metrics_response(unsigned status) {
+    MetricsShard *s = shard();
+    bump(s, &s->responses[status / 100 < 6 ? status / 100 : 0], 1);
+}
+
+void metrics_bytes_out(uint64_t bytes) {
+    MetricsShard *s = shard();
+    bump(s, &s->bytes_out, bytes);
+}
+
+void metrics_busy(uint64_t ns) {
+    MetricsShard *s = shard();
+    bump(s, &s->busy_ns, ns);
+}
+
+static uint64_t load(const atomic_uint_fast64_t *c) {
+    return atomic_load_explicit(c, memory_order_relaxed);
+}
+
+// Soma dos blocos no momento do scrape
+typedef struct {
+    uint64_t buckets[STAGE_COUNT][METRICS_BUCKETS + 1];
+    uint64_t sum_ns[STAGE_COUNT];
+    uint64_t started;
+    uint64_t completed;
+    uint64_t responses[6];
+    uint64_t bytes_out;
+} Totals;
+
+static void sum_shards(size_t n, Totals *t) {
+    memset(t, 0, sizeof(*t));
+    for (size_t i = 0; i < n; ++i) {
+        const MetricsShard *s = &shards[i];
+        for (int st = 0; st < STAGE_COUNT; ++st) {
+            for (size_t b = 0; b <= METRICS_BUCKETS; ++b)
+                t->buckets[st][b] += load(&s->buckets[st][b]);
+            t->sum_ns[st] += load(&s->sum_ns[st]);
+        }
+        t->started += load(&s->started);
+        t->completed += load(&s->completed);
+        for (int c = 0; c < 6; ++c)
+            t->responses[c] += load(&s->responses[c]);
+        t->bytes_out += load(&s->bytes_out);
+    }
+}
+
+static void write_metric(OutBuf *out, const char *name, const char *type, const char *help) {
+    out_str(out, "# HELP ");
+    out_str(out, name);
+    out_char(out, ' ');
+    out_str(out, help);
+    out_str(out, "\n# TYPE ");
+    out_str(out, name);
+    out_char(out, ' ');
+    out_str(out, type);
+    out_char(out, '\n');
+}
+
+static void write_value(OutBuf *out, const char *name, uint64_t v) {
+    out_str(out, name);
+    out_char(out, ' ');
+    out_uint(out, v);
+    out_char(out, '\n');
+}
+
+static void write_real(OutBuf *out, const char *name, double v) {
+    out_str(out, name);
+    out_char(out, ' ');
+    out_fixed(out, v, 6);
+    out_char(out, '\n');
+}
+
+void metrics_render(OutBuf *out, const MetricsExtra *extra) {
+    unsigned registered = atomic_load_explicit(&shard_count, memory_order_relaxed);
+    size_t n = registered < METRICS_MAX_SHARDS ? registered : METRICS_MAX_SHARDS;
+    Totals t;
+    sum_shards(n, &t);
+
+    write_metric(out, "flir2json_stage_seconds", "histogram", "Latency of each POST /extract stage.");
+    for (int st = 0; st < STAGE_COUNT; ++st) {
+        uint64_t cumulative = 0;
+        for (size_t b = 0; b <= METRICS_BUCKETS; ++b) {
+            cumulative += t.buckets[st][b];
+            out_str(out, "flir2json_stage_seconds_bucket{stage=\"");
+            out_str(out, stage_names[st]);
+            out_str(out, "\",le=\"");
+            out_str(out, b < METRICS_BUCKETS ? bucket_labels[b] : "+Inf");
+            out_str(out, "\"} ");
+            out_uint(out, cumulative);
+            out_char(out, '\n');
+        }
+        out_str(out, "flir2json_stage_seconds_sum{stage=\"");
+        out_str(out, stage_names[st]);
+        out_str(out, "\"} ");
+        out_fixed(out, (double)t.sum_ns[st] / 1e9, 6);
+        out_str(out, "\nflir2json_stage_seconds_count{stage=\"");
+        out_str(out, stage_names[st]);
+        out_str(out, "\"} ");
+        out_uint(out, cumulative);
+        out_char(out, '\n');
+    }
+
+    write_metric(out, "flir2json_extract_requests_total", "counter", "POST /extract requests received.");
+    write_value(out, "flir2json_extract_requests_total", t.started);
+    // As duas somas não são lidas no mesmo instante: o gauge nunca fica negativo
+    write_metric(out, "flir2json_extract_in_flight", "gauge",
+                 "POST /extract requests being received, processed or sent.");
+    write_value(out, "flir2json_extract_in_flight", t.started > t.completed ? t.started - t.completed : 0);
+
+    write_metric(out, "flir2json_responses_total", "counter", "Responses queued, by status class.");
+    for (int c = 1; c < 6; ++c) {
+        out_str(out, "flir2json_responses_total{code=\"");
+        out_char(out, (char)('0' + c));
+        out_str(out, "xx\"} ");
+        out_uint(out, t.responses[c]);
+        out_char(out, '\n');
+    }
+    write_metric(out, "flir2json_bytes_out_total", "counter", "Response body bytes handed to the HTTP layer.");
+    write_value(out, "flir2json_bytes_out_total", t.bytes_out);
+
+    double uptime = (double)(metrics_now() - started_at) / 1e9;
+    write_metric(out, "flir2json_workers", "gauge", "HTTP worker threads.");
+    write_value(out, "flir2json_workers", extra->workers);
+    write_metric(out, "flir2json_worker_busy_seconds_total", "counter",
+                 "Time spent inside request handlers, per thread.");
+    uint64_t busy = 0;
+    for (size_t i = 0; i < n; ++i) {
+        uint64_t ns = load(&shards[i].busy_ns);
+        busy += ns;
+        out_str(out, "flir2json_worker_busy_seconds_total{thread=\"");
+        out_uint(out, i);
+        out_str(out, "\"} ");
+        out_fixed(out, (double)ns / 1e9, 6);
+        out_char(out, '\n');
+    }
+    write_metric(out, "flir2json_worker_utilization", "gauge", "Busy fraction of the worker pool since start.");
+    write_real(out, "flir2json_worker_utilization",
+               extra->workers && uptime > 0 ? (double)busy / 1e9 / (uptime * extra->workers) : 0.0);
+
+    write_metric(out, "flir2json_cache_requests_total", "counter", "Result cache lookups, by outcome.");
+    out_str(out, "flir2json_cache_requests_total{result=\"hit\"} ");
+    out_uint(out, extra->cache_hits);
+    out_str(out, "\nflir2json_cache_requests_total{result=\"disk_hit\"} ");
+    out_uint(out, extra->cache_disk_hits);
+    out_str(out, "\nflir2json_cache_requests_total{result=\"miss\"} ");
+    out_uint(out, extra->cache_misses);
+    out_char(out, '\n');
+    uint64_t lookups = extra->cache_hits + extra->cache_disk_hits + extra->cache_misses;
+    write_metric(out, "flir2json_cache_hit_ratio", "gauge", "Share of cache lookups served from memory or disk.");
+    write_real(out, "flir2json_cache_hit_ratio",
+               lookups ? (double)(extra->cache_hits + extra->cache_disk_hits) / (double)lookups : 0.0);
+    write_metric(out, "flir2json_cache_bytes", "gauge", "Bytes of responses held in memory by the cache.");
+    write_value(out, "flir2json_cache_bytes", extra->cache_bytes);
+    write_metric(out, "flir2json_cache_capacity_bytes", "gauge", "Memory budget of the cache.");
+    write_value(out, "flir2json_cache_capacity_bytes", extra->cache_capacity);
+
+    write_metric(out, "flir2json_admission_pending", "gauge",
+                 "Requests with a body admitted and not yet completed.");
+    write_value(out, "flir2json_admission_pending", extra->admission_pending);
+    write_metric(out, "flir2json_admission_limit", "gauge", "Admission limits (0: unlimited).");
+    out_str(out, "flir2json_admission_limit{scope=\"server\"} ");
+    out_uint(out, extra->admission_depth);
+    out_str(out, "\nflir2json_admission_limit{scope=\"client\"} ");
+    out_uint(out, extra->admission_per_client);
+    out_char(out, '\n');
+    write_metric(out, "flir2json_admission_rejected_total", "counter",
+                 "Requests rejected before reading the body, by reason.");
+    out_str(out, "flir2json_admission_rejected_total{reason=\"full\"} ");
+    out_uint(out, extra->rejected_full);
+    out_str(out, "\nflir2json_admission_rejected_total{reason=\"client\"} ");
+    out_uint(out, extra->rejected_client);
+    out_char(out, '\n');
+}
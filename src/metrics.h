@@ -0,0 +1,61 @@
+#ifndef FLIR2JSON_METRICS_H
+#define FLIR2JSON_METRICS_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "output.h"
+
+// Métricas do servidor no formato texto do Prometheus (GET /metrics).
+// Cada thread grava só no seu próprio bloco de contadores (sem trava nem instrução
+// atômica de leitura-modificação-escrita); o scrape soma os blocos de todas as threads.
+
+typedef enum {
+    STAGE_UPLOAD,    // primeira chamada do MHD até o último pedaço do corpo
+    STAGE_DECODE,    // ACS_ThermalImage_openFromMemory
+    STAGE_EXTRACT,   // engine_extract / medições
+    STAGE_SERIALIZE, // codificação da resposta
+    STAGE_SEND,      // resposta enfileirada até o fim do envio
+    STAGE_COUNT
+} MetricsStage;
+
+// Limites superiores dos baldes dos histogramas, em segundos (+Inf implícito)
+#define METRICS_BUCKETS 14
+
+// Blocos de contadores; threads além disso dividem o último, com soma atômica
+#define METRICS_MAX_SHARDS 272
+
+// Marca o início do processo (base da utilização dos workers)
+void metrics_init(void);
+
+// Relógio monotônico em nanossegundos
+uint64_t metrics_now(void);
+
+void metrics_observe(MetricsStage stage, uint64_t ns);
+void metrics_request_started(void);
+void metrics_request_completed(void);
+void metrics_response(unsigned status);
+void metrics_bytes_out(uint64_t bytes);
+// Tempo da thread dentro dos handlers do MHD, para a utilização dos workers
+void metrics_busy(uint64_t ns);
+
+// Valores lidos de fora do módulo no momento do scrape
+typedef struct {
+    unsigned workers;
+    uint64_t cache_hits;
+    uint64_t cache_disk_hits;
+    uint64_t cache_misses;
+    size_t cache_bytes;
+    size_t cache_capacity;
+    unsigned admission_pending;    // vagas ocupadas (admission.h)
+    unsigned admission_depth;      // 0: sem limite
+    unsigned admission_per_client; // 0: sem limite
+    uint64_t rejected_full;        // 503 com a fila cheia
+    uint64_t rejected_client;      // 429 com o cliente no limite
+} MetricsExtra;
+
+void metrics_render(OutBuf *out, const MetricsExtra *extra);
+
+#endif
@@ -0,0 +1,300 @@
+#include "output.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+
+// Pares de dígitos "00".."99": converte dois dígitos por divisão
+static const char digit_pairs[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+static const uint64_t pow10_table[10] = {
+    1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull,
+    1000000ull, 10000000ull, 100000000ull, 1000000000ull
+};
+
+static bool file_sink(void *ctx, const char *data, size_t len) {
+    return fwrite(data, 1, len, (FILE *)ctx) == len;
+}
+
+void out_init_file(OutBuf *ob, FILE *fp, size_t capacity) {
+    memset(ob, 0, sizeof(*ob));
+    ob->capacity = capacity ? capacity : OUT_DEFAULT_CAPACITY;
+    ob->data = malloc(ob->capacity);
+    ob->sink = file_sink;
+    ob->sink_ctx = fp;
+    ob->failed = ob->data == NULL;
+    if (ob->failed) ob->capacity = 0;
+}
+
+void out_init_memory(OutBuf *ob, size_t initial_capacity) {
+    memset(ob, 0, sizeof(*ob));
+    ob->capacity = initial_capacity ? initial_capacity : OUT_DEFAULT_CAPACITY;
+    ob->data = malloc(ob->capacity);
+    ob->failed = ob->data == NULL;
+    if (ob->failed) ob->capacity = 0;
+}
+
+void out_init_buffer(OutBuf *ob, char *data, size_t capacity) {
+    memset(ob, 0, sizeof(*ob));
+    ob->data = data;
+    ob->capacity = capacity;
+}
+
+void out_free(OutBuf *ob) {
+    free(ob->data);
+    memset(ob, 0, sizeof(*ob));
+}
+
+bool out_flush(OutBuf *ob) {
+    if (!ob->sink || ob->len == 0 || ob->failed)
+        return !ob->failed;
+    if (!ob->sink(ob->sink_ctx, ob->data, ob->len))
+        ob->failed = true;
+    ob->len = 0;
+    return !ob->failed;
+}
+
+bool out_reserve(OutBuf *ob, size_t n) {
+    if (ob->failed)
+        return false;
+    if (ob->capacity - ob->len >= n)
+        return true;
+
+    if (ob->sink) {
+        if (!out_flush(ob))
+            return false;
+        if (ob->capacity >= n)
+            return true;
+    }
+
+    size_t cap = ob->capacity ? ob->capacity : OUT_DEFAULT_CAPACITY;
+    while (cap - ob->len < n)
+        cap *= 2;
+    char *grown = realloc(ob->data, cap);
+    if (!grown) {
+        ob->failed = true;
+        return false;
+    }
+    ob->data = grown;
+    ob->capacity = cap;
+    return true;
+}
+
+void out_write(OutBuf *ob, const void *data, size_t len) {
+    // Blocos maiores que o buffer vão direto ao sink, sem cópia intermediária
+    if (ob->sink && len >= ob->capacity) {
+        if (out_flush(ob) && !ob->sink(ob->sink_ctx, data, len))
+            ob->failed = true;
+        return;
+    }
+    if (!out_reserve(ob, len))
+        return;
+    memcpy(ob->data + ob->len, data, len);
+    ob->len += len;
+}
+
+// Vetores por chamada de writev (bem abaixo de IOV_MAX)
+#define OUT_IOV_BATCH 64
+
+bool out_write_buffers(OutBuf *ob, const OutBuf *bufs, size_t count) {
+    if (ob->sink != file_sink) {
+        for (size_t i = 0; i < count; ++i)
+            out_write(ob, bufs[i].data, bufs[i].len);
+        return !ob->failed;
+    }
+    FILE *fp = ob->sink_ctx;
+    if (!out_flush(ob) || fflush(fp) != 0) {
+        ob->failed = true;
+        return false;
+    }
+    // `i`/`done`: primeiro buffer com bytes pendentes e quanto dele já foi gravado
+    size_t i = 0, done = 0;
+    while (i < count) {
+        struct iovec iov[OUT_IOV_BATCH];
+        int n = 0;
+        for (size_t k = i, skip = done; k < count && n < OUT_IOV_BATCH; ++k, skip = 0)
+            if (bufs[k].len > skip)
+                iov[n++] = (struct iovec){ bufs[k].data + skip, bufs[k].len - skip };
+        if (!n)
+            break;
+        ssize_t written = writev(fileno(fp), iov, n);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            ob->failed = true;
+            return false;
+        }
+        size_t left = (size_t)written;
+        while (i < count && left >= bufs[i].len - done) {
+            left -= bufs[i].len - done;
+            done = 0;
+            ++i;
+        }
+        done += left;
+    }
+    return true;
+}
+
+void out_str(OutBuf *ob, const char *s) {
+    out_write(ob, s, strlen(s));
+}
+
+// Escreve os dígitos de `v` a partir do fim de `end`; retorna o início
+static char *format_digits(char *end, uint64_t v) {
+    while (v >= 100) {
+        unsigned pair = (unsigned)(v % 100) * 2;
+        v /= 100;
+        *--end = digit_pairs[pair + 1];
+        *--end = digit_pairs[pair];
+    }
+    if (v >= 10) {
+        *--end = digit_pairs[v * 2 + 1];
+        *--end = digit_pairs[v * 2];
+    } else {
+        *--end = (char)('0' + v);
+    }
+    return end;
+}
+
+void out_uint(OutBuf *ob, uint64_t v) {
+    if (!out_reserve(ob, OUT_NUMBER_MAX))
+        return;
+    char tmp[OUT_NUMBER_MAX];
+    char *start = format_digits(tmp + sizeof(tmp), v);
+    size_t n = (size_t)(tmp + sizeof(tmp) - start);
+    memcpy(ob->data + ob->len, start, n);
+    ob->len += n;
+}
+
+void out_int(OutBuf *ob, int64_t v) {
+    if (v < 0) {
+        out_char(ob, '-');
+        out_uint(ob, (uint64_t)0 - (uint64_t)v);
+    } else {
+        out_uint(ob, (uint64_t)v);
+    }
+}
+
+// Maior campo de out_fixed_row: sinal, 15 dígitos inteiros, ponto, 3 casas e o separador
+#define ROW_FIELD_MAX 24
+
+// Grava `v` com `decimals` casas em `p`, sem reservar. Sempre inlinado: em fixed_row, com
+// `decimals` constante, a parte fracionária vira uma sequência fixa de pares de dígitos
+static inline __attribute__((always_inline)) char *put_fixed(char *p, double v, const int decimals) {
+    // Fora da faixa representável em inteiro escalado: NaN/inf não são números CSV/JSON válidos
+    if (!(v > -1e15 && v < 1e15)) {
+        memcpy(p, "nan", 3);
+        return p + 3;
+    }
+    // Escala para inteiro (ex.: centi-graus) e arredonda meio para longe do zero. Abaixo
+    // de 1e15, |v| * 10^casas só passa de 2^63 com 4+ casas: aí saem as casas que cabem
+    // (com casas constantes até 3, o laço some)
+    bool negative = v < 0;
+    double magnitude = negative ? -v : v;
+    int places = decimals;
+    while (places > 3 && magnitude * (double)pow10_table[places] >= 0x1p63)
+        --places;
+    const uint64_t scale = pow10_table[places];
+    uint64_t scaled = (uint64_t)(magnitude * (double)scale + 0.5);
+    char tmp[OUT_NUMBER_MAX];
+    char *end = tmp + sizeof(tmp);
+    char *q = end;
+    if (places > 0) {
+        uint64_t frac = scaled % scale;
+        int left = places;
+        for (; left >= 2; left -= 2) {
+            unsigned pair = (unsigned)(frac % 100) * 2;
+            frac /= 100;
+            *--q = digit_pairs[pair + 1];
+            *--q = digit_pairs[pair];
+        }
+        if (left)
+            *--q = (char)('0' + frac);
+        *--q = '.';
+    }
+    q = format_digits(q, scaled / scale);
+    if (negative && scaled != 0)
+        *--q = '-';
+    size_t n = (size_t)(end - q);
+    memcpy(p, q, n);
+    return p + n;
+}
+
+void out_fixed(OutBuf *ob, double v, int decimals) {
+    if (decimals < 0) decimals = 0;
+    if (decimals > 9) decimals = 9;
+    if (!out_reserve(ob, OUT_NUMBER_MAX))
+        return;
+    ob->len = (size_t)(put_fixed(ob->data + ob->len, v, decimals) - ob->data);
+}
+
+// Uma linha inteira com um só out_reserve; o separador é só um byte gravado, sem desvio
+static inline __attribute__((always_inline)) void fixed_row(OutBuf *ob, const double *v, size_t n, char delimiter,
+                                                            const int decimals) {
+    if (!n || !out_reserve(ob, n * ROW_FIELD_MAX))
+        return;
+    char *p = ob->data + ob->len;
+    for (size_t i = 0; i < n; ++i) {
+        p = put_fixed(p, v[i], decimals);
+        *p++ = delimiter;
+    }
+    p[-1] = '\n';
+    ob->len = (size_t)(p - ob->data);
+}
+
+static void fixed_row_0(OutBuf *ob, const double *v, size_t n, char delimiter) {
+    fixed_row(ob, v, n, delimiter, 0);
+}
+
+static void fixed_row_1(OutBuf *ob, const double *v, size_t n, char delimiter) {
+    fixed_row(ob, v, n, delimiter, 1);
+}
+
+static void fixed_row_2(OutBuf *ob, const double *v, size_t n, char delimiter) {
+    fixed_row(ob, v, n, delimiter, 2);
+}
+
+static void fixed_row_3(OutBuf *ob, const double *v, size_t n, char delimiter) {
+    fixed_row(ob, v, n, delimiter, 3);
+}
+
+static void (*const fixed_rows[OUT_ROW_MAX_DECIMALS + 1])(OutBuf *, const double *, size_t, char) = {
+    fixed_row_0, fixed_row_1, fixed_row_2, fixed_row_3,
+};
+
+void out_fixed_row(OutBuf *ob, const double *v, size_t n, int decimals, char delimiter) {
+    if (decimals < 0) decimals = 0;
+    if (decimals > OUT_ROW_MAX_DECIMALS) decimals = OUT_ROW_MAX_DECIMALS;
+    fixed_rows[decimals](ob, v, n, delimiter);
+}
+
+void out_json_number(OutBuf *ob, double v, int decimals) {
+    if (v > -1e15 && v < 1e15)
+        out_fixed(ob, v, decimals);
+    else
+        out_write(ob, "null", 4);
+}
+
+void out_json_string(OutBuf *ob, const char *s) {
+    static const char hex[] = "0123456789abcdef";
+    out_char(ob, '"');
+    for (const unsigned char *p = (const unsigned char *)s; *p; ++p) {
+        unsigned char c = *p;
+        if (c == '"' || c == '\\') {
+            out_char(ob, '\\');
+            out_char(ob, (char)c);
+        } else if (c == '\n') {
+            out_write(ob, "\\n", 2);
+        } else if (c < 0x20) {
+            char esc[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xf] };
+            out_write(ob, esc, sizeof(esc));
+        } else {
+            out_char(ob, (char)c);
+        }
+    }
+    out_char(ob, '"');
+}
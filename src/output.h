@@ -0,0 +1,74 @@
+#ifndef FLIR2JSON_OUTPUT_H
+#define FLIR2JSON_OUTPUT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Tamanho padrão do buffer de saída: descarrega em blocos de 1 MiB
+#define OUT_DEFAULT_CAPACITY (1u << 20)
+
+// Maior número de caracteres gerado por uma única formatação numérica
+#define OUT_NUMBER_MAX 32
+
+// Destino dos dados descarregados; retorna false em erro de escrita
+typedef bool (*OutSink)(void *ctx, const char *data, size_t len);
+
+// Buffer de saída em espaço de usuário.
+// Com sink: acumula até `capacity` e descarrega em blocos grandes.
+// Sem sink: cresce sob demanda e guarda o documento inteiro em memória.
+typedef struct {
+    char *data;
+    size_t len;
+    size_t capacity;
+    OutSink sink;
+    void *sink_ctx;
+    bool failed;
+} OutBuf;
+
+void out_init_file(OutBuf *ob, FILE *fp, size_t capacity);
+void out_init_memory(OutBuf *ob, size_t initial_capacity);
+// Modo memória sobre um buffer já alocado com malloc (ex.: bloco de arena.h); ao
+// crescer, `data` e `capacity` mudam e o chamador os recupera do OutBuf
+void out_init_buffer(OutBuf *ob, char *data, size_t capacity);
+void out_free(OutBuf *ob);
+
+// Envia o conteúdo pendente ao sink (no modo memória não faz nada)
+bool out_flush(OutBuf *ob);
+
+// Garante espaço contíguo para `n` bytes, descarregando ou crescendo o buffer
+bool out_reserve(OutBuf *ob, size_t n);
+
+void out_write(OutBuf *ob, const void *data, size_t len);
+
+// Acrescenta o conteúdo (data/len) de cada buffer, em ordem. Com arquivo (out_init_file),
+// descarrega o pendente e grava todos com writev direto no descritor, sem cópia;
+// nos demais modos, equivale a out_write de cada um
+bool out_write_buffers(OutBuf *ob, const OutBuf *bufs, size_t count);
+void out_str(OutBuf *ob, const char *s);
+void out_uint(OutBuf *ob, uint64_t v);
+void out_int(OutBuf *ob, int64_t v);
+
+// Número em ponto fixo com `decimals` casas (0..9), sem printf nem locale. Valores
+// grandes demais para todas as casas (|v| * 10^casas >= 2^63) saem com menos casas
+void out_fixed(OutBuf *ob, double v, int decimals);
+
+// Linha de `n` números de out_fixed separados por `delimiter` e terminada em '\n'.
+// Cada número de casas (0..OUT_ROW_MAX_DECIMALS) tem a própria versão da função, com
+// as casas como constante, escolhida uma vez por linha
+#define OUT_ROW_MAX_DECIMALS 3
+void out_fixed_row(OutBuf *ob, const double *v, size_t n, int decimals, char delimiter);
+
+// String JSON entre aspas, escapando aspas, barra invertida e caracteres de controle
+void out_json_string(OutBuf *ob, const char *s);
+
+// Como out_fixed, mas escreve `null` para NaN/inf (JSON não aceita "nan")
+void out_json_number(OutBuf *ob, double v, int decimals);
+
+static inline void out_char(OutBuf *ob, char c) {
+    if (ob->len < ob->capacity || out_reserve(ob, 1))
+        ob->data[ob->len++] = c;
+}
+
+#endif
@@ -0,0 +1,127 @@
+#include "params.h"
+#include "engine.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *const field_names[PARAM_COUNT] = {
+    [PARAM_EMISSIVITY] = "emissivity",
+    [PARAM_DISTANCE] = "distance",
+    [PARAM_REFLECTED] = "reflected",
+    [PARAM_ATMOSPHERE] = "atmosphere",
+    [PARAM_HUMIDITY] = "humidity",
+    [PARAM_TRANSMISSION] = "transmission",
+    [PARAM_OPTICS_TEMP] = "optics_temp",
+    [PARAM_OPTICS_TRANSMISSION] = "optics_transmission",
+};
+
+// `item` é "campo=valor,..." sem ';'
+static bool parse_variant(const char *item, size_t len, ParamSet *set) {
+    memset(set, 0, sizeof(*set));
+    if (!len || len >= sizeof(set->label))
+        return engine_fail("variante de parâmetros inválida: %.*s", (int)len, item);
+    memcpy(set->label, item, len);
+
+    for (const char *p = set->label; *p;) {
+        size_t n = strcspn(p, ",");
+        const char *eq = memchr(p, '=', n);
+        size_t f = 0;
+        while (f < PARAM_COUNT && !(eq && (size_t)(eq - p) == strlen(field_names[f]) &&
+                                    strncmp(p, field_names[f], (size_t)(eq - p)) == 0))
+            ++f;
+        char *end;
+        double v = f < PARAM_COUNT ? strtod(eq + 1, &end) : 0.0;
+        if (f == PARAM_COUNT || end != p + n || end == eq + 1)
+            return engine_fail("campo de parâmetros inválido (emissivity, distance, reflected, atmosphere, "
+                               "humidity, transmission, optics_temp, optics_transmission): %.*s", (int)n, p);
+        set->value[f] = v;
+        set->set |= 1u << f;
+        p += n;
+        if (*p)
+            ++p;
+    }
+    return true;
+}
+
+bool params_parse(const char *spec, ParamSet *sets, size_t *count) {
+    const char *p = spec;
+    for (;;) {
+        size_t len = strcspn(p, ";");
+        if (*count >= PARAMS_MAX_VARIANTS)
+            return engine_fail("no máximo %d variantes de parâmetros", PARAMS_MAX_VARIANTS);
+        if (!parse_variant(p, len, &sets[*count]))
+            return false;
+        ++*count;
+        if (!p[len])
+            return true;
+        p += len + 1;
+    }
+}
+
+bool params_begin(ACS_ThermalImage *img, ParamState *state) {
+    memset(state, 0, sizeof(*state));
+    if (!(state->params = ACS_ThermalImage_getThermalParameters(img)))
+        return engine_fail("imagem sem parâmetros térmicos: %s", ACS_getLastErrorMessage());
+    ACS_ThermalParameters *tp = state->params;
+    double *v = state->base.value;
+    v[PARAM_EMISSIVITY] = ACS_ThermalParameters_getObjectEmissivity(tp);
+    v[PARAM_DISTANCE] = ACS_ThermalParameters_getObjectDistance(tp);
+    v[PARAM_REFLECTED] = thermal_value_in(ACS_ThermalParameters_getObjectReflectedTemperature(tp), UNIT_CELSIUS);
+    v[PARAM_ATMOSPHERE] = thermal_value_in(ACS_ThermalParameters_getAtmosphericTemperature(tp), UNIT_CELSIUS);
+    v[PARAM_HUMIDITY] = ACS_ThermalParameters_getRelativeHumidity(tp);
+    v[PARAM_TRANSMISSION] = ACS_ThermalParameters_getAtmosphericTransmission(tp);
+    v[PARAM_OPTICS_TEMP] = thermal_value_in(ACS_ThermalParameters_getExternalOpticsTemperature(tp), UNIT_CELSIUS);
+    v[PARAM_OPTICS_TRANSMISSION] = ACS_ThermalParameters_getExternalOpticsTransmission(tp);
+    state->base.set = (1u << PARAM_COUNT) - 1;
+
+    // Gravar a transmissão desliga o cálculo automático do SDK (distância, umidade e
+    // temperatura do ar); gravar 0 o religa. Se religar dá o mesmo valor, a imagem já
+    // estava no automático e é com 0 que a transmissão volta ao original; senão ela era
+    // fixa e volta ao valor lido
+    ACS_ThermalParameters_setAtmosphericTransmission(tp, 0.0);
+    double computed = ACS_ThermalParameters_getAtmosphericTransmission(tp);
+    state->auto_transmission = !ACS_getLastErrorCode() && fabs(computed - v[PARAM_TRANSMISSION]) <= 1e-9;
+    if (!state->auto_transmission)
+        ACS_ThermalParameters_setAtmosphericTransmission(tp, v[PARAM_TRANSMISSION]);
+    return true;
+}
+
+static ACS_ThermalValue celsius(double v) {
+    return (ACS_ThermalValue){ v, ACS_TemperatureUnit_celsius, ACS_ThermalValueState_ok };
+}
+
+static void set_field(ACS_ThermalParameters *tp, ParamField f, double v) {
+    switch (f) {
+    case PARAM_EMISSIVITY: ACS_ThermalParameters_setObjectEmissivity(tp, v); break;
+    case PARAM_DISTANCE: ACS_ThermalParameters_setObjectDistance(tp, v); break;
+    case PARAM_REFLECTED: ACS_ThermalParameters_setObjectReflectedTemperature(tp, celsius(v)); break;
+    case PARAM_ATMOSPHERE: ACS_ThermalParameters_setAtmosphericTemperature(tp, celsius(v)); break;
+    case PARAM_HUMIDITY: ACS_ThermalParameters_setRelativeHumidity(tp, v); break;
+    case PARAM_TRANSMISSION: ACS_ThermalParameters_setAtmosphericTransmission(tp, v); break;
+    case PARAM_OPTICS_TEMP: ACS_ThermalParameters_setExternalOpticsTemperature(tp, celsius(v)); break;
+    case PARAM_OPTICS_TRANSMISSION: ACS_ThermalParameters_setExternalOpticsTransmission(tp, v); break;
+    default: break;
+    }
+}
+
+bool params_apply(ParamState *state, const ParamSet *variant) {
+    // Só os campos tocados: regravar os demais (ex.: transmissão) desligaria o cálculo do
+    // SDK. A transmissão automática volta como 0, para seguir a distância da variante
+    unsigned touch = state->dirty | variant->set;
+    for (unsigned f = 0; f < PARAM_COUNT; ++f) {
+        if (!(touch & (1u << f)))
+            continue;
+        double base = f == PARAM_TRANSMISSION && state->auto_transmission ? 0.0 : state->base.value[f];
+        set_field(state->params, (ParamField)f, variant->set & (1u << f) ? variant->value[f] : base);
+        if (ACS_getLastErrorCode())
+            return engine_fail("%s inválido: %s", field_names[f], ACS_getLastErrorMessage());
+    }
+    state->dirty = variant->set;
+    return true;
+}
+
+bool params_restore(ParamState *state) {
+    ParamSet none = { 0 };
+    return !state->params || params_apply(state, &none);
+}
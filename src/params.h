@@ -0,0 +1,59 @@
+#ifndef FLIR2JSON_PARAMS_H
+#define FLIR2JSON_PARAMS_H
+
+#include <acs/thermal_image.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Variantes de parâmetros térmicos sobre a mesma imagem decodificada: cada variante
+// altera só os campos pedidos (ACS_ThermalParameters_set*) e a extração seguinte
+// remonta apenas a LUT sinal→temperatura; o buffer de sinal continua o mesmo.
+//
+// Especificação: variantes separadas por ';', campos "nome=valor" separados por ','
+//   emissivity, distance, reflected (°C), atmosphere (°C), humidity,
+//   transmission, optics_temp (°C), optics_transmission
+// ex.: "emissivity=0.95,distance=2;emissivity=0.80,reflected=35"
+
+// Máximo de variantes por imagem
+#define PARAMS_MAX_VARIANTS 32
+
+typedef enum {
+    PARAM_EMISSIVITY,
+    PARAM_DISTANCE,
+    PARAM_REFLECTED,
+    PARAM_ATMOSPHERE,
+    PARAM_HUMIDITY,
+    PARAM_TRANSMISSION,
+    PARAM_OPTICS_TEMP,
+    PARAM_OPTICS_TRANSMISSION,
+    PARAM_COUNT
+} ParamField;
+
+typedef struct {
+    double value[PARAM_COUNT]; // temperaturas em °C
+    unsigned set;              // bit (1 << campo) para cada campo definido
+    char label[128];           // texto da variante, para o "# params" do CSV
+} ParamSet;
+
+// Acrescenta as variantes de `spec` a sets[*count] (até PARAMS_MAX_VARIANTS)
+bool params_parse(const char *spec, ParamSet *sets, size_t *count);
+
+// Parâmetros originais da imagem e campos alterados desde então
+typedef struct {
+    ACS_ThermalParameters *params;
+    ParamSet base;
+    unsigned dirty;
+    bool auto_transmission; // transmissão calculada pelo SDK: restaurada com 0
+} ParamState;
+
+// Guarda os parâmetros originais antes da primeira variante
+bool params_begin(ACS_ThermalImage *img, ParamState *state);
+
+// Aplica `variant` sobre os originais: campos da variante anterior que esta não
+// define voltam ao valor do arquivo
+bool params_apply(ParamState *state, const ParamSet *variant);
+
+// Devolve a imagem aos parâmetros originais
+bool params_restore(ParamState *state);
+
+#endif
@@ -0,0 +1,76 @@
+#include "pool.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+typedef struct {
+    PoolTask task;
+    void *ctx;
+    size_t count;
+    atomic_size_t next;
+} PoolShared;
+
+typedef struct {
+    PoolShared *shared;
+    unsigned id;
+} PoolWorker;
+
+unsigned pool_default_workers(void) {
+    const char *env = getenv("FLIR2JSON_THREADS");
+    if (env && *env) {
+        char *end;
+        long n = strtol(env, &end, 10);
+        if (!*end && n >= 1 && n <= POOL_MAX_WORKERS)
+            return (unsigned)n;
+        fprintf(stderr, "⚠️ FLIR2JSON_THREADS inválido (%s), usando um por núcleo.\n", env);
+    }
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus < 1)
+        cpus = 1;
+    return cpus > POOL_MAX_WORKERS ? POOL_MAX_WORKERS : (unsigned)cpus;
+}
+
+static void drain(PoolShared *shared, unsigned id) {
+    for (;;) {
+        size_t i = atomic_fetch_add_explicit(&shared->next, 1, memory_order_relaxed);
+        if (i >= shared->count)
+            return;
+        shared->task(shared->ctx, id, i);
+    }
+}
+
+static void *worker_main(void *arg) {
+    PoolWorker *w = arg;
+    drain(w->shared, w->id);
+    return NULL;
+}
+
+unsigned pool_run(size_t count, unsigned workers, PoolTask task, void *ctx) {
+    PoolShared shared = { task, ctx, count, 0 };
+    if (workers > POOL_MAX_WORKERS)
+        workers = POOL_MAX_WORKERS;
+    if (workers > count)
+        workers = (unsigned)count;
+    if (workers <= 1) {
+        drain(&shared, 0);
+        return 1;
+    }
+
+    // A thread chamadora é o worker 0; as demais são criadas aqui
+    pthread_t threads[POOL_MAX_WORKERS];
+    PoolWorker args[POOL_MAX_WORKERS];
+    unsigned started = 1;
+    for (unsigned i = 1; i < workers; ++i) {
+        args[i] = (PoolWorker){ &shared, i };
+        if (pthread_create(&threads[i], NULL, worker_main, &args[i]) != 0)
+            break;
+        ++started;
+    }
+    drain(&shared, 0);
+    for (unsigned i = 1; i < started; ++i)
+        pthread_join(threads[i], NULL);
+    return started;
+}
@@ -0,0 +1,24 @@
+#ifndef FLIR2JSON_POOL_H
+#define FLIR2JSON_POOL_H
+
+#include <stddef.h>
+
+// Pool simples de threads para lotes: cada thread pega o próximo índice livre
+// até esgotar a lista, então o trabalho se distribui sozinho entre arquivos de
+// tamanhos diferentes.
+
+// Limite de threads aceito por pool_default_workers e pool_run
+#define POOL_MAX_WORKERS 256
+
+// Chamada uma vez por item; `worker` identifica a thread (0..workers-1) para
+// indexar estado próprio dela
+typedef void (*PoolTask)(void *ctx, unsigned worker, size_t index);
+
+// FLIR2JSON_THREADS, ou um por núcleo disponível
+unsigned pool_default_workers(void);
+
+// Executa task(ctx, w, i) para todo i em [0, count) e espera terminar.
+// Com workers <= 1 roda na thread chamadora. Retorna quantas threads usou.
+unsigned pool_run(size_t count, unsigned workers, PoolTask task, void *ctx);
+
+#endif
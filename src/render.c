@@ -0,0 +1,244 @@
+#include "render.h"
+#include "engine.h"
+
+#include <acs/palette.h>
+#include <jpeglib.h>
+#include <setjmp.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <zlib.h>
+
+// Mesma ordem de ACS_PalettePreset
+static const char *const palette_names[] = {
+    "arctic", "blackhot", "bw", "coldest", "colorwheel_redhot", "colorwheel12", "colorwheel6",
+    "doublerainbow2", "hottest", "iron", "lava", "rainbow", "rainhc", "whitehot",
+};
+
+#define PALETTE_COUNT (sizeof(palette_names) / sizeof(palette_names[0]))
+
+bool render_palette_parse(const char *s, int *palette) {
+    for (size_t i = 0; i < PALETTE_COUNT; ++i)
+        if (strcasecmp(s, palette_names[i]) == 0) {
+            *palette = (int)i;
+            return true;
+        }
+    return false;
+}
+
+const char *render_palette_name(int palette) {
+    return palette >= 0 && (size_t)palette < PALETTE_COUNT ? palette_names[palette] : "?";
+}
+
+bool render_format_parse(const char *s, RenderFormat *format) {
+    if (strcmp(s, "png") == 0) *format = RENDER_PNG;
+    else if (strcmp(s, "jpeg") == 0 || strcmp(s, "jpg") == 0) *format = RENDER_JPEG;
+    else return false;
+    return true;
+}
+
+const char *render_format_name(RenderFormat format) {
+    return format == RENDER_JPEG ? "jpeg" : "png";
+}
+
+const char *render_content_type(RenderFormat format) {
+    return format == RENDER_JPEG ? "image/jpeg" : "image/png";
+}
+
+void renderer_free(Renderer *r) {
+    if (r->colorizer)
+        ACS_ImageColorizer_free(r->colorizer);
+    free(r->rows);
+    memset(r, 0, sizeof(*r));
+}
+
+static void put_u32be(unsigned char *p, uint32_t v) {
+    p[0] = (unsigned char)(v >> 24);
+    p[1] = (unsigned char)(v >> 16);
+    p[2] = (unsigned char)(v >> 8);
+    p[3] = (unsigned char)v;
+}
+
+// Chunk PNG com os dados já em out a partir de `start + 8`: preenche tamanho, tipo e CRC
+static void png_close_chunk(OutBuf *out, size_t start, const char *type, size_t len) {
+    unsigned char *p = (unsigned char *)out->data + start;
+    put_u32be(p, (uint32_t)len);
+    memcpy(p + 4, type, 4);
+    put_u32be(p + 8 + len, (uint32_t)crc32(crc32(0, NULL, 0), p + 4, (uInt)(len + 4)));
+    out->len = start + 12 + len;
+}
+
+static bool png_chunk(OutBuf *out, const char *type, const unsigned char *data, size_t len) {
+    size_t start = out->len;
+    if (!out_reserve(out, 12 + len))
+        return false;
+    if (len)
+        memcpy(out->data + start + 8, data, len);
+    png_close_chunk(out, start, type, len);
+    return true;
+}
+
+// RGB 8 bits; cada linha com o filtro Up (diferença para a de cima), que comprime bem
+// os gradientes das imagens térmicas; deflate no nível mais rápido
+static bool encode_png(Renderer *r, const unsigned char *pixels, int width, int height, size_t stride, OutBuf *out) {
+    size_t row_bytes = (size_t)width * 3;
+    size_t raw_len = (row_bytes + 1) * (size_t)height;
+    if (r->rows_capacity < raw_len) {
+        unsigned char *grown = realloc(r->rows, raw_len);
+        if (!grown)
+            return engine_fail("sem memória para o PNG");
+        r->rows = grown;
+        r->rows_capacity = raw_len;
+    }
+    for (int y = 0; y < height; ++y) {
+        const unsigned char *row = pixels + (size_t)y * stride;
+        unsigned char *dst = r->rows + (size_t)y * (row_bytes + 1);
+        if (!y) {
+            dst[0] = 0;
+            memcpy(dst + 1, row, row_bytes);
+            continue;
+        }
+        const unsigned char *up = row - stride;
+        dst[0] = 2;
+        for (size_t i = 0; i < row_bytes; ++i)
+            dst[1 + i] = (unsigned char)(row[i] - up[i]);
+    }
+
+    static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    unsigned char ihdr[13];
+    put_u32be(ihdr, (uint32_t)width);
+    put_u32be(ihdr + 4, (uint32_t)height);
+    ihdr[8] = 8;  // bits por canal
+    ihdr[9] = 2;  // RGB
+    ihdr[10] = ihdr[11] = ihdr[12] = 0;
+    out_write(out, signature, sizeof(signature));
+    if (!png_chunk(out, "IHDR", ihdr, sizeof(ihdr)))
+        return engine_fail("sem memória para o PNG");
+
+    // Deflate direto no buffer de saída, dentro do chunk IDAT
+    uLongf packed = compressBound((uLong)raw_len);
+    size_t start = out->len;
+    if (!out_reserve(out, 12 + packed))
+        return engine_fail("sem memória para o PNG");
+    if (compress2((Bytef *)out->data + start + 8, &packed, r->rows, (uLong)raw_len, Z_BEST_SPEED) != Z_OK)
+        return engine_fail("falha ao comprimir o PNG");
+    png_close_chunk(out, start, "IDAT", packed);
+    return png_chunk(out, "IEND", NULL, 0) || engine_fail("sem memória para o PNG");
+}
+
+// Destino do libjpeg sobre o OutBuf: o codificador escreve no espaço livre e pede mais
+// quando enche
+typedef struct {
+    struct jpeg_destination_mgr pub;
+    OutBuf *out;
+} JpegDest;
+
+#define JPEG_CHUNK (64u << 10)
+
+static void jpeg_dest_init(j_compress_ptr cinfo) {
+    JpegDest *d = (JpegDest *)cinfo->dest;
+    if (!out_reserve(d->out, JPEG_CHUNK))
+        cinfo->err->error_exit((j_common_ptr)cinfo);
+    d->pub.next_output_byte = (JOCTET *)d->out->data + d->out->len;
+    d->pub.free_in_buffer = d->out->capacity - d->out->len;
+}
+
+static boolean jpeg_dest_grow(j_compress_ptr cinfo) {
+    JpegDest *d = (JpegDest *)cinfo->dest;
+    d->out->len = d->out->capacity;
+    jpeg_dest_init(cinfo);
+    return TRUE;
+}
+
+static void jpeg_dest_term(j_compress_ptr cinfo) {
+    JpegDest *d = (JpegDest *)cinfo->dest;
+    d->out->len = d->out->capacity - d->pub.free_in_buffer;
+}
+
+// O tratador padrão do libjpeg encerra o processo: aqui volta para encode_jpeg
+typedef struct {
+    struct jpeg_error_mgr pub;
+    jmp_buf escape;
+} JpegError;
+
+static void jpeg_error_exit(j_common_ptr cinfo) {
+    longjmp(((JpegError *)cinfo->err)->escape, 1);
+}
+
+static bool encode_jpeg(const unsigned char *pixels, int width, int height, size_t stride, int quality, OutBuf *out) {
+    struct jpeg_compress_struct cinfo;
+    JpegError err;
+    JpegDest dest = { .out = out };
+    cinfo.err = jpeg_std_error(&err.pub);
+    err.pub.error_exit = jpeg_error_exit;
+    if (setjmp(err.escape)) {
+        char msg[JMSG_LENGTH_MAX];
+        err.pub.format_message((j_common_ptr)&cinfo, msg);
+        jpeg_destroy_compress(&cinfo);
+        return engine_fail("falha ao codificar o JPEG: %s", out->failed ? "sem memória" : msg);
+    }
+    jpeg_create_compress(&cinfo);
+    dest.pub.init_destination = jpeg_dest_init;
+    dest.pub.empty_output_buffer = jpeg_dest_grow;
+    dest.pub.term_destination = jpeg_dest_term;
+    cinfo.dest = &dest.pub;
+    cinfo.image_width = (JDIMENSION)width;
+    cinfo.image_height = (JDIMENSION)height;
+    cinfo.input_components = 3;
+    cinfo.in_color_space = JCS_RGB;
+    jpeg_set_defaults(&cinfo);
+    jpeg_set_quality(&cinfo, quality, TRUE);
+    jpeg_start_compress(&cinfo, TRUE);
+    while (cinfo.next_scanline < cinfo.image_height) {
+        JSAMPROW row = (JSAMPROW)(pixels + (size_t)cinfo.next_scanline * stride);
+        jpeg_write_scanlines(&cinfo, &row, 1);
+    }
+    jpeg_finish_compress(&cinfo);
+    jpeg_destroy_compress(&cinfo);
+    return true;
+}
+
+static bool acs_failed(const char *what) {
+    if (!ACS_getLastErrorCode())
+        return false;
+    return !engine_fail("%s: %s", what, ACS_getLastErrorMessage());
+}
+
+bool render_image(Renderer *r, ACS_ThermalImage *img, const RenderOptions *opt, OutBuf *out) {
+    if (!r->colorizer || r->image != img) {
+        if (r->colorizer)
+            ACS_ImageColorizer_free(r->colorizer);
+        r->image = img;
+        if (!(r->colorizer = ACS_ImageColorizer_alloc(img)))
+            return engine_fail("ACS_ImageColorizer_alloc: %s", ACS_getLastErrorMessage());
+    }
+    ACS_Colorizer *colorizer = ACS_ImageColorizer_asColorizer(r->colorizer);
+    ACS_Renderer *renderer = ACS_Colorizer_asRenderer(colorizer);
+
+    ACS_ThermalImage_setPalettePreset(img, opt->palette);
+    if (acs_failed("setPalettePreset"))
+        return false;
+    ACS_Colorizer_setAutoScale(colorizer, !opt->fixed_range);
+    if (opt->fixed_range) {
+        ACS_ThermalValue lo = { opt->min, ACS_TemperatureUnit_celsius, ACS_ThermalValueState_ok };
+        ACS_ThermalValue hi = { opt->max, ACS_TemperatureUnit_celsius, ACS_ThermalValueState_ok };
+        ACS_Scale_setScale(ACS_ThermalImage_getScale(img), lo, hi);
+        if (acs_failed("setScale"))
+            return false;
+    }
+    ACS_Renderer_setOutputColorSpace(renderer, ACS_ColorSpaceType_rgb);
+    ACS_Renderer_update(renderer);
+    if (acs_failed("Renderer_update"))
+        return false;
+
+    const ACS_ImageBuffer *buf = ACS_Renderer_getImage(renderer);
+    if (!buf || ACS_ImageBuffer_getBytesPerPixel(buf) != 3)
+        return engine_fail("colorizador não devolveu uma imagem RGB");
+    const unsigned char *pixels = ACS_ImageBuffer_getData(buf);
+    int width = ACS_ImageBuffer_getWidth(buf), height = ACS_ImageBuffer_getHeight(buf);
+    size_t stride = (size_t)ACS_ImageBuffer_getStride(buf);
+    return opt->format == RENDER_JPEG ? encode_jpeg(pixels, width, height, stride, opt->quality, out)
+                                      : encode_png(r, pixels, width, height, stride, out);
+}
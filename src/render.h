@@ -0,0 +1,53 @@
+#ifndef FLIR2JSON_RENDER_H
+#define FLIR2JSON_RENDER_H
+
+#include <acs/palette.h>
+#include <acs/renderer.h>
+#include <acs/thermal_image.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "output.h"
+
+// Imagem em falsa cor pelo colorizador do SDK (ACS_ImageColorizer), codificada em
+// PNG (zlib) ou JPEG (libjpeg) direto num OutBuf, sem passar por arquivo.
+// Erros em engine_last_error().
+
+typedef enum {
+    RENDER_PNG,
+    RENDER_JPEG
+} RenderFormat;
+
+typedef struct {
+    int palette;         // ACS_PalettePreset_*
+    RenderFormat format;
+    bool fixed_range;    // escala [min, max] pedida; senão ajustada aos extremos da imagem
+    double min;          // °C
+    double max;
+    int quality;         // JPEG, 1..100
+} RenderOptions;
+
+#define RENDER_DEFAULT_QUALITY 90
+
+// Um por thread: o colorizador fica ligado à imagem ACS da thread e é reaproveitado
+// enquanto ela for a mesma (reabrir outro arquivo na imagem não o invalida)
+typedef struct {
+    ACS_ImageColorizer *colorizer;
+    const ACS_ThermalImage *image;
+    unsigned char *rows; // PNG: linhas filtradas antes do deflate
+    size_t rows_capacity;
+} Renderer;
+
+// Nomes em minúsculas dos presets ("iron", "rainbow", "whitehot"...)
+bool render_palette_parse(const char *s, int *palette);
+const char *render_palette_name(int palette);
+bool render_format_parse(const char *s, RenderFormat *format);
+const char *render_format_name(RenderFormat format);
+const char *render_content_type(RenderFormat format);
+
+// Coloriza a imagem aberta e acrescenta o arquivo codificado a `out`
+bool render_image(Renderer *r, ACS_ThermalImage *img, const RenderOptions *opt, OutBuf *out);
+
+void renderer_free(Renderer *r);
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef FLIR2JSON_RING_H
+#define FLIR2JSON_RING_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Fila circular de índices sem trava para um produtor e um consumidor. Só guarda
+// as posições: os dados ficam num vetor de `capacity` slots do chamador, indexado
+// por (posição & mask). O produtor escreve no slot de spsc_reserve e publica; o
+// consumidor lê o slot de spsc_peek e libera.
+
+typedef struct {
+    _Alignas(64) atomic_size_t head; // próxima posição a publicar (só o produtor escreve)
+    _Alignas(64) atomic_size_t tail; // próxima posição a consumir (só o consumidor escreve)
+    size_t mask;                     // capacidade - 1 (potência de 2)
+} SpscRing;
+
+// `capacity` precisa ser potência de 2
+static inline void spsc_init(SpscRing *r, size_t capacity) {
+    atomic_init(&r->head, 0);
+    atomic_init(&r->tail, 0);
+    r->mask = capacity - 1;
+}
+
+// Produtor: slot livre para escrever, ou false com a fila cheia
+static inline bool spsc_reserve(SpscRing *r, size_t *slot) {
+    size_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+    if (head - tail > r->mask)
+        return false;
+    *slot = head & r->mask;
+    return true;
+}
+
+// Produtor: torna visível o slot reservado
+static inline void spsc_publish(SpscRing *r) {
+    size_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    atomic_store_explicit(&r->head, head + 1, memory_order_release);
+}
+
+// Consumidor: quadros publicados e ainda não liberados
+static inline size_t spsc_pending(SpscRing *r) {
+    size_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    return atomic_load_explicit(&r->head, memory_order_acquire) - tail;
+}
+
+// Consumidor: slot mais antigo publicado, ou false com a fila vazia
+static inline bool spsc_peek(SpscRing *r, size_t *slot) {
+    if (!spsc_pending(r))
+        return false;
+    *slot = atomic_load_explicit(&r->tail, memory_order_relaxed) & r->mask;
+    return true;
+}
+
+// Consumidor: devolve o slot de spsc_peek ao produtor
+static inline void spsc_release(SpscRing *r) {
+    size_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    atomic_store_explicit(&r->tail, tail + 1, memory_order_release);
+}
+
+#endif
@@ -0,0 +1,451 @@
+#include "sequence.h"
+#include "engine.h"
+#include "pool.h"
+
+#include <acs/thermal_sequence_player.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+
+bool frame_range_parse(const char *spec, FrameRange *range) {
+    FrameRange r = { 0, SIZE_MAX, 1, NULL, 0 };
+    const char *p = spec;
+    char *end;
+    if (*p != ':') {
+        r.first = (size_t)strtoull(p, &end, 10);
+        if (end == p || *p == '-')
+            return false;
+        p = end;
+    }
+    if (*p != ':')
+        return false;
+    ++p;
+    if (*p && *p != ':') {
+        r.last = (size_t)strtoull(p, &end, 10);
+        if (end == p || *p == '-')
+            return false;
+        p = end;
+    }
+    if (*p == ':') {
+        ++p;
+        r.stride = (size_t)strtoull(p, &end, 10);
+        if (end == p || *p == '-' || r.stride == 0)
+            return false;
+        p = end;
+    }
+    if (*p || r.last <= r.first)
+        return false;
+    *range = r;
+    return true;
+}
+
+size_t frame_range_count(const FrameRange *range, size_t total) {
+    if (range->list) {
+        // A lista é crescente: os quadros além do fim da sequência ficam no final
+        size_t n = 0;
+        while (n < range->list_len && range->list[n] < total)
+            ++n;
+        return n;
+    }
+    size_t last = range->last < total ? range->last : total;
+    return range->first < last ? (last - range->first + range->stride - 1) / range->stride : 0;
+}
+
+size_t frame_range_at(const FrameRange *range, size_t i) {
+    return range->list ? range->list[i] : range->first + i * range->stride;
+}
+
+bool sequence_path_detect(const char *path) {
+    const char *dot = strrchr(path, '.');
+    return dot && (strcasecmp(dot, ".seq") == 0 || strcasecmp(dot, ".csq") == 0);
+}
+
+// Estado de cada thread: player próprio e o bloco serializado em memória
+typedef struct {
+    ACS_ThermalSequencePlayer *player;
+    OutBuf chunk;
+} SequenceWorker;
+
+typedef struct {
+    const char *path;
+    FrameRange range; // já limitado ao tamanho da sequência
+    size_t frames;    // quadros selecionados
+    size_t chunk;     // quadros por bloco
+    SequenceFrameFn fn;
+    void *ctx;
+    SequenceWorker *workers;
+    OutBuf *out;
+    atomic_size_t failed;
+    SequenceProgress *progress;
+
+    // Gravação em ordem: o bloco `next_chunk` é o próximo a ir para `out`
+    pthread_mutex_t lock;
+    pthread_cond_t turn;
+    size_t next_chunk;
+} SequenceRun;
+
+// Contexto de forEachInRange, que não informa o índice do quadro
+typedef struct {
+    SequenceRun *run;
+    SequenceWorker *w;
+    unsigned worker;
+    size_t index;
+} FrameVisit;
+
+// `done` quadros processados, dos quais `failed` falharam
+static void count_frames(SequenceRun *run, size_t done, size_t failed) {
+    if (failed)
+        atomic_fetch_add(&run->failed, failed);
+    if (run->progress) {
+        atomic_fetch_add(&run->progress->done, done);
+        if (failed)
+            atomic_fetch_add(&run->progress->failed, failed);
+    }
+}
+
+static void visit_frame(ACS_ThermalImage *img, void *arg) {
+    FrameVisit *v = arg;
+    OutBuf *chunk = &v->w->chunk;
+    size_t mark = chunk->len;
+    bool ok = img && v->run->fn(v->run->ctx, v->worker, v->index, img, chunk);
+    if (!ok)
+        chunk->len = mark; // descarta a saída parcial do quadro
+    count_frames(v->run, 1, !ok);
+    v->index += v->run->range.stride;
+}
+
+static void sequence_task(void *ctx, unsigned worker, size_t chunk) {
+    SequenceRun *run = ctx;
+    SequenceWorker *w = &run->workers[worker];
+    size_t first = chunk * run->chunk;
+    size_t count = run->frames - first < run->chunk ? run->frames - first : run->chunk;
+    size_t stride = run->range.stride;
+    size_t start = frame_range_at(&run->range, first);
+    const size_t *list = run->range.list;
+
+    w->chunk.len = 0;
+    w->chunk.failed = false;
+    if (!w->player)
+        w->player = ACS_ThermalSequencePlayer_alloc(run->path);
+    if (!w->player) {
+        count_frames(run, count, count);
+    } else {
+        FrameVisit visit = { run, w, worker, start };
+        if (stride == 1 && !list) {
+            // Quadros consecutivos: uma passada do player pelo bloco
+            ACS_ThermalSequencePlayer_forEachInRange(w->player, start, start + count, visit_frame, &visit);
+            if (visit.index != start + count)
+                count_frames(run, start + count - visit.index, start + count - visit.index);
+        } else {
+            // Passo ou lista do índice: cada quadro é buscado direto pela posição
+            for (size_t i = 0; i < count; ++i) {
+                size_t before = frame_range_at(&run->range, first + i);
+                visit.index = before;
+                ACS_ThermalSequencePlayer_withFrame(w->player, before, visit_frame, &visit);
+                if (visit.index == before)
+                    count_frames(run, 1, 1);
+            }
+        }
+    }
+
+    // Espera a vez do bloco para manter a saída na ordem dos quadros. Os blocos
+    // são retirados do pool em ordem crescente, então o anterior já está em andamento.
+    pthread_mutex_lock(&run->lock);
+    while (run->next_chunk != chunk)
+        pthread_cond_wait(&run->turn, &run->lock);
+    if (w->chunk.failed)
+        run->out->failed = true;
+    else if (w->chunk.len)
+        out_write(run->out, w->chunk.data, w->chunk.len);
+    run->next_chunk++;
+    pthread_cond_broadcast(&run->turn);
+    pthread_mutex_unlock(&run->lock);
+}
+
+bool sequence_run(const char *path, const FrameRange *range, unsigned workers, size_t chunk_frames,
+                  SequenceFrameFn fn, void *ctx, OutBuf *out, SequenceResult *result, SequenceProgress *progress) {
+    memset(result, 0, sizeof(*result));
+    ACS_ThermalSequencePlayer *probe = ACS_ThermalSequencePlayer_alloc(path);
+    if (!probe)
+        return engine_fail("falha ao abrir sequência %s: %s", path, ACS_getLastErrorMessage());
+    size_t total = ACS_ThermalSequencePlayer_frameCount(probe);
+    ACS_ThermalSequencePlayer_free(probe);
+
+    SequenceRun run = { .path = path, .range = *range, .chunk = chunk_frames ? chunk_frames : SEQUENCE_CHUNK_FRAMES,
+                        .fn = fn, .ctx = ctx, .out = out, .progress = progress };
+    if (run.range.last > total)
+        run.range.last = total;
+    run.frames = frame_range_count(&run.range, total);
+    result->total = total;
+    result->frames = run.frames;
+    if (progress) {
+        atomic_store(&progress->total, total);
+        atomic_store(&progress->frames, run.frames);
+    }
+
+    size_t chunks = (run.frames + run.chunk - 1) / run.chunk;
+    if (workers > chunks)
+        workers = chunks ? (unsigned)chunks : 1;
+    if (!(run.workers = calloc(workers, sizeof(*run.workers))))
+        return engine_fail("sem memória para %u threads", workers);
+    for (unsigned i = 0; i < workers; ++i)
+        out_init_memory(&run.workers[i].chunk, OUT_DEFAULT_CAPACITY);
+    pthread_mutex_init(&run.lock, NULL);
+    pthread_cond_init(&run.turn, NULL);
+
+    result->workers = pool_run(chunks, workers, sequence_task, &run);
+
+    pthread_cond_destroy(&run.turn);
+    pthread_mutex_destroy(&run.lock);
+    for (unsigned i = 0; i < workers; ++i) {
+        if (run.workers[i].player)
+            ACS_ThermalSequencePlayer_free(run.workers[i].player);
+        out_free(&run.workers[i].chunk);
+    }
+    free(run.workers);
+    result->failed = atomic_load(&run.failed);
+    if (out->failed)
+        return engine_fail("erro ao gravar a saída da sequência");
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+
+void sequence_index_init(SequenceIndex *ix, TempUnit unit) {
+    memset(ix, 0, sizeof(*ix));
+    pthread_mutex_init(&ix->lock, NULL);
+    ix->unit = unit;
+}
+
+void sequence_index_free(SequenceIndex *ix) {
+    pthread_mutex_destroy(&ix->lock);
+    free(ix->entries);
+    ix->entries = NULL;
+    ix->count = ix->capacity = 0;
+}
+
+bool sequence_index_add(SequenceIndex *ix, const SequenceIndexEntry *entry) {
+    pthread_mutex_lock(&ix->lock);
+    bool ok = true;
+    if (ix->count == ix->capacity) {
+        size_t capacity = ix->capacity ? ix->capacity * 2 : 1024;
+        SequenceIndexEntry *grown = realloc(ix->entries, capacity * sizeof(*grown));
+        if (grown) {
+            ix->entries = grown;
+            ix->capacity = capacity;
+        } else {
+            ok = false;
+        }
+    }
+    if (ok) {
+        // A data vai entre `;` numa linha: separadores viram espaço
+        SequenceIndexEntry *e = &ix->entries[ix->count++];
+        *e = *entry;
+        for (char *c = e->time; *c; ++c)
+            if (*c == ';' || *c == '\n' || *c == '\r')
+                *c = ' ';
+    }
+    pthread_mutex_unlock(&ix->lock);
+    return ok;
+}
+
+static int by_frame(const void *a, const void *b) {
+    size_t x = ((const SequenceIndexEntry *)a)->frame, y = ((const SequenceIndexEntry *)b)->frame;
+    return (x > y) - (x < y);
+}
+
+bool sequence_index_write(SequenceIndex *ix, const char *path, const char *source, size_t total) {
+    struct stat st;
+    if (stat(source, &st) != 0)
+        return engine_fail("erro ao ler %s: %s", source, strerror(errno));
+    FILE *fp = fopen(path, "w");
+    if (!fp)
+        return engine_fail("erro ao criar %s: %s", path, strerror(errno));
+
+    // As threads entregam os blocos fora de ordem
+    qsort(ix->entries, ix->count, sizeof(*ix->entries), by_frame);
+    OutBuf out;
+    out_init_file(&out, fp, OUT_DEFAULT_CAPACITY);
+    out_str(&out, "# flir2json-index 1 size=");
+    out_uint(&out, (uint64_t)st.st_size);
+    out_str(&out, " mtime=");
+    out_uint(&out, (uint64_t)st.st_mtime);
+    out_str(&out, " total=");
+    out_uint(&out, total);
+    out_str(&out, " unit=");
+    out_str(&out, unit_symbol(ix->unit));
+    out_str(&out, "\nframe;time;min;max;mean\n");
+    for (size_t i = 0; i < ix->count; ++i) {
+        const SequenceIndexEntry *e = &ix->entries[i];
+        out_uint(&out, e->frame);
+        out_char(&out, ';');
+        out_str(&out, e->time);
+        out_char(&out, ';');
+        out_json_number(&out, e->min, 3);
+        out_char(&out, ';');
+        out_json_number(&out, e->max, 3);
+        out_char(&out, ';');
+        out_json_number(&out, e->mean, 3);
+        out_char(&out, '\n');
+    }
+    bool ok = out_flush(&out);
+    out_free(&out);
+    if (fclose(fp) != 0 || !ok)
+        return engine_fail("erro ao gravar %s: %s", path, strerror(errno));
+    return true;
+}
+
+// "frame;time;min;max;mean"; a data não tem `;` (limpa em sequence_index_add)
+static bool parse_entry(char *line, SequenceIndexEntry *e) {
+    char *end;
+    e->frame = (size_t)strtoull(line, &end, 10);
+    if (end == line || *end != ';')
+        return false;
+    char *time = end + 1, *sep = strchr(time, ';');
+    if (!sep || (size_t)(sep - time) >= sizeof(e->time))
+        return false;
+    memcpy(e->time, time, (size_t)(sep - time));
+    e->time[sep - time] = 0;
+    double *fields[] = { &e->min, &e->max, &e->mean };
+    char *p = sep + 1;
+    for (size_t i = 0; i < 3; ++i) {
+        *fields[i] = strtod(p, &end);
+        if (end == p || *end != (i < 2 ? ';' : 0))
+            return false;
+        p = end + 1;
+    }
+    return true;
+}
+
+bool sequence_index_read(SequenceIndex *ix, const char *path, const char *source) {
+    struct stat st;
+    if (stat(source, &st) != 0)
+        return engine_fail("erro ao ler %s: %s", source, strerror(errno));
+    FILE *fp = fopen(path, "r");
+    if (!fp)
+        return engine_fail("erro ao abrir %s: %s", path, strerror(errno));
+
+    char line[256], unit[8];
+    unsigned long long size, mtime, total;
+    bool ok = fgets(line, sizeof(line), fp) &&
+              sscanf(line, "# flir2json-index 1 size=%llu mtime=%llu total=%llu unit=%7s", &size, &mtime, &total,
+                     unit) == 4 &&
+              fgets(line, sizeof(line), fp) && strcmp(line, "frame;time;min;max;mean\n") == 0;
+    if (!ok) {
+        fclose(fp);
+        return engine_fail("%s não é um índice de sequência", path);
+    }
+    if (size != (unsigned long long)st.st_size || mtime != (unsigned long long)st.st_mtime) {
+        fclose(fp);
+        return engine_fail("índice %s desatualizado: %s mudou depois da indexação", path, source);
+    }
+    ix->total = (size_t)total;
+    if (!unit_parse(unit, &ix->unit)) {
+        fclose(fp);
+        return engine_fail("%s: unidade desconhecida \"%s\"", path, unit);
+    }
+    size_t number = 2;
+    while (ok && fgets(line, sizeof(line), fp)) {
+        ++number;
+        line[strcspn(line, "\n")] = 0;
+        SequenceIndexEntry e;
+        if (!parse_entry(line, &e))
+            ok = engine_fail("%s:%zu: linha inválida", path, number);
+        else if (!sequence_index_add(ix, &e))
+            ok = engine_fail("sem memória para o índice");
+    }
+    fclose(fp);
+    // Crescente e sem repetidos é o que sequence_index_select espera, mesmo editado à mão
+    qsort(ix->entries, ix->count, sizeof(*ix->entries), by_frame);
+    return ok;
+}
+
+bool index_query_parse(const char *spec, IndexQuery *query) {
+    static const char *const fields[] = { "min", "max", "mean" };
+    static const char *const ops[] = { ">=", "<=", ">", "<" }; // as de dois caracteres primeiro
+    static const int op_codes[] = { 1, 3, 0, 2 };
+    IndexQuery q = { .count = 0 };
+    const char *p = spec;
+    for (;;) {
+        if (q.count == INDEX_QUERY_MAX)
+            return false;
+        int field = -1;
+        for (int f = 0; f < 3 && field < 0; ++f) {
+            size_t n = strlen(fields[f]);
+            // "max" não pode casar com "mean": exige o operador logo depois do nome
+            if (strncmp(p, fields[f], n) == 0 && (p[n] == '<' || p[n] == '>')) {
+                field = f;
+                p += n;
+            }
+        }
+        if (field < 0)
+            return false;
+        int op = -1;
+        for (int o = 0; o < 4 && op < 0; ++o) {
+            size_t n = strlen(ops[o]);
+            if (strncmp(p, ops[o], n) == 0) {
+                op = op_codes[o];
+                p += n;
+            }
+        }
+        char *end;
+        double value = strtod(p, &end);
+        if (end == p || value != value)
+            return false;
+        q.conds[q.count].field = field;
+        q.conds[q.count].op = op;
+        q.conds[q.count].value = value;
+        q.count++;
+        p = end;
+        if (!*p)
+            break;
+        if (*p++ != ',')
+            return false;
+    }
+    *query = q;
+    return true;
+}
+
+bool index_query_match(const IndexQuery *query, const SequenceIndexEntry *entry) {
+    for (size_t i = 0; i < query->count; ++i) {
+        double v = query->conds[i].field == 0 ? entry->min : query->conds[i].field == 1 ? entry->max : entry->mean;
+        double t = query->conds[i].value;
+        bool ok;
+        switch (query->conds[i].op) {
+        case 0: ok = v > t; break;
+        case 1: ok = v >= t; break;
+        case 2: ok = v < t; break;
+        default: ok = v <= t; break;
+        }
+        if (!ok)
+            return false;
+    }
+    return true;
+}
+
+bool sequence_index_select(const SequenceIndex *ix, const IndexQuery *query, const FrameRange *range,
+                           size_t **list, size_t *count) {
+    *list = NULL;
+    *count = 0;
+    size_t *frames = malloc((ix->count ? ix->count : 1) * sizeof(*frames));
+    if (!frames)
+        return engine_fail("sem memória para o índice");
+    size_t n = 0;
+    for (size_t i = 0; i < ix->count; ++i) {
+        const SequenceIndexEntry *e = &ix->entries[i];
+        if (e->frame < range->first || e->frame >= range->last || (e->frame - range->first) % range->stride)
+            continue;
+        // Linhas repetidas (índice editado à mão) entram uma vez
+        if ((!query || index_query_match(query, e)) && (!n || frames[n - 1] != e->frame))
+            frames[n++] = e->frame;
+    }
+    *list = frames;
+    *count = n;
+    return true;
+}
@@ -0,0 +1,128 @@
+#ifndef FLIR2JSON_SEQUENCE_H
+#define FLIR2JSON_SEQUENCE_H
+
+#include <acs/thermal_image.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "engine.h"
+#include "output.h"
+
+// Extração de sequências radiométricas (.seq/.csq) com ACS_ThermalSequencePlayer.
+// Os quadros selecionados são divididos em blocos consecutivos; cada thread tem o
+// próprio player e decodifica um bloco por vez com forEachInRange, serializando em
+// memória. Os blocos são gravados na saída na ordem dos quadros.
+
+// Quadros consecutivos por bloco (padrão): limita a memória em trânsito (um bloco por thread)
+#define SEQUENCE_CHUNK_FRAMES 8
+
+// Quadros [first, last) a cada `stride`; last == SIZE_MAX vai até o fim. Com `list`,
+// só os `list_len` quadros dela (em ordem crescente), cada um buscado direto pelo
+// índice, sem passar pelos do meio; first/last/stride ficam só como referência.
+typedef struct {
+    size_t first;
+    size_t last;
+    size_t stride;
+    const size_t *list;
+    size_t list_len;
+} FrameRange;
+
+// "INÍCIO:FIM[:PASSO]" com FIM exclusivo; INÍCIO e FIM podem ficar vazios
+bool frame_range_parse(const char *spec, FrameRange *range);
+
+// Quadros de `range` que existem numa sequência de `total` quadros
+size_t frame_range_count(const FrameRange *range, size_t total);
+
+// Índice na sequência do i-ésimo quadro selecionado (i < frame_range_count)
+size_t frame_range_at(const FrameRange *range, size_t i);
+
+// Extensão .seq ou .csq (sem diferenciar maiúsculas)
+bool sequence_path_detect(const char *path);
+
+// Serializa o quadro `index` (já decodificado em `img`) em `out`; false conta como
+// falha do quadro (a mensagem fica por conta da função). Roda em várias threads:
+// `worker` indexa o estado próprio de cada uma.
+typedef bool (*SequenceFrameFn)(void *ctx, unsigned worker, size_t index, ACS_ThermalImage *img, OutBuf *out);
+
+typedef struct {
+    size_t total;    // quadros no arquivo
+    size_t frames;   // quadros selecionados
+    size_t failed;
+    unsigned workers;
+} SequenceResult;
+
+// Andamento, lido por outras threads enquanto sequence_run roda
+typedef struct {
+    atomic_size_t total;  // quadros no arquivo (ACS_ThermalSequencePlayer_frameCount)
+    atomic_size_t frames; // quadros selecionados
+    atomic_size_t done;   // selecionados já processados, com ou sem falha
+    atomic_size_t failed;
+} SequenceProgress;
+
+// Decodifica os quadros de `range` em `workers` threads e grava o que `fn`
+// produzir em `out`, na ordem dos quadros. Cada bloco de `chunk_frames` quadros
+// selecionados (0: SEQUENCE_CHUNK_FRAMES) passa inteiro, em ordem, pela mesma thread.
+// Retorna false se a sequência não abre (mensagem em engine_last_error()) ou se a
+// escrita em `out` falhar. `progress` (opcional) é atualizado a cada quadro.
+bool sequence_run(const char *path, const FrameRange *range, unsigned workers, size_t chunk_frames,
+                  SequenceFrameFn fn, void *ctx, OutBuf *out, SequenceResult *result, SequenceProgress *progress);
+
+// Índice de uma sequência (--write-index / --index): uma linha por quadro com a data
+// da câmera e as estatísticas já calculadas na extração, para reextrair só os quadros
+// que interessam. Texto com `;`, como as estatísticas:
+//   # flir2json-index 1 size=BYTES mtime=SEGUNDOS total=QUADROS unit=C
+//   frame;time;min;max;mean
+// O tamanho e a data de modificação da sequência invalidam o índice quando ela muda.
+typedef struct {
+    size_t frame;
+    char time[32]; // ArcDateTime do quadro; vazia sem data
+    double min;    // sobre todas as regiões extraídas do quadro, na unidade do índice
+    double max;
+    double mean;
+} SequenceIndexEntry;
+
+typedef struct {
+    pthread_mutex_t lock; // sequence_index_add vem das threads da sequência
+    TempUnit unit;
+    size_t total;         // quadros na sequência
+    SequenceIndexEntry *entries;
+    size_t count;
+    size_t capacity;
+} SequenceIndex;
+
+void sequence_index_init(SequenceIndex *ix, TempUnit unit);
+void sequence_index_free(SequenceIndex *ix);
+
+// Seguro entre threads; false sem memória
+bool sequence_index_add(SequenceIndex *ix, const SequenceIndexEntry *entry);
+
+// Ordena por quadro e grava `path`; `source` é a sequência indexada
+bool sequence_index_write(SequenceIndex *ix, const char *path, const char *source, size_t total);
+
+// Lê `path` e confere se ainda corresponde a `source`; erros em engine_last_error()
+bool sequence_index_read(SequenceIndex *ix, const char *path, const char *source);
+
+// Condições sobre as estatísticas do índice, todas obrigatórias: "max>40",
+// "mean<=20.5,min>0"; campos min, max e mean; operadores > >= < <=
+#define INDEX_QUERY_MAX 8
+
+typedef struct {
+    struct {
+        int field; // 0 min, 1 max, 2 mean
+        int op;    // 0 >, 1 >=, 2 <, 3 <=
+        double value;
+    } conds[INDEX_QUERY_MAX];
+    size_t count;
+} IndexQuery;
+
+bool index_query_parse(const char *spec, IndexQuery *query);
+bool index_query_match(const IndexQuery *query, const SequenceIndexEntry *entry);
+
+// Quadros do índice que atendem `query` (NULL: todos) dentro de `range`, em ordem
+// crescente; *list alocado com malloc mesmo sem nenhum quadro (free com o chamador)
+bool sequence_index_select(const SequenceIndex *ix, const IndexQuery *query, const FrameRange *range,
+                           size_t **list, size_t *count);
+
+#endif
@@ -0,0 +1,690 @@
+#include "serialize.h"
+#include "pool.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+bool output_format_parse(const char *s, OutputFormat *format) {
+    if (strcmp(s, "csv") == 0) *format = FORMAT_CSV;
+    else if (strcmp(s, "bin") == 0) *format = FORMAT_BIN;
+    else if (strcmp(s, "json") == 0) *format = FORMAT_JSON;
+    else if (strcmp(s, "delta") == 0) *format = FORMAT_DELTA;
+    else if (strcmp(s, "arrow") == 0) *format = FORMAT_ARROW;
+    else return false;
+    return true;
+}
+
+bool output_dtype_parse(const char *s, BinaryDType *dtype) {
+    if (strcmp(s, "f32") == 0) *dtype = DTYPE_F32;
+    else if (strcmp(s, "u16") == 0) *dtype = DTYPE_U16;
+    else return false;
+    return true;
+}
+
+bool csv_delimiter_parse(const char *s, char *delimiter) {
+    if (strcmp(s, "tab") == 0) *delimiter = '\t';
+    else if (strcmp(s, "space") == 0) *delimiter = ' ';
+    else if (s[0] && !s[1] && strchr(",;|:", s[0])) *delimiter = s[0];
+    else return false;
+    return true;
+}
+
+const char *output_content_type(OutputFormat format) {
+    switch (format) {
+    case FORMAT_BIN:
+    case FORMAT_DELTA: return "application/octet-stream";
+    case FORMAT_JSON: return "application/json";
+    case FORMAT_ARROW: return "application/vnd.apache.arrow.file";
+    default: return "text/csv; charset=utf-8";
+    }
+}
+
+const char *output_extension(OutputFormat format) {
+    switch (format) {
+    case FORMAT_BIN: return "bin";
+    case FORMAT_JSON: return "json";
+    case FORMAT_DELTA: return "f2jd";
+    case FORMAT_ARROW: return "arrow";
+    default: return "csv";
+    }
+}
+
+bool output_is_binary(OutputFormat format) {
+    return format == FORMAT_BIN || format == FORMAT_DELTA || format == FORMAT_ARROW;
+}
+
+void output_configure_extract(const OutputOptions *out_opt, ExtractOptions *ext_opt) {
+    ext_opt->fixed_u16 = out_opt->format == FORMAT_DELTA ||
+                         (out_opt->format == FORMAT_BIN && out_opt->dtype == DTYPE_U16);
+    ext_opt->scale = out_opt->scale;
+    ext_opt->offset = out_opt->offset;
+}
+
+// "x,y,w,h", a mesma forma de --roi
+static void write_rect(OutBuf *out, const ACS_Rectangle *r) {
+    out_int(out, r->x);
+    out_char(out, ',');
+    out_int(out, r->y);
+    out_char(out, ',');
+    out_int(out, r->width);
+    out_char(out, ',');
+    out_int(out, r->height);
+}
+
+// `,"downsample":N,"pool":"max"` quando a matriz é a grade reduzida (width/height
+// são os da grade; roi continua em pixels da imagem)
+static void write_downsample(OutBuf *out, const Frame *frame) {
+    if (frame->downsample <= 1)
+        return;
+    out_str(out, ",\"downsample\":");
+    out_uint(out, frame->downsample);
+    out_str(out, ",\"pool\":\"");
+    out_str(out, pool_name(frame->pool));
+    out_char(out, '"');
+}
+
+// `"aggregate":{...},` no lugar de `"frame":N,` dos quadros comuns
+static void write_aggregate_json(OutBuf *out, const Frame *frame) {
+    out_str(out, "\"aggregate\":{\"stat\":\"");
+    out_str(out, frame->aggregate);
+    out_str(out, "\",\"first\":");
+    out_int(out, frame->index);
+    out_str(out, ",\"last\":");
+    out_int(out, frame->window_last);
+    out_str(out, ",\"frames\":");
+    out_uint(out, frame->window_frames);
+    out_str(out, "},");
+}
+
+// Linhas de comentário antes da matriz e, com `csv->header`, a linha das colunas
+static void write_csv_header(OutBuf *out, const Frame *frame, const CsvDialect *csv) {
+    if (frame->aggregate) {
+        out_str(out, "# aggregate ");
+        out_str(out, frame->aggregate);
+        out_str(out, " frames ");
+        out_int(out, frame->index);
+        out_char(out, '-');
+        out_int(out, frame->window_last);
+        out_str(out, " count ");
+        out_uint(out, frame->window_frames);
+        out_char(out, '\n');
+    } else if (frame->index >= 0) {
+        out_str(out, "# frame ");
+        out_int(out, frame->index);
+        out_char(out, '\n');
+    }
+    if (frame->params) {
+        out_str(out, "# params ");
+        out_str(out, frame->params);
+        out_char(out, '\n');
+    }
+    if (frame->tag_roi) {
+        out_str(out, "# roi ");
+        write_rect(out, &frame->rect);
+        out_char(out, '\n');
+    }
+    if (frame->downsample > 1) {
+        out_str(out, "# downsample ");
+        out_uint(out, frame->downsample);
+        out_char(out, ' ');
+        out_str(out, pool_name(frame->pool));
+        out_char(out, '\n');
+    }
+    if (csv->header) {
+        // Com downsample, a primeira coluna de pixels de cada bloco
+        unsigned step = frame->downsample > 1 ? frame->downsample : 1;
+        for (int x = 0; x < frame->width; ++x) {
+            out_int(out, (int64_t)frame->rect.x + (int64_t)x * step);
+            out_char(out, x < frame->width - 1 ? csv->delimiter : '\n');
+        }
+    }
+}
+
+static void write_csv_rows(OutBuf *out, const Frame *frame, const CsvDialect *csv, size_t first, size_t last) {
+    size_t width = (size_t)frame->width;
+    for (size_t y = first; y < last; ++y)
+        out_fixed_row(out, frame->values + y * width, width, csv->decimals, csv->delimiter);
+}
+
+bool serialize_csv(OutBuf *out, const Frame *frame, const CsvDialect *csv) {
+    CsvDialect dialect = csv ? *csv : CSV_DEFAULT_DIALECT;
+    write_csv_header(out, frame, &dialect);
+    write_csv_rows(out, frame, &dialect, 0, (size_t)frame->height);
+    return !out->failed;
+}
+
+static void put_u16le(unsigned char *p, uint16_t v) {
+    p[0] = (unsigned char)(v & 0xff);
+    p[1] = (unsigned char)(v >> 8);
+}
+
+static void put_f32le(unsigned char *p, float f) {
+    uint32_t v;
+    memcpy(&v, &f, sizeof(v));
+    p[0] = (unsigned char)(v & 0xff);
+    p[1] = (unsigned char)((v >> 8) & 0xff);
+    p[2] = (unsigned char)((v >> 16) & 0xff);
+    p[3] = (unsigned char)(v >> 24);
+}
+
+// Converte a matriz para o payload little-endian (independe da arquitetura);
+// retorna quantos pixels saturaram (u16)
+static size_t encode_payload(const double *values, size_t count, const OutputOptions *opt, unsigned char *payload) {
+    size_t clipped = 0;
+    if (opt->dtype == DTYPE_F32) {
+        for (size_t i = 0; i < count; ++i)
+            put_f32le(payload + i * 4, (float)values[i]);
+        return 0;
+    }
+
+    double inv_scale = 1.0 / opt->scale;
+    for (size_t i = 0; i < count; ++i) {
+        double q = (values[i] - opt->offset) * inv_scale + 0.5;
+        uint16_t v;
+        if (q >= 0.0 && q < 65536.0) {
+            v = (uint16_t)q;
+        } else {
+            v = q >= 65536.0 ? 65535 : 0; // NaN também vira 0
+            ++clipped;
+        }
+        put_u16le(payload + i * 2, v);
+    }
+    return clipped;
+}
+
+// Fragmento `,"thermal_parameters":{...}` (omitido se a imagem não tem parâmetros)
+static void write_thermal_parameters(OutBuf *out, ACS_ThermalImage *img, TempUnit unit) {
+    ACS_ThermalParameters *params = img ? ACS_ThermalImage_getThermalParameters(img) : NULL;
+    if (!params)
+        return;
+    out_str(out, ",\"thermal_parameters\":{\"emissivity\":");
+    out_json_number(out, ACS_ThermalParameters_getObjectEmissivity(params), 6);
+    out_str(out, ",\"object_distance\":");
+    out_json_number(out, ACS_ThermalParameters_getObjectDistance(params), 6);
+    out_str(out, ",\"reflected_temperature\":");
+    out_json_number(out, thermal_value_in(ACS_ThermalParameters_getObjectReflectedTemperature(params), unit), 6);
+    out_str(out, ",\"atmospheric_temperature\":");
+    out_json_number(out, thermal_value_in(ACS_ThermalParameters_getAtmosphericTemperature(params), unit), 6);
+    out_str(out, ",\"relative_humidity\":");
+    out_json_number(out, ACS_ThermalParameters_getRelativeHumidity(params), 6);
+    out_str(out, ",\"atmospheric_transmission\":");
+    out_json_number(out, ACS_ThermalParameters_getAtmosphericTransmission(params), 6);
+    out_str(out, ",\"external_optics_temperature\":");
+    out_json_number(out, thermal_value_in(ACS_ThermalParameters_getExternalOpticsTemperature(params), unit), 6);
+    out_str(out, ",\"external_optics_transmission\":");
+    out_json_number(out, ACS_ThermalParameters_getExternalOpticsTransmission(params), 6);
+    out_char(out, '}');
+}
+
+static void write_bin_header(OutBuf *out, ACS_ThermalImage *img, const Frame *frame, const OutputOptions *opt) {
+    const ACS_Rectangle *rect = &frame->rect;
+    size_t start = out->len;
+
+    size_t data_offset = BIN_PAYLOAD_ALIGN;
+    for (;;) {
+        out->len = start;
+        out_str(out, "{\"format\":\"flir2json-bin\",\"version\":1,");
+        if (frame->aggregate) {
+            write_aggregate_json(out, frame);
+        } else if (frame->index >= 0) {
+            out_str(out, "\"frame\":");
+            out_int(out, frame->index);
+            out_char(out, ',');
+        }
+        out_str(out, "\"width\":");
+        out_uint(out, (uint64_t)frame->width);
+        out_str(out, ",\"height\":");
+        out_uint(out, (uint64_t)frame->height);
+        write_downsample(out, frame);
+        out_str(out, ",\"roi\":[");
+        out_uint(out, (uint64_t)rect->x);
+        out_char(out, ',');
+        out_uint(out, (uint64_t)rect->y);
+        out_char(out, ',');
+        out_uint(out, (uint64_t)rect->width);
+        out_char(out, ',');
+        out_uint(out, (uint64_t)rect->height);
+        out_str(out, "],\"dtype\":");
+        out_str(out, opt->dtype == DTYPE_F32 ? "\"<f4\"" : "\"<u2\"");
+        out_str(out, ",\"unit\":\"");
+        out_str(out, unit_symbol(frame->unit));
+        out_str(out, "\",\"scale\":");
+        out_json_number(out, opt->dtype == DTYPE_F32 ? 1.0 : opt->scale, 6);
+        out_str(out, ",\"offset\":");
+        out_json_number(out, opt->dtype == DTYPE_F32 ? 0.0 : opt->offset, 6);
+        out_str(out, ",\"data_offset\":");
+        out_uint(out, data_offset);
+
+        out_str(out, ",\"stats\":{\"min\":");
+        out_json_number(out, frame->stats.min, 4);
+        out_str(out, ",\"max\":");
+        out_json_number(out, frame->stats.max, 4);
+        out_str(out, ",\"mean\":");
+        out_json_number(out, frame->stats.mean, 4);
+        out_char(out, '}');
+
+        write_thermal_parameters(out, img, frame->unit);
+        out_char(out, '}');
+
+        if (out->len - start + 1 <= data_offset || out->failed)
+            break;
+        data_offset += BIN_PAYLOAD_ALIGN;
+    }
+
+    while (out->len - start + 1 < data_offset && !out->failed)
+        out_char(out, ' ');
+    out_char(out, '\n');
+}
+
+bool serialize_bin(OutBuf *out, ACS_ThermalImage *img, const Frame *frame, const OutputOptions *opt,
+                   Workspace *ws, size_t *clipped) {
+    size_t count = (size_t)frame->width * (size_t)frame->height;
+    size_t elem = opt->dtype == DTYPE_F32 ? 4 : 2;
+
+    // O cabeçalho precisa ficar inteiro no buffer (o padding reescreve a partir do início)
+    if (!out_reserve(out, 4096))
+        return false;
+    write_bin_header(out, img, frame, opt);
+
+    const unsigned char *payload;
+    if (frame->fixed) {
+        // Kernel já gerou u16 na ordem nativa
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        unsigned char *le = workspace_scratch(ws, count * elem);
+        if (!le)
+            return false;
+        for (size_t i = 0; i < count; ++i)
+            put_u16le(le + i * 2, frame->fixed[i]);
+        payload = le;
+#else
+        payload = (const unsigned char *)frame->fixed;
+#endif
+        *clipped = frame->clipped;
+    } else {
+        unsigned char *encoded = workspace_scratch(ws, count * elem);
+        if (!encoded)
+            return false;
+        *clipped = encode_payload(frame->values, count, opt, encoded);
+        payload = encoded;
+    }
+
+    // Payload contíguo: com sink vai numa única escrita, sem passar pelo buffer
+    out_write(out, payload, count * elem);
+    return !out->failed;
+}
+
+// String JSON ou null; `max` limita campos de tamanho fixo sem terminador garantido
+static void write_json_text(OutBuf *out, const char *s, size_t max) {
+    if (!s) {
+        out_str(out, "null");
+        return;
+    }
+    char tmp[256];
+    size_t n = strnlen(s, max < sizeof(tmp) - 1 ? max : sizeof(tmp) - 1);
+    memcpy(tmp, s, n);
+    tmp[n] = 0;
+    out_json_string(out, tmp);
+}
+
+static void write_camera_info(OutBuf *out, const ACS_ThermalImage *img) {
+    ACS_Image_CameraInformation *info = img ? ACS_ThermalImage_getCameraInformation(img) : NULL;
+    if (!info || (img && ACS_getLastErrorCode())) {
+        out_str(out, ",\"camera\":null");
+        if (info)
+            ACS_Image_CameraInformation_free(info);
+        return;
+    }
+    out_str(out, ",\"camera\":{\"model\":");
+    write_json_text(out, ACS_Image_CameraInformation_getModelName(info), SIZE_MAX);
+    out_str(out, ",\"serial_number\":");
+    write_json_text(out, ACS_Image_CameraInformation_getSerialNumber(info), SIZE_MAX);
+    out_str(out, ",\"lens\":");
+    write_json_text(out, ACS_Image_CameraInformation_getLens(info), SIZE_MAX);
+    out_str(out, ",\"filter\":");
+    write_json_text(out, ACS_Image_CameraInformation_getFilter(info), SIZE_MAX);
+    out_str(out, ",\"program_version\":");
+    write_json_text(out, ACS_Image_CameraInformation_getProgramVersion(info), SIZE_MAX);
+    out_str(out, ",\"date_time\":");
+    write_json_text(out, ACS_Image_CameraInformation_getArcDateTime(info), SIZE_MAX);
+    out_char(out, '}');
+    ACS_Image_CameraInformation_free(info);
+}
+
+static void write_gps(OutBuf *out, const ACS_ThermalImage *img) {
+    if (!img) {
+        out_str(out, ",\"gps\":null");
+        return;
+    }
+    ACS_GpsInformation gps = ACS_ThermalImage_getGpsInformation(img);
+    if (ACS_getLastErrorCode() || !gps.isValid) {
+        out_str(out, ",\"gps\":null");
+        return;
+    }
+    char lat_ref[2] = { gps.latitudeRef, 0 }, lon_ref[2] = { gps.longitudeRef, 0 };
+    out_str(out, ",\"gps\":{\"latitude\":");
+    out_json_number(out, gps.latitude, 8);
+    out_str(out, ",\"latitude_ref\":");
+    write_json_text(out, lat_ref, 1);
+    out_str(out, ",\"longitude\":");
+    out_json_number(out, gps.longitude, 8);
+    out_str(out, ",\"longitude_ref\":");
+    write_json_text(out, lon_ref, 1);
+    out_str(out, ",\"altitude\":");
+    out_json_number(out, gps.altitude, 3);
+    out_str(out, ",\"altitude_ref\":");
+    out_int(out, gps.altitudeRef);
+    out_str(out, ",\"dop\":");
+    out_json_number(out, gps.dop, 3);
+    out_str(out, ",\"map_datum\":");
+    write_json_text(out, gps.mapDatum, sizeof(gps.mapDatum));
+    out_str(out, ",\"timestamp\":");
+    out_int(out, (int64_t)gps.timeStamp);
+    out_char(out, '}');
+}
+
+// Tudo antes da primeira linha da matriz
+static void write_json_header(OutBuf *out, ACS_ThermalImage *img, const Frame *frame) {
+    const ACS_Rectangle *rect = &frame->rect;
+    out_char(out, '{');
+    if (frame->aggregate) {
+        write_aggregate_json(out, frame);
+    } else if (frame->index >= 0) {
+        out_str(out, "\"frame\":");
+        out_int(out, frame->index);
+        out_char(out, ',');
+    }
+    out_str(out, "\"width\":");
+    out_uint(out, (uint64_t)frame->width);
+    out_str(out, ",\"height\":");
+    out_uint(out, (uint64_t)frame->height);
+    write_downsample(out, frame);
+    out_str(out, ",\"roi\":[");
+    out_uint(out, (uint64_t)rect->x);
+    out_char(out, ',');
+    out_uint(out, (uint64_t)rect->y);
+    out_char(out, ',');
+    out_uint(out, (uint64_t)rect->width);
+    out_char(out, ',');
+    out_uint(out, (uint64_t)rect->height);
+    out_str(out, "],\"unit\":\"");
+    out_str(out, unit_symbol(frame->unit));
+    out_char(out, '"');
+    write_camera_info(out, img);
+    write_thermal_parameters(out, img, frame->unit);
+    write_gps(out, img);
+    out_str(out, ",\"stats\":{\"min\":");
+    out_json_number(out, frame->stats.min, 4);
+    out_str(out, ",\"max\":");
+    out_json_number(out, frame->stats.max, 4);
+    out_str(out, ",\"mean\":");
+    out_json_number(out, frame->stats.mean, 4);
+    out_str(out, "},\"values\":[");
+}
+
+bool serialize_metadata_json(OutBuf *out, ACS_ThermalImage *img, const char *file, TempUnit unit) {
+    out_char(out, '{');
+    if (file) {
+        out_str(out, "\"file\":");
+        out_json_string(out, file);
+        out_char(out, ',');
+    }
+    out_str(out, "\"width\":");
+    out_uint(out, (uint64_t)ACS_ThermalImage_getWidth(img));
+    out_str(out, ",\"height\":");
+    out_uint(out, (uint64_t)ACS_ThermalImage_getHeight(img));
+    out_str(out, ",\"unit\":\"");
+    out_str(out, unit_symbol(unit));
+    out_char(out, '"');
+    write_camera_info(out, img);
+    write_thermal_parameters(out, img, unit);
+    write_gps(out, img);
+    out_str(out, "}\n");
+    return !out->failed;
+}
+
+#define JSON_TRAILER "\n]}\n"
+
+static void write_json_row(OutBuf *out, const Frame *frame, size_t y) {
+    size_t width = (size_t)frame->width;
+    const double *values = frame->values + y * width;
+    out_str(out, y ? ",\n[" : "\n[");
+    for (size_t x = 0; x < width; ++x) {
+        if (x)
+            out_char(out, ',');
+        out_json_number(out, values[x], 2);
+    }
+    out_char(out, ']');
+}
+
+// Gera linhas a partir de `*row` até acumular `budget` bytes ou acabar a matriz,
+// fechando o documento depois da última; true quando o fechamento foi gravado
+static bool write_json_rows(OutBuf *out, const Frame *frame, size_t *row, size_t budget) {
+    size_t height = (size_t)frame->height;
+    size_t start = out->len;
+    while (*row < height) {
+        write_json_row(out, frame, (*row)++);
+        if (out->len - start >= budget)
+            return false;
+    }
+    out_str(out, JSON_TRAILER);
+    return true;
+}
+
+bool serialize_json(OutBuf *out, ACS_ThermalImage *img, const Frame *frame) {
+    write_json_header(out, img, frame);
+    size_t row = 0;
+    // Com sink, out_reserve descarrega sozinho; sem limite de orçamento por chamada
+    write_json_rows(out, frame, &row, SIZE_MAX);
+    return !out->failed;
+}
+
+typedef struct {
+    const Frame *frame;
+    OutputFormat format;
+    const CsvDialect *csv;
+    OutBuf *bands;
+    size_t rows_per_band;
+} BandJob;
+
+static void format_band(void *ctx, unsigned worker, size_t index) {
+    (void)worker;
+    BandJob *job = ctx;
+    OutBuf *band = &job->bands[index];
+    size_t first = index * job->rows_per_band, last = first + job->rows_per_band;
+    if (last > (size_t)job->frame->height)
+        last = (size_t)job->frame->height;
+    band->len = 0;
+    if (job->format == FORMAT_JSON)
+        for (size_t y = first; y < last; ++y)
+            write_json_row(band, job->frame, y);
+    else
+        write_csv_rows(band, job->frame, job->csv, first, last);
+}
+
+static bool row_bands_reserve(RowBands *rb, size_t count) {
+    if (rb->capacity >= count)
+        return true;
+    OutBuf *grown = realloc(rb->bands, count * sizeof(*grown));
+    if (!grown)
+        return false;
+    rb->bands = grown;
+    for (size_t i = rb->capacity; i < count; ++i)
+        out_init_memory(&rb->bands[i], 0);
+    rb->capacity = count;
+    return true;
+}
+
+bool serialize_banded(OutBuf *out, ACS_ThermalImage *img, const Frame *frame, OutputFormat format,
+                      const CsvDialect *csv, RowBands *rb, unsigned workers) {
+    CsvDialect dialect = csv ? *csv : CSV_DEFAULT_DIALECT;
+    size_t height = (size_t)frame->height;
+    size_t pixels = (size_t)frame->width * height;
+    size_t count = workers;
+    bool banded = rb && workers > 1 && pixels >= SERIALIZE_BAND_MIN_PIXELS && height >= 2 * SERIALIZE_BAND_MIN_ROWS;
+    if (banded) {
+        // Algumas faixas por thread equilibram linhas de custo diferente; nunca menores que o mínimo
+        count = (size_t)workers * 4;
+        if (count > height / SERIALIZE_BAND_MIN_ROWS)
+            count = height / SERIALIZE_BAND_MIN_ROWS;
+        banded = row_bands_reserve(rb, count);
+    }
+    if (!banded)
+        return format == FORMAT_JSON ? serialize_json(out, img, frame) : serialize_csv(out, frame, &dialect);
+
+    BandJob job = { frame, format, &dialect, rb->bands, (height + count - 1) / count };
+    count = (height + job.rows_per_band - 1) / job.rows_per_band;
+    pool_run(count, workers, format_band, &job);
+    for (size_t i = 0; i < count; ++i)
+        if (rb->bands[i].failed)
+            return false;
+
+    if (format == FORMAT_JSON)
+        write_json_header(out, img, frame);
+    else
+        write_csv_header(out, frame, &dialect);
+    out_write_buffers(out, rb->bands, count);
+    if (format == FORMAT_JSON)
+        out_str(out, JSON_TRAILER);
+    return !out->failed;
+}
+
+void row_bands_free(RowBands *rb) {
+    for (size_t i = 0; i < rb->capacity; ++i)
+        out_free(&rb->bands[i]);
+    free(rb->bands);
+    rb->bands = NULL;
+    rb->capacity = 0;
+}
+
+bool json_stream_init(JsonStream *js, ACS_ThermalImage *img, const Frame *frame, double *owned, char *chunk,
+                      size_t chunk_size) {
+    memset(js, 0, sizeof(*js));
+    js->frame = *frame;
+    js->owned = owned;
+    if (chunk)
+        out_init_buffer(&js->chunk, chunk, chunk_size);
+    else
+        out_init_memory(&js->chunk, chunk_size);
+    write_json_header(&js->chunk, img, frame);
+    return !js->chunk.failed;
+}
+
+size_t json_stream_read(JsonStream *js, char *dst, size_t max) {
+    if (js->pos == js->chunk.len) {
+        if (js->finished || js->chunk.failed)
+            return 0;
+        // Reaproveita o bloco: uma linha longa pode crescê-lo, mas nunca o documento inteiro
+        js->chunk.len = js->pos = 0;
+        js->finished = write_json_rows(&js->chunk, &js->frame, &js->row, js->chunk.capacity / 2);
+        if (js->chunk.failed)
+            return 0;
+    }
+    size_t n = js->chunk.len - js->pos;
+    if (n > max)
+        n = max;
+    memcpy(dst, js->chunk.data + js->pos, n);
+    js->pos += n;
+    return n;
+}
+
+void json_stream_free(JsonStream *js) {
+    out_free(&js->chunk);
+    free(js->owned);
+    js->owned = NULL;
+}
+
+void serialize_summary_header(OutBuf *out, OutputFormat format, bool with_roi) {
+    if (format == FORMAT_CSV)
+        out_str(out, with_roi ? "frame;roi;unit;min;max;mean;stddev;hot_x;hot_y;cold_x;cold_y\n"
+                              : "frame;unit;min;max;mean;stddev;hot_x;hot_y;cold_x;cold_y\n");
+}
+
+void serialize_summary(OutBuf *out, OutputFormat format, const FrameSummary *sm, long index, bool with_roi) {
+    if (index < 0)
+        index = 0;
+    if (format == FORMAT_JSON) {
+        out_str(out, "{\"frame\":");
+        out_int(out, index);
+        if (with_roi) {
+            out_str(out, ",\"roi\":[");
+            write_rect(out, &sm->rect);
+            out_char(out, ']');
+        }
+        out_str(out, ",\"unit\":\"");
+        out_str(out, unit_symbol(sm->unit));
+        out_str(out, "\",\"min\":");
+        out_json_number(out, sm->min, 4);
+        out_str(out, ",\"max\":");
+        out_json_number(out, sm->max, 4);
+        out_str(out, ",\"mean\":");
+        out_json_number(out, sm->mean, 4);
+        out_str(out, ",\"stddev\":");
+        out_json_number(out, sm->stddev, 4);
+        out_str(out, ",\"hot\":[");
+        out_int(out, sm->hot_x);
+        out_char(out, ',');
+        out_int(out, sm->hot_y);
+        out_str(out, "],\"cold\":[");
+        out_int(out, sm->cold_x);
+        out_char(out, ',');
+        out_int(out, sm->cold_y);
+        out_str(out, "]}\n");
+        return;
+    }
+    out_int(out, index);
+    out_char(out, ';');
+    if (with_roi) {
+        write_rect(out, &sm->rect);
+        out_char(out, ';');
+    }
+    out_str(out, unit_symbol(sm->unit));
+    out_char(out, ';');
+    out_fixed(out, sm->min, 4);
+    out_char(out, ';');
+    out_fixed(out, sm->max, 4);
+    out_char(out, ';');
+    out_fixed(out, sm->mean, 4);
+    out_char(out, ';');
+    out_fixed(out, sm->stddev, 4);
+    out_char(out, ';');
+    out_int(out, sm->hot_x);
+    out_char(out, ';');
+    out_int(out, sm->hot_y);
+    out_char(out, ';');
+    out_int(out, sm->cold_x);
+    out_char(out, ';');
+    out_int(out, sm->cold_y);
+    out_char(out, '\n');
+}
+
+void serialize_histogram_json(OutBuf *out, const SignalLut *lut, TempUnit unit, const FrameStats *fs, int bins) {
+    uint64_t *counts = calloc((size_t)bins, sizeof(uint64_t));
+    if (!counts) {
+        out->failed = true;
+        return;
+    }
+    UnitConv conv = unit_conv(unit);
+    double span = fs->max - fs->min;
+    for (size_t i = 0; i < lut->len; ++i) {
+        if (!lut->histogram[i])
+            continue;
+        double v = lut->values[i] * conv.mul + conv.add;
+        int b = span > 0.0 ? (int)((v - fs->min) / span * bins) : 0;
+        if (b < 0) b = 0;
+        if (b >= bins) b = bins - 1;
+        counts[b] += lut->histogram[i];
+    }
+
+    out_str(out, ", \"histogram\": {\"min\": ");
+    out_json_number(out, fs->min, 4);
+    out_str(out, ", \"max\": ");
+    out_json_number(out, fs->max, 4);
+    out_str(out, ", \"counts\": [");
+    for (int b = 0; b < bins; ++b) {
+        if (b) out_str(out, ", ");
+        out_uint(out, counts[b]);
+    }
+    out_str(out, "]}");
+    free(counts);
+}
@@ -0,0 +1,133 @@
+#ifndef FLIR2JSON_SERIALIZE_H
+#define FLIR2JSON_SERIALIZE_H
+
+#include "engine.h"
+#include "output.h"
+
+// Formatos de saída suportados
+typedef enum {
+    FORMAT_CSV,
+    FORMAT_BIN,
+    FORMAT_JSON,
+    FORMAT_DELTA, // quadros u16 com quadro-chave + diferenças comprimidas (delta.h)
+    FORMAT_ARROW  // arquivo Arrow IPC, uma linha por matriz (arrow.h)
+} OutputFormat;
+
+// Tipo do payload binário
+typedef enum {
+    DTYPE_F32,
+    DTYPE_U16
+} BinaryDType;
+
+// Dialeto do CSV da matriz; o padrão é o formato histórico (`;`, 2 casas, sem cabeçalho)
+typedef struct {
+    char delimiter; // entre colunas
+    int decimals;   // 0..OUT_ROW_MAX_DECIMALS
+    bool header;    // primeira linha com a coluna x (pixels da imagem) de cada valor
+} CsvDialect;
+
+#define CSV_DEFAULT_DIALECT ((CsvDialect){ ';', 2, false })
+
+typedef struct {
+    OutputFormat format;
+    BinaryDType dtype;
+    double scale;  // u16: temperatura = valor * scale + offset
+    double offset; // na unidade de saída
+    CsvDialect csv;
+} OutputOptions;
+
+// Faixa aceita para scale/offset do u16 (--scale/--offset, ?scale=/?offset=): além dela o
+// u16 não representa temperaturas de forma útil
+#define OUTPUT_SCALE_MIN 1e-6
+#define OUTPUT_SCALE_MAX 1e3
+#define OUTPUT_OFFSET_MAX 1e6
+
+// Alinhamento do início do payload binário (permite mmap/SIMD direto)
+#define BIN_PAYLOAD_ALIGN 64
+
+bool output_format_parse(const char *s, OutputFormat *format);
+bool output_dtype_parse(const char *s, BinaryDType *dtype);
+// Um de , ; | : ou "tab"/"space"
+bool csv_delimiter_parse(const char *s, char *delimiter);
+const char *output_content_type(OutputFormat format);
+
+// Extensão de arquivo do formato ("csv", "bin", "json", "f2jd", "arrow")
+const char *output_extension(OutputFormat format);
+
+// Formatos binários (arquivos abertos em modo "wb")
+bool output_is_binary(OutputFormat format);
+
+// Ajusta a extração ao formato (u16 sai direto do kernel no caminho de sinal)
+void output_configure_extract(const OutputOptions *out_opt, ExtractOptions *ext_opt);
+
+// Os serializadores aceitam `img` NULL (quadros ao vivo): os metadados do SDK ficam de fora.
+
+// Matriz em texto: uma linha por linha da imagem, no dialeto `csv` (NULL: o padrão,
+// `;` entre colunas e 2 casas decimais). Quadros de sequência começam com a linha
+// "# frame N"; variantes de parâmetros trazem "# params ..." e, com várias ROIs, cada
+// retângulo vem depois de "# roi x,y,w,h". O cabeçalho do dialeto vem depois dessas linhas.
+bool serialize_csv(OutBuf *out, const Frame *frame, const CsvDialect *csv);
+
+// Cabeçalho JSON de uma linha (com padding até BIN_PAYLOAD_ALIGN) seguido do
+// payload little-endian contíguo. `clipped` recebe os pixels u16 saturados.
+// Leitura em Python: np.fromfile(path, dtype=hdr["dtype"], offset=hdr["data_offset"]).reshape(h, w)
+bool serialize_bin(OutBuf *out, ACS_ThermalImage *img, const Frame *frame, const OutputOptions *opt,
+                   Workspace *ws, size_t *clipped);
+
+// Documento JSON: metadados (câmera, parâmetros térmicos, GPS, estatísticas) e a
+// matriz em "values" como um array por linha. É gerado linha a linha, então com
+// sink o pico de memória é só o buffer do OutBuf.
+bool serialize_json(OutBuf *out, ACS_ThermalImage *img, const Frame *frame);
+
+// Matrizes grandes em CSV/JSON formatadas em paralelo: faixas de linhas, cada uma num
+// buffer próprio (reaproveitado entre chamadas), anexadas em ordem com out_write_buffers
+// (writev quando `out` grava em arquivo). Saída idêntica a serialize_csv/serialize_json,
+// que são usados abaixo dos limites, com um worker ou com `rb` NULL.
+#define SERIALIZE_BAND_MIN_PIXELS (1u << 19)
+#define SERIALIZE_BAND_MIN_ROWS 32
+
+typedef struct {
+    OutBuf *bands;
+    size_t capacity;
+} RowBands;
+
+bool serialize_banded(OutBuf *out, ACS_ThermalImage *img, const Frame *frame, OutputFormat format,
+                      const CsvDialect *csv, RowBands *rb, unsigned workers);
+void row_bands_free(RowBands *rb);
+
+// Leitura incremental do mesmo documento, para respostas em blocos (ex.: callback do MHD).
+// Os metadados são gravados já em json_stream_init, então a imagem pode ser
+// reaproveitada logo depois; a matriz de frame->values precisa continuar válida
+// até o fim da leitura (ou pertencer ao stream, via `owned`).
+typedef struct {
+    Frame frame;
+    double *owned;  // liberado em json_stream_free
+    size_t row;     // próxima linha a gerar
+    bool finished;  // fechamento do documento já está no bloco
+    OutBuf chunk;   // bloco atual, de tamanho fixo
+    size_t pos;     // bytes do bloco já entregues
+} JsonStream;
+
+// `chunk` (alocado com malloc, ou NULL para alocar) passa a pertencer ao stream
+bool json_stream_init(JsonStream *js, ACS_ThermalImage *img, const Frame *frame, double *owned, char *chunk,
+                      size_t chunk_size);
+// Copia até `max` bytes para `dst`; 0 indica fim do documento
+size_t json_stream_read(JsonStream *js, char *dst, size_t max);
+void json_stream_free(JsonStream *js);
+
+// Só os metadados (--metadata-only, POST /metadata), sem extrair nem tocar nos pixels:
+// uma linha JSON {"file":...,"width":W,"height":H,"unit":...,"camera":{...},
+// "thermal_parameters":{...},"gps":{...}}, com as temperaturas dos parâmetros em `unit`.
+// `file` NULL omite o campo.
+bool serialize_metadata_json(OutBuf *out, ACS_ThermalImage *img, const char *file, TempUnit unit);
+
+// Série temporal do modo só-estatísticas, uma linha por quadro:
+// CSV com cabeçalho (mesmo separador `;` da matriz) ou NDJSON (FORMAT_JSON).
+// `with_roi` acrescenta o retângulo (coluna "roi" / campo "roi"), para várias ROIs por quadro.
+void serialize_summary_header(OutBuf *out, OutputFormat format, bool with_roi);
+void serialize_summary(OutBuf *out, OutputFormat format, const FrameSummary *sm, long index, bool with_roi);
+
+// Fragmento `, "histogram": {...}` com `bins` faixas em [min, max], derivado da contagem por sinal
+void serialize_histogram_json(OutBuf *out, const SignalLut *lut, TempUnit unit, const FrameStats *fs, int bins);
+
+#endif
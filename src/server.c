@@ -1,39 +1,2626 @@
+#include <acs/thermal_image.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdbool.h>
 #include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
 #include <microhttpd.h>
 
+#include "admission.h"
+#include "archive.h"
+#include "arena.h"
+#include "arrow.h"
+#include "cache.h"
+#include "compress.h"
+#include "delta.h"
+#include "engine.h"
+#include "input.h"
+#include "jobs.h"
+#include "live.h"
+#include "hotspot.h"
+#include "isotherm.h"
+#include "measure.h"
+#include "metrics.h"
+#include "output.h"
+#include "params.h"
+#include "pool.h"
+#include "render.h"
+#include "serialize.h"
+
 #define PORT 8080
 
-static int handle_request(void *cls, struct MHD_Connection *connection,
-                          const char *url, const char *method,
-                          const char *version, const char *upload_data,
-                          size_t *upload_data_size, void **con_cls)
+// Maior corpo aceito em POST /extract
+#define MAX_UPLOAD_BYTES (64u << 20)
+// Lote inteiro num corpo só (~200 imagens por visita de campo, com folga)
+#define BATCH_MAX_UPLOAD_BYTES (512u << 20)
+// Sequência de POST /jobs, gravada direto em disco
+#define JOBS_MAX_UPLOAD_BYTES ((size_t)64 << 30)
+
+// Corpo recebido de uma conexão, acumulado entre as chamadas do MHD num bloco da arena
+typedef struct Upload {
+    ArenaBlock *block;
+    size_t len;
+    size_t limit; // MAX_UPLOAD_BYTES, BATCH_MAX_UPLOAD_BYTES ou JOBS_MAX_UPLOAD_BYTES
+    Job *job;     // POST /jobs: o corpo vai para o arquivo do job, não para a arena
+    bool too_large;
+    AdmissionTicket ticket; // vaga no controle de admissão, até o fim da requisição
+    uint64_t started_ns; // primeira chamada (métricas)
+    uint64_t queued_ns;  // resposta enfileirada
+    struct Upload *next; // lista de livres da thread
+} Upload;
+
+// Estado de cada thread do pool do MHD: uma imagem ACS, os buffers de extração e os
+// blocos de upload e de resposta, reaproveitados entre as requisições da thread
+static __thread ACS_ThermalImage *worker_image;
+static __thread Workspace workspace;
+static __thread Arena arena;
+static __thread Upload *spare_uploads;
+static __thread Renderer renderer;
+static __thread RowBands bands;
+
+// Threads por matriz grande em CSV/JSON (serialize_banded); poucas, porque as
+// requisições já rodam em paralelo no pool do MHD
+#define BAND_WORKERS 4
+
+// Contextos aquecidos na partida: uma imagem ACS que já decodificou um quadro, um
+// Workspace já dimensionado e o colorizador dessa imagem, entregues às threads do
+// pool na primeira requisição
+typedef struct WarmContext
+{
+    ACS_ThermalImage *image;
+    Workspace workspace;
+    Renderer renderer;
+    struct WarmContext *next;
+} WarmContext;
+
+static WarmContext *warm_contexts;
+static pthread_mutex_t warm_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// /health só responde ok depois do aquecimento
+static atomic_bool server_ready;
+
+// Quadro do aquecimento sem --warmup
+#define WARMUP_WIDTH 640
+#define WARMUP_HEIGHT 480
+
+// Respostas de POST /extract já codificadas (cache.h); --cache-mb 0 desliga
+static ResultCache result_cache;
+#define CACHE_DEFAULT_MB 128
+#define CACHE_DIR_DEFAULT_MB 4096
+
+// Threads do pool do MHD, para a utilização em /metrics
+static unsigned int server_workers;
+
+// Extrações de sequência assíncronas (POST /jobs); desligadas com --max-jobs 0
+#define JOBS_DEFAULT_DIR "/tmp/flir2json-jobs"
+static JobQueue job_queue;
+static bool jobs_enabled;
+
+// Vagas das requisições com corpo (admission.h); padrão: ADMISSION_DEFAULT_DEPTH por
+// thread do pool e, por cliente, no máximo uma requisição por thread
+static Admission admission;
+#define ADMISSION_DEFAULT_DEPTH 4
+
+// gzip das respostas de /extract e /render (compress.h); 0 threads desliga
+static CompressStage compress_stage;
+#define COMPRESS_DEFAULT_THREADS 2
+
+// Toda resposta passa por aqui: conta a classe do status e os bytes de corpo já
+// conhecidos (respostas por callback contam os bytes conforme os geram)
+static enum MHD_Result queue_response(struct MHD_Connection *connection, unsigned int status,
+                                      struct MHD_Response *response, uint64_t bytes)
+{
+    metrics_response(status);
+    metrics_bytes_out(bytes);
+    return MHD_queue_response(connection, status, response);
+}
+
+// Imagem ACS da thread; na primeira requisição, adota um contexto aquecido se houver
+static ACS_ThermalImage *worker_context(void)
+{
+    if (worker_image)
+        return worker_image;
+    pthread_mutex_lock(&warm_lock);
+    WarmContext *ctx = warm_contexts;
+    if (ctx)
+        warm_contexts = ctx->next;
+    pthread_mutex_unlock(&warm_lock);
+    if (!ctx)
+        return worker_image = ACS_ThermalImage_alloc();
+    worker_image = ctx->image;
+    workspace = ctx->workspace;
+    renderer = ctx->renderer;
+    free(ctx);
+    return worker_image;
+}
+
+// Carrega o SDK e prepara um contexto por thread: cada imagem decodifica
+// o quadro de aquecimento, extrai a matriz em CSV, JSON e binário e o coloriza em PNG e
+// JPEG, o que resolve os símbolos, aquece decodificador, kernels e colorizador e deixa
+// os buffers no tamanho do quadro
+static bool warm_up(unsigned int workers, const char *path)
+{
+    unsigned char *data;
+    size_t len;
+    if (path ? !input_read_file(path, &data, &len) : !input_synthetic(WARMUP_WIDTH, WARMUP_HEIGHT, &data, &len))
+    {
+        fprintf(stderr, "❌ Failed to load warm-up frame %s\n", path ? path : "(synthetic)");
+        return false;
+    }
+
+    ExtractOptions ext = { .engine = ENGINE_SIGNAL, .unit = UNIT_CELSIUS };
+    OutputOptions formats[] = {
+        { FORMAT_CSV, DTYPE_F32, 0.01, 0.0, CSV_DEFAULT_DIALECT },
+        { FORMAT_JSON, DTYPE_F32, 0.01, 0.0, CSV_DEFAULT_DIALECT },
+        { FORMAT_BIN, DTYPE_U16, 0.01, unit_absolute_zero(UNIT_CELSIUS), CSV_DEFAULT_DIALECT },
+    };
+    OutBuf out;
+    out_init_memory(&out, OUT_DEFAULT_CAPACITY);
+    bool ok = true;
+    for (unsigned int w = 0; ok && w < workers; ++w)
+    {
+        WarmContext *ctx = calloc(1, sizeof(*ctx));
+        if (!ctx || !(ctx->image = ACS_ThermalImage_alloc()))
+        {
+            free(ctx);
+            ok = engine_fail("sem memória para os contextos");
+            break;
+        }
+        ACS_ThermalImage_openFromMemory(ctx->image, data, len);
+        ok = !ACS_getLastErrorCode() || engine_fail("%s", ACS_getLastErrorMessage());
+        ok = ok && engine_prepare(ctx->image, &ext);
+        ACS_Rectangle rect = { 0, 0, ACS_ThermalImage_getWidth(ctx->image), ACS_ThermalImage_getHeight(ctx->image) };
+        for (size_t f = 0; ok && f < sizeof(formats) / sizeof(formats[0]); ++f)
+        {
+            Frame frame;
+            size_t clipped;
+            ExtractOptions opt = ext;
+            output_configure_extract(&formats[f], &opt);
+            out.len = 0;
+            ok = engine_extract(ctx->image, &rect, &opt, &ctx->workspace, &frame) &&
+                 (formats[f].format == FORMAT_BIN
+                      ? serialize_bin(&out, ctx->image, &frame, &formats[f], &ctx->workspace, &clipped)
+                  : formats[f].format == FORMAT_JSON ? serialize_json(&out, ctx->image, &frame)
+                                                     : serialize_csv(&out, &frame, NULL));
+        }
+        for (int f = RENDER_PNG; ok && f <= RENDER_JPEG; ++f)
+        {
+            RenderOptions render = { ACS_PalettePreset_iron, (RenderFormat)f, false, 0.0, 0.0,
+                                     RENDER_DEFAULT_QUALITY };
+            out.len = 0;
+            ok = render_image(&ctx->renderer, ctx->image, &render, &out);
+        }
+        pthread_mutex_lock(&warm_lock);
+        ctx->next = warm_contexts;
+        warm_contexts = ctx;
+        pthread_mutex_unlock(&warm_lock);
+    }
+    out_free(&out);
+    free(data);
+    if (!ok)
+        fprintf(stderr, "❌ Warm-up failed: %s\n", engine_last_error());
+    return ok;
+}
+
+// Documento de resposta montado direto num bloco da arena
+static void arena_out_init(OutBuf *out, ArenaBlock *block)
+{
+    out_init_buffer(out, block->data, block->capacity);
+}
+
+// Recupera o buffer (que pode ter crescido) do OutBuf de volta para o bloco
+static void arena_out_finish(OutBuf *out, ArenaBlock *block)
+{
+    block->data = out->data;
+    block->capacity = out->capacity;
+    out->data = NULL;
+    out->capacity = 0;
+}
+
+static void arena_out_discard(OutBuf *out, ArenaBlock *block)
+{
+    arena_out_finish(out, block);
+    arena_give(&arena, block);
+}
+
+static void arena_response_release(void *cls)
+{
+    arena_give(&arena, cls);
+}
+
+static enum MHD_Result send_buffer(struct MHD_Connection *connection, unsigned int status,
+                                   const char *content_type, void *data, size_t len,
+                                   enum MHD_ResponseMemoryMode mode)
+{
+    struct MHD_Response *response = MHD_create_response_from_buffer(len, data, mode);
+    if (!response)
+    {
+        if (mode == MHD_RESPMEM_MUST_FREE)
+            free(data);
+        return MHD_NO;
+    }
+    MHD_add_response_header(response, "Content-Type", content_type);
+    enum MHD_Result ret = queue_response(connection, status, response, len);
+    MHD_destroy_response(response);
+    return ret;
+}
+
+static enum MHD_Result send_error(struct MHD_Connection *connection, unsigned int status, const char *message)
+{
+    OutBuf out;
+    out_init_memory(&out, 256);
+    out_str(&out, "{\"status\":\"error\",\"message\":");
+    out_json_string(&out, message);
+    out_char(&out, '}');
+    if (out.failed)
+    {
+        out_free(&out);
+        return MHD_NO;
+    }
+    return send_buffer(connection, status, "application/json", out.data, out.len, MHD_RESPMEM_MUST_FREE);
+}
+
+// Recusa sem ler o corpo: 503 com a fila cheia, 429 com o cliente no limite, e o
+// Retry-After para o cliente esperar antes de reenviar
+static enum MHD_Result send_busy(struct MHD_Connection *connection, AdmissionVerdict verdict)
+{
+    bool full = verdict == ADMIT_FULL;
+    unsigned int status = full ? MHD_HTTP_SERVICE_UNAVAILABLE : MHD_HTTP_TOO_MANY_REQUESTS;
+    const char *message = full ? "server busy: pending request limit reached"
+                               : "too many concurrent requests from this client";
+    char retry[16];
+    snprintf(retry, sizeof(retry), "%u", admission_retry_after(&admission, verdict));
+    OutBuf out;
+    out_init_memory(&out, 128);
+    out_str(&out, "{\"status\":\"error\",\"message\":");
+    out_json_string(&out, message);
+    out_char(&out, '}');
+    if (out.failed)
+    {
+        out_free(&out);
+        return MHD_NO;
+    }
+    size_t len = out.len;
+    struct MHD_Response *response = MHD_create_response_from_buffer(len, out.data, MHD_RESPMEM_MUST_FREE);
+    if (!response)
+    {
+        out_free(&out);
+        return MHD_NO;
+    }
+    MHD_add_response_header(response, "Content-Type", "application/json");
+    MHD_add_response_header(response, MHD_HTTP_HEADER_RETRY_AFTER, retry);
+    enum MHD_Result ret = queue_response(connection, status, response, len);
+    MHD_destroy_response(response);
+    return ret;
+}
+
+// Garante `need` bytes contíguos, preservando o que já chegou
+static bool upload_reserve(Upload *up, size_t need)
+{
+    if (!up->block)
+        return (up->block = arena_take(&arena, need)) != NULL;
+    return arena_grow(up->block, need);
+}
+
+// O bloco volta à arena, a vaga à admissão e o estado da conexão à lista de livres da thread
+static void upload_release(Upload *up)
+{
+    admission_leave(&admission, &up->ticket, metrics_now());
+    arena_give(&arena, up->block);
+    up->next = spare_uploads;
+    spare_uploads = up;
+}
+
+// Com Content-Length o buffer já tem o tamanho final; sem ele (chunked), dobra
+static bool upload_append(Upload *up, const char *data, size_t size)
+{
+    if (up->too_large || size > up->limit - up->len)
+    {
+        up->too_large = true;
+        return false;
+    }
+    size_t capacity = up->block ? up->block->capacity : 0;
+    if (up->len + size > capacity)
+    {
+        size_t cap = capacity ? capacity : 64 * 1024;
+        while (cap < up->len + size)
+            cap *= 2;
+        if (!upload_reserve(up, cap < up->limit ? cap : up->limit))
+            return false;
+    }
+    memcpy(up->block->data + up->len, data, size);
+    up->len += size;
+    return true;
+}
+
+// Lê format/csv_*/dtype/unit/engine/scale/offset/downsample/pool da query string
+static bool parse_query(struct MHD_Connection *connection, ExtractOptions *ext, OutputOptions *out,
+                        bool allow_delta, const char **bad)
+{
+    memset(ext, 0, sizeof(*ext));
+    memset(out, 0, sizeof(*out));
+    ext->engine = ENGINE_SIGNAL;
+    ext->unit = UNIT_CELSIUS;
+    out->format = FORMAT_CSV;
+    out->csv = CSV_DEFAULT_DIALECT;
+    out->dtype = DTYPE_F32;
+    out->scale = 0.01;
+
+    const char *v;
+    // delta só existe entre quadros (GET /live?kind=delta, POST /jobs)
+    if ((v = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "format")) &&
+        (!output_format_parse(v, &out->format) || (out->format == FORMAT_DELTA && !allow_delta)))
+        return *bad = "format", false;
+    if ((v = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "csv_delimiter")) &&
+        !csv_delimiter_parse(v, &out->csv.delimiter))
+        return *bad = "csv_delimiter", false;
+    if ((v = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "csv_decimals")))
+    {
+        char *end;
+        long n = strtol(v, &end, 10);
+        if (*end || end == v || n < 0 || n > OUT_ROW_MAX_DECIMALS)
+            return *bad = "csv_decimals", false;
+        out->csv.decimals = (int)n;
+    }
+    if ((v = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "csv_header")))
+    {
+        if (strcmp(v, "1") == 0 || strcmp(v, "true") == 0) out->csv.header = true;
+        else if (strcmp(v, "0") == 0 || strcmp(v, "false") == 0) out->csv.header = false;
+        else return *bad = "csv_header", false;
+    }
+    if ((v = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "dtype")) &&
+        !output_dtype_parse(v, &out->dtype))
+        return *bad = "dtype", false;
+    if ((v = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "unit")) &&
+        !unit_parse(v, &ext->unit))
+        return *bad = "unit", false;
+    if ((v = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "engine")))
+    {
+        if (strcmp(v, "signal") == 0) ext->engine = ENGINE_SIGNAL;
+        else if (strcmp(v, "values") == 0) ext->engine = ENGINE_VALUES;
+        else return *bad = "engine", false;
+    }
+    if ((v = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "scale")))
+    {
+        char *end;
+        out->scale = strtod(v, &end);
+        if (*end || !(out->scale >= OUTPUT_SCALE_MIN && out->scale <= OUTPUT_SCALE_MAX))
+            return *bad = "scale", false;
+    }
+    out->offset = unit_absolute_zero(ext->unit);
+    if ((v = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "offset")))
+    {
+        char *end;
+        out->offset = strtod(v, &end);
+        if (*end || end == v || !(out->offset >= -OUTPUT_OFFSET_MAX && out->offset <= OUTPUT_OFFSET_MAX))
+            return *bad = "offset", false;
+    }
+    if ((v = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "downsample")))
+    {
+        char *end;
+        long factor = strtol(v, &end, 10);
+        if (*end || factor < 1 || factor > DOWNSAMPLE_MAX)
+            return *bad = "downsample", false;
+        ext->downsample = (unsigned)factor;
+    }
+    if ((v = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "pool")) && !pool_parse(v, &ext->pool))
+        return *bad = "pool", false;
+    output_configure_extract(out, ext);
+    return true;
+}
+
+// Valores de ?roi= (repetível; cada valor aceita várias ROIs separadas por ';')
+typedef struct
+{
+    const char *specs[ROI_MAX];
+    size_t count;
+    bool overflow;
+} RoiQuery;
+
+static enum MHD_Result collect_roi(void *cls, enum MHD_ValueKind kind, const char *key, const char *value)
+{
+    (void)kind;
+    RoiQuery *q = cls;
+    if (strcmp(key, "roi") != 0)
+        return MHD_YES;
+    if (!value || q->count == ROI_MAX)
+    {
+        q->overflow = true;
+        return MHD_NO;
+    }
+    q->specs[q->count++] = value;
+    return MHD_YES;
+}
+
+// Retângulos pedidos na imagem width x height (ela inteira sem ?roi=)
+static bool resolve_rois(const RoiQuery *q, int width, int height, ACS_Rectangle *rects, size_t *count)
+{
+    *count = 0;
+    if (q->overflow)
+        return engine_fail("no máximo %d ROIs por imagem", ROI_MAX);
+    for (size_t i = 0; i < q->count; ++i)
+        if (!parse_roi_list(q->specs[i], width, height, rects, count))
+            return false;
+    if (!*count)
+    {
+        rects[0] = (ACS_Rectangle){ 0, 0, width, height };
+        *count = 1;
+    }
+    return true;
+}
+
+// Tamanho dos blocos do JSON enviados com chunked transfer
+#define JSON_CHUNK_BYTES (64u * 1024)
+
+// Stream em andamento: o bloco do JSON vem da arena e a matriz, do Workspace da thread
+typedef struct JsonResponse
+{
+    JsonStream js;
+    ArenaBlock *chunk;
+    size_t values_capacity;
+    uint64_t serialize_ns;     // soma das chamadas do reader, uma observação no fim
+    struct JsonResponse *next; // lista de livres da thread
+} JsonResponse;
+
+static __thread JsonResponse *spare_streams;
+
+static ssize_t json_stream_reader(void *cls, uint64_t pos, char *buf, size_t max)
+{
+    (void)pos;
+    JsonResponse *jr = cls;
+    uint64_t t0 = metrics_now();
+    size_t n = json_stream_read(&jr->js, buf, max);
+    jr->serialize_ns += metrics_now() - t0;
+    metrics_bytes_out(n);
+    if (n)
+        return (ssize_t)n;
+    return jr->js.chunk.failed ? MHD_CONTENT_READER_END_WITH_ERROR : MHD_CONTENT_READER_END_OF_STREAM;
+}
+
+// No fim do envio o bloco volta à arena e a matriz ao Workspace, para a próxima requisição
+static void json_stream_release(void *cls)
+{
+    JsonResponse *jr = cls;
+    if (jr->serialize_ns)
+        metrics_observe(STAGE_SERIALIZE, jr->serialize_ns);
+    if (jr->chunk)
+    {
+        arena_out_finish(&jr->js.chunk, jr->chunk);
+        arena_give(&arena, jr->chunk);
+    }
+    if (jr->js.owned)
+        workspace_give_values(&workspace, jr->js.owned, jr->values_capacity);
+    jr->js.owned = NULL;
+    json_stream_free(&jr->js);
+    jr->next = spare_streams;
+    spare_streams = jr;
+}
+
+// JSON sai em blocos pelo callback, sem montar o documento: o stream leva a matriz
+// double da thread enquanto gera as linhas conforme o MHD pede mais dados
+static enum MHD_Result send_json_stream(struct MHD_Connection *connection, ACS_ThermalImage *img,
+                                        const Frame *frame)
+{
+    JsonResponse *jr = spare_streams;
+    if (jr)
+        spare_streams = jr->next;
+    else if (!(jr = malloc(sizeof(*jr))))
+        return send_error(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, "out of memory");
+    JsonStream *js = &jr->js;
+    jr->serialize_ns = 0;
+    jr->chunk = arena_take(&arena, JSON_CHUNK_BYTES);
+    double *values = workspace_take_values(&workspace, &jr->values_capacity);
+    if (!jr->chunk)
+    {
+        memset(js, 0, sizeof(*js));
+        js->owned = values;
+    }
+    if (!jr->chunk || !json_stream_init(js, img, frame, values, jr->chunk->data, jr->chunk->capacity))
+    {
+        json_stream_release(jr);
+        return send_error(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, "out of memory while serializing");
+    }
+
+    struct MHD_Response *response = MHD_create_response_from_callback(MHD_SIZE_UNKNOWN, JSON_CHUNK_BYTES,
+                                                                      &json_stream_reader, jr,
+                                                                      &json_stream_release);
+    if (!response)
+    {
+        json_stream_release(jr);
+        return MHD_NO;
+    }
+    MHD_add_response_header(response, "Content-Type", output_content_type(FORMAT_JSON));
+    enum MHD_Result ret = queue_response(connection, MHD_HTTP_OK, response, 0);
+    MHD_destroy_response(response);
+    return ret;
+}
+
+// Push ao vivo (GET /live): cada quadro da câmera é codificado uma única vez como
+// evento SSE e o mesmo buffer, com contagem de referências, vai para todos os
+// assinantes. Cada canal guarda só o evento mais recente: um cliente lento termina
+// o evento que está enviando e pula direto para o último, sem fila por conexão.
+typedef enum
+{
+    PUSH_STATS, // resumo do quadro (uma linha JSON)
+    PUSH_FRAME, // documento JSON completo com a matriz
+    PUSH_DELTA, // quadro do formato delta (delta.h) em base64
+    PUSH_HOTSPOTS, // regiões acima do limite de --hotspots (hotspot.h), uma linha JSON
+    PUSH_KINDS
+} PushKind;
+
+typedef struct
+{
+    atomic_uint refs;
+    uint64_t seq;
+    uint64_t ref; // quadro-chave de que o evento depende (o próprio seq se independente)
+    size_t len;
+    char data[];
+} PushEvent;
+
+struct PushChannel;
+
+typedef struct Subscriber
+{
+    struct Subscriber *next;
+    struct PushChannel *channel;
+    struct MHD_Connection *connection;
+    PushEvent *event; // evento em envio
+    size_t pos;
+    uint64_t sent;    // último quadro enviado; UINT64_MAX antes do primeiro
+    uint64_t key;     // último quadro-chave enviado
+    bool suspended;
+} Subscriber;
+
+typedef struct PushChannel
+{
+    pthread_mutex_t lock;
+    PushEvent *latest;
+    PushEvent *key; // último quadro-chave (delta), para quem entra ou perdeu a referência
+    Subscriber *subscribers;
+    atomic_uint count; // assinantes: sem nenhum, o quadro nem é codificado
+} PushChannel;
+
+// Uma câmera do modo ao vivo; só um worker do live.c de cada vez codifica
+typedef struct
+{
+    const char *ip;
+    PushChannel channels[PUSH_KINDS];
+    Workspace workspace;
+    OutBuf doc;
+    DeltaEncoder delta;
+} LiveFeed;
+
+static LiveFeed *live_feeds;
+static size_t live_feed_count;
+static HotspotOptions live_hotspots; // --hotspots T: habilita GET /live?kind=hotspots
+
+static void push_event_release(PushEvent *ev)
+{
+    if (ev && atomic_fetch_sub_explicit(&ev->refs, 1, memory_order_acq_rel) == 1)
+        free(ev);
+}
+
+// Monta o evento SSE a partir do documento: cada linha vira um campo "data:"
+static PushEvent *push_event_create(const char *name, uint64_t seq, const char *doc, size_t len)
+{
+    while (len && doc[len - 1] == '\n')
+        --len;
+    size_t lines = 1;
+    for (size_t i = 0; i < len; ++i)
+        lines += doc[i] == '\n';
+
+    char head[64];
+    int head_len = snprintf(head, sizeof(head), "id: %llu\nevent: %s\n", (unsigned long long)seq, name);
+    size_t size = (size_t)head_len + len + lines * 6 + 1;
+    PushEvent *ev = malloc(sizeof(*ev) + size);
+    if (!ev)
+        return NULL;
+    atomic_init(&ev->refs, 1);
+    ev->seq = seq;
+    ev->ref = seq;
+    char *p = ev->data;
+    memcpy(p, head, (size_t)head_len);
+    p += head_len;
+    memcpy(p, "data: ", 6);
+    p += 6;
+    for (size_t i = 0; i < len; ++i)
+    {
+        *p++ = doc[i];
+        if (doc[i] == '\n')
+        {
+            memcpy(p, "data: ", 6);
+            p += 6;
+        }
+    }
+    *p++ = '\n';
+    *p++ = '\n';
+    ev->len = (size_t)(p - ev->data);
+    return ev;
+}
+
+// Evento com o quadro binário em base64, numa única linha "data:"
+static PushEvent *push_event_base64(const char *name, uint64_t seq, uint64_t ref, const unsigned char *data,
+                                    size_t len)
+{
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    char head[64];
+    int head_len = snprintf(head, sizeof(head), "id: %llu\nevent: %s\ndata: ", (unsigned long long)seq, name);
+    size_t size = (size_t)head_len + (len + 2) / 3 * 4 + 2;
+    PushEvent *ev = malloc(sizeof(*ev) + size);
+    if (!ev)
+        return NULL;
+    atomic_init(&ev->refs, 1);
+    ev->seq = seq;
+    ev->ref = ref;
+    char *p = ev->data;
+    memcpy(p, head, (size_t)head_len);
+    p += head_len;
+    size_t i = 0;
+    for (; i + 2 < len; i += 3)
+    {
+        uint32_t v = (uint32_t)data[i] << 16 | (uint32_t)data[i + 1] << 8 | data[i + 2];
+        *p++ = alphabet[v >> 18];
+        *p++ = alphabet[(v >> 12) & 63];
+        *p++ = alphabet[(v >> 6) & 63];
+        *p++ = alphabet[v & 63];
+    }
+    if (i < len)
+    {
+        uint32_t v = (uint32_t)data[i] << 16 | (i + 1 < len ? (uint32_t)data[i + 1] << 8 : 0);
+        *p++ = alphabet[v >> 18];
+        *p++ = alphabet[(v >> 12) & 63];
+        *p++ = i + 1 < len ? alphabet[(v >> 6) & 63] : '=';
+        *p++ = '=';
+    }
+    *p++ = '\n';
+    *p++ = '\n';
+    ev->len = (size_t)(p - ev->data);
+    return ev;
+}
+
+// Troca o evento mais recente do canal e acorda os assinantes suspensos
+static void push_publish(PushChannel *ch, PushEvent *ev)
+{
+    pthread_mutex_lock(&ch->lock);
+    PushEvent *old = ch->latest;
+    PushEvent *old_key = NULL;
+    ch->latest = ev;
+    if (ev->ref == ev->seq && ch->key != ev)
+    {
+        old_key = ch->key;
+        atomic_fetch_add_explicit(&ev->refs, 1, memory_order_relaxed);
+        ch->key = ev;
+    }
+    for (Subscriber *sub = ch->subscribers; sub; sub = sub->next)
+    {
+        if (sub->suspended)
+        {
+            sub->suspended = false;
+            MHD_resume_connection(sub->connection);
+        }
+    }
+    pthread_mutex_unlock(&ch->lock);
+    push_event_release(old);
+    push_event_release(old_key);
+}
+
+// Consumidor de cada câmera: codifica o quadro só para os canais com assinantes
+static bool live_push_frame(void *ctx, size_t camera, uint64_t seq, const RawSignal *raw)
+{
+    (void)ctx;
+    LiveFeed *feed = &live_feeds[camera];
+    ExtractOptions ext = { .engine = ENGINE_SIGNAL, .unit = UNIT_CELSIUS };
+    ACS_Rectangle rect = { 0, 0, raw->width, raw->height };
+    bool ok = true;
+
+    if (atomic_load(&feed->channels[PUSH_STATS].count))
+    {
+        FrameSummary sm;
+        feed->doc.len = 0;
+        feed->doc.failed = false;
+        PushEvent *ev = NULL;
+        if (engine_summarize_raw(raw, &rect, &ext, &feed->workspace, &sm))
+        {
+            serialize_summary(&feed->doc, FORMAT_JSON, &sm, (long)seq, false);
+            if (!feed->doc.failed)
+                ev = push_event_create("stats", seq, feed->doc.data, feed->doc.len);
+        }
+        if (ev)
+            push_publish(&feed->channels[PUSH_STATS], ev);
+        else
+            ok = false;
+    }
+    if (atomic_load(&feed->channels[PUSH_FRAME].count))
+    {
+        Frame frame;
+        feed->doc.len = 0;
+        feed->doc.failed = false;
+        PushEvent *ev = NULL;
+        if (engine_extract_raw(raw, &rect, &ext, &feed->workspace, &frame))
+        {
+            frame.index = (long)seq;
+            if (serialize_json(&feed->doc, NULL, &frame))
+                ev = push_event_create("frame", seq, feed->doc.data, feed->doc.len);
+        }
+        if (ev)
+            push_publish(&feed->channels[PUSH_FRAME], ev);
+        else
+            ok = false;
+    }
+    if (atomic_load(&feed->channels[PUSH_DELTA].count))
+    {
+        // u16 em centi-kelvin (padrão do --dtype u16); lacunas não forçam quadro-chave
+        ExtractOptions fixed = ext;
+        OutputOptions out = { .format = FORMAT_DELTA, .dtype = DTYPE_U16, .scale = 0.01,
+                              .offset = unit_absolute_zero(UNIT_CELSIUS) };
+        output_configure_extract(&out, &fixed);
+        Frame frame;
+        feed->doc.len = 0;
+        feed->doc.failed = false;
+        PushEvent *ev = NULL;
+        if (engine_extract_raw(raw, &rect, &fixed, &feed->workspace, &frame) &&
+            delta_encode(&feed->delta, &feed->doc, &frame, &out, seq, 0))
+            ev = push_event_base64("delta", seq, feed->delta.key_index, (const unsigned char *)feed->doc.data,
+                                   feed->doc.len);
+        if (ev)
+            push_publish(&feed->channels[PUSH_DELTA], ev);
+        else
+            ok = false;
+    }
+    if (atomic_load(&feed->channels[PUSH_HOTSPOTS].count))
+    {
+        SignalWindow win;
+        feed->doc.len = 0;
+        feed->doc.failed = false;
+        PushEvent *ev = NULL;
+        if (engine_signal_window_raw(raw, &rect, &win) &&
+            hotspot_eval_json(&live_hotspots, &win, &rect, ext.unit, &feed->workspace, (long)seq, &feed->doc))
+            ev = push_event_create("hotspots", seq, feed->doc.data, feed->doc.len);
+        if (ev)
+            push_publish(&feed->channels[PUSH_HOTSPOTS], ev);
+        else
+            ok = false;
+    }
+    return ok;
+}
+
+// Entrega o evento atual; sem evento novo, suspende a conexão até o próximo quadro
+static ssize_t push_reader(void *cls, uint64_t pos, char *buf, size_t max)
+{
+    (void)pos;
+    Subscriber *sub = cls;
+    if (!sub->event)
+    {
+        PushChannel *ch = sub->channel;
+        pthread_mutex_lock(&ch->lock);
+        PushEvent *ev = ch->latest;
+        // Sem o quadro-chave de que o evento depende, envia o quadro-chave antes
+        if (ev && ev->ref != ev->seq && ev->ref != sub->key && ch->key && ch->key->seq == ev->ref &&
+            ch->key->seq != sub->sent)
+            ev = ch->key;
+        if (ev && ev->seq != sub->sent)
+        {
+            atomic_fetch_add_explicit(&ev->refs, 1, memory_order_relaxed);
+            sub->event = ev;
+            sub->pos = 0;
+        }
+        else
+        {
+            sub->suspended = true;
+            MHD_suspend_connection(sub->connection);
+        }
+        pthread_mutex_unlock(&ch->lock);
+        if (!sub->event)
+            return 0;
+    }
+
+    size_t n = sub->event->len - sub->pos;
+    if (n > max)
+        n = max;
+    memcpy(buf, sub->event->data + sub->pos, n);
+    metrics_bytes_out(n);
+    sub->pos += n;
+    if (sub->pos == sub->event->len)
+    {
+        sub->sent = sub->event->seq;
+        if (sub->event->ref == sub->event->seq)
+            sub->key = sub->event->seq;
+        push_event_release(sub->event);
+        sub->event = NULL;
+    }
+    return (ssize_t)n;
+}
+
+static void push_release(void *cls)
+{
+    Subscriber *sub = cls;
+    PushChannel *ch = sub->channel;
+    pthread_mutex_lock(&ch->lock);
+    for (Subscriber **link = &ch->subscribers; *link; link = &(*link)->next)
+    {
+        if (*link == sub)
+        {
+            *link = sub->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&ch->lock);
+    atomic_fetch_sub(&ch->count, 1);
+    push_event_release(sub->event);
+    free(sub);
+}
+
+// GET /live?camera=IP|índice&kind=stats|frame|delta: text/event-stream sem fim
+static enum MHD_Result handle_live(struct MHD_Connection *connection)
+{
+    if (!live_feed_count)
+        return send_error(connection, MHD_HTTP_NOT_FOUND, "live mode disabled (start with --live)");
+
+    LiveFeed *feed = &live_feeds[0];
+    const char *v = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "camera");
+    if (v)
+    {
+        char *end;
+        unsigned long index = strtoul(v, &end, 10);
+        feed = NULL;
+        for (size_t i = 0; i < live_feed_count && !feed; ++i)
+            if (strcmp(live_feeds[i].ip, v) == 0)
+                feed = &live_feeds[i];
+        if (!feed && *v && !*end && index < live_feed_count)
+            feed = &live_feeds[index];
+        if (!feed)
+            return send_error(connection, MHD_HTTP_NOT_FOUND, "unknown camera");
+    }
+    PushKind kind = PUSH_STATS;
+    if ((v = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "kind")))
+    {
+        if (strcmp(v, "stats") == 0) kind = PUSH_STATS;
+        else if (strcmp(v, "frame") == 0) kind = PUSH_FRAME;
+        else if (strcmp(v, "delta") == 0) kind = PUSH_DELTA;
+        else if (strcmp(v, "hotspots") == 0) kind = PUSH_HOTSPOTS;
+        else return send_error(connection, MHD_HTTP_BAD_REQUEST, "invalid query parameter: kind");
+    }
+    if (kind == PUSH_HOTSPOTS && !live_hotspots.enabled)
+        return send_error(connection, MHD_HTTP_BAD_REQUEST, "hotspots feed disabled (start with --hotspots T)");
+
+    Subscriber *sub = calloc(1, sizeof(*sub));
+    if (!sub)
+        return send_error(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, "out of memory");
+    PushChannel *ch = &feed->channels[kind];
+    sub->channel = ch;
+    sub->connection = connection;
+    sub->sent = UINT64_MAX;
+    sub->key = UINT64_MAX;
+    pthread_mutex_lock(&ch->lock);
+    sub->next = ch->subscribers;
+    ch->subscribers = sub;
+    pthread_mutex_unlock(&ch->lock);
+    atomic_fetch_add(&ch->count, 1);
+
+    struct MHD_Response *response = MHD_create_response_from_callback(MHD_SIZE_UNKNOWN, JSON_CHUNK_BYTES,
+                                                                      &push_reader, sub, &push_release);
+    if (!response)
+    {
+        push_release(sub);
+        return MHD_NO;
+    }
+    MHD_add_response_header(response, "Content-Type", "text/event-stream");
+    MHD_add_response_header(response, "Cache-Control", "no-cache");
+    enum MHD_Result ret = queue_response(connection, MHD_HTTP_OK, response, 0);
+    MHD_destroy_response(response);
+    return ret;
+}
+
+static volatile sig_atomic_t live_stop;
+
+typedef struct
+{
+    LiveOptions options;
+    LiveCounters *counters;
+} LiveService;
+
+// Thread do modo ao vivo: live_run só retorna quando todas as câmeras caem
+static void *live_service(void *arg)
+{
+    LiveService *svc = arg;
+    if (!live_run(&svc->options, &live_stop, svc->counters))
+        fprintf(stderr, "❌ %s\n", engine_last_error());
+    for (size_t i = 0; i < svc->options.count; ++i)
+    {
+        const LiveCounters *c = &svc->counters[i];
+        if (!c->connected)
+            fprintf(stderr, "❌ %s\n", c->error);
+        else
+            fprintf(stderr,
+                    "📡 %s encerrada: %llu recebidos, %llu processados, %llu descartados, %llu roubados (worker %u)\n",
+                    live_feeds[i].ip, (unsigned long long)c->received, (unsigned long long)c->processed,
+                    (unsigned long long)c->dropped, (unsigned long long)c->stolen, c->worker);
+    }
+    return NULL;
+}
+
+// Cria os canais de cada câmera e inicia a ingestão em segundo plano
+static bool live_start(char *list, size_t ring, LiveDropPolicy policy, unsigned int workers)
+{
+    size_t count = 0;
+    const char **ips = NULL;
+    for (char *save = NULL, *ip = strtok_r(list, ",", &save); ip; ip = strtok_r(NULL, ",", &save))
+    {
+        const char **grown = realloc(ips, (count + 1) * sizeof(*ips));
+        if (!grown)
+            return false;
+        ips = grown;
+        ips[count++] = ip;
+    }
+    if (!count || !(live_feeds = calloc(count, sizeof(*live_feeds))))
+        return false;
+    for (size_t i = 0; i < count; ++i)
+    {
+        live_feeds[i].ip = ips[i];
+        out_init_memory(&live_feeds[i].doc, OUT_DEFAULT_CAPACITY);
+        delta_init(&live_feeds[i].delta, DELTA_DEFAULT_KEYFRAME);
+        for (int k = 0; k < PUSH_KINDS; ++k)
+            pthread_mutex_init(&live_feeds[i].channels[k].lock, NULL);
+    }
+    live_feed_count = count;
+
+    static LiveService svc;
+    svc.options = (LiveOptions){ ips, count, ring, policy, live_push_frame, NULL, workers };
+    if (!(svc.counters = calloc(count, sizeof(*svc.counters))))
+        return false;
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, live_service, &svc) != 0)
+        return false;
+    pthread_detach(thread);
+    return true;
+}
+
+// Requisição de /extract ou /render com chave no cache: a resposta de sucesso é guardada antes do envio
+typedef struct
+{
+    CacheKey key;
+    const char *options;
+    uint64_t body_len;
+} CacheSlot;
+
+static enum MHD_Result append_option(void *cls, enum MHD_ValueKind kind, const char *key, const char *value)
+{
+    (void)kind;
+    OutBuf *options = cls;
+    out_str(options, key);
+    out_char(options, '=');
+    out_str(options, value ? value : "");
+    out_char(options, '&');
+    return MHD_YES;
+}
+
+static void cached_response_release(void *cls)
+{
+    cache_release(cls);
+}
+
+// A forma gzip de um resultado é outra entrada do cache: a chave deriva da chave sem
+// compressão e as opções ganham o prefixo, que também marca a entrada no envio
+#define GZIP_OPTIONS_PREFIX "gzip:"
+
+static bool client_accepts_gzip(struct MHD_Connection *connection)
+{
+    return compress_enabled(&compress_stage) &&
+           compress_accepts_gzip(MHD_lookup_connection_value(connection, MHD_HEADER_KIND,
+                                                             MHD_HTTP_HEADER_ACCEPT_ENCODING));
+}
+
+// Imagens já vêm comprimidas e documentos pequenos não compensam
+static bool compressible(const char *content_type, size_t len)
+{
+    return len >= COMPRESS_MIN_BYTES && strncmp(content_type, "image/", 6) != 0;
+}
+
+// `gz->options` alocado com malloc (free com o chamador); false sem memória
+static bool gzip_slot(const CacheSlot *slot, CacheSlot *gz)
+{
+    size_t len = strlen(slot->options);
+    char *options = malloc(sizeof(GZIP_OPTIONS_PREFIX) + len);
+    if (!options)
+        return false;
+    memcpy(options, GZIP_OPTIONS_PREFIX, sizeof(GZIP_OPTIONS_PREFIX) - 1);
+    memcpy(options + sizeof(GZIP_OPTIONS_PREFIX) - 1, slot->options, len + 1);
+    *gz = (CacheSlot){ cache_key(&result_cache, &slot->key, sizeof(slot->key), options), options, slot->body_len };
+    return true;
+}
+
+static void add_encoding_headers(struct MHD_Response *response, bool gzip)
+{
+    if (gzip)
+        MHD_add_response_header(response, "Content-Encoding", "gzip");
+    if (compress_enabled(&compress_stage))
+        MHD_add_response_header(response, "Vary", "Accept-Encoding");
+}
+
+// Sem cópia: a resposta aponta para os bytes da entrada e segura uma referência,
+// devolvida pelo MHD quando termina o envio (mesmo que a LRU já a tenha descartado)
+static enum MHD_Result send_cached(struct MHD_Connection *connection, CacheEntry *entry, bool hit)
+{
+    struct MHD_Response *response = MHD_create_response_from_buffer_with_free_callback_cls(
+        entry->len, entry->data, &cached_response_release, entry);
+    if (!response)
+    {
+        cache_release(entry);
+        return MHD_NO;
+    }
+    MHD_add_response_header(response, "Content-Type", entry->content_type);
+    MHD_add_response_header(response, "X-Cache", hit ? "hit" : "miss");
+    add_encoding_headers(response,
+                         strncmp(entry->options, GZIP_OPTIONS_PREFIX, sizeof(GZIP_OPTIONS_PREFIX) - 1) == 0);
+    enum MHD_Result ret = queue_response(connection, MHD_HTTP_OK, response, entry->len);
+    MHD_destroy_response(response);
+    return ret;
+}
+
+// Resposta gzip: o documento vai para o estágio de compressão e o reader envia o que
+// já saiu, suspendendo a conexão quando alcança a saída (o estágio a retoma a cada
+// fatia). A origem é um bloco da arena ou uma entrada do cache, segura até o fim
+typedef struct
+{
+    GzipJob gz;
+    struct MHD_Connection *connection;
+    bool suspended;     // sob gz.lock
+    size_t pos;         // só na thread do MHD
+    ArenaBlock *block;  // documento fora do cache, devolvido à arena no fim
+    CacheEntry *source; // ou a entrada sem compressão
+    bool store;         // a forma gzip entra no cache com `slot` ao terminar
+    CacheSlot slot;
+} GzipResponse;
+
+static void gzip_notify(GzipJob *job)
+{
+    GzipResponse *gr = job->ctx;
+    if (gr->suspended)
+    {
+        gr->suspended = false;
+        MHD_resume_connection(gr->connection);
+    }
+}
+
+static ssize_t gzip_reader(void *cls, uint64_t pos, char *buf, size_t max)
+{
+    (void)pos;
+    GzipResponse *gr = cls;
+    pthread_mutex_lock(&gr->gz.lock);
+    size_t ready = gr->gz.out_len;
+    bool finished = gr->gz.finished, failed = gr->gz.failed;
+    if (ready == gr->pos && !finished)
+    {
+        gr->suspended = true;
+        MHD_suspend_connection(gr->connection);
+    }
+    pthread_mutex_unlock(&gr->gz.lock);
+    if (failed)
+        return MHD_CONTENT_READER_END_WITH_ERROR;
+    if (ready == gr->pos)
+        return finished ? MHD_CONTENT_READER_END_OF_STREAM : 0;
+    // Bytes publicados não mudam mais: a cópia sai sem a trava
+    size_t n = ready - gr->pos < max ? ready - gr->pos : max;
+    memcpy(buf, gr->gz.out + gr->pos, n);
+    metrics_bytes_out(n);
+    gr->pos += n;
+    return (ssize_t)n;
+}
+
+// Na thread do MHD dona da conexão. Sem cache, um cliente que saiu interrompe a
+// compressão; com cache, ela vai até o fim para a forma gzip ser guardada
+static void gzip_release(void *cls)
+{
+    GzipResponse *gr = cls;
+    if (!gr->store)
+        atomic_store(&gr->gz.cancel, true);
+    compress_wait(&gr->gz);
+    if (gr->store && !gr->gz.failed)
+    {
+        unsigned char *data = realloc(gr->gz.out, gr->gz.out_len);
+        CacheEntry *entry = cache_put(&result_cache, &gr->slot.key, gr->slot.options, gr->slot.body_len,
+                                      gr->source->content_type, data ? data : gr->gz.out, gr->gz.out_len);
+        if (entry)
+            cache_release(entry);
+    }
+    else
+    {
+        free(gr->gz.out);
+    }
+    if (gr->block)
+        arena_give(&arena, gr->block);
+    if (gr->source)
+        cache_release(gr->source);
+    free((char *)gr->slot.options);
+    free(gr);
+}
+
+// Assume `block` ou a referência de `source` (que leva X-Cache, com `hit`); com `store`,
+// a forma gzip é guardada no cache
+static enum MHD_Result send_gzip(struct MHD_Connection *connection, const char *content_type, const void *data,
+                                 size_t len, ArenaBlock *block, CacheEntry *source, const CacheSlot *store, bool hit)
+{
+    GzipResponse *gr = calloc(1, sizeof(*gr));
+    if (gr && store && !gzip_slot(store, &gr->slot))
+    {
+        free(gr);
+        gr = NULL;
+    }
+    if (!gr || !compress_submit(&compress_stage, &gr->gz, data, len, &gzip_notify, gr))
+    {
+        if (gr)
+            free((char *)gr->slot.options);
+        free(gr);
+        if (block)
+            arena_give(&arena, block);
+        if (source)
+            cache_release(source);
+        return send_error(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, "out of memory");
+    }
+    gr->connection = connection;
+    gr->block = block;
+    gr->source = source;
+    gr->store = store != NULL;
+
+    struct MHD_Response *response = MHD_create_response_from_callback(MHD_SIZE_UNKNOWN, JSON_CHUNK_BYTES,
+                                                                      &gzip_reader, gr, &gzip_release);
+    if (!response)
+    {
+        gzip_release(gr);
+        return MHD_NO;
+    }
+    MHD_add_response_header(response, "Content-Type", content_type);
+    if (source)
+        MHD_add_response_header(response, "X-Cache", hit ? "hit" : "miss");
+    add_encoding_headers(response, true);
+    enum MHD_Result ret = queue_response(connection, MHD_HTTP_OK, response, 0);
+    MHD_destroy_response(response);
+    return ret;
+}
+
+// Resultado já no cache: com gzip aceito, a forma comprimida guardada sai direto, sem
+// recomprimir; se só há a forma sem compressão, ela passa pelo estágio e a forma gzip
+// é guardada ao fim. false sem acerto
+static bool send_from_cache(struct MHD_Connection *connection, const CacheSlot *slot, enum MHD_Result *ret)
+{
+    if (!cache_enabled(&result_cache))
+        return false;
+    bool gzip = client_accepts_gzip(connection);
+    CacheSlot gz;
+    if (gzip && gzip_slot(slot, &gz))
+    {
+        CacheEntry *hit = cache_get(&result_cache, &gz.key, gz.options, gz.body_len);
+        free((char *)gz.options);
+        if (hit)
+            return *ret = send_cached(connection, hit, true), true;
+    }
+    CacheEntry *hit = cache_get(&result_cache, &slot->key, slot->options, slot->body_len);
+    if (!hit)
+        return false;
+    *ret = gzip && compressible(hit->content_type, hit->len)
+               ? send_gzip(connection, hit->content_type, hit->data, hit->len, NULL, hit, slot, true)
+               : send_cached(connection, hit, true);
+    return true;
+}
+
+// Envia o documento montado em `out` sobre `block`, sem cópia. Sem cache, a resposta
+// aponta para o bloco e o devolve à arena no fim do envio; com cache, a entrada assume
+// os próprios bytes do bloco (encolhidos ao tamanho exato) e o bloco vazio volta na hora.
+// Com gzip aceito, o bloco ou a entrada vira a entrada do estágio de compressão
+static enum MHD_Result send_result(struct MHD_Connection *connection, const CacheSlot *slot,
+                                   const char *content_type, OutBuf *out, ArenaBlock *block)
+{
+    size_t len = out->len;
+    arena_out_finish(out, block);
+    bool gzip = compressible(content_type, len) && client_accepts_gzip(connection);
+    if (!slot)
+    {
+        if (gzip)
+            return send_gzip(connection, content_type, block->data, len, block, NULL, NULL, false);
+        struct MHD_Response *response = MHD_create_response_from_buffer_with_free_callback_cls(
+            len, block->data, &arena_response_release, block);
+        if (!response)
+        {
+            arena_give(&arena, block);
+            return MHD_NO;
+        }
+        MHD_add_response_header(response, "Content-Type", content_type);
+        add_encoding_headers(response, false);
+        enum MHD_Result ret = queue_response(connection, MHD_HTTP_OK, response, len);
+        MHD_destroy_response(response);
+        return ret;
+    }
+    unsigned char *data = (unsigned char *)arena_detach(block, len);
+    arena_give(&arena, block);
+    CacheEntry *entry = cache_put(&result_cache, &slot->key, slot->options, slot->body_len, content_type, data, len);
+    if (!entry)
+        return send_error(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, "out of memory");
+    if (gzip)
+        return send_gzip(connection, content_type, entry->data, entry->len, NULL, entry, slot, false);
+    return send_cached(connection, entry, false);
+}
+
+// ?measure=: só os valores das formas (measure.h), sem a matriz
+static enum MHD_Result send_measurements(struct MHD_Connection *connection, ACS_ThermalImage *img,
+                                         const char *spec, const ExtractOptions *ext, bool with_roi,
+                                         const CacheSlot *slot)
+{
+    const char *format = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "format");
+    if (with_roi || (format && strcmp(format, "json") != 0))
+        return send_error(connection, MHD_HTTP_BAD_REQUEST,
+                          "measure returns JSON and does not combine with roi or params");
+    MeasureSet set = { 0 };
+    if (!measure_parse(spec, &set))
+    {
+        char msg[256];
+        snprintf(msg, sizeof(msg), "invalid query parameter: measure (%s)", engine_last_error());
+        measure_free(&set);
+        return send_error(connection, MHD_HTTP_BAD_REQUEST, msg);
+    }
+    ArenaBlock *doc = arena_take(&arena, 256 * set.count + 64);
+    if (!doc)
+    {
+        measure_free(&set);
+        return send_error(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, "out of memory");
+    }
+    OutBuf out;
+    arena_out_init(&out, doc);
+    uint64_t t0 = metrics_now();
+    bool ok = measure_eval_json(&set, img, ext->unit, -1, &out);
+    metrics_observe(STAGE_EXTRACT, metrics_now() - t0);
+    measure_free(&set);
+    if (!ok)
+    {
+        arena_out_discard(&out, doc);
+        return send_error(connection, MHD_HTTP_UNPROCESSABLE_ENTITY, engine_last_error());
+    }
+    return send_result(connection, slot, output_content_type(FORMAT_JSON), &out, doc);
+}
+
+// ?isotherm=: contagem, retângulo envolvente e máscara de cada faixa (isotherm.h), uma
+// linha JSON por retângulo
+static enum MHD_Result send_isotherms(struct MHD_Connection *connection, ACS_ThermalImage *img,
+                                      const char *spec, const ExtractOptions *ext, const ACS_Rectangle *rects,
+                                      size_t count, bool with_params, const CacheSlot *slot)
+{
+    const char *format = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "format");
+    if (with_params || ext->engine != ENGINE_SIGNAL || ext->downsample > 1 || (format && strcmp(format, "json") != 0))
+        return send_error(connection, MHD_HTTP_BAD_REQUEST,
+                          "isotherm returns JSON from the signal engine and does not combine with params or "
+                          "downsample");
+    IsothermSet set = { 0 };
+    const char *encoding = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "isotherm_encoding");
+    if (encoding && !isotherm_encoding_parse(encoding, &set.encoding))
+        return send_error(connection, MHD_HTTP_BAD_REQUEST, "invalid query parameter: isotherm_encoding");
+    if (!isotherm_parse(spec, &set))
+    {
+        char msg[256];
+        snprintf(msg, sizeof(msg), "invalid query parameter: isotherm (%s)", engine_last_error());
+        return send_error(connection, MHD_HTTP_BAD_REQUEST, msg);
+    }
+    // RLE típico: poucas corridas por linha; o documento cresce se preciso
+    size_t pixels = 0;
+    for (size_t i = 0; i < count; ++i)
+        pixels += (size_t)rects[i].width * (size_t)rects[i].height;
+    ArenaBlock *doc = arena_take(&arena, set.count * (pixels / 16 + 256) + 64);
+    if (!doc)
+        return send_error(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, "out of memory");
+    OutBuf out;
+    arena_out_init(&out, doc);
+    uint64_t t0 = metrics_now();
+    bool ok = true;
+    for (size_t i = 0; ok && i < count; ++i)
+        ok = isotherm_eval_json(&set, img, &rects[i], ext->unit, &workspace, -1, &out);
+    metrics_observe(STAGE_EXTRACT, metrics_now() - t0);
+    if (!ok)
+    {
+        arena_out_discard(&out, doc);
+        return send_error(connection, MHD_HTTP_UNPROCESSABLE_ENTITY, engine_last_error());
+    }
+    return send_result(connection, slot, output_content_type(FORMAT_JSON), &out, doc);
+}
+
+// ?hotspots=T: regiões conectadas com t >= T (hotspot.h), uma linha JSON por retângulo;
+// ?hotspot_min_area=N descarta as menores
+static enum MHD_Result send_hotspots(struct MHD_Connection *connection, ACS_ThermalImage *img,
+                                     const char *threshold, const ExtractOptions *ext, const ACS_Rectangle *rects,
+                                     size_t count, bool with_params, const CacheSlot *slot)
+{
+    const char *format = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "format");
+    if (with_params || ext->engine != ENGINE_SIGNAL || ext->downsample > 1 || (format && strcmp(format, "json") != 0))
+        return send_error(connection, MHD_HTTP_BAD_REQUEST,
+                          "hotspots returns JSON from the signal engine and does not combine with params or "
+                          "downsample");
+    HotspotOptions opt = { true, 0.0, 1 };
+    char *end;
+    opt.threshold = strtod(threshold, &end);
+    if (*end || end == threshold || opt.threshold != opt.threshold)
+        return send_error(connection, MHD_HTTP_BAD_REQUEST, "invalid query parameter: hotspots");
+    const char *min_area = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "hotspot_min_area");
+    if (min_area)
+    {
+        long area = strtol(min_area, &end, 10);
+        if (*end || end == min_area || area < 1)
+            return send_error(connection, MHD_HTTP_BAD_REQUEST, "invalid query parameter: hotspot_min_area");
+        opt.min_area = (size_t)area;
+    }
+    ArenaBlock *doc = arena_take(&arena, 4096 * count);
+    if (!doc)
+        return send_error(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, "out of memory");
+    OutBuf out;
+    arena_out_init(&out, doc);
+    uint64_t t0 = metrics_now();
+    bool ok = true;
+    for (size_t i = 0; ok && i < count; ++i)
+    {
+        SignalWindow win;
+        ok = engine_signal_window(img, &rects[i], &workspace, &win) &&
+             hotspot_eval_json(&opt, &win, &rects[i], ext->unit, &workspace, -1, &out);
+    }
+    metrics_observe(STAGE_EXTRACT, metrics_now() - t0);
+    if (!ok)
+    {
+        arena_out_discard(&out, doc);
+        return send_error(connection, MHD_HTTP_UNPROCESSABLE_ENTITY, engine_last_error());
+    }
+    return send_result(connection, slot, output_content_type(FORMAT_JSON), &out, doc);
+}
+
+// Decodifica a imagem direto do corpo da requisição (sem arquivo temporário) e
+// devolve a matriz de temperaturas no formato pedido
+static enum MHD_Result extract_response(struct MHD_Connection *connection, const Upload *up, const CacheSlot *slot)
+{
+    ExtractOptions ext;
+    OutputOptions opt;
+    const char *bad;
+    if (!parse_query(connection, &ext, &opt, false, &bad))
+    {
+        char msg[64];
+        snprintf(msg, sizeof(msg), "invalid query parameter: %s", bad);
+        return send_error(connection, MHD_HTTP_BAD_REQUEST, msg);
+    }
+    // ?params=: variantes de parâmetros térmicos sobre o mesmo sinal (params.h)
+    ParamSet variants[PARAMS_MAX_VARIANTS];
+    size_t variant_count = 0;
+    const char *spec = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "params");
+    if (spec && !params_parse(spec, variants, &variant_count))
+    {
+        char msg[256];
+        snprintf(msg, sizeof(msg), "invalid query parameter: params (%s)", engine_last_error());
+        return send_error(connection, MHD_HTTP_BAD_REQUEST, msg);
+    }
+
+    ACS_ThermalImage *img = worker_context();
+    if (!img)
+        return send_error(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, "failed to allocate thermal image");
+    uint64_t t0 = metrics_now();
+    ACS_ThermalImage_openFromMemory(img, (const unsigned char *)up->block->data, up->len);
+    metrics_observe(STAGE_DECODE, metrics_now() - t0);
+    if (ACS_getLastErrorCode())
+    {
+        char msg[512];
+        snprintf(msg, sizeof(msg), "invalid radiometric image: %s", ACS_getLastErrorMessage());
+        return send_error(connection, MHD_HTTP_UNPROCESSABLE_ENTITY, msg);
+    }
+
+    ACS_Rectangle rects[ROI_MAX];
+    size_t count;
+    RoiQuery roi = { 0 };
+    MHD_get_connection_values(connection, MHD_GET_ARGUMENT_KIND, &collect_roi, &roi);
+    if (!resolve_rois(&roi, ACS_ThermalImage_getWidth(img), ACS_ThermalImage_getHeight(img), rects, &count))
+    {
+        char msg[160];
+        snprintf(msg, sizeof(msg), "invalid query parameter: roi (%s)", engine_last_error());
+        return send_error(connection, MHD_HTTP_BAD_REQUEST, msg);
+    }
+    // Várias ROIs ou variantes: um documento por bloco (array JSON; CSV marcado com "# roi"/"# params")
+    bool multi_roi = roi.count > 1 || count > 1;
+    bool multi = multi_roi || variant_count;
+
+    if (!engine_prepare(img, &ext))
+        return send_error(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, engine_last_error());
+    const char *measure = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "measure");
+    if (measure)
+        return send_measurements(connection, img, measure, &ext, roi.count > 0 || variant_count, slot);
+    const char *isotherm = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "isotherm");
+    if (isotherm)
+        return send_isotherms(connection, img, isotherm, &ext, rects, count, variant_count > 0, slot);
+    const char *hotspots = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "hotspots");
+    if (hotspots)
+        return send_hotspots(connection, img, hotspots, &ext, rects, count, variant_count > 0, slot);
+
+    // CSV: ~8 bytes por pixel ("-12.34;"); binário: cabeçalho + 4 bytes por pixel (da grade, com downsample)
+    size_t blocks = variant_count ? variant_count : 1;
+    size_t pixels = 0;
+    for (size_t i = 0; i < count; ++i)
+        pixels += (size_t)downsample_dim(rects[i].width, ext.downsample) *
+                  (size_t)downsample_dim(rects[i].height, ext.downsample);
+    size_t estimate = blocks * (pixels * 8 + 4096 * count);
+    // Documento grande demais para o cache: o JSON volta a sair em blocos
+    if (slot && estimate > result_cache.capacity / CACHE_MAX_ENTRY_FRACTION)
+        slot = NULL;
+    // Com gzip o documento é montado inteiro, para a compressão sair da thread da conexão
+    Frame frame;
+    if (opt.format == FORMAT_JSON && !multi && !slot && !client_accepts_gzip(connection))
+    {
+        t0 = metrics_now();
+        if (!engine_extract(img, &rects[0], &ext, &workspace, &frame))
+            return send_error(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, engine_last_error());
+        metrics_observe(STAGE_EXTRACT, metrics_now() - t0);
+        return send_json_stream(connection, img, &frame);
+    }
+
+    // O bloco segue com a resposta até o fim do envio
+    ArenaBlock *doc = arena_take(&arena, estimate);
+    if (!doc)
+        return send_error(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, "out of memory");
+    OutBuf out;
+    arena_out_init(&out, doc);
+    ParamState params;
+    if (variant_count && !params_begin(img, &params))
+    {
+        arena_out_discard(&out, doc);
+        return send_error(connection, MHD_HTTP_UNPROCESSABLE_ENTITY, engine_last_error());
+    }
+    if (opt.format == FORMAT_JSON && multi)
+        out_char(&out, '[');
+    // Arrow: um arquivo com uma linha por variante e retângulo
+    bool arrow = opt.format == FORMAT_ARROW;
+    ArrowWriter writer;
+    bool ok = !arrow || arrow_begin(&writer, &out, ext.unit);
+    // Uma observação por requisição, somando todos os blocos
+    uint64_t extract_ns = 0, serialize_ns = 0;
+    for (size_t v = 0; ok && v < blocks; ++v)
+    {
+        // Só a LUT é remontada: o buffer de sinal da imagem continua o mesmo
+        const ParamSet *variant = variant_count ? &variants[v] : NULL;
+        if (variant && !params_apply(&params, variant))
+        {
+            params_restore(&params);
+            if (arrow)
+                arrow_free(&writer);
+            arena_out_discard(&out, doc);
+            return send_error(connection, MHD_HTTP_BAD_REQUEST, engine_last_error());
+        }
+        for (size_t i = 0; ok && i < count; ++i)
+        {
+            t0 = metrics_now();
+            bool extracted = engine_extract(img, &rects[i], &ext, &workspace, &frame);
+            uint64_t t1 = metrics_now();
+            extract_ns += t1 - t0;
+            if (!extracted)
+            {
+                if (variant_count)
+                    params_restore(&params);
+                if (arrow)
+                    arrow_free(&writer);
+                arena_out_discard(&out, doc);
+                return send_error(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, engine_last_error());
+            }
+            frame.tag_roi = multi_roi;
+            frame.params = variant ? variant->label : NULL;
+            size_t clipped = 0;
+            if (opt.format == FORMAT_JSON && multi && (v || i))
+                out_char(&out, ',');
+            ok = arrow ? arrow_append(&writer, img, NULL, &frame)
+                 : opt.format == FORMAT_BIN
+                     ? serialize_bin(&out, img, &frame, &opt, &workspace, &clipped)
+                     : serialize_banded(&out, img, &frame, opt.format, &opt.csv, &bands, BAND_WORKERS);
+            serialize_ns += metrics_now() - t1;
+        }
+    }
+    metrics_observe(STAGE_EXTRACT, extract_ns);
+    metrics_observe(STAGE_SERIALIZE, serialize_ns);
+    if (variant_count)
+        params_restore(&params);
+    if (opt.format == FORMAT_JSON && multi)
+        out_str(&out, "]\n");
+    if (arrow)
+    {
+        ok = ok && arrow_finish(&writer);
+        arrow_free(&writer);
+    }
+    if (!ok || out.failed)
+    {
+        arena_out_discard(&out, doc);
+        return send_error(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, "out of memory while serializing");
+    }
+
+    return send_result(connection, slot, output_content_type(opt.format), &out, doc);
+}
+
+// Mesmos bytes enviados e mesmos argumentos (na ordem recebida) têm a mesma resposta:
+// no acerto, os bytes guardados saem direto, sem abrir a imagem no SDK
+static enum MHD_Result handle_extract(struct MHD_Connection *connection, const Upload *up)
+{
+    if (!cache_enabled(&result_cache))
+        return extract_response(connection, up, NULL);
+    ArenaBlock *block = arena_take(&arena, 256);
+    if (!block)
+        return send_error(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, "out of memory");
+    OutBuf options;
+    arena_out_init(&options, block);
+    MHD_get_connection_values(connection, MHD_GET_ARGUMENT_KIND, &append_option, &options);
+    out_char(&options, '\0');
+    if (options.failed)
+    {
+        arena_out_discard(&options, block);
+        return send_error(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, "out of memory");
+    }
+    CacheSlot slot = { cache_key(&result_cache, up->block->data, up->len, options.data), options.data, up->len };
+    enum MHD_Result ret;
+    if (!send_from_cache(connection, &slot, &ret))
+        ret = extract_response(connection, up, &slot);
+    arena_out_discard(&options, block);
+    return ret;
+}
+
+// POST /metadata?unit=C|K|F: câmera, parâmetros térmicos e GPS da imagem, sem
+// engine_prepare nem extração; para catálogos e indexação de acervos
+static enum MHD_Result handle_metadata(struct MHD_Connection *connection, const Upload *up)
+{
+    TempUnit unit = UNIT_CELSIUS;
+    const char *v = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "unit");
+    if (v && !unit_parse(v, &unit))
+        return send_error(connection, MHD_HTTP_BAD_REQUEST, "invalid query parameter: unit");
+
+    ACS_ThermalImage *img = worker_context();
+    if (!img)
+        return send_error(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, "failed to allocate thermal image");
+    uint64_t t0 = metrics_now();
+    ACS_ThermalImage_openFromMemory(img, (const unsigned char *)up->block->data, up->len);
+    metrics_observe(STAGE_DECODE, metrics_now() - t0);
+    if (ACS_getLastErrorCode())
+    {
+        char msg[512];
+        snprintf(msg, sizeof(msg), "invalid radiometric image: %s", ACS_getLastErrorMessage());
+        return send_error(connection, MHD_HTTP_UNPROCESSABLE_ENTITY, msg);
+    }
+    ArenaBlock *doc = arena_take(&arena, 2048);
+    if (!doc)
+        return send_error(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, "out of memory");
+    OutBuf out;
+    arena_out_init(&out, doc);
+    if (!serialize_metadata_json(&out, img, NULL, unit))
+    {
+        arena_out_discard(&out, doc);
+        return send_error(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, "out of memory while serializing");
+    }
+    return send_result(connection, NULL, output_content_type(FORMAT_JSON), &out, doc);
+}
+
+// Lê palette/format/min/max/quality da query string de /render
+static bool parse_render_query(struct MHD_Connection *connection, RenderOptions *opt, const char **bad)
+{
+    memset(opt, 0, sizeof(*opt));
+    opt->palette = ACS_PalettePreset_iron;
+    opt->format = RENDER_PNG;
+    opt->quality = RENDER_DEFAULT_QUALITY;
+
+    const char *v;
+    if ((v = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "palette")) &&
+        !render_palette_parse(v, &opt->palette))
+        return *bad = "palette", false;
+    if ((v = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "format")) &&
+        !render_format_parse(v, &opt->format))
+        return *bad = "format", false;
+    if ((v = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "quality")))
+    {
+        char *end;
+        long q = strtol(v, &end, 10);
+        if (*end || q < 1 || q > 100)
+            return *bad = "quality", false;
+        opt->quality = (int)q;
+    }
+    // Escala manual em °C: min e max juntos; sem eles, ajustada aos extremos da imagem
+    const char *lo = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "min");
+    const char *hi = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "max");
+    if (lo || hi)
+    {
+        char *end_lo = NULL, *end_hi = NULL;
+        opt->min = lo ? strtod(lo, &end_lo) : 0.0;
+        opt->max = hi ? strtod(hi, &end_hi) : 0.0;
+        if (!lo || !hi || *end_lo || *end_hi || !(opt->min < opt->max))
+            return *bad = "min/max", false;
+        opt->fixed_range = true;
+    }
+    return true;
+}
+
+// POST /render: o mesmo corpo de /extract colorizado em PNG ou JPEG pelo SDK. A chave do
+// cache usa só o que muda os pixels (paleta, escala, formato e qualidade), na forma canônica
+static enum MHD_Result handle_render(struct MHD_Connection *connection, const Upload *up)
+{
+    RenderOptions opt;
+    const char *bad;
+    if (!parse_render_query(connection, &opt, &bad))
+    {
+        char msg[64];
+        snprintf(msg, sizeof(msg), "invalid query parameter: %s", bad);
+        return send_error(connection, MHD_HTTP_BAD_REQUEST, msg);
+    }
+    CacheSlot slot, *cached = NULL;
+    char options[160];
+    if (cache_enabled(&result_cache))
+    {
+        int n = snprintf(options, sizeof(options), "render:%s:%s:%d:", render_palette_name(opt.palette),
+                         render_format_name(opt.format), opt.format == RENDER_JPEG ? opt.quality : 0);
+        if (opt.fixed_range)
+            snprintf(options + n, sizeof(options) - (size_t)n, "%.17g:%.17g", opt.min, opt.max);
+        else
+            snprintf(options + n, sizeof(options) - (size_t)n, "auto");
+        slot = (CacheSlot){ cache_key(&result_cache, up->block->data, up->len, options), options, up->len };
+        enum MHD_Result ret;
+        if (send_from_cache(connection, &slot, &ret))
+            return ret;
+        cached = &slot;
+    }
+
+    ACS_ThermalImage *img = worker_context();
+    if (!img)
+        return send_error(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, "failed to allocate thermal image");
+    uint64_t t0 = metrics_now();
+    ACS_ThermalImage_openFromMemory(img, (const unsigned char *)up->block->data, up->len);
+    uint64_t t1 = metrics_now();
+    metrics_observe(STAGE_DECODE, t1 - t0);
+    if (ACS_getLastErrorCode())
+    {
+        char msg[512];
+        snprintf(msg, sizeof(msg), "invalid radiometric image: %s", ACS_getLastErrorMessage());
+        return send_error(connection, MHD_HTTP_UNPROCESSABLE_ENTITY, msg);
+    }
+    // RGB sem compressão como teto: PNG/JPEG de imagens térmicas saem bem menores
+    size_t estimate = (size_t)ACS_ThermalImage_getWidth(img) * (size_t)ACS_ThermalImage_getHeight(img) * 3 + 4096;
+    ArenaBlock *doc = arena_take(&arena, estimate);
+    if (!doc)
+        return send_error(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, "out of memory");
+    OutBuf out;
+    arena_out_init(&out, doc);
+    bool ok = render_image(&renderer, img, &opt, &out);
+    // Colorização e codificação contam como serialização
+    metrics_observe(STAGE_SERIALIZE, metrics_now() - t1);
+    if (!ok || out.failed)
+    {
+        arena_out_discard(&out, doc);
+        return send_error(connection, MHD_HTTP_UNPROCESSABLE_ENTITY, ok ? "out of memory" : engine_last_error());
+    }
+    return send_result(connection, cached, render_content_type(opt.format), &out, doc);
+}
+
+// Lote (POST /extract/batch): o corpo multipart ou tar é dividido sem cópia (archive.h)
+// e as imagens são decodificadas em paralelo por threads do lote, cada uma com um
+// contexto (imagem ACS + Workspace) reaproveitado entre lotes. Cada resultado entra
+// numa fila na ordem em que termina, marcado com o índice de entrada, e a resposta
+// (NDJSON ou multipart/mixed) a esvazia, suspensa enquanto não há nada pronto.
+#define BATCH_MAX_ITEMS 4096
+
+typedef struct BatchResult
+{
+    struct BatchResult *next;
+    size_t len;
+    char data[];
+} BatchResult;
+
+// Tempos das etapas de uma imagem do lote; `stages`: bits das etapas medidas
+typedef struct
+{
+    uint64_t ns[STAGE_COUNT];
+    unsigned int stages;
+} BatchTiming;
+
+typedef struct
+{
+    ArchiveList list;
+    ArenaBlock *body; // corpo recebido: pertence ao lote até a resposta ser liberada
+    ExtractOptions ext;
+    OutputOptions out;
+    bool multipart;
+    char boundary[48];
+    unsigned int workers;
+    WarmContext **contexts; // um por thread do lote, tomado na primeira imagem dela
+    OutBuf *docs;           // registro em montagem de cada thread, reaproveitado
+    BatchTiming *timings;   // um por imagem, passado às métricas pela thread do MHD no fim
+    atomic_bool cancel;     // cliente foi embora: as imagens restantes são puladas
+    bool started;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    BatchResult *head, *tail; // prontos, na ordem de conclusão
+    bool done;
+    bool suspended;
+    struct MHD_Connection *connection;
+    BatchResult *sending; // só na thread do MHD
+    size_t pos;
+} BatchJob;
+
+// Contextos devolvidos pelos lotes (sob warm_lock)
+static WarmContext *batch_contexts;
+
+static WarmContext *batch_context_take(void)
+{
+    pthread_mutex_lock(&warm_lock);
+    WarmContext *ctx = batch_contexts;
+    if (ctx)
+        batch_contexts = ctx->next;
+    pthread_mutex_unlock(&warm_lock);
+    if (ctx || !(ctx = calloc(1, sizeof(*ctx))))
+        return ctx;
+    if (!(ctx->image = ACS_ThermalImage_alloc()))
+    {
+        free(ctx);
+        return NULL;
+    }
+    return ctx;
+}
+
+static void batch_context_give(WarmContext *ctx)
+{
+    if (!ctx)
+        return;
+    pthread_mutex_lock(&warm_lock);
+    ctx->next = batch_contexts;
+    batch_contexts = ctx;
+    pthread_mutex_unlock(&warm_lock);
+}
+
+// Enfileira um resultado (ou só marca o fim, com `last`) e acorda a resposta suspensa
+static void batch_publish(BatchJob *job, BatchResult *res, bool last)
+{
+    pthread_mutex_lock(&job->lock);
+    if (res)
+    {
+        res->next = NULL;
+        if (job->tail)
+            job->tail->next = res;
+        else
+            job->head = res;
+        job->tail = res;
+    }
+    if (last)
+        job->done = true;
+    if (job->suspended)
+    {
+        job->suspended = false;
+        MHD_resume_connection(job->connection);
+    }
+    pthread_mutex_unlock(&job->lock);
+}
+
+// Nome da entrada num cabeçalho MIME: aspas, barras e controles viram '_'
+static void batch_header_name(OutBuf *out, const char *name)
+{
+    for (const char *p = name; *p; ++p)
+        out_char(out, *p == '"' || *p == '\\' || (unsigned char)*p < 0x20 ? '_' : *p);
+}
+
+// Início do registro: linha NDJSON até "result": ou, no multipart, delimitador e cabeçalhos da parte
+static void batch_record_head(const BatchJob *job, OutBuf *out, size_t index, const ArchiveItem *item,
+                              const char *status, const char *content_type)
+{
+    if (!job->multipart)
+    {
+        out_str(out, "{\"index\":");
+        out_uint(out, index);
+        out_str(out, ",\"name\":");
+        out_json_string(out, item->name);
+        out_str(out, ",\"status\":\"");
+        out_str(out, status);
+        out_str(out, "\",");
+        return;
+    }
+    out_str(out, "--");
+    out_str(out, job->boundary);
+    out_str(out, "\r\nContent-Type: ");
+    out_str(out, content_type);
+    if (item->name[0])
+    {
+        out_str(out, "\r\nContent-Disposition: attachment; filename=\"");
+        batch_header_name(out, item->name);
+        out_char(out, '"');
+    }
+    out_str(out, "\r\nX-Batch-Index: ");
+    out_uint(out, index);
+    out_str(out, "\r\nX-Batch-Status: ");
+    out_str(out, status);
+    out_str(out, "\r\n\r\n");
+}
+
+static void batch_record_error(const BatchJob *job, OutBuf *out, size_t index, const ArchiveItem *item,
+                               const char *message)
+{
+    batch_record_head(job, out, index, item, "error", "application/json");
+    out_str(out, job->multipart ? "{\"status\":\"error\",\"message\":" : "\"message\":");
+    out_json_string(out, message);
+    out_str(out, job->multipart ? "}\r\n" : "}\n");
+}
+
+// Uma imagem do lote, numa thread do pool_run; o registro segue direto para a fila. Os
+// tempos ficam em job->timings: as threads do pool_run (e a do lote) são novas a cada
+// lote e não podem tomar blocos de métricas (metrics.c os guarda para sempre)
+static void batch_task(void *ctx, unsigned int worker, size_t index)
+{
+    BatchJob *job = ctx;
+    if (atomic_load(&job->cancel))
+        return;
+    const ArchiveItem *item = &job->list.items[index];
+    BatchTiming *timing = &job->timings[index];
+    if (!job->contexts[worker])
+        job->contexts[worker] = batch_context_take();
+    WarmContext *wc = job->contexts[worker];
+    OutBuf *doc = &job->docs[worker];
+    doc->len = 0;
+    doc->failed = false;
+
+    char msg[512];
+    const char *error = NULL;
+    Frame frame;
+    if (!wc)
+    {
+        error = "failed to allocate thermal image";
+    }
+    else
+    {
+        uint64_t t0 = metrics_now();
+        ACS_ThermalImage_openFromMemory(wc->image, item->data, item->len);
+        uint64_t t1 = metrics_now();
+        timing->ns[STAGE_DECODE] = t1 - t0;
+        timing->stages |= 1u << STAGE_DECODE;
+        if (ACS_getLastErrorCode())
+        {
+            snprintf(msg, sizeof(msg), "invalid radiometric image: %s", ACS_getLastErrorMessage());
+            error = msg;
+        }
+        else
+        {
+            ACS_Rectangle rect = { 0, 0, ACS_ThermalImage_getWidth(wc->image),
+                                   ACS_ThermalImage_getHeight(wc->image) };
+            if (!engine_prepare(wc->image, &job->ext) ||
+                !engine_extract(wc->image, &rect, &job->ext, &wc->workspace, &frame))
+                error = engine_last_error();
+            timing->ns[STAGE_EXTRACT] = metrics_now() - t1;
+            timing->stages |= 1u << STAGE_EXTRACT;
+        }
+    }
+
+    if (error)
+    {
+        batch_record_error(job, doc, index, item, error);
+    }
+    else
+    {
+        batch_record_head(job, doc, index, item, "ok", output_content_type(job->out.format));
+        if (!job->multipart)
+            out_str(doc, "\"result\":");
+        size_t start = doc->len, clipped;
+        uint64_t t0 = metrics_now();
+        bool ok = job->out.format == FORMAT_BIN
+                      ? serialize_bin(doc, wc->image, &frame, &job->out, &wc->workspace, &clipped)
+                  : job->out.format == FORMAT_JSON ? serialize_json(doc, wc->image, &frame)
+                                                   : serialize_csv(doc, &frame, &job->out.csv);
+        timing->ns[STAGE_SERIALIZE] = metrics_now() - t0;
+        timing->stages |= 1u << STAGE_SERIALIZE;
+        // NDJSON: o documento vai numa linha só (as quebras dele são só espaçamento)
+        if (ok && !job->multipart)
+        {
+            size_t n = start;
+            for (size_t i = start; i < doc->len; ++i)
+                if (doc->data[i] != '\n')
+                    doc->data[n++] = doc->data[i];
+            doc->len = n;
+        }
+        out_str(doc, job->multipart ? "\r\n" : "}\n");
+    }
+    if (doc->failed)
+    {
+        doc->len = 0;
+        doc->failed = false;
+        batch_record_error(job, doc, index, item, "out of memory while serializing");
+        if (doc->failed)
+            return;
+    }
+
+    BatchResult *res = malloc(sizeof(*res) + doc->len);
+    if (!res)
+        return;
+    res->len = doc->len;
+    memcpy(res->data, doc->data, doc->len);
+    batch_publish(job, res, false);
+}
+
+static void *batch_service(void *arg)
+{
+    BatchJob *job = arg;
+    pool_run(job->list.count, job->workers, batch_task, job);
+    BatchResult *closing = NULL;
+    if (job->multipart && (closing = malloc(sizeof(*closing) + sizeof(job->boundary) + 8)))
+        closing->len = (size_t)sprintf(closing->data, "--%s--\r\n", job->boundary);
+    batch_publish(job, closing, true);
+    return NULL;
+}
+
+static ssize_t batch_reader(void *cls, uint64_t pos, char *buf, size_t max)
+{
+    (void)pos;
+    BatchJob *job = cls;
+    if (!job->sending)
+    {
+        pthread_mutex_lock(&job->lock);
+        bool finished = false;
+        if ((job->sending = job->head))
+        {
+            if (!(job->head = job->sending->next))
+                job->tail = NULL;
+            job->pos = 0;
+        }
+        else if (job->done)
+        {
+            finished = true;
+        }
+        else
+        {
+            job->suspended = true;
+            MHD_suspend_connection(job->connection);
+        }
+        pthread_mutex_unlock(&job->lock);
+        if (finished)
+            return MHD_CONTENT_READER_END_OF_STREAM;
+        if (!job->sending)
+            return 0;
+    }
+
+    size_t n = job->sending->len - job->pos;
+    if (n > max)
+        n = max;
+    memcpy(buf, job->sending->data + job->pos, n);
+    metrics_bytes_out(n);
+    job->pos += n;
+    if (job->pos == job->sending->len)
+    {
+        free(job->sending);
+        job->sending = NULL;
+    }
+    return (ssize_t)n;
+}
+
+// Na thread do MHD dona da conexão (a mesma da arena do corpo). Se o cliente saiu no
+// meio, espera só as imagens em andamento. Os tempos das imagens vão às métricas daqui,
+// no bloco da thread do MHD
+static void batch_release(void *cls)
+{
+    BatchJob *job = cls;
+    atomic_store(&job->cancel, true);
+    if (job->started)
+        pthread_join(job->thread, NULL);
+    for (size_t i = 0; job->timings && i < job->list.count; ++i)
+        for (int stage = 0; stage < STAGE_COUNT; ++stage)
+            if (job->timings[i].stages & 1u << stage)
+                metrics_observe((MetricsStage)stage, job->timings[i].ns[stage]);
+    free(job->sending);
+    for (BatchResult *res = job->head, *next; res; res = next)
+    {
+        next = res->next;
+        free(res);
+    }
+    for (unsigned int i = 0; i < job->workers; ++i)
+    {
+        if (job->contexts)
+            batch_context_give(job->contexts[i]);
+        if (job->docs)
+            out_free(&job->docs[i]);
+    }
+    free(job->contexts);
+    free(job->docs);
+    free(job->timings);
+    archive_free(&job->list);
+    arena_give(&arena, job->body);
+    pthread_mutex_destroy(&job->lock);
+    free(job);
+}
+
+// POST /extract/batch?response=ndjson|multipart: várias imagens num corpo multipart ou
+// tar, com as mesmas opções de /extract aplicadas a cada uma (imagem inteira)
+static enum MHD_Result handle_batch(struct MHD_Connection *connection, Upload *up)
+{
+    ExtractOptions ext;
+    OutputOptions opt;
+    const char *bad;
+    if (!parse_query(connection, &ext, &opt, false, &bad))
+    {
+        char msg[64];
+        snprintf(msg, sizeof(msg), "invalid query parameter: %s", bad);
+        return send_error(connection, MHD_HTTP_BAD_REQUEST, msg);
+    }
+    // Arrow é um arquivo inteiro por resposta, não uma parte por imagem
+    if (opt.format == FORMAT_ARROW)
+        return send_error(connection, MHD_HTTP_BAD_REQUEST, "format=arrow is only available on /extract");
+    static const char *const unsupported[] = { "roi", "params", "measure", "isotherm", "hotspots" };
+    for (size_t i = 0; i < sizeof(unsupported) / sizeof(unsupported[0]); ++i)
+    {
+        if (MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, unsupported[i]))
+        {
+            char msg[64];
+            snprintf(msg, sizeof(msg), "query parameter not supported on /extract/batch: %s", unsupported[i]);
+            return send_error(connection, MHD_HTTP_BAD_REQUEST, msg);
+        }
+    }
+    // Sem ?response=, Accept: multipart/... escolhe o multipart; senão NDJSON
+    const char *v = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "response");
+    const char *accept = MHD_lookup_connection_value(connection, MHD_HEADER_KIND, MHD_HTTP_HEADER_ACCEPT);
+    bool multipart = accept && strncmp(accept, "multipart/", 10) == 0;
+    if (v)
+    {
+        if (strcmp(v, "ndjson") == 0) multipart = false;
+        else if (strcmp(v, "multipart") == 0) multipart = true;
+        else return send_error(connection, MHD_HTTP_BAD_REQUEST, "invalid query parameter: response");
+    }
+    // Cada linha NDJSON leva o documento JSON da imagem; CSV e binário só em partes multipart
+    if (!multipart && !MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "format"))
+        opt.format = FORMAT_JSON;
+    if (!multipart && opt.format != FORMAT_JSON)
+        return send_error(connection, MHD_HTTP_BAD_REQUEST,
+                          "NDJSON batches carry JSON documents: use format=json or response=multipart");
+
+    BatchJob *job = calloc(1, sizeof(*job));
+    if (!job)
+        return send_error(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, "out of memory");
+    const char *content_type = MHD_lookup_connection_value(connection, MHD_HEADER_KIND,
+                                                           MHD_HTTP_HEADER_CONTENT_TYPE);
+    if (!archive_parse(content_type, (const unsigned char *)up->block->data, up->len, BATCH_MAX_ITEMS, &job->list))
+    {
+        free(job);
+        char msg[320];
+        snprintf(msg, sizeof(msg), "invalid batch body: %s", engine_last_error());
+        return send_error(connection, MHD_HTTP_BAD_REQUEST, msg);
+    }
+    job->ext = ext;
+    job->out = opt;
+    job->multipart = multipart;
+    snprintf(job->boundary, sizeof(job->boundary), "flir2json-batch-%016llx",
+             (unsigned long long)(metrics_now() ^ (uintptr_t)job));
+    job->workers = server_workers ? server_workers : 1;
+    if (job->workers > job->list.count)
+        job->workers = (unsigned int)job->list.count;
+    job->connection = connection;
+    pthread_mutex_init(&job->lock, NULL);
+    // O corpo passa a ser do lote (os itens apontam para ele); a conexão não o devolve mais
+    job->body = up->block;
+    up->block = NULL;
+    job->contexts = calloc(job->workers, sizeof(*job->contexts));
+    job->docs = calloc(job->workers, sizeof(*job->docs));
+    for (unsigned int i = 0; job->docs && i < job->workers; ++i)
+        out_init_memory(&job->docs[i], 0);
+    job->timings = calloc(job->list.count, sizeof(*job->timings));
+
+    struct MHD_Response *response = MHD_create_response_from_callback(MHD_SIZE_UNKNOWN, JSON_CHUNK_BYTES,
+                                                                      &batch_reader, job, &batch_release);
+    if (!response)
+    {
+        batch_release(job);
+        return MHD_NO;
+    }
+    if (!job->contexts || !job->docs || !job->timings || pthread_create(&job->thread, NULL, batch_service, job) != 0)
+    {
+        MHD_destroy_response(response);
+        return send_error(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, "failed to start batch");
+    }
+    job->started = true;
+    char type[96];
+    snprintf(type, sizeof(type), "multipart/mixed; boundary=%s", job->boundary);
+    MHD_add_response_header(response, "Content-Type", multipart ? type : "application/x-ndjson");
+    enum MHD_Result ret = queue_response(connection, MHD_HTTP_OK, response, 0);
+    MHD_destroy_response(response);
+    return ret;
+}
+
+// GET /metrics: texto do Prometheus, somando os contadores de todas as threads
+static enum MHD_Result handle_metrics(struct MHD_Connection *connection)
+{
+    MetricsExtra extra = {
+        .workers = server_workers,
+        .cache_hits = atomic_load_explicit(&result_cache.hits, memory_order_relaxed),
+        .cache_disk_hits = atomic_load_explicit(&result_cache.disk_hits, memory_order_relaxed),
+        .cache_misses = atomic_load_explicit(&result_cache.misses, memory_order_relaxed),
+        .cache_capacity = result_cache.capacity,
+        .admission_pending = admission_pending(&admission),
+        .admission_depth = admission.depth,
+        .admission_per_client = admission.per_client,
+        .rejected_full = atomic_load_explicit(&admission.rejected_full, memory_order_relaxed),
+        .rejected_client = atomic_load_explicit(&admission.rejected_client, memory_order_relaxed),
+    };
+    if (cache_enabled(&result_cache))
+    {
+        pthread_mutex_lock(&result_cache.lock);
+        extra.cache_bytes = result_cache.bytes;
+        pthread_mutex_unlock(&result_cache.lock);
+    }
+    OutBuf out;
+    out_init_memory(&out, 16 * 1024);
+    metrics_render(&out, &extra);
+    if (out.failed)
+    {
+        out_free(&out);
+        return send_error(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, "out of memory");
+    }
+    return send_buffer(connection, MHD_HTTP_OK, "text/plain; version=0.0.4; charset=utf-8", out.data, out.len,
+                       MHD_RESPMEM_MUST_FREE);
+}
+
+// Opções de POST /jobs: as de /extract (mais format=delta) e frames=A:B[:S], keyframe=N
+static bool parse_job_query(struct MHD_Connection *connection, JobOptions *opt, const char **bad)
+{
+    memset(opt, 0, sizeof(*opt));
+    if (!parse_query(connection, &opt->extract, &opt->output, true, bad))
+        return false;
+    if (opt->output.format == FORMAT_ARROW)
+        return *bad = "format", false;
+    // Como no extrator, delta sai em u16 (centi-kelvin por padrão)
+    if (opt->output.format == FORMAT_DELTA)
+    {
+        opt->output.dtype = DTYPE_U16;
+        output_configure_extract(&opt->output, &opt->extract);
+    }
+    opt->frames = (FrameRange){ 0, SIZE_MAX, 1, NULL, 0 };
+    opt->keyframe = DELTA_DEFAULT_KEYFRAME;
+    const char *v;
+    if ((v = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "frames")) &&
+        !frame_range_parse(v, &opt->frames))
+        return *bad = "frames", false;
+    if ((v = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "keyframe")))
+    {
+        char *end;
+        long n = strtol(v, &end, 10);
+        if (*end || n < 1 || n > 100000)
+            return *bad = "keyframe", false;
+        opt->keyframe = (unsigned)n;
+    }
+    return true;
+}
+
+static bool job_upload_append(Upload *up, const char *data, size_t size)
 {
-    const char *response_text = "{\"status\":\"ok\",\"message\":\"FLIR JSON API is running!\"}";
-    struct MHD_Response *response;
-    int ret;
+    if (up->too_large || size > up->limit - up->len)
+    {
+        up->too_large = true;
+        return false;
+    }
+    if (!jobs_append(up->job, data, size))
+        return false;
+    up->len += size;
+    return true;
+}
 
-    response = MHD_create_response_from_buffer(strlen(response_text),
-                                               (void *)response_text,
-                                               MHD_RESPMEM_PERSISTENT);
+// Corpo completo: o job entra na fila e a resposta sai na hora (202 com o id)
+static enum MHD_Result handle_job_submit(struct MHD_Connection *connection, Upload *up)
+{
+    // Na fila o job pode terminar (e sair do registro) a qualquer momento: o id vai antes
+    char location[64], body[160];
+    snprintf(location, sizeof(location), "/jobs/%s", up->job->id);
+    int len = snprintf(body, sizeof(body), "{\"id\":\"%s\",\"state\":\"queued\",\"location\":\"%s\"}\n",
+                       up->job->id, location);
+    Job *job = up->job;
+    up->job = NULL;
+    if (!jobs_submit(&job_queue, job))
+        return send_error(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, engine_last_error());
+    struct MHD_Response *response = MHD_create_response_from_buffer((size_t)len, body, MHD_RESPMEM_MUST_COPY);
+    if (!response)
+        return MHD_NO;
     MHD_add_response_header(response, "Content-Type", "application/json");
-    ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
+    MHD_add_response_header(response, "Location", location);
+    enum MHD_Result ret = queue_response(connection, MHD_HTTP_ACCEPTED, response, (uint64_t)len);
     MHD_destroy_response(response);
+    return ret;
+}
+
+// GET /jobs/{id} (andamento) e GET /jobs/{id}/result (arquivo gerado, direto do disco)
+static enum MHD_Result handle_job(struct MHD_Connection *connection, const char *path)
+{
+    if (!jobs_enabled)
+        return send_error(connection, MHD_HTTP_NOT_FOUND, "job queue disabled (--max-jobs 0)");
+    char id[JOB_ID_LEN + 1];
+    size_t n = strspn(path, "0123456789abcdef");
+    bool result = strcmp(path + n, "/result") == 0;
+    if (n != JOB_ID_LEN || (path[n] && !result))
+        return send_error(connection, MHD_HTTP_NOT_FOUND, "unknown job");
+    memcpy(id, path, n);
+    id[n] = '\0';
+
+    if (!result)
+    {
+        OutBuf out;
+        out_init_memory(&out, 512);
+        if (!jobs_status_json(&job_queue, id, &out))
+        {
+            bool failed = out.failed;
+            out_free(&out);
+            return failed ? MHD_NO : send_error(connection, MHD_HTTP_NOT_FOUND, "unknown job");
+        }
+        return send_buffer(connection, MHD_HTTP_OK, "application/json", out.data, out.len, MHD_RESPMEM_MUST_FREE);
+    }
+
+    JobState state;
+    OutputFormat format;
+    char file[JOB_FILE_MAX];
+    if (!jobs_result(&job_queue, id, &state, &format, file, sizeof(file)))
+        return send_error(connection, MHD_HTTP_NOT_FOUND, "unknown job");
+    if (state != JOB_DONE)
+    {
+        char msg[64];
+        snprintf(msg, sizeof(msg), "job is %s", job_state_name(state));
+        return send_error(connection, MHD_HTTP_CONFLICT, msg);
+    }
+    int fd = open(file, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0)
+    {
+        if (fd >= 0)
+            close(fd);
+        return send_error(connection, MHD_HTTP_GONE, "job result no longer available");
+    }
+    // O MHD fecha o descritor ao destruir a resposta
+    struct MHD_Response *response = MHD_create_response_from_fd((uint64_t)st.st_size, fd);
+    if (!response)
+    {
+        close(fd);
+        return MHD_NO;
+    }
+    MHD_add_response_header(response, "Content-Type", output_content_type(format));
+    enum MHD_Result ret = queue_response(connection, MHD_HTTP_OK, response, (uint64_t)st.st_size);
+    MHD_destroy_response(response);
+    return ret;
+}
+
+static enum MHD_Result route_request(struct MHD_Connection *connection, const char *url, const char *method,
+                                     const char *upload_data, size_t *upload_data_size, void **con_cls)
+{
+    bool render = strcmp(url, "/render") == 0;
+    bool batch = strcmp(url, "/extract/batch") == 0;
+    bool jobs = strcmp(url, "/jobs") == 0;
+    bool metadata = strcmp(url, "/metadata") == 0;
+    if (render || batch || jobs || metadata || strcmp(url, "/extract") == 0)
+    {
+        if (strcmp(method, "POST") != 0)
+            return send_error(connection, MHD_HTTP_METHOD_NOT_ALLOWED, "use POST with the radiometric JPEG as body");
+
+        // Primeira chamada: só os cabeçalhos. Um Content-Length acima do limite, a fila cheia
+        // ou o cliente no limite são recusados antes de ler o corpo; senão, o buffer é
+        // reservado de uma vez
+        Upload *up = *con_cls;
+        if (!up)
+        {
+            const char *length = MHD_lookup_connection_value(connection, MHD_HEADER_KIND,
+                                                             MHD_HTTP_HEADER_CONTENT_LENGTH);
+            char *end;
+            unsigned long long declared = length ? strtoull(length, &end, 10) : 0;
+            if (length && (*end || end == length))
+                return send_error(connection, MHD_HTTP_BAD_REQUEST, "invalid Content-Length");
+            size_t limit = jobs ? JOBS_MAX_UPLOAD_BYTES : batch ? BATCH_MAX_UPLOAD_BYTES : MAX_UPLOAD_BYTES;
+            if (declared > limit)
+                return send_error(connection, MHD_HTTP_PAYLOAD_TOO_LARGE, "upload exceeds size limit");
+            // Opções do job validadas antes de gravar qualquer byte
+            JobOptions job_opt;
+            const char *bad;
+            if (jobs && !jobs_enabled)
+                return send_error(connection, MHD_HTTP_NOT_FOUND, "job queue disabled (--max-jobs 0)");
+            if (jobs && !parse_job_query(connection, &job_opt, &bad))
+            {
+                char msg[64];
+                snprintf(msg, sizeof(msg), "invalid query parameter: %s", bad);
+                return send_error(connection, MHD_HTTP_BAD_REQUEST, msg);
+            }
+            // Fila cheia ou cliente no limite: recusa já, antes de reservar o buffer
+            const union MHD_ConnectionInfo *info =
+                MHD_get_connection_info(connection, MHD_CONNECTION_INFO_CLIENT_ADDRESS);
+            AdmissionTicket ticket;
+            AdmissionVerdict verdict =
+                admission_enter(&admission, info ? info->client_addr : NULL, metrics_now(), &ticket);
+            if (verdict != ADMIT_OK)
+                return send_busy(connection, verdict);
+            if ((up = spare_uploads))
+                spare_uploads = up->next;
+            else if (!(up = malloc(sizeof(*up))))
+            {
+                admission_leave(&admission, &ticket, metrics_now());
+                return MHD_NO;
+            }
+            memset(up, 0, sizeof(*up));
+            up->ticket = ticket;
+            up->limit = limit;
+            up->started_ns = metrics_now();
+            metrics_request_started();
+            if (jobs && !(up->job = jobs_create(&job_queue, &job_opt)))
+            {
+                upload_release(up);
+                return send_error(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, engine_last_error());
+            }
+            if (declared && !up->job && !upload_reserve(up, (size_t)declared))
+            {
+                upload_release(up);
+                return send_error(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, "out of memory");
+            }
+            *con_cls = up;
+            return MHD_YES;
+        }
+        // Corpo em pedaços, copiados direto para a posição final: ao chegar o último,
+        // a imagem é decodificada do próprio buffer (openFromMemory) sem outra cópia
+        if (*upload_data_size)
+        {
+            bool ok = up->job ? job_upload_append(up, upload_data, *upload_data_size)
+                              : upload_append(up, upload_data, *upload_data_size);
+            *upload_data_size = 0;
+            if (ok)
+                return MHD_YES;
+            // Responde já, sem esperar o resto do corpo; o MHD descarta o que faltar
+            up->queued_ns = metrics_now();
+            if (up->too_large)
+                return send_error(connection, MHD_HTTP_PAYLOAD_TOO_LARGE, "upload exceeds size limit");
+            return send_error(connection, MHD_HTTP_INTERNAL_SERVER_ERROR,
+                              up->job ? "failed to store the sequence" : "out of memory");
+        }
+
+        metrics_observe(STAGE_UPLOAD, metrics_now() - up->started_ns);
+        enum MHD_Result ret = !up->len ? send_error(connection, MHD_HTTP_BAD_REQUEST, "empty request body")
+                            : render    ? handle_render(connection, up)
+                            : batch     ? handle_batch(connection, up)
+                            : jobs      ? handle_job_submit(connection, up)
+                            : metadata  ? handle_metadata(connection, up)
+                                        : handle_extract(connection, up);
+        up->queued_ns = metrics_now();
+        return ret;
+    }
+
+    if (strncmp(url, "/jobs/", 6) == 0)
+    {
+        if (strcmp(method, "GET") != 0)
+            return send_error(connection, MHD_HTTP_METHOD_NOT_ALLOWED, "use GET");
+        return handle_job(connection, url + 6);
+    }
+
+    if (strcmp(url, "/metrics") == 0)
+    {
+        if (strcmp(method, "GET") != 0)
+            return send_error(connection, MHD_HTTP_METHOD_NOT_ALLOWED, "use GET");
+        return handle_metrics(connection);
+    }
+
+    if (strcmp(url, "/live") == 0)
+    {
+        if (strcmp(method, "GET") != 0)
+            return send_error(connection, MHD_HTTP_METHOD_NOT_ALLOWED, "use GET");
+        return handle_live(connection);
+    }
 
+    if (strcmp(url, "/") == 0 || strcmp(url, "/health") == 0)
+    {
+        // Pronto só depois do aquecimento: antes disso, 503 para o balanceador esperar
+        if (!atomic_load(&server_ready))
+        {
+            const char *starting = "{\"status\":\"starting\",\"message\":\"warming up worker contexts\"}";
+            return send_buffer(connection, MHD_HTTP_SERVICE_UNAVAILABLE, "application/json", (void *)starting,
+                               strlen(starting), MHD_RESPMEM_PERSISTENT);
+        }
+        const char *response_text = "{\"status\":\"ok\",\"message\":\"FLIR JSON API is running!\"}";
+        return send_buffer(connection, MHD_HTTP_OK, "application/json", (void *)response_text,
+                           strlen(response_text), MHD_RESPMEM_PERSISTENT);
+    }
+
+    return send_error(connection, MHD_HTTP_NOT_FOUND, "not found");
+}
+
+// Tempo dentro do handler conta como ocupação da thread
+static enum MHD_Result handle_request(void *cls, struct MHD_Connection *connection,
+                                      const char *url, const char *method,
+                                      const char *version, const char *upload_data,
+                                      size_t *upload_data_size, void **con_cls)
+{
+    (void)cls;
+    (void)version;
+    uint64_t t0 = metrics_now();
+    enum MHD_Result ret = route_request(connection, url, method, upload_data, upload_data_size, con_cls);
+    metrics_busy(metrics_now() - t0);
     return ret;
 }
 
-int main()
+static void request_completed(void *cls, struct MHD_Connection *connection,
+                              void **con_cls, enum MHD_RequestTerminationCode toe)
+{
+    (void)cls;
+    (void)connection;
+    (void)toe;
+
+    Upload *up = *con_cls;
+    if (up)
+    {
+        if (up->queued_ns)
+            metrics_observe(STAGE_SEND, metrics_now() - up->queued_ns);
+        metrics_request_completed();
+        // Corpo interrompido: o job nunca entrou na fila
+        if (up->job)
+            jobs_discard(&job_queue, up->job);
+        upload_release(up);
+        *con_cls = NULL;
+    }
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Uso: %s [--live ip[,ip...]] [--ring N] [--drop new|latest] [--cache-mb N] [--cache-dir DIR]\n"
+            "       [--cache-dir-mb N] [--warmup imagem.jpg] [--jobs-dir DIR] [--max-jobs N] [--job-threads N] [--hotspots T]\n"
+            "       [--gzip-threads N] [--live-workers N] [--max-pending N] [--max-per-client N]\n"
+            "  --live IPs           recebe quadros das câmeras e publica em GET /live (SSE)\n"
+            "  --hotspots T         GET /live?kind=hotspots: regiões de cada quadro com t >= T °C\n"
+            "  --ring N             quadros na fila de cada câmera, potência de 2 (padrão 8)\n"
+            "  --drop new|latest    fila cheia: descarta o quadro novo (padrão) ou pula para o mais recente\n"
+            "  --live-workers N     threads fixadas em núcleos que dividem as câmeras (padrão: uma por núcleo)\n"
+            "  --cache-mb N         respostas de /extract guardadas em memória, em MiB (padrão %d; 0 desliga)\n"
+            "  --cache-dir DIR      também grava as respostas em DIR e as relê quando saem da memória\n"
+            "  --cache-dir-mb N     limite de DIR em MiB; passando dele, apaga as respostas usadas há\n"
+            "                       mais tempo (padrão %d; 0: sem limite)\n"
+            "  --warmup ARQUIVO     JPEG radiométrico do aquecimento (padrão: quadro sintético %dx%d);\n"
+            "                       /health responde 503 até cada thread ter um contexto pronto\n"
+            "  --jobs-dir DIR       sequências e resultados de POST /jobs (padrão %s)\n"
+            "  --max-jobs N         jobs de sequência rodando ao mesmo tempo (padrão 1; 0 desliga /jobs)\n"
+            "  --job-threads N      threads de decodificação por job, em prioridade baixa\n"
+            "                       (padrão: metade dos núcleos)\n"
+            "  --gzip-threads N     threads que comprimem as respostas para clientes com\n"
+            "                       Accept-Encoding: gzip (padrão %d; 0 desliga)\n"
+            "  --max-pending N      requisições com corpo admitidas ao mesmo tempo, do upload ao fim\n"
+            "                       da resposta; além disso, 503 com Retry-After sem ler o corpo\n"
+            "                       (padrão: %d por thread; 0 desliga)\n"
+            "  --max-per-client N   requisições simultâneas de um mesmo IP; além disso, 429 com\n"
+            "                       Retry-After (padrão: uma por thread; 0 desliga)\n",
+            prog, CACHE_DEFAULT_MB, CACHE_DIR_DEFAULT_MB, WARMUP_WIDTH, WARMUP_HEIGHT, JOBS_DEFAULT_DIR, COMPRESS_DEFAULT_THREADS,
+            ADMISSION_DEFAULT_DEPTH);
+}
+
+int main(int argc, char **argv)
 {
     struct MHD_Daemon *daemon;
+    unsigned int workers = pool_default_workers();
+    char *live = NULL;
+    size_t ring = LIVE_DEFAULT_RING;
+    LiveDropPolicy policy = LIVE_DROP_NEW;
+    unsigned int live_workers = 0;
+    size_t cache_mb = CACHE_DEFAULT_MB;
+    const char *cache_dir = NULL;
+    size_t cache_dir_mb = CACHE_DIR_DEFAULT_MB;
+    const char *warmup = NULL;
+    const char *jobs_dir = JOBS_DEFAULT_DIR;
+    unsigned int max_jobs = 1, job_threads = workers > 1 ? workers / 2 : 1;
+    unsigned int gzip_threads = COMPRESS_DEFAULT_THREADS;
+    long max_pending = -1, max_per_client = -1; // -1: padrão, proporcional às threads
+    for (int i = 1; i < argc; ++i)
+    {
+        const char *val = i + 1 < argc ? argv[i + 1] : NULL;
+        bool ok = val != NULL;
+        if (ok && strcmp(argv[i], "--live") == 0) live = argv[i + 1];
+        else if (ok && strcmp(argv[i], "--drop") == 0) ok = live_drop_parse(val, &policy);
+        else if (ok && strcmp(argv[i], "--ring") == 0)
+        {
+            char *end;
+            long n = strtol(val, &end, 10);
+            ok = !*end && n >= 2 && n <= 1024 && !(n & (n - 1));
+            ring = (size_t)n;
+        }
+        else if (ok && strcmp(argv[i], "--live-workers") == 0)
+        {
+            char *end;
+            long n = strtol(val, &end, 10);
+            ok = !*end && n >= 1 && n <= POOL_MAX_WORKERS;
+            live_workers = (unsigned int)n;
+        }
+        else if (ok && strcmp(argv[i], "--cache-mb") == 0)
+        {
+            char *end;
+            long n = strtol(val, &end, 10);
+            ok = !*end && n >= 0 && n <= 1 << 20;
+            cache_mb = (size_t)n;
+        }
+        else if (ok && strcmp(argv[i], "--cache-dir-mb") == 0)
+        {
+            char *end;
+            long n = strtol(val, &end, 10);
+            ok = !*end && n >= 0 && n <= 1 << 30;
+            cache_dir_mb = (size_t)n;
+        }
+        else if (ok && strcmp(argv[i], "--cache-dir") == 0)
+        {
+            cache_dir = val;
+            ok = access(val, W_OK) == 0;
+        }
+        else if (ok && strcmp(argv[i], "--warmup") == 0)
+        {
+            warmup = val;
+            ok = access(val, R_OK) == 0;
+        }
+        else if (ok && strcmp(argv[i], "--hotspots") == 0)
+        {
+            char *end;
+            live_hotspots = (HotspotOptions){ true, strtod(val, &end), 1 };
+            ok = !*end && end != val && live_hotspots.threshold == live_hotspots.threshold;
+        }
+        else if (ok && strcmp(argv[i], "--jobs-dir") == 0) jobs_dir = val;
+        else if (ok && strcmp(argv[i], "--max-jobs") == 0)
+        {
+            char *end;
+            long n = strtol(val, &end, 10);
+            ok = !*end && n >= 0 && n <= POOL_MAX_WORKERS;
+            max_jobs = (unsigned int)n;
+        }
+        else if (ok && strcmp(argv[i], "--job-threads") == 0)
+        {
+            char *end;
+            long n = strtol(val, &end, 10);
+            ok = !*end && n >= 1 && n <= POOL_MAX_WORKERS;
+            job_threads = (unsigned int)n;
+        }
+        else if (ok && strcmp(argv[i], "--gzip-threads") == 0)
+        {
+            char *end;
+            long n = strtol(val, &end, 10);
+            ok = !*end && n >= 0 && n <= POOL_MAX_WORKERS;
+            gzip_threads = (unsigned int)n;
+        }
+        else if (ok && strcmp(argv[i], "--max-pending") == 0)
+        {
+            char *end;
+            max_pending = strtol(val, &end, 10);
+            ok = !*end && end != val && max_pending >= 0 && max_pending <= 1 << 20;
+        }
+        else if (ok && strcmp(argv[i], "--max-per-client") == 0)
+        {
+            char *end;
+            max_per_client = strtol(val, &end, 10);
+            ok = !*end && end != val && max_per_client >= 0 && max_per_client <= 1 << 20;
+        }
+        else ok = false;
+        if (!ok)
+        {
+            usage(argv[0]);
+            return 1;
+        }
+        ++i;
+    }
+
+    // SIGINT/SIGTERM ficam bloqueados em todas as threads (herdam a máscara) e são
+    // esperados só pela principal, que encerra o processo (PID 1 no contêiner)
+    sigset_t stop_signals;
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    sigaddset(&stop_signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stop_signals, NULL);
+
+    if (!cache_init(&result_cache, cache_mb << 20, cache_dir, cache_dir_mb << 20))
+    {
+        fprintf(stderr, "❌ Failed to set up the cache hash key%s%s\n", cache_dir ? " in " : "",
+                cache_dir ? cache_dir : "");
+        return 1;
+    }
+    if (!compress_init(&compress_stage, gzip_threads))
+    {
+        fprintf(stderr, "❌ %s\n", engine_last_error());
+        return 1;
+    }
+    metrics_init();
+    server_workers = workers;
+    admission_init(&admission, max_pending < 0 ? ADMISSION_DEFAULT_DEPTH * workers : (unsigned int)max_pending,
+                   max_per_client < 0 ? workers : (unsigned int)max_per_client, workers);
 
-    printf("🚀 Starting FLIR JSON API on 0.0.0.0:%d...\n", PORT);
+    printf("🚀 Starting FLIR JSON API on 0.0.0.0:%d with %u worker threads...\n", PORT, workers);
 
-    daemon = MHD_start_daemon(MHD_USE_INTERNAL_POLLING_THREAD,
+    // Cada thread do pool tem seu próprio laço de eventos e atende as conexões
+    // do início ao fim, o que mantém o estado __thread coerente por requisição
+    // Suspensão: assinantes de /live esperam o próximo quadro fora do laço de eventos
+    daemon = MHD_start_daemon(MHD_USE_INTERNAL_POLLING_THREAD | MHD_USE_AUTO | MHD_ALLOW_SUSPEND_RESUME,
                               PORT,
                               NULL, NULL,
                               &handle_request, NULL,
+                              MHD_OPTION_THREAD_POOL_SIZE, workers,
+                              MHD_OPTION_NOTIFY_COMPLETED, &request_completed, NULL,
                               MHD_OPTION_END);
 
     if (daemon == NULL)
@@ -41,13 +2628,33 @@ int main()
         fprintf(stderr, "❌ Failed to start HTTP server.\n");
         return 1;
     }
+    if (max_jobs && !(jobs_enabled = jobs_init(&job_queue, jobs_dir, max_jobs, job_threads)))
+    {
+        fprintf(stderr, "❌ Failed to start the job queue: %s\n", engine_last_error());
+        MHD_stop_daemon(daemon);
+        return 1;
+    }
+    if (live && !live_start(live, ring, policy, live_workers))
+    {
+        fprintf(stderr, "❌ Failed to start live ingestion.\n");
+        MHD_stop_daemon(daemon);
+        return 1;
+    }
 
-    // Mantém o servidor ativo
-    while (1)
+    // O daemon já atende (o /health diz 503) enquanto os contextos são preparados
+    uint64_t t0 = metrics_now();
+    if (!warm_up(workers, warmup))
     {
-        sleep(60);
+        MHD_stop_daemon(daemon);
+        return 1;
     }
+    atomic_store(&server_ready, true);
+    printf("✅ Ready: %u worker contexts warmed in %.1f ms\n", workers, (double)(metrics_now() - t0) / 1e6);
+    fflush(stdout);
 
-    MHD_stop_daemon(daemon);
+    int sig;
+    sigwait(&stop_signals, &sig);
+    printf("🛑 %s received, shutting down\n", sig == SIGTERM ? "SIGTERM" : "SIGINT");
+    live_stop = 1;
     return 0;
 }